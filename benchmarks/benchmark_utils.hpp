@@ -0,0 +1,57 @@
+#pragma once
+
+#include "RISCV64_model.hpp"
+#include "synthetic_trace.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+
+namespace bench {
+    // generated traces are cached by size, so repetitions do not regenerate them
+    inline const std::string& synthetic_trace_text(size_t events) {
+        static std::map<size_t, std::string> cache;
+        auto it = cache.find(events);
+        if (it == cache.end()) {
+            SyntheticTraceConfig config;
+            config.events = events;
+            std::ostringstream out;
+            write_synthetic_trace(out, config, 0);
+            it = cache.emplace(events, out.str()).first;
+        }
+        return it->second;
+    }
+
+    inline std::string synthetic_trace_dir(size_t events, size_t harts) {
+        namespace fs = std::filesystem;
+        fs::path dir = fs::temp_directory_path() /
+            ("sc-trace-bench-" + std::to_string(events) + "x" + std::to_string(harts));
+        if (!fs::exists(dir)) {
+            SyntheticTraceConfig config;
+            config.events = events;
+            config.harts = harts;
+            write_synthetic_trace_dir(dir.string(), config);
+        }
+        return dir.string();
+    }
+
+    inline std::optional<std::string> env(const char* name) {
+        const char* value = std::getenv(name);
+        if (value == nullptr || *value == '\0') {
+            return std::nullopt;
+        }
+        return std::string(value);
+    }
+
+    class ModelDUT : public RISCV64Model {
+    public:
+        using RISCV64Model::RISCV64Model;
+        void load(const std::string& text) {
+            std::istringstream input(text);
+            init(input, "synthetic");
+        }
+    };
+}
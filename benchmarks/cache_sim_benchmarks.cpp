@@ -0,0 +1,35 @@
+#include "cache_sim.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+namespace {
+    // mostly sequential accesses over a working set with occasional random jumps
+    std::vector<CacheAccess> synthetic_accesses(size_t count, uint64_t working_set) {
+        std::mt19937_64 random(1);
+        std::vector<CacheAccess> res;
+        res.reserve(count);
+        uint64_t address = 0x80000000;
+        for (size_t i = 0; i < count; ++i) {
+            if (random() % 16 == 0) {
+                address = 0x80000000 + (random() % working_set & ~7ull);
+            } else {
+                address += 8;
+            }
+            res.push_back(CacheAccess{i, 0x1000 + (i % 64) * 4, address, 8, random() % 4 == 0});
+        }
+        return res;
+    }
+}
+
+static void BM_CacheSim(benchmark::State& state) {
+    const std::vector<std::vector<CacheAccess>> harts = {synthetic_accesses(1 << 22, state.range(0) << 10)};
+    auto config = CacheHierarchyConfig::parse("32k:8:64:plru,1m:16:64:lru");
+    for (auto _ : state) {
+        auto report = simulate_caches(harts, config);
+        benchmark::DoNotOptimize(report.l1[0].misses());
+    }
+    state.SetItemsProcessed(state.iterations() * harts[0].size());
+}
+BENCHMARK(BM_CacheSim)->Arg(16)->Arg(256)->Arg(4096)->Unit(benchmark::kMillisecond);
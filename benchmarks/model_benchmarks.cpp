@@ -0,0 +1,100 @@
+#include "benchmark_utils.hpp"
+#include "trace_query.hpp"
+
+#include <benchmark/benchmark.h>
+
+static void BM_ModelInit(benchmark::State& state) {
+    const auto& text = bench::synthetic_trace_text(state.range(0));
+    for (auto _ : state) {
+        bench::ModelDUT model;
+        model.load(text);
+        benchmark::DoNotOptimize(model.read_pc());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ModelInit)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_ModelInitPaged(benchmark::State& state) {
+    const auto& text = bench::synthetic_trace_text(state.range(0));
+    for (auto _ : state) {
+        bench::ModelDUT model(std::make_unique<PagedTraceStore>());
+        model.load(text);
+        benchmark::DoNotOptimize(model.read_pc());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ModelInitPaged)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_StepForward(benchmark::State& state) {
+    bench::ModelDUT model;
+    model.load(bench::synthetic_trace_text(state.range(0)));
+    size_t steps = 0;
+    for (auto _ : state) {
+        if (!model.step_forward()) {
+            state.PauseTiming();
+            while (model.step_back()) {}
+            state.ResumeTiming();
+        }
+        ++steps;
+    }
+    state.SetItemsProcessed(steps);
+}
+BENCHMARK(BM_StepForward)->RangeMultiplier(100)->Range(1000, 1000000);
+
+static void BM_StepBack(benchmark::State& state) {
+    bench::ModelDUT model;
+    model.load(bench::synthetic_trace_text(state.range(0)));
+    while (model.step_forward()) {}
+    size_t steps = 0;
+    for (auto _ : state) {
+        if (!model.step_back()) {
+            state.PauseTiming();
+            while (model.step_forward()) {}
+            state.ResumeTiming();
+        }
+        ++steps;
+    }
+    state.SetItemsProcessed(steps);
+}
+BENCHMARK(BM_StepBack)->RangeMultiplier(100)->Range(1000, 1000000);
+
+// reads at the end of the trace, where a lookup has the longest history to search
+static void BM_ReadMemoryDword(benchmark::State& state) {
+    bench::ModelDUT model;
+    model.load(bench::synthetic_trace_text(state.range(0)));
+    while (model.step_forward()) {}
+    const uint64_t sp = model.read_register(2);
+    uint64_t offset = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(model.read_memory_dword(sp - 2048 + offset));
+        offset = (offset + 8) % 4096;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReadMemoryDword)->RangeMultiplier(10)->Range(1000, 100000);
+
+static void BM_CountQuery(benchmark::State& state) {
+    bench::ModelDUT model;
+    model.load(bench::synthetic_trace_text(state.range(0)));
+    auto query = TraceQuery::parse("store pc 0x1000..0x80000000 sp >= 0x1000");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(count_events(model.trace_store(), query));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CountQuery)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+
+// the pc is never reached, so the whole trace is scanned
+static void BM_SetStatePcMiss(benchmark::State& state) {
+    bench::ModelDUT model;
+    model.load(bench::synthetic_trace_text(state.range(0)));
+    for (auto _ : state) {
+        try {
+            model.set_state_pc(1);
+        } catch (const NoSuchPcException&) {
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SetStatePcMiss)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,21 @@
+#include "benchmark_utils.hpp"
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+static void BM_TraceLineParse(benchmark::State& state) {
+    std::vector<std::string> lines;
+    std::istringstream input(bench::synthetic_trace_text(state.range(0)));
+    for (std::string line; std::getline(input, line);) {
+        lines.push_back(line);
+    }
+    for (auto _ : state) {
+        for (const auto& line : lines) {
+            TraceLine trace_line(line);
+            benchmark::DoNotOptimize(trace_line);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BM_TraceLineParse)->RangeMultiplier(10)->Range(1000, 100000);
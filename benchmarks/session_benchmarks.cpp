@@ -0,0 +1,100 @@
+#include "benchmark_utils.hpp"
+#include "debug_info_provider.hpp"
+#include "session.hpp"
+
+#include <benchmark/benchmark.h>
+
+static void run_all_on(benchmark::State& state, const std::string& dir, const TraceStorageConfig& config) {
+    DebugSessionFactory factory(config);
+    size_t events = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        DebugSession session = factory.create_session(dir);
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(session.run_all());
+        state.PauseTiming();
+        for (const auto& hart : session.get_harts()) {
+            while (hart->step_back()) {
+                ++events;
+            }
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(events);
+}
+
+static void BM_RunAll(benchmark::State& state) {
+    run_all_on(state, bench::synthetic_trace_dir(state.range(0), state.range(1)), TraceStorageConfig());
+}
+BENCHMARK(BM_RunAll)->ArgsProduct({{10000, 1000000}, {1, 4}})->Unit(benchmark::kMillisecond);
+
+// SC_TRACE_BENCH_DIR points to a large directory made by sc-trace-gen,
+// SC_TRACE_BENCH_BUDGET_MB switches it to paged storage
+static void BM_RunAllExternal(benchmark::State& state) {
+    auto dir = bench::env("SC_TRACE_BENCH_DIR");
+    if (!dir) {
+        state.SkipWithError("SC_TRACE_BENCH_DIR is not set");
+        return;
+    }
+    TraceStorageConfig config;
+    if (auto budget = bench::env("SC_TRACE_BENCH_BUDGET_MB")) {
+        config.paged = true;
+        config.paged_config.memory_budget = std::stoull(budget.value()) << 20;
+    }
+    run_all_on(state, dir.value(), config);
+}
+BENCHMARK(BM_RunAllExternal)->Unit(benchmark::kMillisecond)->Iterations(1);
+
+// a 4 KiB stack dump at the end of the trace, read at once or dword by dword
+static void BM_SessionReadMemoryRange(benchmark::State& state) {
+    DebugSession session = DebugSessionFactory().create_session(bench::synthetic_trace_dir(100000, 1));
+    while (session->step_forward()) {}
+    const uint64_t base = (session->read_register(2) - 2048) & ~0x7ULL;
+    session.memory_view();
+    for (auto _ : state) {
+        if (state.range(0)) {
+            benchmark::DoNotOptimize(session.read_memory_range(base, 4096));
+        } else {
+            for (uint64_t offset = 0; offset < 4096; offset += 8) {
+                benchmark::DoNotOptimize(session.read_memory(base + offset, 8));
+            }
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * 4096);
+}
+BENCHMARK(BM_SessionReadMemoryRange)->Arg(0)->Arg(1);
+
+// SC_TRACE_BENCH_ELF must point to an ELF with DWARF line info
+static void BM_DebugInfoLineLookup(benchmark::State& state) {
+    auto elf = bench::env("SC_TRACE_BENCH_ELF");
+    if (!elf) {
+        state.SkipWithError("SC_TRACE_BENCH_ELF is not set");
+        return;
+    }
+    DebugInfoProvider provider(elf.value(), "tests/");
+    uint64_t pc = 0;
+    size_t found = 0;
+    for (auto _ : state) {
+        try {
+            benchmark::DoNotOptimize(provider.get_line_by_pc(pc));
+            ++found;
+        } catch (const NoSuchLineException& e) {
+        }
+        pc = (pc + 4) & 0xffffff;
+    }
+    state.counters["found"] = found;
+}
+BENCHMARK(BM_DebugInfoLineLookup);
+
+static void BM_DebugInfoBuildMaps(benchmark::State& state) {
+    auto elf = bench::env("SC_TRACE_BENCH_ELF");
+    if (!elf) {
+        state.SkipWithError("SC_TRACE_BENCH_ELF is not set");
+        return;
+    }
+    for (auto _ : state) {
+        DebugInfoProvider provider(elf.value(), "tests/");
+        benchmark::DoNotOptimize(provider.empty());
+    }
+}
+BENCHMARK(BM_DebugInfoBuildMaps)->Unit(benchmark::kMillisecond);
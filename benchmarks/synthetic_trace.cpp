@@ -0,0 +1,276 @@
+#include "synthetic_trace.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    constexpr uint64_t CODE_BASE = 0x2000000;
+    constexpr uint64_t FUNCTIONS_BASE = CODE_BASE + 0x10000;
+    constexpr uint64_t FUNCTION_STRIDE = 0x400;
+    constexpr size_t MAIN_SLOTS = 256;
+    constexpr size_t FUNCTION_SLOTS = 64;
+    constexpr size_t FUNCTION_COUNT = 16;
+    constexpr uint64_t DATA_BASE = 0x10000000;
+    constexpr uint64_t HART_DATA_STRIDE = 0x100000;
+    constexpr size_t DATA_SLOTS = 512;
+    // the topmost data slots keep return addresses of functions, one per function
+    constexpr size_t RA_SLOTS_BEGIN = DATA_SLOTS - FUNCTION_COUNT;
+    constexpr uint8_t RA = 1;
+    constexpr uint8_t SP = 2;
+
+    enum class SlotKind {
+        SET_SP,
+        LOAD,
+        STORE,
+        ALU,
+        NOP,
+        CALL,
+        JUMP_BACK,
+        RETURN
+    };
+
+    struct Slot {
+        SlotKind kind;
+        uint32_t instr;
+        uint8_t rd = 0;
+        uint8_t rs = 0;
+        int32_t imm = 0;
+        uint64_t target = 0;
+    };
+
+    uint32_t encode_i(uint8_t opcode, uint8_t funct3, uint8_t rd, uint8_t rs1, int32_t imm) {
+        return ((imm & 0xfff) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+    }
+
+    uint32_t encode_s(uint8_t opcode, uint8_t funct3, uint8_t rs1, uint8_t rs2, int32_t imm) {
+        return (((imm >> 5) & 0x7f) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1f) << 7) | opcode;
+    }
+
+    uint32_t encode_lui(uint8_t rd, uint32_t upper) {
+        return (upper << 12) | (rd << 7) | 0x37;
+    }
+
+    int32_t sp_offset(size_t data_slot) {
+        return static_cast<int32_t>(data_slot * 8) - 2048;
+    }
+
+    uint32_t encode_jal(uint8_t rd, int32_t offset) {
+        uint32_t imm = offset;
+        return (((imm >> 20) & 1) << 31) | (((imm >> 1) & 0x3ff) << 21) | (((imm >> 11) & 1) << 20) |
+            (((imm >> 12) & 0xff) << 12) | (rd << 7) | 0x6f;
+    }
+
+    class Program {
+        std::vector<Slot> main_slots;
+        std::vector<std::vector<Slot>> functions;
+
+        Slot random_slot(std::mt19937_64& rng, const SyntheticTraceConfig& config) {
+            std::uniform_real_distribution<double> kind_dist(0.0, 1.0);
+            std::uniform_int_distribution<int> reg_dist(5, 31);
+            std::uniform_int_distribution<int> offset_dist(0, RA_SLOTS_BEGIN - 1);
+            std::uniform_int_distribution<int> imm_dist(-64, 64);
+            Slot slot;
+            double r = kind_dist(rng);
+            if (r < config.load_ratio) {
+                slot.kind = SlotKind::LOAD;
+                slot.rd = reg_dist(rng);
+                slot.imm = sp_offset(offset_dist(rng));
+                slot.instr = encode_i(0x03, 3, slot.rd, SP, slot.imm);
+            } else if (r < config.load_ratio + config.store_ratio) {
+                slot.kind = SlotKind::STORE;
+                slot.rs = reg_dist(rng);
+                slot.imm = sp_offset(offset_dist(rng));
+                slot.instr = encode_s(0x23, 3, SP, slot.rs, slot.imm);
+            } else if (r < config.load_ratio + config.store_ratio + config.reg_write_ratio) {
+                slot.kind = SlotKind::ALU;
+                slot.rd = reg_dist(rng);
+                slot.rs = reg_dist(rng);
+                slot.imm = imm_dist(rng);
+                slot.instr = encode_i(0x13, 0, slot.rd, slot.rs, slot.imm);
+            } else {
+                slot.kind = SlotKind::NOP;
+                slot.instr = encode_i(0x13, 0, 0, 0, 0);
+            }
+            return slot;
+        }
+
+        static Slot ra_slot(SlotKind kind, size_t function_id) {
+            Slot slot;
+            slot.kind = kind;
+            slot.imm = sp_offset(RA_SLOTS_BEGIN + function_id);
+            if (kind == SlotKind::STORE) {
+                slot.rs = RA;
+                slot.instr = encode_s(0x23, 3, SP, RA, slot.imm);
+            } else {
+                slot.rd = RA;
+                slot.instr = encode_i(0x03, 3, RA, SP, slot.imm);
+            }
+            return slot;
+        }
+
+        // callees always have a greater index than the caller, so there is no recursion.
+        // Inside functions every call is followed by a reload of ra saved in the prologue.
+        void place_calls(std::vector<Slot>& slots, uint64_t slots_base, std::optional<size_t> caller,
+                         std::mt19937_64& rng, const SyntheticTraceConfig& config) {
+            size_t first_callee = caller ? caller.value() + 1 : 0;
+            if (first_callee >= FUNCTION_COUNT) {
+                return;
+            }
+            std::uniform_real_distribution<double> call_dist(0.0, 1.0);
+            std::uniform_int_distribution<size_t> callee_dist(first_callee, FUNCTION_COUNT - 1);
+            for (size_t i = 1; i + 2 < slots.size(); ++i) {
+                if (call_dist(rng) >= config.call_ratio) {
+                    continue;
+                }
+                Slot& slot = slots[i];
+                slot.kind = SlotKind::CALL;
+                slot.target = FUNCTIONS_BASE + callee_dist(rng) * FUNCTION_STRIDE;
+                slot.instr = encode_jal(RA, slot.target - (slots_base + i * 4));
+                if (caller) {
+                    slots[++i] = ra_slot(SlotKind::LOAD, caller.value());
+                }
+            }
+        }
+    public:
+        Program(const SyntheticTraceConfig& config, uint64_t seed) {
+            std::mt19937_64 rng(seed);
+            for (size_t i = 0; i < MAIN_SLOTS; ++i) {
+                main_slots.push_back(random_slot(rng, config));
+            }
+            main_slots.front().kind = SlotKind::SET_SP;
+            main_slots.back().kind = SlotKind::JUMP_BACK;
+            main_slots.back().instr = encode_jal(0, -static_cast<int32_t>((MAIN_SLOTS - 1) * 4));
+            place_calls(main_slots, CODE_BASE, std::nullopt, rng, config);
+            for (size_t f = 0; f < FUNCTION_COUNT; ++f) {
+                std::vector<Slot> body;
+                for (size_t i = 0; i < FUNCTION_SLOTS; ++i) {
+                    body.push_back(random_slot(rng, config));
+                }
+                body.front() = ra_slot(SlotKind::STORE, f);
+                body.back().kind = SlotKind::RETURN;
+                body.back().instr = encode_i(0x67, 0, 0, RA, 0);
+                place_calls(body, FUNCTIONS_BASE + f * FUNCTION_STRIDE, f, rng, config);
+                functions.emplace_back(std::move(body));
+            }
+        }
+
+        const Slot& at(uint64_t pc) const {
+            if (pc < FUNCTIONS_BASE) {
+                return main_slots[(pc - CODE_BASE) / 4];
+            }
+            uint64_t offset = pc - FUNCTIONS_BASE;
+            return functions[offset / FUNCTION_STRIDE][(offset % FUNCTION_STRIDE) / 4];
+        }
+    };
+
+    class TraceWriter {
+        std::ostream& out;
+        std::vector<char> buffer;
+        size_t used = 0;
+    public:
+        explicit TraceWriter(std::ostream& out_stream) : out(out_stream), buffer(1 << 20) {}
+        void write(uint64_t time, uint64_t pc, uint32_t instr, uint64_t next_pc, int reg, uint64_t value) {
+            if (buffer.size() - used < 128) {
+                flush();
+            }
+            int len = std::snprintf(buffer.data() + used, buffer.size() - used,
+                "%20llu %11d N %016llx %08x %016llx",
+                static_cast<unsigned long long>(time), 0,
+                static_cast<unsigned long long>(pc), instr,
+                static_cast<unsigned long long>(next_pc));
+            used += len;
+            if (reg > 0) {
+                len = std::snprintf(buffer.data() + used, buffer.size() - used,
+                    " x%d=%016llx", reg, static_cast<unsigned long long>(value));
+                used += len;
+            }
+            buffer[used++] = '\n';
+        }
+        void flush() {
+            out.write(buffer.data(), used);
+            used = 0;
+        }
+        ~TraceWriter() {
+            flush();
+        }
+    };
+}
+
+void write_synthetic_trace(std::ostream& out, const SyntheticTraceConfig& config, size_t hart_id) {
+    // harts run the same program on their own data, with different timing
+    Program program(config, config.seed);
+    std::mt19937_64 rng(config.seed * 7919 + hart_id);
+    std::uniform_int_distribution<int> stall_dist(0, 99);
+    uint64_t regs[32] = {0};
+    std::vector<uint64_t> data(DATA_SLOTS, 0);
+    const uint64_t sp_value = DATA_BASE + hart_id * HART_DATA_STRIDE + 0x1000;
+    const uint32_t set_sp_instr = encode_lui(SP, sp_value >> 12);
+    uint64_t pc = CODE_BASE;
+    uint64_t time = 1 + hart_id;
+    TraceWriter writer(out);
+    for (size_t event = 0; event < config.events; ++event) {
+        const Slot& slot = program.at(pc);
+        uint32_t instr = slot.instr;
+        uint64_t next_pc = pc + 4;
+        int reg = -1;
+        switch (slot.kind) {
+        case SlotKind::SET_SP:
+            instr = set_sp_instr;
+            reg = SP;
+            regs[SP] = sp_value;
+            break;
+        case SlotKind::LOAD: {
+            size_t index = (slot.imm + 2048) / 8;
+            reg = slot.rd;
+            regs[reg] = data[index];
+            break;
+        }
+        case SlotKind::STORE: {
+            size_t index = (slot.imm + 2048) / 8;
+            data[index] = regs[slot.rs];
+            break;
+        }
+        case SlotKind::ALU:
+            reg = slot.rd;
+            regs[reg] = regs[slot.rs] + slot.imm;
+            break;
+        case SlotKind::NOP:
+            break;
+        case SlotKind::CALL:
+            reg = RA;
+            regs[RA] = pc + 4;
+            next_pc = slot.target;
+            break;
+        case SlotKind::JUMP_BACK:
+            next_pc = CODE_BASE;
+            break;
+        case SlotKind::RETURN:
+            next_pc = regs[RA];
+            break;
+        }
+        writer.write(time, pc, instr, next_pc, reg, reg >= 0 ? regs[reg] : 0);
+        time += 1;
+        if (slot.kind == SlotKind::LOAD && stall_dist(rng) < 5) {
+            time += 20 + stall_dist(rng);
+        }
+        pc = next_pc;
+    }
+}
+
+void write_synthetic_trace_dir(const std::string& dir_path, const SyntheticTraceConfig& config) {
+    namespace fs = std::filesystem;
+    fs::create_directories(dir_path);
+    for (size_t hart = 0; hart < config.harts; ++hart) {
+        fs::path path = fs::path(dir_path) / ("trace_log_" + std::to_string(hart));
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("failed to create " + path.string());
+        }
+        write_synthetic_trace(out, config, hart);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Generates trace_log files of a random but fixed RV64I program: a main loop with
+// loads and stores relative to sp, register writing arithmetics, nops and calls into
+// leaf-ward functions. Every pc always holds the same instruction, register and memory
+// values stay consistent with the executed loads and stores.
+struct SyntheticTraceConfig {
+    size_t events = 1000000;
+    size_t harts = 1;
+    double load_ratio = 0.2;
+    double store_ratio = 0.1;
+    double reg_write_ratio = 0.5;
+    double call_ratio = 0.02;
+    uint64_t seed = 1;
+};
+
+void write_synthetic_trace(std::ostream& out, const SyntheticTraceConfig& config, size_t hart_id);
+
+void write_synthetic_trace_dir(const std::string& dir_path, const SyntheticTraceConfig& config);
@@ -0,0 +1,43 @@
+#include "synthetic_trace.hpp"
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Not enough arguments\n";
+        std::cerr << "Usage: sc-trace-gen <output dir> [--events N] [--harts N] [--loads ratio]"
+                     " [--stores ratio] [--reg-writes ratio] [--calls ratio] [--seed N]\n";
+        return 1;
+    }
+    SyntheticTraceConfig config;
+    try {
+        for (int i = 2; i + 1 < argc; i += 2) {
+            std::string option = argv[i];
+            std::string value = argv[i + 1];
+            if (option == "--events") {
+                config.events = std::stoull(value);
+            } else if (option == "--harts") {
+                config.harts = std::stoull(value);
+            } else if (option == "--loads") {
+                config.load_ratio = std::stod(value);
+            } else if (option == "--stores") {
+                config.store_ratio = std::stod(value);
+            } else if (option == "--reg-writes") {
+                config.reg_write_ratio = std::stod(value);
+            } else if (option == "--calls") {
+                config.call_ratio = std::stod(value);
+            } else if (option == "--seed") {
+                config.seed = std::stoull(value);
+            } else {
+                std::cerr << "Unknown option " << option << std::endl;
+                return 1;
+            }
+        }
+        write_synthetic_trace_dir(argv[1], config);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -1,15 +1,41 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <string_view>
 
 namespace RISCV64Decode {
 
+inline constexpr uint32_t OPCODE_MASK = 0b1111111;
+inline constexpr uint8_t LOAD_OPCODE = 0b0000011;
+inline constexpr uint8_t STORE_OPCODE = 0b0100011;
+inline constexpr uint8_t AMO_OPCODE = 0b0101111;
+inline constexpr uint8_t JAL_OPCODE = 0b1101111;
+inline constexpr uint8_t JALR_OPCODE = 0b1100111;
+
 enum class InstructionType {
     LOAD,
     STORE,
+    ATOMIC,
     UNSUPPORTED
 };
 
+// lr, sc and the amo operations of the A extension
+enum class AtomicOperation {
+    LR,
+    SC,
+    SWAP,
+    ADD,
+    XOR,
+    AND,
+    OR,
+    MIN,
+    MAX,
+    MINU,
+    MAXU
+};
+
 struct Instruction {
     InstructionType type;
     union Content {
@@ -26,9 +52,71 @@ struct Instruction {
             uint8_t rs1Index;
             uint8_t rs2Index;
         } storeContent;
+        // the address is rs1 without an offset, rd gets the old value or the sc result
+        struct AtomicContent {
+            AtomicOperation operation;
+            uint8_t size;
+            uint8_t rs1Index;
+            uint8_t rs2Index;
+            uint8_t rdIndex;
+            bool acquire;
+            bool release;
+        } atomicContent;
     } content;
 };
 
+// integer loads and stores, their compressed forms and the A extension
 Instruction decode(uint32_t instr);
 
+// value an atomic leaves in memory given rd after it and rs2; nothing for lr, a failed sc,
+// and an amo into x0 other than a swap, whose old value is not in the trace
+std::optional<uint64_t> atomic_stored_value(const Instruction::Content::AtomicContent& atomic, uint64_t rd_after, uint64_t rs2);
+
+// effect of a jump on the return address stack, following the link register hints of the ISA
+enum class ControlTransfer {
+    NONE,
+    CALL,
+    RETURN,
+    // jalr between the two link registers: returns and calls at once
+    RETURN_AND_CALL
+};
+
+// recognises jal, jalr and their compressed forms, other instructions give NONE
+ControlTransfer control_transfer(uint32_t instr);
+
+inline constexpr const char* abi_register_names[32] = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+    "fp", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+    "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+};
+
+// execution unit class of an instruction, compressed forms are classed as their expansions
+enum class InstructionClass {
+    ALU,
+    MUL,
+    DIV,
+    LOAD,
+    STORE,
+    BRANCH,
+    JUMP,
+    ATOMIC,
+    FLOAT,
+    CSR,
+    // fences, ecall, ebreak, xret and wfi
+    SYSTEM,
+    OTHER
+};
+
+inline constexpr size_t INSTRUCTION_CLASS_COUNT = static_cast<size_t>(InstructionClass::OTHER) + 1;
+
+inline constexpr const char* instruction_class_names[INSTRUCTION_CLASS_COUNT] = {
+    "alu", "mul", "div", "load", "store", "branch", "jump", "atomic", "float", "csr", "system", "other"
+};
+
+InstructionClass classify(uint32_t instr);
+
+// index of an integer register given as xN or by its ABI name
+std::optional<size_t> register_index(std::string_view name);
+
 }
@@ -1,71 +1,18 @@
 #pragma once
 
+#include "call_stack.hpp"
+#include "csr_index.hpp"
 #include "model.hpp"
 #include "session_memory.hpp"
+#include "trace_entry.hpp"
+#include "trace_store.hpp"
 
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <unordered_map>
 #include <vector>
 
-enum class RegType {
-    INT,
-    FLOAT
-};
-struct RegisterDescription {
-    size_t index;
-    RegType type;
-    bool operator==(const RegisterDescription& other) const {
-        return index == other.index && type == other.type;
-    }
-    bool operator!=(const RegisterDescription& other) const {
-        return !((*this) == other);
-    }
-};
-
-struct RegisterUpdateEvent {
-    RegisterDescription reg;
-    uint64_t val;
-    uint64_t prev;
-    RegisterUpdateEvent(const RegisterDescription& descr, uint64_t new_val, uint64_t prev_val = 0) :
-        reg(descr),
-        val(new_val),
-        prev(prev_val) {}
-};
-
-struct TraceLine {
-    uint64_t time;
-    int rsv1;
-    char rsv2;
-    uint64_t cur_pc;
-    uint32_t instr;
-    uint64_t next_pc;
-    std::optional<RegisterDescription> changed_reg = std::nullopt;
-    std::optional<uint64_t> new_reg_val = std::nullopt;
-    TraceLine() = default;
-    explicit TraceLine(const std::string& line);
-};
-
-struct TraceEntry {
-    uint64_t time;
-    uint64_t pc;
-    uint32_t instr;
-    std::optional<RegisterUpdateEvent> changed_reg = std::nullopt;
-    TraceEntry(const TraceLine& line, const IModel& model) :
-        time(line.time), 
-        pc(line.cur_pc),
-        instr(line.instr) {
-            if (line.changed_reg) {
-                changed_reg = RegisterUpdateEvent(
-                    line.changed_reg.value(),
-                    line.new_reg_val.value(),
-                    model.read_register(line.changed_reg.value().index)
-                    );                                             
-            }
-        }
-};
-
-
 class MisalignedAddressException : public std::runtime_error {
 public:
     MisalignedAddressException(uint64_t address, uint16_t size) :
@@ -76,31 +23,95 @@ public:
             std::to_string(size)) {}
 };
 
+// progress of RISCV64Model::init, read by other threads while it runs
+struct TraceLoadProgress {
+    std::atomic<size_t> lines_read = 0;
+    std::atomic<bool> cancelled = false;
+    TraceLoadProgress() = default;
+    // a model is only moved while nothing loads it
+    TraceLoadProgress(TraceLoadProgress&& other) :
+        lines_read(other.lines_read.load(std::memory_order_relaxed)),
+        cancelled(other.cancelled.load(std::memory_order_relaxed)) {}
+    TraceLoadProgress& operator=(TraceLoadProgress&& other) {
+        lines_read.store(other.lines_read.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        cancelled.store(other.cancelled.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+};
+
 class RISCV64Model : public IModel {
 protected:
     virtual void init(std::istream& trace_input, const std::string& filename);
-    std::vector<TraceEntry> trace_events;
+    // CSR trace of the hart, read after the events are loaded
+    void init_csrs(std::istream& csr_input, const std::string& filename);
+    // lines written to the traces after init, the call stack and CSR changes are extended with them.
+    // Returns the number of events added.
+    size_t append_trace(std::istream& trace_input);
+    void append_csrs(std::istream& csr_input, const std::string& filename);
+    std::unique_ptr<ITraceStore> trace_events;
+    CallStack calls;
+    CsrIndex csrs;
     std::shared_ptr<Memory> memory;
     size_t cur_event_id = 0;
     uint64_t integer_reg_array[32] = {0};
     uint64_t pc = 0;
+    // registers after the last event, appended events take their previous values from here
+    uint64_t tail_reg_array[32] = {0};
     size_t hart_id = 0;
     std::string trace_name;
+    TraceLoadConfig load_config;
+    TraceLoadErrors load_errors;
+    TraceLoadProgress load_progress;
+    void apply_event(const TraceEntry& event);
+    void report_load_errors() const;
 public:
+    RISCV64Model() : trace_events(std::make_unique<InMemoryTraceStore>()) {}
+    explicit RISCV64Model(std::unique_ptr<ITraceStore> store) : trace_events(std::move(store)) {}
     virtual void set_state_pc(uint64_t address) override;
     virtual bool step_forward() override;
     virtual bool step_back() override;
+    virtual void seek_event(size_t event_id) override;
+    virtual void seek_time(uint64_t time) override;
     virtual uint64_t read_register(size_t index) const override;
     virtual uint64_t read_pc() const override;
     virtual uint64_t cur_time() const override;
+    virtual size_t cur_event() const override {
+        return cur_event_id;
+    }
     virtual uint64_t read_register(const std::string& name) const override;
     virtual std::vector<std::pair<std::string, uint64_t>> get_all_regs() const override;
     virtual std::string description() const override {
         return "Basic RV64 model (" + trace_name + ')';
     }
+    virtual size_t event_count() const override {
+        return trace_events->size();
+    }
+    virtual const ITraceStore& trace_store() const override {
+        return *trace_events;
+    }
+    virtual const CallStack& call_stack() const override {
+        return calls;
+    }
+    virtual size_t memory_footprint() const override {
+        return trace_events->resident_bytes() + calls.memory_footprint() + csrs.memory_footprint();
+    }
     virtual uint64_t read_memory_dword(uint64_t address) const override;
     virtual uint32_t read_memory_word(uint64_t address) const override;
     virtual uint16_t read_memory_hword(uint64_t address) const override;
     virtual uint8_t read_memory_byte(uint64_t address) const override;
+    virtual std::vector<MemoryAccess> memory_accesses(size_t hart_id) const override;
+    const CsrIndex& csr_index() const {
+        return csrs;
+    }
+    size_t loaded_lines() const {
+        return load_progress.lines_read.load(std::memory_order_relaxed);
+    }
+    // makes a running init return early, the model is unusable after that
+    void cancel_loading() {
+        load_progress.cancelled.store(true, std::memory_order_relaxed);
+    }
+    const TraceLoadErrors& get_load_errors() const {
+        return load_errors;
+    }
     friend class DebugSessionFactory;
 };
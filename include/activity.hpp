@@ -0,0 +1,54 @@
+#pragma once
+
+#include "call_stack.hpp"
+#include "trace_store.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Activity of a hart over a time range. Stall is every time unit beyond the first between
+// an event and the one before it. Functions are the entry pcs of the executing call frames.
+struct ActivitySummary {
+    uint64_t instructions = 0;
+    uint64_t loads = 0;
+    uint64_t stores = 0;
+    uint64_t stall = 0;
+    // bit per hashed function, so that summaries of adjacent ranges merge by OR
+    std::array<uint64_t, 8> functions{};
+    void add_function(uint64_t entry_pc);
+    void merge(const ActivitySummary& other);
+    // distinct functions estimated by linear counting, exact while there are few
+    size_t function_estimate() const;
+};
+
+// Summaries of a hart over fixed time buckets, each level FANOUT times coarser than the one below.
+// A time range is combined from O(log n) nodes and the events of the partial buckets at its ends.
+class ActivityPyramid {
+    uint64_t origin = 0;
+    uint64_t bucket_width = 1;
+    std::vector<std::vector<ActivitySummary>> levels;
+    // first event of every base bucket, followed by the event count
+    std::vector<size_t> bucket_events;
+    ActivitySummary combine(size_t first_bucket, size_t end_bucket) const;
+public:
+    static constexpr size_t FANOUT = 8;
+    static constexpr size_t MAX_BUCKETS = 1 << 16;
+    // bucket width 0 chooses the narrowest one giving at most MAX_BUCKETS buckets
+    static ActivityPyramid build(const ITraceStore& store, const CallStack& stack, uint64_t width = 0);
+    // events with first_time <= time < end_time, the store and call stack must be those it was built from
+    ActivitySummary summarize(const ITraceStore& store, const CallStack& stack, uint64_t first_time, uint64_t end_time) const;
+    uint64_t start_time() const {
+        return origin;
+    }
+    size_t level_count() const {
+        return levels.size();
+    }
+    const std::vector<ActivitySummary>& level(size_t index) const {
+        return levels[index];
+    }
+    // time covered by one node of the level, nodes start at start_time()
+    uint64_t node_width(size_t index) const;
+    size_t memory_footprint() const;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class BreakConditionException : public std::runtime_error {
+public:
+    BreakConditionException(const std::string& message) : std::runtime_error("Break condition: " + message) {}
+};
+
+// Breakpoint condition compiled once into a stack machine program.
+// Operands: numbers, registers (x0-x31 or ABI names), pc, time, hart, hits
+// and memory reads byte[addr], hword[addr], word[addr], dword[addr].
+// Operators follow C precedence: ! ~ - * / % + - << >> < <= > >= == != & ^ | && ||,
+// all values are unsigned 64-bit.
+class BreakCondition {
+public:
+    enum class Op : uint8_t {
+        PUSH,
+        REG,
+        PC,
+        TIME,
+        HART,
+        HITS,
+        LOAD8,
+        LOAD16,
+        LOAD32,
+        LOAD64,
+        NOT,
+        NEG,
+        INV,
+        MUL,
+        DIV,
+        MOD,
+        ADD,
+        SUB,
+        SHL,
+        SHR,
+        LT,
+        LE,
+        GT,
+        GE,
+        EQ,
+        NE,
+        AND,
+        XOR,
+        OR,
+        // short circuit of && and ||: jump to operand keeping the top of the stack, or pop it
+        JUMP_IF_ZERO_OR_POP,
+        JUMP_IF_NONZERO_OR_POP,
+        // replace the top of the stack with 0 or 1
+        BOOL
+    };
+    struct Instruction {
+        Op op;
+        uint64_t operand = 0;
+    };
+    static constexpr size_t MAX_STACK = 32;
+    // parentheses, brackets and unary operators, each one recurses in the compiler
+    static constexpr size_t MAX_NESTING = 128;
+    using MemoryReader = std::function<uint64_t(uint64_t address, size_t size)>;
+private:
+    std::string text;
+    std::vector<Instruction> code;
+public:
+    explicit BreakCondition(const std::string& expression);
+    // memory is read from the model when no reader is given
+    bool evaluate(const IModel& model, size_t hart_id, uint64_t hits, const MemoryReader* memory = nullptr) const;
+    const std::string& source() const {
+        return text;
+    }
+    const std::vector<Instruction>& program() const {
+        return code;
+    }
+};
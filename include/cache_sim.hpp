@@ -0,0 +1,114 @@
+#pragma once
+
+#include "trace_store.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CacheSimException : public std::runtime_error {
+public:
+    CacheSimException(const std::string& message) : std::runtime_error("Cache simulator: " + message) {}
+};
+
+enum class ReplacementPolicy {
+    LRU,
+    FIFO,
+    RANDOM,
+    // tree pseudo-LRU
+    PLRU
+};
+
+struct CacheConfig {
+    size_t size;
+    size_t ways;
+    size_t line_size;
+    ReplacementPolicy policy = ReplacementPolicy::LRU;
+    // <size>[k|m]:<ways>:<line size>[:lru|fifo|random|plru], e.g. 32k:8:64:plru
+    static CacheConfig parse(const std::string& spec);
+    std::string to_string() const;
+};
+
+// L1 data cache of every hart and an optional L2, private to every hart or shared by all
+struct CacheHierarchyConfig {
+    CacheConfig l1;
+    std::optional<CacheConfig> l2;
+    bool shared_l2 = false;
+    // <l1>[,<l2>[,shared]], e.g. 32k:8:64:lru,1m:16:64:plru,shared
+    static CacheHierarchyConfig parse(const std::string& spec);
+    std::string to_string() const;
+};
+
+// Set associative cache of line numbers, allocating on every miss. Sizes and ways must be powers of two.
+class Cache {
+    CacheConfig config;
+    unsigned line_shift;
+    uint64_t set_mask;
+    unsigned way_bits;
+    // line number of every way, INVALID when empty
+    std::vector<uint64_t> tags;
+    // last use for LRU, fill for FIFO
+    std::vector<uint64_t> stamps;
+    // tree bits of every set for PLRU, bit n is node n of the heap ordered tree
+    std::vector<uint64_t> tree;
+    uint64_t clock = 0;
+    uint64_t random_state = 0x9e3779b97f4a7c15;
+    size_t victim(size_t set);
+    void touch(size_t set, size_t way);
+public:
+    static constexpr uint64_t INVALID = ~0ull;
+    explicit Cache(const CacheConfig& cache_config);
+    unsigned line_bits() const {
+        return line_shift;
+    }
+    // returns true on a hit, fills the line on a miss
+    bool access(uint64_t line);
+};
+
+struct CacheAccess {
+    uint64_t time;
+    uint64_t pc;
+    uint64_t address;
+    uint8_t size;
+    bool is_store;
+};
+
+// loads, stores and atomics of the trace in order with their effective addresses, an amo is both
+std::vector<CacheAccess> collect_cache_accesses(const ITraceStore& store);
+
+struct CacheLevelStats {
+    // every line an access touches counts as an access of the level
+    uint64_t loads = 0;
+    uint64_t stores = 0;
+    uint64_t load_misses = 0;
+    uint64_t store_misses = 0;
+    std::unordered_map<uint64_t, uint64_t> pc_misses;
+    // misses by line address
+    std::unordered_map<uint64_t, uint64_t> line_misses;
+    uint64_t accesses() const {
+        return loads + stores;
+    }
+    uint64_t misses() const {
+        return load_misses + store_misses;
+    }
+};
+
+struct CacheSimReport {
+    CacheHierarchyConfig config;
+    std::vector<CacheLevelStats> l1;
+    // one entry per hart, or a single one for a shared L2
+    std::vector<CacheLevelStats> l2;
+};
+
+// accesses of every hart in time order; a shared L2 sees the misses of all harts interleaved by time
+CacheSimReport simulate_caches(const std::vector<std::vector<CacheAccess>>& harts, const CacheHierarchyConfig& config);
+
+// hit rates of every level and the pcs and lines with the most misses, resolve names a pc when it can
+void write_cache_report(std::ostream& out, const CacheSimReport& report, size_t top,
+                        const std::function<std::string(uint64_t pc)>& resolve = nullptr);
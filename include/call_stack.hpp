@@ -0,0 +1,56 @@
+#pragma once
+
+#include "trace_store.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct CallFrame {
+    static constexpr uint32_t NO_FRAME = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t NO_EVENT = std::numeric_limits<size_t>::max();
+    // NO_FRAME for the outermost frames, whose caller is not in the trace
+    uint32_t parent;
+    uint32_t depth;
+    // event of the call instruction in the parent frame, NO_EVENT for the outermost frames
+    size_t call_event;
+    uint64_t call_pc;
+    size_t entry_event;
+    uint64_t entry_pc;
+    // first event back in the caller, NO_EVENT if the frame is still open at the end of the trace
+    size_t return_event;
+};
+
+// Shadow call stack of a whole trace built in one pass over jal/jalr: a tree of frames
+// linked to their callers and the frame of every event, stored as the events where it changes.
+class CallStack {
+    std::vector<CallFrame> frames;
+    std::vector<size_t> change_events;
+    std::vector<uint32_t> change_frames;
+    size_t event_count = 0;
+    // frame of the last event, and what the event after it is owed when it has yet to be appended
+    uint32_t last_frame = CallFrame::NO_FRAME;
+    uint32_t pending_return = CallFrame::NO_FRAME;
+    bool pending_change = false;
+public:
+    static CallStack build(const ITraceStore& store);
+    // continues over the events appended to the store since the last build or extend
+    void extend(const ITraceStore& store);
+    size_t size() const {
+        return frames.size();
+    }
+    const CallFrame& frame(uint32_t frame_id) const {
+        return frames[frame_id];
+    }
+    // frame executing the event, found by binary search
+    uint32_t frame_at(size_t event_id) const;
+    // first event after event_id that runs in another frame, NO_EVENT when the frame lasts to the end
+    size_t frame_end(size_t event_id) const;
+    // frame of the event followed by its callers, innermost first
+    std::vector<uint32_t> backtrace(size_t event_id) const;
+    size_t memory_footprint() const {
+        return frames.capacity() * sizeof(CallFrame) +
+            change_events.capacity() * sizeof(size_t) + change_frames.capacity() * sizeof(uint32_t);
+    }
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "debug_info_provider.hpp"
+#include "session.hpp"
+#include "trace_store.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class CoverageException : public std::runtime_error {
+public:
+    CoverageException(const std::string& message) : std::runtime_error("Coverage: " + message) {}
+};
+
+// Executed pcs over a code range, one bit per 2 byte instruction slot
+class CoverageBitmap {
+    uint64_t first = 0;
+    uint64_t end = 0;
+    std::vector<uint64_t> words;
+public:
+    CoverageBitmap() = default;
+    CoverageBitmap(uint64_t first_pc, uint64_t end_pc);
+    uint64_t first_pc() const {
+        return first;
+    }
+    uint64_t end_pc() const {
+        return end;
+    }
+    bool contains(uint64_t pc) const {
+        return pc >= first && pc < end;
+    }
+    bool covered(uint64_t pc) const {
+        if (!contains(pc)) {
+            return false;
+        }
+        const uint64_t slot = (pc - first) >> 1;
+        return (words[slot >> 6] >> (slot & 63)) & 1;
+    }
+    // any pc of [first_pc, end_pc) covered
+    bool any_covered(uint64_t first_pc, uint64_t end_pc) const;
+    void mark(uint64_t pc);
+    // marks the pcs of all events in parallel, returns the number of events outside the range
+    size_t mark_trace(const ITraceStore& store);
+    // word-wide OR with a bitmap over the same range
+    void merge(const CoverageBitmap& other);
+    size_t count() const;
+};
+
+// marks the traces of all harts, returns the number of events outside the range
+size_t mark_session(CoverageBitmap& bitmap, DebugSession& session);
+
+struct FunctionCoverage {
+    std::string name;
+    size_t line;
+    bool hit;
+};
+
+struct FileCoverage {
+    std::string source_path;
+    // sorted by line number
+    std::vector<std::pair<size_t, bool>> lines;
+    std::vector<FunctionCoverage> functions;
+    size_t lines_hit = 0;
+    size_t functions_hit = 0;
+};
+
+// Files sorted by path. A line is hit when any of its addresses is covered,
+// a function when any instruction of its code range is. Functions are placed at the line of their entry.
+std::vector<FileCoverage> build_coverage_report(const CoverageBitmap& bitmap, const LineToAddrMap& lines,
+                                                const std::vector<FunctionInfo>& functions,
+                                                const std::function<const SourceLineSpec*(uint64_t pc)>& resolve);
+std::vector<FileCoverage> build_coverage_report(const CoverageBitmap& bitmap, const DebugInfoProvider& debug_info);
+
+// lcov tracefile, hit counts are 0 or 1
+void write_lcov(std::ostream& out, const std::vector<FileCoverage>& report, const std::string& test_name = "");
+void write_coverage_summary(std::ostream& out, const std::vector<FileCoverage>& report);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "trace_store.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CsrTraceException : public std::runtime_error {
+public:
+    CsrTraceException(const std::string& trace_name, size_t line_number) :
+        std::runtime_error("Malformed CSR trace line " + std::to_string(line_number) + " of " + trace_name) {}
+};
+
+class UnknownCsrValueException : public std::runtime_error {
+public:
+    UnknownCsrValueException(const std::string& name, size_t event_id) :
+        std::runtime_error("No value of " + name + " recorded before event " + std::to_string(event_id)) {}
+};
+
+struct CsrChange {
+    // number of hart events with time not after the change: it is visible once they are applied
+    size_t event_id;
+    uint64_t time;
+    uint64_t value;
+};
+
+// Sparse history of the CSRs of one hart, kept apart from the trace events as a sorted
+// change list per CSR. Lines of a CSR trace are "<time> <name>=<hex value> ...".
+class CsrIndex {
+    std::vector<std::string> csr_names;
+    std::unordered_map<std::string, size_t> csr_ids;
+    std::vector<std::vector<CsrChange>> csr_changes;
+    size_t skipped = 0;
+    size_t parsed_lines = 0;
+    struct PendingChange {
+        size_t csr_id;
+        CsrChange change;
+    };
+    void parse(std::istream& input, const std::string& trace_name, bool strict, std::vector<PendingChange>& pending);
+public:
+    // malformed lines are skipped unless strict
+    static CsrIndex load(std::istream& input, const std::string& trace_name, const ITraceStore& events,
+                         bool strict = false);
+    // adds lines written to the CSR trace after the load
+    void append(std::istream& input, const std::string& trace_name, const ITraceStore& events, bool strict = false);
+    // moves the changes placed after the last event to the events appended from first_new on
+    void events_appended(const ITraceStore& events, size_t first_new);
+    bool empty() const {
+        return csr_names.empty();
+    }
+    bool contains(const std::string& name) const {
+        return csr_ids.contains(name);
+    }
+    // in order of the first appearance in the trace
+    const std::vector<std::string>& names() const {
+        return csr_names;
+    }
+    const std::vector<CsrChange>& changes(const std::string& name) const;
+    // value after the first applied_events events, nullopt before the first recorded change
+    std::optional<uint64_t> read(const std::string& name, size_t applied_events) const;
+    size_t skipped_lines() const {
+        return skipped;
+    }
+    size_t memory_footprint() const;
+};
@@ -2,6 +2,7 @@
 
 #define LIBDWARF_STATIC
 
+#include <mutex>
 #include <string>
 #include <optional>
 #include <ostream>
@@ -66,6 +67,13 @@ struct VariableLocation {
     int64_t value;
 };
 
+// code range of a function, high_pc is the first address after it
+struct FunctionInfo {
+    std::string name;
+    uint64_t low_pc;
+    uint64_t high_pc;
+};
+
 struct VariableInfo {
     std::string name;
     std::string type_name;
@@ -89,9 +97,12 @@ private:
     Elf* elf_handler = nullptr;
     Dwarf_Debug dbg = nullptr;
     mutable Dwarf_Error err = nullptr;
+    mutable std::mutex dwarf_lock;
     LineToAddrMap line_addr_map;
     AddrToLineMap addr_line_map;
     TypeSizeMap type_size_map;
+    std::vector<FunctionInfo> function_list;
+    std::pair<uint64_t, uint64_t> text_address_range = {0, 0};
 public:
     DebugInfoProvider() = default;
     explicit DebugInfoProvider(const std::string& elf_path, const std::string& common_prefix = "");
@@ -102,7 +113,20 @@ public:
         return elf_fd == -1 && (!elf_handler) && (!dbg) && (!err);
     }
     const SourceLineSpec& get_line_by_pc(uint64_t pc) const;
+    // nullptr when the pc has no line
+    const SourceLineSpec* find_line_by_pc(uint64_t pc) const noexcept;
     const std::vector<uint64_t>& get_pc_by_line(const SourceLineSpec& line_spec) const;
     std::vector<VariableInfo> get_available_variables(uint64_t pc) const;
+    // lines without columns and their addresses
+    const LineToAddrMap& lines() const {
+        return line_addr_map;
+    }
+    const std::vector<FunctionInfo>& functions() const {
+        return function_list;
+    }
+    // [first, end) covering the executable sections, or the line table when there are none
+    std::pair<uint64_t, uint64_t> text_range() const {
+        return text_address_range;
+    }
     virtual ~DebugInfoProvider();
 };
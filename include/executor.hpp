@@ -5,6 +5,8 @@
 
 #include <iostream>
 #include <functional>
+#include <future>
+#include <memory>
 
 class UnsupportedCommandException : public std::runtime_error {
 public:
@@ -12,34 +14,59 @@ public:
 };
 
 class Executor {
+public:
+    // may still be loading in the background, commands that need it wait for it
+    using DebugInfoFuture = std::shared_future<std::shared_ptr<DebugInfoProvider>>;
+private:
     DebugSession session;
-    DebugInfoProvider debug_info;
+    DebugInfoFuture debug_info = ready(std::make_shared<DebugInfoProvider>());
     std::ostream* out = &std::cout;
     std::ostream* err = &std::cerr;
+    static DebugInfoFuture ready(std::shared_ptr<DebugInfoProvider> provider) {
+        std::promise<std::shared_ptr<DebugInfoProvider>> loaded;
+        loaded.set_value(std::move(provider));
+        return loaded.get_future().share();
+    }
 public:
     struct CommandParams {
         const std::string& args;
         std::ostream& out;
         std::ostream& err; 
         DebugSession& session;
-        DebugInfoProvider& debug_info_provider;
+        const DebugInfoFuture& debug_info;
         CommandParams(const std::string& args_, 
                  std::ostream& out_, 
                  std::ostream& err_,
                  DebugSession& session_,
-                 DebugInfoProvider& debug_info_provider_)
+                 const DebugInfoFuture& debug_info_)
         : args(args_),
           out(out_),
           err(err_),
           session(session_),
-          debug_info_provider(debug_info_provider_) {}
+          debug_info(debug_info_) {}
+        DebugInfoProvider& debug_info_provider() const {
+            return *debug_info.get();
+        }
     };
     using CommandObject = std::function<void(CommandParams)>;
+    // loads in the background, a failure is reported to err once and leaves the provider empty,
+    // so that commands run without line info and those needing it say that none is loaded
+    static DebugInfoFuture load_debug_info(const std::string& elf_path, const std::string& common_prefix, std::ostream& err);
     Executor() = default;
     Executor(DebugSession&& debug_session, DebugInfoProvider&& provider) :
+        session(std::move(debug_session)),
+        debug_info(ready(std::make_shared<DebugInfoProvider>(std::move(provider)))) {}
+    Executor(DebugSession&& debug_session, std::shared_ptr<DebugInfoProvider> provider) :
+        session(std::move(debug_session)),
+        debug_info(ready(std::move(provider))) {}
+    Executor(DebugSession&& debug_session, DebugInfoFuture provider) :
         session(std::move(debug_session)),
         debug_info(std::move(provider)) {}
     Executor(const Executor& other) = delete;
     Executor& operator=(const Executor& other) = delete;
+    void set_output(std::ostream& out_stream, std::ostream& err_stream) {
+        out = &out_stream;
+        err = &err_stream;
+    }
     void execute_command(const std::string& command);
 };
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "debug_info_provider.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct FarmJob {
+    size_t id;
+    std::string trace_dir;
+    std::string elf_path;
+    std::string script_path;
+};
+
+// one job per line: <trace dir> <elf> <script>, blank lines and lines starting with # are skipped
+std::vector<FarmJob> read_manifest(std::istream& manifest);
+
+// DWARF of an ELF shared by several tests is parsed once; the first job to request
+// it builds the provider, the rest wait on the same future
+class DebugInfoCache {
+public:
+    using Loader = std::function<std::shared_ptr<DebugInfoProvider>(const std::string& elf_path)>;
+    DebugInfoCache();
+    explicit DebugInfoCache(Loader elf_loader) : loader(std::move(elf_loader)) {}
+    // rethrows the load failure to every job of the ELF
+    std::shared_ptr<DebugInfoProvider> get(const std::string& elf_path);
+private:
+    Loader loader;
+    std::mutex lock;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<DebugInfoProvider>>> providers;
+};
+
+// writes whole result blocks, so that concurrent jobs never interleave
+class ResultWriter {
+    std::mutex lock;
+    std::ostream& out;
+public:
+    explicit ResultWriter(std::ostream& out_stream) : out(out_stream) {}
+    void write(const std::string& block);
+};
+
+// loads the traces without progress output and writes the script output between the test and status lines
+void run_job(const FarmJob& job, DebugInfoCache& debug_info_cache, ResultWriter& writer);
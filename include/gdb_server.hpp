@@ -0,0 +1,45 @@
+#pragma once
+
+#include "session.hpp"
+
+#include <stdexcept>
+#include <string>
+
+class GdbServerException : public std::runtime_error {
+public:
+    GdbServerException(const std::string& message) : std::runtime_error("gdb server: " + message) {}
+};
+
+// GDB remote serial protocol on top of DebugSession. Harts are exposed as threads
+// with ids starting from 1, the trace is read only, so only reads, breakpoints and
+// forward/reverse execution are supported.
+// Target is either a TCP port (bound to localhost), a unix socket path or "-" for stdin/stdout.
+class GdbServer {
+    DebugSession& session;
+    int in_fd = -1;
+    int out_fd = -1;
+    bool ack_mode = true;
+    std::string in_buffer;
+    bool read_char(char& c);
+    bool read_packet(std::string& packet);
+    void write_all(const std::string& data);
+    void send_packet(const std::string& payload);
+    std::string stop_reply(int signal, const std::string& reason = "") const;
+    std::string handle_packet(const std::string& packet, bool& detach);
+    std::string handle_query(const std::string& packet);
+    std::string read_registers() const;
+    std::string read_register(const std::string& args) const;
+    std::string read_memory(const std::string& args) const;
+    std::string set_thread(const std::string& args);
+    std::string breakpoint(const std::string& packet);
+    std::string resume(const std::string& packet);
+    std::string resume_actions(const std::string& packet);
+    void serve_connection();
+public:
+    explicit GdbServer(DebugSession& debug_session) : session(debug_session) {}
+    GdbServer(const GdbServer& other) = delete;
+    GdbServer& operator=(const GdbServer& other) = delete;
+    void serve(const std::string& target);
+    // serves one connection over already open descriptors, e.g. the ends of a socketpair
+    void serve(int input_fd, int output_fd);
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// string contents for a JSON string literal: quotes, backslashes and control characters are escaped
+std::string json_escape(std::string_view value);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "RISCV64_decode.hpp"
+#include "debug_info_provider.hpp"
+#include "session.hpp"
+#include "trace_store.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+// Retire time deltas of events in power of two buckets: bucket 0 holds delta 0, bucket b
+// deltas [2^(b-1), 2^b). Every time unit beyond the first of a delta counts as a stall.
+struct LatencyHistogram {
+    static constexpr size_t BUCKETS = 65;
+    std::array<uint64_t, BUCKETS> buckets{};
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t stall = 0;
+    uint64_t max = 0;
+    void add(uint64_t delta);
+    void merge(const LatencyHistogram& other);
+    double mean() const {
+        return count == 0 ? 0.0 : static_cast<double>(total) / count;
+    }
+    // upper bound of the bucket holding the given fraction of events
+    uint64_t percentile_bound(double fraction) const;
+};
+
+struct SiteLatency {
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t stall = 0;
+    uint64_t max = 0;
+    void add(uint64_t delta) {
+        ++count;
+        total += delta;
+        stall += delta > 1 ? delta - 1 : 0;
+        max = std::max(max, delta);
+    }
+    void merge(const SiteLatency& other) {
+        count += other.count;
+        total += other.total;
+        stall += other.stall;
+        max = std::max(max, other.max);
+    }
+};
+
+// The latency of an event is its time minus that of the previous event, or 0 when time goes back,
+// the first event has none
+struct HartLatency {
+    size_t events = 0;
+    uint64_t first_time = 0;
+    uint64_t last_time = 0;
+    LatencyHistogram all;
+    std::array<LatencyHistogram, RISCV64Decode::INSTRUCTION_CLASS_COUNT> classes;
+    std::unordered_map<uint64_t, SiteLatency> pcs;
+    uint64_t span() const {
+        return last_time > first_time ? last_time - first_time : 0;
+    }
+    // events retired per time unit
+    double ipc() const {
+        return span() == 0 ? 0.0 : static_cast<double>(events) / span();
+    }
+};
+
+// deltas are computed with vector instructions when supported, accumulation is scalar
+HartLatency analyze_latency(const ITraceStore& store);
+// harts in parallel
+std::vector<HartLatency> analyze_latency(DebugSession& session);
+
+// IPC and class histograms of every hart, then the pcs and, with debug info, source lines of all harts with the most stall
+void write_latency_report(std::ostream& out, const std::vector<HartLatency>& harts, size_t top,
+                          const DebugInfoProvider* debug_info = nullptr);
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "RISCV64_model.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Model of one hart that is loaded in the background or on its first use, whichever
+// comes first. Every call waits only for this hart and rethrows its load error.
+class LazyModel : public IModel {
+public:
+    using Loader = std::function<void(RISCV64Model& model)>;
+    LazyModel(std::unique_ptr<RISCV64Model> model, Loader loader, const std::string& name);
+    LazyModel(const LazyModel& other) = delete;
+    LazyModel& operator=(const LazyModel& other) = delete;
+    // cancels a load that is still running
+    ~LazyModel();
+    // loads on the calling thread unless another one already does
+    void load() const;
+    // task for a background thread, does nothing if the model is loaded or destroyed first
+    std::function<void()> load_task() const;
+    bool loaded() const {
+        return state->ready.load(std::memory_order_acquire);
+    }
+    // does not wait, e.g. "loading, 1200000 lines read"
+    std::string load_status() const;
+
+    virtual void set_state_pc(uint64_t address) override {
+        model().set_state_pc(address);
+    }
+    virtual bool step_forward() override {
+        return model().step_forward();
+    }
+    virtual bool step_back() override {
+        return model().step_back();
+    }
+    virtual void seek_event(size_t event_id) override {
+        model().seek_event(event_id);
+    }
+    virtual void seek_time(uint64_t time) override {
+        model().seek_time(time);
+    }
+    virtual uint64_t read_register(size_t index) const override {
+        return model().read_register(index);
+    }
+    virtual uint64_t read_pc() const override {
+        return model().read_pc();
+    }
+    virtual uint64_t cur_time() const override {
+        return model().cur_time();
+    }
+    virtual size_t cur_event() const override {
+        return model().cur_event();
+    }
+    virtual uint64_t read_register(const std::string& name) const override {
+        return model().read_register(name);
+    }
+    virtual std::vector<std::pair<std::string, uint64_t>> get_all_regs() const override {
+        return model().get_all_regs();
+    }
+    // shows the load status instead of waiting
+    virtual std::string description() const override;
+    virtual size_t event_count() const override {
+        return model().event_count();
+    }
+    virtual const ITraceStore& trace_store() const override {
+        return model().trace_store();
+    }
+    virtual const CallStack& call_stack() const override {
+        return model().call_stack();
+    }
+    virtual size_t memory_footprint() const override {
+        return model().memory_footprint();
+    }
+    virtual uint64_t read_memory_dword(uint64_t address) const override {
+        return model().read_memory_dword(address);
+    }
+    virtual uint32_t read_memory_word(uint64_t address) const override {
+        return model().read_memory_word(address);
+    }
+    virtual uint16_t read_memory_hword(uint64_t address) const override {
+        return model().read_memory_hword(address);
+    }
+    virtual uint8_t read_memory_byte(uint64_t address) const override {
+        return model().read_memory_byte(address);
+    }
+    virtual std::vector<MemoryAccess> memory_accesses(size_t hart_id) const override {
+        return model().memory_accesses(hart_id);
+    }
+private:
+    enum class Status {
+        PENDING,
+        LOADING,
+        READY,
+        FAILED
+    };
+    // shared with the background task, which may outlive the model
+    struct State {
+        std::mutex lock;
+        std::condition_variable done;
+        Status status = Status::PENDING;
+        std::atomic<bool> ready = false;
+        bool cancelled = false;
+        std::exception_ptr error;
+        std::unique_ptr<RISCV64Model> model;
+        Loader loader;
+        std::string name;
+        void load();
+    };
+    std::shared_ptr<State> state;
+    RISCV64Model& model() const {
+        if (!loaded()) {
+            load();
+        }
+        return *state->model;
+    }
+};
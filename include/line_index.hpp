@@ -0,0 +1,53 @@
+#pragma once
+
+#include "call_stack.hpp"
+#include "debug_info_provider.hpp"
+#include "trace_store.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <vector>
+
+// Source line of every event of a trace, stored as runs of consecutive events on one line.
+// Lines are told apart by file and line number, columns are ignored.
+class LineIndex {
+public:
+    static constexpr uint32_t NO_LINE = std::numeric_limits<uint32_t>::max();
+    // must be safe to call from several threads, nullptr for pcs without a line
+    using LineResolver = std::function<const SourceLineSpec*(uint64_t pc)>;
+    static LineIndex build(const ITraceStore& store, const LineResolver& resolve);
+    static LineIndex build(const ITraceStore& store, const DebugInfoProvider& debug_info);
+    size_t size() const {
+        return event_count;
+    }
+    size_t run_count() const {
+        return run_events.size();
+    }
+    // run containing the event, found by binary search
+    size_t run_at(size_t event_id) const;
+    size_t run_first_event(size_t run) const {
+        return run_events[run];
+    }
+    size_t run_end_event(size_t run) const {
+        return run + 1 < run_events.size() ? run_events[run + 1] : event_count;
+    }
+    uint32_t run_line(size_t run) const {
+        return run_lines[run];
+    }
+    const SourceLineSpec& line(uint32_t line_id) const {
+        return *lines[line_id];
+    }
+private:
+    std::vector<size_t> run_events;
+    std::vector<uint32_t> run_lines;
+    std::vector<const SourceLineSpec*> lines;
+    size_t event_count = 0;
+};
+
+// Events where source-level stepping from the given event stops, nullopt when the trace ends first.
+// next and prev skip over calls made from the frame of the event, step-line enters them.
+std::optional<size_t> next_line_event(const LineIndex& lines, const CallStack& calls, size_t event_id);
+std::optional<size_t> step_line_event(const LineIndex& lines, size_t event_id);
+std::optional<size_t> prev_line_event(const LineIndex& lines, const CallStack& calls, size_t event_id);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "RISCV64_decode.hpp"
+#include "debug_info_provider.hpp"
+#include "session.hpp"
+#include "trace_store.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <set>
+#include <vector>
+
+// Atomic access of a hart with its effective address and the register values around it.
+// loaded is rd after the event: the old memory value of lr and amo operations, the result of sc.
+struct AtomicAccess {
+    size_t event_id;
+    uint64_t time;
+    uint64_t pc;
+    uint64_t address;
+    RISCV64Decode::AtomicOperation operation;
+    uint64_t stored;
+    uint64_t loaded;
+};
+
+// atomic accesses of a hart in event order, addresses come from the registers before the access
+std::vector<AtomicAccess> collect_atomic_accesses(const ITraceStore& store);
+
+// Lock word transitions of a hart. An amoswap or amoor writing a nonzero value to a word holding
+// zero, or a successful sc of a nonzero value acquires it, writing zero by a store, amoswap,
+// amoand or sc releases it. A failed acquire attempt, a failed sc and a load or lr reading
+// a nonzero word while it is not held are spin iterations.
+struct LockEvent {
+    enum class Kind {
+        SPIN,
+        ACQUIRE,
+        RELEASE,
+        UPDATE
+    };
+    Kind kind;
+    size_t hart_id;
+    uint64_t time;
+    uint64_t pc;
+    uint64_t address;
+    // acquire: time since the first spin iteration before it, release: time since the acquire
+    uint64_t duration = 0;
+    // acquire: spin iterations before it
+    uint64_t spins = 0;
+};
+
+// lock events of a hart on the given words in event order, stores and loads of other words are ignored
+std::vector<LockEvent> collect_lock_events(const ITraceStore& store, size_t hart_id, const std::vector<AtomicAccess>& atomics,
+                                           const std::set<uint64_t>& addresses);
+
+struct LockHartStats {
+    uint64_t acquires = 0;
+    uint64_t contended_acquires = 0;
+    uint64_t spins = 0;
+    uint64_t wait = 0;
+    uint64_t max_wait = 0;
+    uint64_t hold = 0;
+    // amo operations other than acquires and releases, e.g. counters next to the lock
+    uint64_t updates = 0;
+    // spin iterations while another hart held the lock, by holder
+    std::map<size_t, uint64_t> blocked_by;
+};
+
+struct LockStats {
+    uint64_t address = 0;
+    // pc of the first acquire seen
+    uint64_t pc = 0;
+    std::map<size_t, LockHartStats> harts;
+    LockHartStats total() const;
+    // harts spinning on the lock
+    size_t contending_harts() const;
+};
+
+// merges the events of all harts on every word by time, ties go to the lower hart; words without
+// acquires and spins are dropped, the rest come by total wait descending
+std::vector<LockStats> merge_lock_events(const std::vector<std::vector<LockEvent>>& harts);
+// atomic accesses and lock events are collected for the harts in parallel, then merged
+std::vector<LockStats> analyze_locks(DebugSession& session);
+
+// the top locks by wait with their per hart breakdown, with debug info the acquire site is shown
+void write_lock_report(std::ostream& out, const std::vector<LockStats>& locks, size_t top,
+                       const DebugInfoProvider* debug_info = nullptr);
@@ -1,10 +1,15 @@
 #pragma once
 
+#include "session_memory.hpp"
+
 #include <istream>
 #include <stdexcept>
 #include <utility>
 #include <vector>
 
+class CallStack;
+class ITraceStore;
+
 class NoSuchPcException : public std::runtime_error {
 public:
     NoSuchPcException(uint64_t pc) : runtime_error(std::string("No record for pc=") + std::to_string(pc)) {}
@@ -20,15 +25,28 @@ public:
     virtual void set_state_pc(uint64_t address) = 0;
     virtual bool step_forward() = 0;
     virtual bool step_back() = 0;
+    // moves so that event_id is the next event to apply, or to the end of the trace
+    virtual void seek_event(size_t event_id) = 0;
+    // moves to the last event with time not after the given one, or to the first event
+    virtual void seek_time(uint64_t time) = 0;
     virtual uint64_t read_register(size_t index) const = 0;
     virtual uint64_t read_pc() const = 0;
     virtual uint64_t cur_time() const = 0;
+    // index of the next event to apply
+    virtual size_t cur_event() const = 0;
     virtual uint64_t read_register(const std::string& name) const = 0;
     virtual std::vector<std::pair<std::string, uint64_t>> get_all_regs() const = 0;
     virtual std::string description() const = 0;
+    virtual size_t event_count() const = 0;
+    virtual const ITraceStore& trace_store() const = 0;
+    virtual const CallStack& call_stack() const = 0;
+    // bytes of trace data currently held in memory
+    virtual size_t memory_footprint() const = 0;
     virtual ~IModel() = default;
     virtual uint64_t read_memory_dword(uint64_t address) const = 0;
     virtual uint32_t read_memory_word(uint64_t address) const = 0;
     virtual uint16_t read_memory_hword(uint64_t address) const = 0;
     virtual uint8_t read_memory_byte(uint64_t address) const = 0;
+    // loads and stores of the whole trace in event order
+    virtual std::vector<MemoryAccess> memory_accesses(size_t hart_id) const = 0;
 };
@@ -0,0 +1,73 @@
+#ifndef SCTRACE_H
+#define SCTRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* C ABI of libsctrace for bindings from other languages. Functions returning int give 0 on
+ * success and -1 on failure, functions returning pointers give NULL on failure;
+ * sctrace_last_error describes the last failure of the calling thread. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCTRACE_NO_REGISTER 0xff
+
+typedef struct sctrace_session sctrace_session;
+typedef struct sctrace_debug_info sctrace_debug_info;
+
+typedef struct {
+    int strict;
+    /* keeps the events on disk and pages them in within the budget when not 0 */
+    size_t memory_budget_mib;
+    /* NULL for the system temporary directory */
+    const char* spill_dir;
+} sctrace_options;
+
+/* events [first_event, first_event + size), the pointers are valid until the visitor returns */
+typedef struct {
+    uint64_t first_event;
+    size_t size;
+    const uint64_t* time;
+    const uint64_t* pc;
+    const uint32_t* instr;
+    /* SCTRACE_NO_REGISTER when the event writes no register */
+    const uint8_t* reg_index;
+    const uint8_t* reg_type;
+    const uint64_t* reg_value;
+    const uint64_t* reg_prev;
+} sctrace_columns;
+
+/* returns 0 to stop the visit */
+typedef int (*sctrace_visitor)(const sctrace_columns* columns, void* user_data);
+
+const char* sctrace_last_error(void);
+
+/* options may be NULL for the defaults */
+sctrace_session* sctrace_open(const char* trace_dir, const sctrace_options* options);
+void sctrace_close(sctrace_session* session);
+size_t sctrace_hart_count(const sctrace_session* session);
+int sctrace_event_count(const sctrace_session* session, size_t hart_id, size_t* count);
+int sctrace_visit(const sctrace_session* session, size_t hart_id, size_t first, size_t last,
+                  sctrace_visitor visitor, void* user_data);
+/* memory seen by the hart after its first applied_events events, bytes never accessed read as zero */
+int sctrace_read_memory(const sctrace_session* session, uint64_t address, size_t size, size_t hart_id,
+                        size_t applied_events, uint64_t* value);
+int sctrace_read_memory_range(const sctrace_session* session, uint64_t address, size_t length, size_t hart_id,
+                              size_t applied_events, uint8_t* out);
+
+sctrace_debug_info* sctrace_debug_info_open(const char* elf_path, const char* common_prefix);
+void sctrace_debug_info_close(sctrace_debug_info* debug_info);
+/* returns 1 and fills file (truncated to file_size) and line when the pc has a line, 0 when it has none */
+int sctrace_line_by_pc(const sctrace_debug_info* debug_info, uint64_t pc, char* file, size_t file_size,
+                       size_t* line);
+/* returns 1 and fills name, low_pc and high_pc when the pc is inside a function, 0 when it is not */
+int sctrace_function_by_pc(const sctrace_debug_info* debug_info, uint64_t pc, char* name, size_t name_size,
+                           uint64_t* low_pc, uint64_t* high_pc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Stable C++ API of libsctrace for tools that analyse traces without the CLI. Only this
+// header and sctrace.h are needed to use the library, the classes behind it may change.
+// Const methods may be called from several threads at once. Errors are thrown as
+// std::runtime_error.
+namespace sctrace {
+    constexpr uint8_t NO_REGISTER = 0xff;
+
+    // Events [first_event, first_event + size()) as views into the stored columns, nothing is copied
+    struct EventColumns {
+        size_t first_event;
+        std::span<const uint64_t> time;
+        std::span<const uint64_t> pc;
+        std::span<const uint32_t> instr;
+        // NO_REGISTER when the event writes no register
+        std::span<const uint8_t> reg_index;
+        // 0 for integer, 1 for floating point registers
+        std::span<const uint8_t> reg_type;
+        std::span<const uint64_t> reg_value;
+        std::span<const uint64_t> reg_prev;
+        size_t size() const {
+            return time.size();
+        }
+    };
+
+    struct Event {
+        uint64_t time;
+        uint64_t pc;
+        uint32_t instr;
+        uint8_t reg_index;
+        uint8_t reg_type;
+        uint64_t reg_value;
+        uint64_t reg_prev;
+    };
+
+    struct SourceLine {
+        std::string file;
+        size_t line;
+        size_t column;
+    };
+
+    // high_pc is the first address after the function
+    struct Function {
+        std::string name;
+        uint64_t low_pc;
+        uint64_t high_pc;
+    };
+
+    struct SessionOptions {
+        // fail on the first malformed line instead of skipping it
+        bool strict = false;
+        // keeps the events on disk and pages them in within the budget when not 0
+        size_t memory_budget_mib = 0;
+        // directory for paged trace files, system temporary directory when empty
+        std::string spill_dir;
+    };
+
+    class Hart {
+    public:
+        // returns false to stop the visit
+        using ColumnVisitor = std::function<bool(const EventColumns& columns)>;
+        size_t id() const {
+            return hart_id;
+        }
+        size_t event_count() const;
+        Event event(size_t event_id) const;
+        // visits events [first, last) block by block, the views are valid until the visitor returns
+        void visit(size_t first, size_t last, const ColumnVisitor& visitor) const;
+        // all events as one view valid while the session lives, nullopt when they are paged
+        std::optional<EventColumns> columns() const;
+    private:
+        struct Impl;
+        friend class Session;
+        Hart(std::shared_ptr<const Impl> hart_impl, size_t id) : impl(std::move(hart_impl)), hart_id(id) {}
+        std::shared_ptr<const Impl> impl;
+        size_t hart_id;
+    };
+
+    // Traces of all harts of one test run. Memory is observed by a hart after its first
+    // applied_events events: its own accesses up to them, those of other harts up to their time.
+    class Session {
+    public:
+        static Session open(const std::string& trace_dir, const SessionOptions& options = SessionOptions());
+        size_t hart_count() const;
+        Hart hart(size_t hart_id) const;
+        // bytes never accessed read as zero
+        uint64_t read_memory(uint64_t address, size_t size, size_t hart_id, size_t applied_events) const;
+        std::vector<uint8_t> read_memory_range(uint64_t address, size_t length, size_t hart_id, size_t applied_events) const;
+        std::vector<uint64_t> read_memory(std::span<const uint64_t> addresses, size_t size, size_t hart_id,
+                                          size_t applied_events) const;
+    private:
+        struct Impl;
+        explicit Session(std::shared_ptr<Impl> session_impl) : impl(std::move(session_impl)) {}
+        std::shared_ptr<Impl> impl;
+    };
+
+    // DWARF line and function information of the test ELF
+    class DebugInfo {
+    public:
+        // common_prefix is cut from the reported source paths
+        static DebugInfo open(const std::string& elf_path, const std::string& common_prefix = "");
+        std::optional<SourceLine> line(uint64_t pc) const;
+        // addresses of the line, empty when it has no code
+        std::vector<uint64_t> pcs(const std::string& file, size_t line) const;
+        std::vector<Function> functions() const;
+        std::optional<Function> function_at(uint64_t pc) const;
+    private:
+        struct Impl;
+        explicit DebugInfo(std::shared_ptr<const Impl> debug_info_impl) : impl(std::move(debug_info_impl)) {}
+        std::shared_ptr<const Impl> impl;
+    };
+}
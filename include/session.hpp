@@ -1,11 +1,21 @@
 #pragma once
 
+#include "activity.hpp"
+#include "break_condition.hpp"
+#include "call_stack.hpp"
+#include "line_index.hpp"
 #include "model.hpp"
 #include "session_memory.hpp"
+#include "thread_pool.hpp"
+#include "trace_follow.hpp"
+#include "trace_query.hpp"
+#include "trace_store.hpp"
 
+#include <limits>
+#include <map>
 #include <memory>
 #include <optional>
-#include <set>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
@@ -19,11 +29,73 @@ public:
     SessionCreationError() : std::runtime_error("Failed to create session check trace directory") {}
 };
 
+class NoReturnException : public std::runtime_error {
+public:
+    NoReturnException() : std::runtime_error("Selected frame does not return before the end of trace") {}
+};
+
+struct BreakPoint {
+    std::optional<BreakCondition> condition;
+    uint64_t hits = 0;
+};
+
 class DebugSession {
     std::vector<std::shared_ptr<IModel>> cpu_array;
-    std::set<uint64_t> breakpoint_addresses;
-    Memory memory;
+    std::map<uint64_t, BreakPoint> break_points;
+    // merged memory history of all harts, built on first use
+    std::optional<Memory> memory;
+    // activity summaries of every hart, built on first use
+    std::vector<ActivityPyramid> activity_pyramids;
     size_t active_hart = 0;
+    bool auto_sync = false;
+    // frame chosen by up and down, valid only while the hart stays at the event
+    struct FrameSelection {
+        size_t hart_id;
+        size_t event_id;
+        size_t level;
+    };
+    std::optional<FrameSelection> frame_selection;
+    // source lines of every hart, built on the first source-level step
+    std::vector<std::optional<LineIndex>> line_indexes;
+    const DebugInfoProvider* line_index_source = nullptr;
+    // reads the lines written to the traces after loading, null unless they are followed
+    std::shared_ptr<TraceFollower> follower;
+    // at the end of a followed trace waits for its writer to append more, false when
+    // the writers have finished or the wait was interrupted
+    bool wait_for_trace_data() {
+        while (follower) {
+            if (update_traces()) {
+                return true;
+            }
+            if (follower->wait() != TraceFollower::WaitResult::MODIFIED) {
+                return false;
+            }
+        }
+        return false;
+    }
+    // the condition is evaluated only when the address matches, hits count every match reached
+    // going forward, so that stepping back over a break point does not change conditions on them
+    bool break_point_hit(size_t hart_id, bool forward = true) {
+        if (break_points.empty()) {
+            return false;
+        }
+        const auto& cpu = cpu_array[hart_id];
+        auto it = break_points.find(cpu->read_pc());
+        if (it == break_points.end()) {
+            return false;
+        }
+        auto& break_point = it->second;
+        if (forward) {
+            ++break_point.hits;
+        }
+        if (!break_point.condition) {
+            return true;
+        }
+        BreakCondition::MemoryReader read = [this, hart_id](uint64_t address, size_t size) {
+            return read_memory(address, size, hart_id);
+        };
+        return break_point.condition->evaluate(*cpu, hart_id, break_point.hits, &read);
+    }
 public:
     const IModel* operator->() const {
         return cpu_array[active_hart].get();
@@ -38,21 +110,61 @@ public:
         if (hart_id >= cpu_array.size()) {
             throw NoSuchHartException(hart_id);
         }
+        if (auto_sync && hart_id != active_hart) {
+            sync();
+        }
         active_hart = hart_id;
     }
-    void add_break_point(uint64_t addr) noexcept {
-        breakpoint_addresses.insert(addr);
+    bool get_auto_sync() const {
+        return auto_sync;
+    }
+    // when set, switching the active hart first brings the other harts to its time
+    void set_auto_sync(bool enabled) {
+        auto_sync = enabled;
+    }
+    void seek_time(uint64_t time, std::optional<size_t> skip_hart = std::nullopt) {
+        ThreadPool::shared().parallel_for(cpu_array.size(), [this, time, skip_hart](size_t i) {
+            if (i != skip_hart) {
+                cpu_array[i]->seek_time(time);
+            }
+        });
+    }
+    // moves every other hart to the last event at or before the current time of the active one
+    void sync() {
+        seek_time(cpu_array[active_hart]->cur_time(), active_hart);
+    }
+    void add_break_point(uint64_t addr, std::optional<BreakCondition> condition = std::nullopt) {
+        break_points[addr] = BreakPoint{std::move(condition), 0};
     }
     bool remove_break_point(uint64_t addr) noexcept {
-        return breakpoint_addresses.erase(addr) > 0;
+        return break_points.erase(addr) > 0;
+    }
+    const std::map<uint64_t, BreakPoint>& get_break_points() const {
+        return break_points;
     }
+    bool following() const {
+        return follower != nullptr;
+    }
+    // applies the lines written to followed traces since the last call and drops the
+    // indexes built over the whole session, returns true if there were any
+    bool update_traces() {
+        if (!follower || follower->update() == 0) {
+            return false;
+        }
+        memory.reset();
+        activity_pyramids.clear();
+        line_index_source = nullptr;
+        return true;
+    }
+    // runs the active hart until a break point, waiting for more events at the end of a followed trace
     std::optional<size_t> run() {
-        while (!breakpoint_addresses.contains(cpu_array[active_hart]->read_pc())) {
-            if (!cpu_array[active_hart]->step_forward()) {
-                return active_hart;
-                break;
+        do {
+            while (cpu_array[active_hart]->step_forward()) {
+                if (break_point_hit(active_hart)) {
+                    return active_hart;
+                }
             }
-        }
+        } while (wait_for_trace_data());
         return std::nullopt;
     }
     std::optional<size_t> run_all() {
@@ -62,27 +174,217 @@ public:
             bool cpu_alive = false;
             for (size_t i = 0; i < cpu_array.size(); ++i) {
                 auto& cpu = cpu_array[i];
-                cpu_alive |= cpu->step_forward();
-                bool reached_break_point = breakpoint_addresses.contains(cpu->read_pc());
+                bool stepped = cpu->step_forward();
+                cpu_alive |= stepped;
+                bool reached_break_point = stepped && break_point_hit(i);
                 need_stop |= reached_break_point;
                 if (reached_break_point) {
                     ret = i;
                     break;
                 }
             }
-            if (!cpu_alive) {
+            if (!cpu_alive && !wait_for_trace_data()) {
                 break;
             }
         }
         return ret;
     }
+    std::optional<size_t> run_back() {
+        auto& cpu = cpu_array[active_hart];
+        while (cpu->step_back()) {
+            if (break_point_hit(active_hart, false)) {
+                return active_hart;
+            }
+        }
+        return std::nullopt;
+    }
+    // mirror of run_all: steps every hart back by one event per round, the last hart first,
+    // until one of them reaches a break point or all are at the start of their traces
+    std::optional<size_t> run_all_back() {
+        while (true) {
+            bool cpu_alive = false;
+            for (size_t i = cpu_array.size(); i-- > 0;) {
+                bool stepped = cpu_array[i]->step_back();
+                cpu_alive |= stepped;
+                if (stepped && break_point_hit(i, false)) {
+                    return i;
+                }
+            }
+            if (!cpu_alive) {
+                return std::nullopt;
+            }
+        }
+    }
+    // event whose pc the hart shows: the last applied one
+    size_t position_event(size_t hart_id) const {
+        size_t cur_event = cpu_array[hart_id]->cur_event();
+        return cur_event > 0 ? cur_event - 1 : 0;
+    }
+    // frames of the active hart at its position, innermost first
+    std::vector<uint32_t> backtrace() const {
+        return cpu_array[active_hart]->call_stack().backtrace(position_event(active_hart));
+    }
+    size_t get_selected_frame() const {
+        if (frame_selection && frame_selection->hart_id == active_hart &&
+            frame_selection->event_id == position_event(active_hart)) {
+            return frame_selection->level;
+        }
+        return 0;
+    }
+    void select_frame(size_t level) {
+        frame_selection = FrameSelection{active_hart, position_event(active_hart), level};
+    }
+    // runs the active hart until the selected frame has returned and the caller instruction
+    // after the call is applied, stops earlier at a break point
+    std::optional<size_t> finish() {
+        auto frames = backtrace();
+        size_t level = get_selected_frame();
+        if (level >= frames.size()) {
+            throw NoReturnException();
+        }
+        const size_t return_event = cpu_array[active_hart]->call_stack().frame(frames[level]).return_event;
+        if (return_event == CallFrame::NO_EVENT) {
+            throw NoReturnException();
+        }
+        return run_to(return_event + 1);
+    }
+    // moves the active hart so that event_id is the next event, checking break points
+    // on the way when there are any
+    std::optional<size_t> run_to(size_t event_id) {
+        auto& cpu = cpu_array[active_hart];
+        if (break_points.empty()) {
+            cpu->seek_event(event_id);
+            return std::nullopt;
+        }
+        while (cpu->cur_event() < event_id && cpu->step_forward()) {
+            if (break_point_hit(active_hart)) {
+                return active_hart;
+            }
+        }
+        while (cpu->cur_event() > event_id && cpu->step_back()) {
+            if (break_point_hit(active_hart, false)) {
+                return active_hart;
+            }
+        }
+        return std::nullopt;
+    }
+    const LineIndex& line_index(const DebugInfoProvider& debug_info) {
+        if (line_index_source != &debug_info) {
+            line_indexes.assign(cpu_array.size(), std::nullopt);
+            line_index_source = &debug_info;
+        }
+        auto& index = line_indexes[active_hart];
+        if (!index) {
+            index = LineIndex::build(cpu_array[active_hart]->trace_store(), debug_info);
+        }
+        return index.value();
+    }
+    enum class SourceStep {
+        NEXT,
+        STEP,
+        PREV
+    };
+    // applies the first event of the line reached, or moves to the end of trace when there is none
+    std::optional<size_t> source_step(SourceStep step, const DebugInfoProvider& debug_info) {
+        const auto& lines = line_index(debug_info);
+        const auto& calls = cpu_array[active_hart]->call_stack();
+        const size_t event = position_event(active_hart);
+        std::optional<size_t> target;
+        if (step == SourceStep::NEXT) {
+            target = next_line_event(lines, calls, event);
+        } else if (step == SourceStep::STEP) {
+            target = step_line_event(lines, event);
+        } else {
+            target = prev_line_event(lines, calls, event);
+            if (!target) {
+                return run_to(0);
+            }
+        }
+        return run_to(target ? target.value() + 1 : cpu_array[active_hart]->event_count());
+    }
+    const std::vector<ActivityPyramid>& activity() {
+        if (activity_pyramids.size() != cpu_array.size()) {
+            activity_pyramids.assign(cpu_array.size(), ActivityPyramid());
+            ThreadPool::shared().parallel_for(cpu_array.size(), [this](size_t i) {
+                activity_pyramids[i] = ActivityPyramid::build(cpu_array[i]->trace_store(), cpu_array[i]->call_stack());
+            });
+        }
+        return activity_pyramids;
+    }
+    const Memory& memory_view() {
+        if (!memory) {
+            std::vector<std::vector<MemoryAccess>> per_hart(cpu_array.size());
+            ThreadPool::shared().parallel_for(cpu_array.size(), [this, &per_hart](size_t i) {
+                per_hart[i] = cpu_array[i]->memory_accesses(i);
+            });
+            memory = Memory::merge(std::move(per_hart));
+        }
+        return memory.value();
+    }
+    MemoryPosition memory_position(size_t hart_id) const {
+        const auto& cpu = cpu_array[hart_id];
+        return MemoryPosition{cpu->cur_time(), hart_id, cpu->cur_event()};
+    }
+    // value seen by the given hart at its current point, written by any hart
+    uint64_t read_memory(uint64_t address, size_t size, size_t hart_id) {
+        return memory_view().read(address, size, memory_position(hart_id));
+    }
+    uint64_t read_memory(uint64_t address, size_t size) {
+        return read_memory(address, size, active_hart);
+    }
+    std::vector<uint8_t> read_memory_range(uint64_t address, size_t length) {
+        return memory_view().read_range(address, length, memory_position(active_hart));
+    }
+    std::vector<uint64_t> read_memory(std::span<const uint64_t> addresses, size_t size) {
+        return memory_view().read_batch(addresses, size, memory_position(active_hart));
+    }
+    std::optional<MemoryAccess> last_memory_write(uint64_t address) {
+        return memory_view().last_store(address, memory_position(active_hart));
+    }
+    // events of the active hart from first_event on, memory addresses are matched against the merged memory view
+    std::vector<size_t> find_events(const TraceQuery& query, size_t first_event = 0,
+                                    size_t limit = std::numeric_limits<size_t>::max()) {
+        const auto& store = cpu_array[active_hart]->trace_store();
+        if (!query.address) {
+            return ::find_events(store, query, first_event, limit);
+        }
+        std::vector<size_t> res;
+        for (size_t event_id : memory_view().access_events(active_hart, query.address->first, query.address->last)) {
+            if (res.size() == limit) {
+                break;
+            }
+            if (event_id >= first_event && query.matches(store.get(event_id))) {
+                res.push_back(event_id);
+            }
+        }
+        return res;
+    }
+    size_t count_events(const TraceQuery& query) {
+        if (!query.address) {
+            return ::count_events(cpu_array[active_hart]->trace_store(), query);
+        }
+        return find_events(query).size();
+    }
     const auto& get_harts() {
         return cpu_array;
     }
     friend class DebugSessionFactory;
 };
 
+struct TraceStorageConfig {
+    bool paged = false;
+    // memory budget of paged_config is shared by all harts of the session
+    PagedTraceStoreConfig paged_config;
+};
+
 class DebugSessionFactory {
+    TraceStorageConfig storage_config;
+    TraceLoadConfig load_config;
 public:
-    DebugSession create_session(const std::string& trace_dir_path);
+    DebugSessionFactory() = default;
+    explicit DebugSessionFactory(const TraceStorageConfig& config, const TraceLoadConfig& load = TraceLoadConfig()) :
+        storage_config(config),
+        load_config(load) {}
+    // with background the harts load in the background and on first use instead of before the return
+    DebugSession create_session(const std::string& trace_dir_path, bool background = false);
 };
@@ -1,6 +1,59 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+struct MemoryAccess {
+    uint64_t time;
+    uint64_t event_id;
+    uint64_t address;
+    // accessed bytes in little endian order, loads keep the low bytes of the loaded register
+    uint64_t value;
+    uint32_t hart_id;
+    uint8_t size;
+    bool is_store;
+};
+
+// Point of the session the memory is observed from: accesses of the observing hart
+// are visible up to its current event, accesses of other harts up to its time.
+struct MemoryPosition {
+    uint64_t time;
+    size_t hart_id;
+    size_t event_id;
+};
+
+// Memory accesses of all harts of a session merged in time order. A byte is read
+// from the latest visible access that covers it: a store, or a load that observed it.
 class Memory {
+    std::vector<MemoryAccess> accesses;
+    // sorted aligned dwords touched by any access; accesses of dwords[i] in time order are
+    // access_indices[dword_offsets[i]] .. access_indices[dword_offsets[i + 1] - 1]
+    std::vector<uint64_t> dwords;
+    std::vector<size_t> dword_offsets;
+    std::vector<size_t> access_indices;
+    template <typename Visitor>
+    void visit_visible(size_t slot, const MemoryPosition& position, Visitor visitor) const;
+    // first slot from the given one whose dword is not below the dword of the address
+    size_t first_slot(uint64_t address, size_t from = 0) const;
+    // fills out[0, length) with the bytes from address on, slot is first_slot(address)
+    void read_from(size_t slot, uint64_t address, size_t length, const MemoryPosition& position, uint8_t* out) const;
 public:
-    uint64_t getValue(uint64_t address, uint64_t time) const;
+    Memory() = default;
+    // every per-hart sequence must be ordered by time
+    static Memory merge(std::vector<std::vector<MemoryAccess>> per_hart);
+    size_t size() const {
+        return accesses.size();
+    }
+    // bytes never accessed up to the position read as zero
+    uint64_t read(uint64_t address, size_t size, const MemoryPosition& position) const;
+    // bytes [address, address + length) with one index lookup for the whole range
+    std::vector<uint8_t> read_range(uint64_t address, size_t length, const MemoryPosition& position) const;
+    // size bytes at every address, the addresses are resolved in one ascending walk over the index
+    std::vector<uint64_t> read_batch(std::span<const uint64_t> addresses, size_t size, const MemoryPosition& position) const;
+    std::optional<MemoryAccess> last_store(uint64_t address, const MemoryPosition& position) const;
+    // events of the hart accessing any byte of [first_address, last_address], in order
+    std::vector<size_t> access_events(size_t hart_id, uint64_t first_address, uint64_t last_address) const;
 };
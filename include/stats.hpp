@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+// Process-wide timers and counters. Collection is off by default, instrumented code
+// checks enabled() once and skips all clock reads and map updates when it is off.
+namespace stats {
+    inline std::atomic<bool> collection_enabled = false;
+
+    inline bool enabled() noexcept {
+        return collection_enabled.load(std::memory_order_relaxed);
+    }
+
+    inline void set_enabled(bool value) noexcept {
+        collection_enabled.store(value, std::memory_order_relaxed);
+    }
+
+    struct TimerValue {
+        std::chrono::nanoseconds total{0};
+        uint64_t calls = 0;
+    };
+
+    struct Snapshot {
+        std::map<std::string, TimerValue> timers;
+        std::map<std::string, uint64_t> counters;
+    };
+
+    void add_time(const std::string& name, std::chrono::nanoseconds duration, uint64_t calls = 1);
+    void add_count(const std::string& name, uint64_t value);
+    Snapshot snapshot();
+    void reset();
+
+    void print(std::ostream& out, const Snapshot& values);
+    void write_json(std::ostream& out, const Snapshot& values);
+
+    class ScopedTimer {
+        const char* name;
+        bool active;
+        std::chrono::steady_clock::time_point start;
+    public:
+        explicit ScopedTimer(const char* timer_name) : name(timer_name), active(enabled()) {
+            if (active) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+        ScopedTimer(const ScopedTimer& other) = delete;
+        ScopedTimer& operator=(const ScopedTimer& other) = delete;
+        ~ScopedTimer() {
+            if (active) {
+                add_time(name, std::chrono::steady_clock::now() - start);
+            }
+        }
+    };
+
+    // Splits a loop body into phases: each lap() adds the time since the previous lap to a local total
+    class LapTimer {
+        bool active;
+        std::chrono::steady_clock::time_point last;
+    public:
+        explicit LapTimer(bool is_active) : active(is_active) {
+            if (active) {
+                last = std::chrono::steady_clock::now();
+            }
+        }
+        void lap(std::chrono::nanoseconds& total) {
+            if (active) {
+                auto now = std::chrono::steady_clock::now();
+                total += now - last;
+                last = now;
+            }
+        }
+    };
+}
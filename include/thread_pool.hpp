@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Every worker owns a deque: it pops its own tasks from the back and steals
+// from the front of the other queues when its own is empty.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+    explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    // process-wide pool for background and data-parallel work
+    static ThreadPool& shared();
+    void submit(Task task);
+    void wait_idle();
+    // calls body for every index in [0, count) and returns when all calls are done.
+    // The caller takes part in the work, so it is safe to call from a pool task.
+    // The first exception thrown by body is rethrown.
+    void parallel_for(size_t count, const std::function<void(size_t)>& body);
+    size_t size() const {
+        return workers.size();
+    }
+    ~ThreadPool();
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+    bool try_pop(size_t queue_id, Task& task);
+    void worker_loop(size_t worker_id);
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex state_lock;
+    std::condition_variable has_work;
+    std::condition_variable idle;
+    size_t queued = 0;
+    size_t pending = 0;
+    bool stopping = false;
+    std::atomic<size_t> next_queue = 0;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "activity.hpp"
+#include "call_stack.hpp"
+#include "debug_info_provider.hpp"
+#include "json.hpp"
+#include "session.hpp"
+#include "trace_store.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class TimelineException : public std::runtime_error {
+public:
+    TimelineException(const std::string& message) : std::runtime_error("Timeline: " + message) {}
+};
+
+// Chrome trace event JSON, also opened by Perfetto, written through a fixed-size buffer,
+// so that the document is never held in memory. Time units of the trace are shown as microseconds.
+class ChromeTraceWriter {
+    std::ostream& out;
+    std::string buffer;
+    size_t buffer_limit;
+    size_t events = 0;
+    bool finished = false;
+    void begin_event();
+    void append(std::string_view value);
+    void append(uint64_t value);
+    void flush();
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+    explicit ChromeTraceWriter(std::ostream& stream, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    ChromeTraceWriter(const ChromeTraceWriter& other) = delete;
+    ChromeTraceWriter& operator=(const ChromeTraceWriter& other) = delete;
+    void thread_name(uint64_t tid, std::string_view name);
+    // complete event over [begin, end), name is already escaped
+    void slice(uint64_t tid, std::string_view escaped_name, uint64_t begin, uint64_t end);
+    // sample of a counter track, names are already escaped
+    void counter(std::string_view escaped_name, uint64_t time,
+                 std::initializer_list<std::pair<std::string_view, uint64_t>> values);
+    // closes the document and flushes it
+    void finish();
+    size_t event_count() const {
+        return events;
+    }
+};
+
+// Escaped function names by address, functions without debug info are named by their entry pc
+class FunctionNames {
+    struct Range {
+        uint64_t low_pc;
+        uint64_t high_pc;
+        std::string escaped_name;
+    };
+    std::vector<Range> ranges;
+public:
+    FunctionNames() = default;
+    explicit FunctionNames(const std::vector<FunctionInfo>& functions);
+    std::string_view find(uint64_t pc, std::string& fallback) const;
+};
+
+// writes every frame of the call stack as a slice from its entry to its return on thread tid,
+// frames still open at the end of the trace end at its last event; returns the number of slices
+size_t write_timeline(ChromeTraceWriter& writer, uint64_t tid, const ITraceStore& store, const CallStack& stack,
+                      const FunctionNames& names);
+// activity of the pyramid level with at most max_samples nodes as a counter track
+void write_activity_counters(ChromeTraceWriter& writer, std::string_view escaped_name, const ActivityPyramid& pyramid,
+                             size_t max_samples);
+// one thread and one activity counter track per hart, returns the number of slices
+size_t export_timeline(std::ostream& out, DebugSession& session, const std::vector<FunctionInfo>& functions);
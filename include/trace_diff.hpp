@@ -0,0 +1,23 @@
+#pragma once
+
+#include "debug_info_provider.hpp"
+#include "session.hpp"
+#include "trace_store.hpp"
+
+#include <optional>
+#include <ostream>
+
+constexpr size_t DEFAULT_DIFF_WINDOW = 4096;
+
+// Finds the first event where pc, instruction or register write of two traces differ,
+// time is not compared. Hashes of fixed windows are computed in parallel, a binary
+// search over their prefix hashes finds the first differing window and only that window
+// is compared event by event. When one trace is a prefix of the other the length of the
+// shorter one is returned, nullopt means the traces are equal.
+std::optional<size_t> find_first_divergence(const ITraceStore& golden, const ITraceStore& failing,
+                                            size_t window_events = DEFAULT_DIFF_WINDOW);
+
+// Compares harts with the same index and prints the first divergence of each,
+// with source lines when debug info is given
+void write_diff_report(std::ostream& out, DebugSession& golden, DebugSession& failing,
+                       const DebugInfoProvider* debug_info = nullptr);
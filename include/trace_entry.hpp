@@ -0,0 +1,144 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class RegType {
+    INT,
+    FLOAT
+};
+struct RegisterDescription {
+    size_t index;
+    RegType type;
+    bool operator==(const RegisterDescription& other) const {
+        return index == other.index && type == other.type;
+    }
+    bool operator!=(const RegisterDescription& other) const {
+        return !((*this) == other);
+    }
+};
+
+struct RegisterUpdateEvent {
+    RegisterDescription reg;
+    uint64_t val;
+    uint64_t prev;
+    RegisterUpdateEvent(const RegisterDescription& descr, uint64_t new_val, uint64_t prev_val = 0) :
+        reg(descr),
+        val(new_val),
+        prev(prev_val) {}
+};
+
+enum class TraceParseError {
+    NONE,
+    MISSING_FIELD,
+    BAD_FIELD,
+    BAD_REGISTER
+};
+
+inline const char* trace_parse_error_name(TraceParseError error) {
+    switch (error) {
+    case TraceParseError::NONE:
+        return "no error";
+    case TraceParseError::MISSING_FIELD:
+        return "missing field";
+    case TraceParseError::BAD_FIELD:
+        return "bad field";
+    case TraceParseError::BAD_REGISTER:
+        return "bad register update";
+    }
+    return "unknown error";
+}
+
+class TraceParseException : public std::runtime_error {
+public:
+    TraceParseException(TraceParseError error) :
+        std::runtime_error(std::string("Malformed trace line: ") + trace_parse_error_name(error)) {}
+};
+
+class TraceLoadException : public std::runtime_error {
+public:
+    TraceLoadException(const std::string& trace_name, size_t line_number, TraceParseError error) :
+        std::runtime_error(
+            trace_name + ':' + std::to_string(line_number) + ": malformed line (" +
+            trace_parse_error_name(error) + ')') {}
+};
+
+struct TraceLoadConfig {
+    // abort loading on the first malformed line instead of skipping it
+    bool strict = false;
+    size_t max_error_samples = 10;
+    // keep appending the lines written to the traces after they are loaded
+    bool follow = false;
+    // print a processing line per trace to stderr
+    bool progress = true;
+};
+
+struct TraceLoadErrors {
+    struct Sample {
+        size_t line_number;
+        TraceParseError error;
+        std::string text;
+    };
+    std::array<size_t, 4> counts{};
+    std::vector<Sample> samples;
+    void add(size_t line_number, const std::string& text, TraceParseError error, size_t max_samples) {
+        ++counts[static_cast<size_t>(error)];
+        if (samples.size() < max_samples) {
+            samples.push_back({line_number, error, text});
+        }
+    }
+    size_t total() const {
+        size_t res = 0;
+        for (size_t count : counts) {
+            res += count;
+        }
+        return res;
+    }
+};
+
+struct TraceLine {
+    uint64_t time;
+    int rsv1;
+    char rsv2;
+    uint64_t cur_pc;
+    uint32_t instr;
+    uint64_t next_pc;
+    std::optional<RegisterDescription> changed_reg = std::nullopt;
+    std::optional<uint64_t> new_reg_val = std::nullopt;
+    TraceLine() = default;
+    // throws TraceParseException on malformed lines
+    explicit TraceLine(const std::string& line);
+    // does not throw, out is valid only when NONE is returned
+    static TraceParseError parse(std::string_view line, TraceLine& out) noexcept;
+};
+
+struct TraceEntry {
+    uint64_t time;
+    uint64_t pc;
+    uint32_t instr;
+    std::optional<RegisterUpdateEvent> changed_reg = std::nullopt;
+    TraceEntry(uint64_t time_, uint64_t pc_, uint32_t instr_, std::optional<RegisterUpdateEvent> changed_reg_ = std::nullopt) :
+        time(time_),
+        pc(pc_),
+        instr(instr_),
+        changed_reg(changed_reg_) {}
+    TraceEntry(const TraceLine& line, const IModel& model) :
+        time(line.time), 
+        pc(line.cur_pc),
+        instr(line.instr) {
+            if (line.changed_reg) {
+                changed_reg = RegisterUpdateEvent(
+                    line.changed_reg.value(),
+                    line.new_reg_val.value(),
+                    model.read_register(line.changed_reg.value().index)
+                    );                                             
+            }
+        }
+};
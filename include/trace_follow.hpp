@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TraceFollowException : public std::runtime_error {
+public:
+    TraceFollowException(const std::string& message) : std::runtime_error("Trace follow: " + message) {}
+};
+
+// Follows uncompressed traces that are still being written. inotify tells which files were
+// modified, their new lines are read by update on the calling thread, so sinks may change
+// models without locking. An unfinished last line stays in the file until its newline is written.
+class TraceFollower {
+public:
+    // gets the complete lines appended since the previous call
+    using Sink = std::function<void(std::istream& lines)>;
+    enum class WaitResult {
+        MODIFIED,
+        // every followed file has been closed by its writer
+        FINISHED,
+        INTERRUPTED
+    };
+    TraceFollower();
+    TraceFollower(const TraceFollower& other) = delete;
+    TraceFollower& operator=(const TraceFollower& other) = delete;
+    ~TraceFollower();
+    // follows path from offset on, may be called from any thread
+    void add(const std::string& path, uint64_t offset, Sink sink);
+    // passes the new lines of the modified files to their sinks, returns the number of files that had any
+    size_t update();
+    // blocks until a followed file is modified, all writers have closed their files or SIGINT arrives
+    WaitResult wait();
+private:
+    struct File {
+        std::string path;
+        int fd;
+        uint64_t offset;
+        Sink sink;
+        bool modified = true;
+        // set by a modification and cleared when the writer closes the file, decides whether
+        // the file is still written when the writers cannot be probed with a lease
+        bool writing = false;
+    };
+    // drains pending inotify events into the file flags, lock must be held
+    void read_events();
+    bool read_appended(File& file);
+    std::mutex lock;
+    std::vector<std::unique_ptr<File>> files;
+    std::unordered_map<int, File*> watches;
+    int inotify_fd = -1;
+    // written by the SIGINT handler while wait blocks
+    int interrupt_fd = -1;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+class TraceInputException : public std::runtime_error {
+public:
+    TraceInputException(const std::string& path, const std::string& message) :
+        std::runtime_error("Failed to read trace " + path + ": " + message) {}
+};
+
+// Opens a trace file for line by line reading. Gzip and zstd compressed files are
+// recognised by their magic number and decompressed by a background stage that runs
+// ahead of the parser; independent zstd frames are decompressed in parallel.
+// Decompression errors are rethrown from the reading call.
+std::unique_ptr<std::istream> open_trace_input(const std::string& path);
+
+// Opens the complete lines an uncompressed trace has at the time of the call, for a
+// trace that is still being written. length is set to their size in bytes: the offset
+// where following the trace continues.
+std::unique_ptr<std::istream> open_trace_prefix(const std::string& path, uint64_t& length);
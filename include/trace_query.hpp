@@ -0,0 +1,47 @@
+#pragma once
+
+#include "trace_store.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class TraceQueryException : public std::runtime_error {
+public:
+    TraceQueryException(const std::string& message) : std::runtime_error("Query: " + message) {}
+};
+
+// inclusive on both ends, so that a range can reach the maximal value
+struct ValueRange {
+    uint64_t first = 0;
+    uint64_t last = std::numeric_limits<uint64_t>::max();
+    bool contains(uint64_t value) const {
+        return value - first <= last - first;
+    }
+};
+
+// Conjunction of conditions on the fields of an event, unset conditions always hold
+struct TraceQuery {
+    std::optional<ValueRange> pc;
+    std::optional<ValueRange> time;
+    uint32_t instr_mask = 0;
+    uint32_t instr_value = 0;
+    // integer register written by the event and the range of the written value
+    std::optional<uint8_t> reg_index;
+    std::optional<ValueRange> reg_value;
+    // address of a memory access, not stored in the trace columns: evaluated by the session
+    std::optional<ValueRange> address;
+
+    // space separated conditions, e.g. "store pc 0x100..0x200 a0 > 0x1000 addr 0x8000..0x9000"
+    static TraceQuery parse(const std::string& text);
+    bool matches(const TraceEntry& event) const;
+};
+
+// Events from first_event on matching all conditions except address, in order and at most limit of them.
+// Columns are scanned in parallel blocks with vector instructions where the CPU supports them.
+std::vector<size_t> find_events(const ITraceStore& store, const TraceQuery& query, size_t first_event = 0,
+                                size_t limit = std::numeric_limits<size_t>::max());
+size_t count_events(const ITraceStore& store, const TraceQuery& query);
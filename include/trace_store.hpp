@@ -0,0 +1,126 @@
+#pragma once
+
+#include "trace_entry.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class TraceStoreException : public std::runtime_error {
+public:
+    TraceStoreException(const std::string& message) : std::runtime_error("Trace store: " + message) {}
+};
+
+// Events stored field by field, so that scans over one field touch only its array
+struct TraceColumns {
+    static constexpr uint8_t NO_REG = 0xff;
+    static constexpr size_t EVENT_BYTES = 2 * sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(uint8_t) + 2 * sizeof(uint64_t);
+    std::vector<uint64_t> time;
+    std::vector<uint64_t> pc;
+    std::vector<uint32_t> instr;
+    // NO_REG when the event writes no register
+    std::vector<uint8_t> reg_index;
+    std::vector<uint8_t> reg_type;
+    std::vector<uint64_t> reg_val;
+    std::vector<uint64_t> reg_prev;
+
+    size_t size() const {
+        return time.size();
+    }
+    void reserve(size_t count);
+    void resize(size_t count);
+    void clear();
+    void shrink_to_fit();
+    size_t capacity_bytes() const {
+        return time.capacity() * EVENT_BYTES;
+    }
+    void push_back(const TraceEntry& entry);
+    TraceEntry get(size_t index) const;
+};
+
+// Events [begin, end) of a block of columns whose first element is event first_event
+struct TraceBlock {
+    const TraceColumns& columns;
+    size_t first_event;
+    size_t begin;
+    size_t end;
+};
+
+class ITraceStore {
+public:
+    // returns false to stop the visit
+    using BlockVisitor = std::function<bool(const TraceBlock&)>;
+    virtual size_t size() const = 0;
+    virtual TraceEntry get(size_t event_id) const = 0;
+    virtual void append(const TraceEntry& entry) = 0;
+    // called once after the last append of the initial load
+    virtual void finish_loading() {}
+    virtual size_t resident_bytes() const = 0;
+    // visits events [first, last) in order, block by block
+    virtual void visit_blocks(size_t first, size_t last, const BlockVisitor& visitor) const = 0;
+    // all events when they stay in memory for the lifetime of the store, nullptr otherwise
+    virtual const TraceColumns* resident_columns() const {
+        return nullptr;
+    }
+    virtual ~ITraceStore() = default;
+};
+
+class InMemoryTraceStore : public ITraceStore {
+    TraceColumns events;
+public:
+    virtual size_t size() const override {
+        return events.size();
+    }
+    virtual TraceEntry get(size_t event_id) const override {
+        return events.get(event_id);
+    }
+    virtual void append(const TraceEntry& entry) override {
+        events.push_back(entry);
+    }
+    virtual size_t resident_bytes() const override {
+        return events.capacity_bytes();
+    }
+    virtual void visit_blocks(size_t first, size_t last, const BlockVisitor& visitor) const override {
+        if (first < last) {
+            visitor(TraceBlock{events, 0, first, last});
+        }
+    }
+    virtual const TraceColumns* resident_columns() const override {
+        return &events;
+    }
+};
+
+struct PagedTraceStoreConfig {
+    size_t chunk_events = 1 << 16;
+    size_t memory_budget = 64 << 20;
+    // directory for the spill file, system temporary directory when empty
+    std::string spill_dir;
+};
+
+// Keeps events in an unlinked spill file in fixed-size chunks, each written column
+// by column, and holds only the most recently used chunks in memory. Crossing a
+// chunk boundary schedules an asynchronous load of the next chunk in the direction of travel.
+class PagedTraceStore : public ITraceStore {
+    // shared with in-flight prefetch tasks, so that the store can be destroyed without waiting for them
+    struct State;
+    std::shared_ptr<State> state;
+    size_t event_count = 0;
+    TraceColumns write_buffer;
+    void flush_write_buffer();
+    std::shared_ptr<const TraceColumns> load_chunk(size_t chunk_id) const;
+public:
+    explicit PagedTraceStore(const PagedTraceStoreConfig& store_config = PagedTraceStoreConfig());
+    PagedTraceStore(const PagedTraceStore& other) = delete;
+    PagedTraceStore& operator=(const PagedTraceStore& other) = delete;
+    virtual size_t size() const override {
+        return event_count;
+    }
+    virtual TraceEntry get(size_t event_id) const override;
+    virtual void append(const TraceEntry& entry) override;
+    virtual void finish_loading() override;
+    virtual size_t resident_bytes() const override;
+    virtual void visit_blocks(size_t first, size_t last, const BlockVisitor& visitor) const override;
+};
@@ -1,15 +1,123 @@
 #include "RISCV64_decode.hpp"
 
-constexpr uint8_t LOAD_OPCODE = 0b0000011;
-constexpr uint8_t STORE_OPCODE = 0b0100011;
+#include <charconv>
+
+constexpr bool is_link_register(uint8_t index) {
+    return index == 1 || index == 5;
+}
+
+constexpr RISCV64Decode::ControlTransfer jalr_transfer(uint8_t rd, uint8_t rs1) {
+    using RISCV64Decode::ControlTransfer;
+    if (is_link_register(rd)) {
+        if (is_link_register(rs1) && rs1 != rd) {
+            return ControlTransfer::RETURN_AND_CALL;
+        }
+        return ControlTransfer::CALL;
+    }
+    return is_link_register(rs1) ? ControlTransfer::RETURN : ControlTransfer::NONE;
+}
+
+constexpr std::optional<RISCV64Decode::AtomicOperation> atomic_operation(uint8_t funct5) {
+    using RISCV64Decode::AtomicOperation;
+    switch (funct5) {
+    case 0b00010:
+        return AtomicOperation::LR;
+    case 0b00011:
+        return AtomicOperation::SC;
+    case 0b00001:
+        return AtomicOperation::SWAP;
+    case 0b00000:
+        return AtomicOperation::ADD;
+    case 0b00100:
+        return AtomicOperation::XOR;
+    case 0b01100:
+        return AtomicOperation::AND;
+    case 0b01000:
+        return AtomicOperation::OR;
+    case 0b10000:
+        return AtomicOperation::MIN;
+    case 0b10100:
+        return AtomicOperation::MAX;
+    case 0b11000:
+        return AtomicOperation::MINU;
+    case 0b11100:
+        return AtomicOperation::MAXU;
+    default:
+        return std::nullopt;
+    }
+}
 
 constexpr int16_t extend_sign(uint16_t src) {
     constexpr uint16_t mask = 1 << 11;
     return (src ^ mask) - mask;
 }
 
+// c.lw, c.ld, c.sw, c.sd and their sp relative forms, other compressed instructions are unsupported
+RISCV64Decode::Instruction decode_compressed(const uint32_t instr) {
+    using RISCV64Decode::InstructionType;
+    RISCV64Decode::Instruction ret;
+    ret.type = InstructionType::UNSUPPORTED;
+    auto load = [&ret](uint8_t size, uint8_t dest, uint8_t base, uint16_t offset) {
+        ret.type = InstructionType::LOAD;
+        ret.content.loadContent = {static_cast<int16_t>(offset), size, base, dest, true};
+    };
+    auto store = [&ret](uint8_t size, uint8_t base, uint8_t src, uint16_t offset) {
+        ret.type = InstructionType::STORE;
+        ret.content.storeContent = {static_cast<int16_t>(offset), size, base, src};
+    };
+    // the three bit register fields name x8-x15
+    const uint8_t rs1_short = 8 + ((instr >> 7) & 0b111);
+    const uint8_t rd_short = 8 + ((instr >> 2) & 0b111);
+    const uint8_t rd = (instr >> 7) & 0b11111;
+    const uint8_t rs2 = (instr >> 2) & 0b11111;
+    // offset[5:3] is in bits 12:10, offset[2|6] in bits 6:5 for words and offset[7:6] for double words
+    const uint16_t word_offset = ((instr >> 7) & 0b111000) | ((instr >> 4) & 0b100) | ((instr << 1) & 0b1000000);
+    const uint16_t dword_offset = ((instr >> 7) & 0b111000) | ((instr << 1) & 0b11000000);
+    const uint8_t funct3 = (instr >> 13) & 0b111;
+    switch ((instr & 0b11) << 3 | funct3) {
+    case 0b00010:
+        load(4, rd_short, rs1_short, word_offset);
+        break;
+    case 0b00011:
+        load(8, rd_short, rs1_short, dword_offset);
+        break;
+    case 0b00110:
+        store(4, rs1_short, rd_short, word_offset);
+        break;
+    case 0b00111:
+        store(8, rs1_short, rd_short, dword_offset);
+        break;
+    case 0b10010:
+        // c.lwsp: offset[5] in bit 12, offset[4:2|7:6] in bits 6:2
+        if (rd != 0) {
+            load(4, rd, 2, ((instr >> 7) & 0b100000) | ((instr >> 2) & 0b11100) | ((instr << 4) & 0b11000000));
+        }
+        break;
+    case 0b10011:
+        // c.ldsp: offset[5] in bit 12, offset[4:3|8:6] in bits 6:2
+        if (rd != 0) {
+            load(8, rd, 2, ((instr >> 7) & 0b100000) | ((instr >> 2) & 0b11000) | ((instr << 4) & 0b111000000));
+        }
+        break;
+    case 0b10110:
+        // c.swsp: offset[5:2|7:6] in bits 12:7
+        store(4, 2, rs2, ((instr >> 7) & 0b111100) | ((instr >> 1) & 0b11000000));
+        break;
+    case 0b10111:
+        // c.sdsp: offset[5:3|8:6] in bits 12:7
+        store(8, 2, rs2, ((instr >> 7) & 0b111000) | ((instr >> 1) & 0b111000000));
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
+
 RISCV64Decode::Instruction RISCV64Decode::decode(const uint32_t instr) {
-    uint8_t opcode = instr & (0b1111111);
+    if ((instr & 0b11) != 0b11) {
+        return decode_compressed(instr);
+    }
+    uint8_t opcode = instr & OPCODE_MASK;
     Instruction ret;
     switch (opcode) {
     case (LOAD_OPCODE): {
@@ -37,9 +145,182 @@ RISCV64Decode::Instruction RISCV64Decode::decode(const uint32_t instr) {
         ret.content.storeContent.size = 1 << funct3;
         break;
     }
+    case (AMO_OPCODE): {
+        const uint8_t funct3 = (instr >> 12) & 0b111;
+        const uint8_t funct5 = instr >> 27;
+        auto operation = atomic_operation(funct5);
+        if ((funct3 != 0b010 && funct3 != 0b011) || !operation) {
+            ret.type = InstructionType::UNSUPPORTED;
+            break;
+        }
+        ret.type = InstructionType::ATOMIC;
+        ret.content.atomicContent.operation = operation.value();
+        ret.content.atomicContent.size = 1 << funct3;
+        ret.content.atomicContent.rs1Index = (instr >> 15) & 0b11111;
+        ret.content.atomicContent.rs2Index = (instr >> 20) & 0b11111;
+        ret.content.atomicContent.rdIndex = (instr >> 7) & 0b11111;
+        ret.content.atomicContent.acquire = (instr >> 26) & 1;
+        ret.content.atomicContent.release = (instr >> 25) & 1;
+        break;
+    }
     default:
         ret.type = InstructionType::UNSUPPORTED;
         break;
     }
     return ret;
 }
+
+std::optional<uint64_t> RISCV64Decode::atomic_stored_value(const Instruction::Content::AtomicContent& atomic,
+                                                           uint64_t rd_after, uint64_t rs2) {
+    if (atomic.operation == AtomicOperation::LR) {
+        return std::nullopt;
+    }
+    if (atomic.operation == AtomicOperation::SC) {
+        return rd_after == 0 ? std::optional<uint64_t>(rs2) : std::nullopt;
+    }
+    if (atomic.operation == AtomicOperation::SWAP) {
+        return rs2;
+    }
+    if (atomic.rdIndex == 0) {
+        return std::nullopt;
+    }
+    // word operations compare the low halves, the high half of the result is ignored by the store
+    const bool word = atomic.size == 4;
+    const int64_t signed_old = word ? static_cast<int32_t>(rd_after) : static_cast<int64_t>(rd_after);
+    const int64_t signed_rs2 = word ? static_cast<int32_t>(rs2) : static_cast<int64_t>(rs2);
+    const uint64_t unsigned_old = word ? static_cast<uint32_t>(rd_after) : rd_after;
+    const uint64_t unsigned_rs2 = word ? static_cast<uint32_t>(rs2) : rs2;
+    switch (atomic.operation) {
+    case AtomicOperation::ADD:
+        return rd_after + rs2;
+    case AtomicOperation::XOR:
+        return rd_after ^ rs2;
+    case AtomicOperation::AND:
+        return rd_after & rs2;
+    case AtomicOperation::OR:
+        return rd_after | rs2;
+    case AtomicOperation::MIN:
+        return signed_old < signed_rs2 ? rd_after : rs2;
+    case AtomicOperation::MAX:
+        return signed_old > signed_rs2 ? rd_after : rs2;
+    case AtomicOperation::MINU:
+        return unsigned_old < unsigned_rs2 ? rd_after : rs2;
+    case AtomicOperation::MAXU:
+        return unsigned_old > unsigned_rs2 ? rd_after : rs2;
+    default:
+        return std::nullopt;
+    }
+}
+
+RISCV64Decode::ControlTransfer RISCV64Decode::control_transfer(uint32_t instr) {
+    if ((instr & 0b11) != 0b11) {
+        // c.jr and c.jalr: quadrant 2, funct3 100, rs2 zero, nonzero rs1
+        const uint8_t rs1 = (instr >> 7) & 0b11111;
+        if ((instr & 0b11) != 0b10 || ((instr >> 13) & 0b111) != 0b100 || ((instr >> 2) & 0b11111) != 0 || rs1 == 0) {
+            return ControlTransfer::NONE;
+        }
+        return jalr_transfer((instr >> 12) & 1 ? 1 : 0, rs1);
+    }
+    const uint8_t opcode = instr & OPCODE_MASK;
+    const uint8_t rd = (instr >> 7) & 0b11111;
+    if (opcode == JAL_OPCODE) {
+        return is_link_register(rd) ? ControlTransfer::CALL : ControlTransfer::NONE;
+    }
+    if (opcode == JALR_OPCODE) {
+        return jalr_transfer(rd, (instr >> 15) & 0b11111);
+    }
+    return ControlTransfer::NONE;
+}
+
+RISCV64Decode::InstructionClass RISCV64Decode::classify(uint32_t instr) {
+    // compressed instructions keep funct3 in the top bits of their half word
+    const uint8_t compressed_funct3 = (instr >> 13) & 0b111;
+    switch (instr & 0b11) {
+    case 0b00:
+        if (compressed_funct3 == 0b000) {
+            return InstructionClass::ALU;
+        }
+        return compressed_funct3 < 0b100 ? InstructionClass::LOAD : InstructionClass::STORE;
+    case 0b01:
+        if (compressed_funct3 == 0b101) {
+            return InstructionClass::JUMP;
+        }
+        return compressed_funct3 >= 0b110 ? InstructionClass::BRANCH : InstructionClass::ALU;
+    case 0b10:
+        if (compressed_funct3 == 0b000) {
+            return InstructionClass::ALU;
+        }
+        if (compressed_funct3 < 0b100) {
+            return InstructionClass::LOAD;
+        }
+        if (compressed_funct3 > 0b100) {
+            return InstructionClass::STORE;
+        }
+        // c.jr, c.jalr and c.ebreak have no rs2, c.mv and c.add have one
+        if (((instr >> 2) & 0b11111) != 0) {
+            return InstructionClass::ALU;
+        }
+        return ((instr >> 7) & 0b11111) != 0 ? InstructionClass::JUMP : InstructionClass::SYSTEM;
+    default:
+        break;
+    }
+    const uint8_t funct3 = (instr >> 12) & 0b111;
+    switch (instr & OPCODE_MASK) {
+    case LOAD_OPCODE:
+    case 0b0000111:
+        return InstructionClass::LOAD;
+    case STORE_OPCODE:
+    case 0b0100111:
+        return InstructionClass::STORE;
+    case 0b0010011:
+    case 0b0011011:
+    case 0b0110111:
+    case 0b0010111:
+        return InstructionClass::ALU;
+    case 0b0110011:
+    case 0b0111011:
+        if ((instr >> 25) == 0b0000001) {
+            return funct3 < 0b100 ? InstructionClass::MUL : InstructionClass::DIV;
+        }
+        return InstructionClass::ALU;
+    case 0b1100011:
+        return InstructionClass::BRANCH;
+    case JAL_OPCODE:
+    case JALR_OPCODE:
+        return InstructionClass::JUMP;
+    case AMO_OPCODE:
+        return InstructionClass::ATOMIC;
+    case 0b1000011:
+    case 0b1000111:
+    case 0b1001011:
+    case 0b1001111:
+    case 0b1010011:
+        return InstructionClass::FLOAT;
+    case 0b1110011:
+        return funct3 != 0 ? InstructionClass::CSR : InstructionClass::SYSTEM;
+    case 0b0001111:
+        return InstructionClass::SYSTEM;
+    default:
+        return InstructionClass::OTHER;
+    }
+}
+
+std::optional<size_t> RISCV64Decode::register_index(std::string_view name) {
+    if (name.size() > 1 && name[0] == 'x') {
+        size_t index;
+        auto [ptr, ec] = std::from_chars(name.data() + 1, name.data() + name.size(), index);
+        if (ec == std::errc() && ptr == name.data() + name.size() && index < 32) {
+            return index;
+        }
+        return std::nullopt;
+    }
+    if (name == "s0") {
+        return 8;
+    }
+    for (size_t i = 0; i < 32; ++i) {
+        if (name == abi_register_names[i]) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
@@ -1,50 +1,135 @@
 #include "RISCV64_model.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <iostream>
 #include <map>
-#include <sstream>
+#include <string_view>
 
 #include "RISCV64_decode.hpp"
+#include "stats.hpp"
+#include "trace_query.hpp"
+
+namespace {
+    // load progress is published and cancellation checked once per this many lines
+    constexpr size_t PROGRESS_LINES_MASK = (1 << 12) - 1;
+
+    bool is_blank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    class FieldReader {
+        const char* cur;
+        const char* end;
+    public:
+        explicit FieldReader(std::string_view line) : cur(line.data()), end(line.data() + line.size()) {}
+        std::string_view next() {
+            while (cur != end && is_blank(*cur)) {
+                ++cur;
+            }
+            const char* start = cur;
+            while (cur != end && !is_blank(*cur)) {
+                ++cur;
+            }
+            return std::string_view(start, cur - start);
+        }
+    };
+
+    template <typename T>
+    bool parse_number(std::string_view field, T& value, int base) {
+        if (base == 16 && field.size() > 2 && field[0] == '0' && (field[1] == 'x' || field[1] == 'X')) {
+            field.remove_prefix(2);
+        }
+        const char* field_end = field.data() + field.size();
+        auto [ptr, ec] = std::from_chars(field.data(), field_end, value, base);
+        return ec == std::errc() && ptr == field_end;
+    }
+}
 
 TraceLine::TraceLine(const std::string& line) {
-    std::stringstream view(line);
-    view >> time;
-    view >> rsv1;
-    rsv2 = ' ';
-    while (rsv2 == ' ') {
-        view >> rsv2;
-    }
-    view >> std::hex;
-    view >> cur_pc;
-    view >> instr;
-    view >> next_pc;
-    if (!view.eof()) {
-        std::string reg_update_descr;
-        view >> reg_update_descr;
-        char type_char = reg_update_descr[0];
-        int index = std::stoi(reg_update_descr.c_str() + 1);
-        changed_reg = RegisterDescription();
-        if (type_char == 'x') {
-            changed_reg->type = RegType::INT;
-        }
-        if (type_char == 'f') {
-            changed_reg->type = RegType::FLOAT;
-        }
-        changed_reg->index = index;
-        const char* value_start = reg_update_descr.c_str();
-        while (*value_start != '=') {
-            ++value_start;
-        }
-        ++value_start;
-        new_reg_val = std::stoull(value_start, nullptr, 16);
+    TraceParseError error = parse(line, *this);
+    if (error != TraceParseError::NONE) {
+        throw TraceParseException(error);
     }
 }
 
+TraceParseError TraceLine::parse(std::string_view line, TraceLine& out) noexcept {
+    FieldReader reader(line);
+    std::string_view field;
+    auto next_number = [&reader, &field](auto& value, int base) {
+        field = reader.next();
+        if (field.empty()) {
+            return TraceParseError::MISSING_FIELD;
+        }
+        return parse_number(field, value, base) ? TraceParseError::NONE : TraceParseError::BAD_FIELD;
+    };
+    TraceParseError error;
+    if ((error = next_number(out.time, 10)) != TraceParseError::NONE ||
+        (error = next_number(out.rsv1, 10)) != TraceParseError::NONE) {
+        return error;
+    }
+    field = reader.next();
+    if (field.empty()) {
+        return TraceParseError::MISSING_FIELD;
+    }
+    if (field.size() != 1) {
+        return TraceParseError::BAD_FIELD;
+    }
+    out.rsv2 = field[0];
+    if ((error = next_number(out.cur_pc, 16)) != TraceParseError::NONE ||
+        (error = next_number(out.instr, 16)) != TraceParseError::NONE ||
+        (error = next_number(out.next_pc, 16)) != TraceParseError::NONE) {
+        return error;
+    }
+    out.changed_reg = std::nullopt;
+    out.new_reg_val = std::nullopt;
+    std::string_view reg_update_descr = reader.next();
+    if (reg_update_descr.empty()) {
+        return TraceParseError::NONE;
+    }
+    RegisterDescription reg;
+    if (reg_update_descr[0] == 'x') {
+        reg.type = RegType::INT;
+    } else if (reg_update_descr[0] == 'f') {
+        reg.type = RegType::FLOAT;
+    } else {
+        return TraceParseError::BAD_REGISTER;
+    }
+    size_t eq_pos = reg_update_descr.find('=');
+    uint64_t value;
+    if (eq_pos == std::string_view::npos ||
+        !parse_number(reg_update_descr.substr(1, eq_pos - 1), reg.index, 10) ||
+        reg.index >= 32 ||
+        !parse_number(reg_update_descr.substr(eq_pos + 1), value, 16)) {
+        return TraceParseError::BAD_REGISTER;
+    }
+    out.changed_reg = reg;
+    out.new_reg_val = value;
+    return TraceParseError::NONE;
+}
+
 void RISCV64Model::init(std::istream& trace_input, const std::string& filename) {
     trace_name = filename;
+    const bool collect_stats = stats::enabled();
+    std::chrono::nanoseconds read_time{0};
+    std::chrono::nanoseconds parse_time{0};
+    std::chrono::nanoseconds build_time{0};
+    std::chrono::nanoseconds call_stack_time{0};
+    uint64_t bytes_read = 0;
+    load_errors = TraceLoadErrors();
     size_t line_number = 0;
+    stats::LapTimer timer(collect_stats);
     for (std::string line; trace_input.good(), ++line_number;) {
         std::getline(trace_input, line);
+        timer.lap(read_time);
+        if ((line_number & PROGRESS_LINES_MASK) == 0) {
+            load_progress.lines_read.store(line_number, std::memory_order_relaxed);
+            if (load_progress.cancelled.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        bytes_read += line.size() + 1;
         const char* first_no_space = line.c_str();
         if (line.empty()) {
             break;
@@ -55,43 +140,151 @@ void RISCV64Model::init(std::istream& trace_input, const std::string& filename)
         if (*first_no_space == '#') {
             continue;
         }
-        try {
-            TraceLine trace_line(line);
-            trace_events.emplace_back(trace_line, *this);
-            step_forward();
-        } catch (std::exception& e) {
-            std::cerr << "Error (" << e.what() << ") on reading line " << line_number << ": " << line << std::endl;
-        } catch (...) {
-            std::cerr << "Error on reading line " << line_number << ": " << line << std::endl;
+        TraceLine trace_line;
+        TraceParseError error = TraceLine::parse(line, trace_line);
+        timer.lap(parse_time);
+        if (error != TraceParseError::NONE) {
+            if (load_config.strict) {
+                throw TraceLoadException(trace_name, line_number, error);
+            }
+            load_errors.add(line_number, line, error, load_config.max_error_samples);
+            continue;
         }
+        TraceEntry event(trace_line, *this);
+        apply_event(event);
+        trace_events->append(event);
+        timer.lap(build_time);
     }
+    load_progress.lines_read.store(line_number - 1, std::memory_order_relaxed);
+    trace_events->finish_loading();
+    timer.lap(build_time);
+    calls = CallStack::build(*trace_events);
+    timer.lap(call_stack_time);
     cur_event_id = 0;
-    pc = trace_events[cur_event_id].pc;
+    pc = trace_events->size() > 0 ? trace_events->get(0).pc : 0;
     for (size_t i = 0; i < 32; ++i) {
+        tail_reg_array[i] = integer_reg_array[i];
         integer_reg_array[i] = 0;
     }
+    if (load_errors.total() > 0) {
+        report_load_errors();
+    }
+    if (collect_stats) {
+        stats::add_time("load.read", read_time);
+        stats::add_time("load.parse", parse_time);
+        stats::add_time("load.build", build_time);
+        stats::add_time("load.call_stack", call_stack_time);
+        stats::add_count("load.lines", line_number - 1);
+        stats::add_count("load.bad_lines", load_errors.total());
+        stats::add_count("load.bytes", bytes_read);
+        stats::add_count("load.events", trace_events->size());
+    }
 }
 
-void RISCV64Model::set_state_pc(uint64_t address) {
-    while(trace_events[cur_event_id].pc != address) {
-        step_forward();
-        if (cur_event_id >= trace_events.size()) {
-            throw NoSuchPcException(address);
+void RISCV64Model::init_csrs(std::istream& csr_input, const std::string& filename) {
+    stats::ScopedTimer timer("load.csrs");
+    csrs = CsrIndex::load(csr_input, filename, *trace_events, load_config.strict);
+    if (csrs.skipped_lines() > 0) {
+        std::cerr << filename << ": skipped " << csrs.skipped_lines() << " malformed lines\n";
+    }
+}
+
+size_t RISCV64Model::append_trace(std::istream& trace_input) {
+    const size_t first_new = trace_events->size();
+    const size_t errors_before = load_errors.total();
+    size_t line_number = load_progress.lines_read.load(std::memory_order_relaxed);
+    std::optional<TraceLoadException> strict_error;
+    for (std::string line; std::getline(trace_input, line);) {
+        ++line_number;
+        const char* first_no_space = line.c_str();
+        while (is_blank(*first_no_space)) {
+            ++first_no_space;
+        }
+        if (*first_no_space == '\0' || *first_no_space == '#') {
+            continue;
+        }
+        TraceLine trace_line;
+        TraceParseError error = TraceLine::parse(line, trace_line);
+        if (error != TraceParseError::NONE) {
+            if (load_config.strict) {
+                // the events before it are still appended and indexed
+                strict_error.emplace(trace_name, line_number, error);
+                break;
+            }
+            load_errors.add(line_number, line, error, load_config.max_error_samples);
+            continue;
         }
-    }    
+        std::optional<RegisterUpdateEvent> changed_reg;
+        if (trace_line.changed_reg) {
+            const auto& reg = trace_line.changed_reg.value();
+            changed_reg = RegisterUpdateEvent(reg, trace_line.new_reg_val.value(), tail_reg_array[reg.index]);
+            if (reg.type == RegType::INT) {
+                tail_reg_array[reg.index] = trace_line.new_reg_val.value();
+            }
+        }
+        trace_events->append(TraceEntry(trace_line.time, trace_line.cur_pc, trace_line.instr, changed_reg));
+    }
+    load_progress.lines_read.store(line_number, std::memory_order_relaxed);
+    calls.extend(*trace_events);
+    csrs.events_appended(*trace_events, first_new);
+    if (first_new == 0 && cur_event_id == 0 && trace_events->size() > 0) {
+        pc = trace_events->get(0).pc;
+    }
+    if (load_errors.total() > errors_before) {
+        std::cerr << trace_name << ": skipped " << load_errors.total() - errors_before << " malformed appended lines\n";
+    }
+    if (strict_error) {
+        throw strict_error.value();
+    }
+    return trace_events->size() - first_new;
 }
 
-bool RISCV64Model::step_forward() {
-    if (cur_event_id == trace_events.size()) {
-        return false;
+void RISCV64Model::append_csrs(std::istream& csr_input, const std::string& filename) {
+    csrs.append(csr_input, filename, *trace_events, load_config.strict);
+}
+
+void RISCV64Model::report_load_errors() const {
+    std::cerr << trace_name << ": skipped " << load_errors.total() << " malformed lines (";
+    const char* separator = "";
+    for (size_t i = 0; i < load_errors.counts.size(); ++i) {
+        if (load_errors.counts[i] > 0) {
+            std::cerr << separator << trace_parse_error_name(static_cast<TraceParseError>(i)) << ": " << load_errors.counts[i];
+            separator = ", ";
+        }
+    }
+    std::cerr << ")\n";
+    for (const auto& sample : load_errors.samples) {
+        std::cerr << "  line " << sample.line_number << " (" << trace_parse_error_name(sample.error) << "): " << sample.text << '\n';
+    }
+    if (load_errors.samples.size() < load_errors.total()) {
+        std::cerr << "  ...\n";
+    }
+}
+
+void RISCV64Model::set_state_pc(uint64_t address) {
+    TraceQuery query;
+    query.pc = ValueRange{address, address};
+    auto found = find_events(*trace_events, query, cur_event_id, 1);
+    if (found.empty()) {
+        throw NoSuchPcException(address);
     }
-    const auto& event = trace_events[cur_event_id];
+    seek_event(found[0]);
+}
+
+void RISCV64Model::apply_event(const TraceEntry& event) {
     pc = event.pc;
     if (event.changed_reg.has_value()) {
         if (event.changed_reg->reg.type == RegType::INT) {
             integer_reg_array[event.changed_reg->reg.index] = event.changed_reg->val;
         }
     }
+}
+
+bool RISCV64Model::step_forward() {
+    if (cur_event_id == trace_events->size()) {
+        return false;
+    }
+    apply_event(trace_events->get(cur_event_id));
     ++cur_event_id;
     return true;
 }
@@ -101,17 +294,40 @@ bool RISCV64Model::step_back() {
         return false;
     }
     --cur_event_id;
-    const auto& cur_event = trace_events[cur_event_id];
+    const auto cur_event = trace_events->get(cur_event_id);
     if (cur_event.changed_reg.has_value()) {
         uint64_t old_value = cur_event.changed_reg->prev;
         size_t changed_reg_index = cur_event.changed_reg->reg.index;
         integer_reg_array[changed_reg_index] = old_value;
     }
-    const auto& prev_event = trace_events[cur_event_id - 1];
-    pc = prev_event.pc;
+    pc = trace_events->get(cur_event_id > 0 ? cur_event_id - 1 : 0).pc;
     return true;
 }
 
+void RISCV64Model::seek_time(uint64_t time) {
+    size_t first_after = 0;
+    size_t last = trace_events->size();
+    while (first_after < last) {
+        size_t middle = first_after + (last - first_after) / 2;
+        if (trace_events->get(middle).time <= time) {
+            first_after = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    seek_event(first_after > 0 ? first_after - 1 : 0);
+}
+
+void RISCV64Model::seek_event(size_t event_id) {
+    event_id = std::min(event_id, trace_events->size());
+    while (cur_event_id < event_id) {
+        step_forward();
+    }
+    while (cur_event_id > event_id) {
+        step_back();
+    }
+}
+
 uint64_t RISCV64Model::read_register(size_t index) const {
     if (index >= 32) {
         std::string reg_name = "x" + std::to_string(index);
@@ -125,16 +341,26 @@ uint64_t RISCV64Model::read_pc() const {
 }
 
 uint64_t RISCV64Model::cur_time() const {
-    if (cur_event_id < trace_events.size()) {
-        return trace_events.at(cur_event_id).time;
+    if (cur_event_id < trace_events->size()) {
+        return trace_events->get(cur_event_id).time;
     }
-    return trace_events.at(cur_event_id - 1).time;
+    if (cur_event_id == 0) {
+        return 0;
+    }
+    return trace_events->get(cur_event_id - 1).time;
 }
 
 uint64_t RISCV64Model::read_register(const std::string& name) const {
     if (name.starts_with("pc")) {
         return pc;
     }
+    if (csrs.contains(name)) {
+        auto value = csrs.read(name, cur_event_id);
+        if (!value) {
+            throw UnknownCsrValueException(name, cur_event_id);
+        }
+        return value.value();
+    }
     if (name[0] != 'x') {
         throw NoSuchRegisterException(name);
     }
@@ -147,14 +373,19 @@ std::vector<std::pair<std::string, uint64_t>> RISCV64Model::get_all_regs() const
     for (size_t i = 0; i < 32; ++i) {
         res.push_back({"x" + std::to_string(i), integer_reg_array[i]});
     }
+    for (const auto& name : csrs.names()) {
+        if (auto value = csrs.read(name, cur_event_id)) {
+            res.push_back({name, value.value()});
+        }
+    }
     return res;
 }
 
 uint64_t RISCV64Model::read_memory_dword(uint64_t address) const {
-    for (size_t i = cur_event_id; i > 0; --i) {
-        const auto& event = trace_events.at(i);
+    for (size_t i = std::min(cur_event_id, trace_events->size() - 1); i > 0; --i) {
+        const auto event = trace_events->get(i);
         auto decoded = RISCV64Decode::decode(event.instr);
-        if (decoded.type == RISCV64Decode::InstructionType::UNSUPPORTED) {
+        if (decoded.type != RISCV64Decode::InstructionType::LOAD && decoded.type != RISCV64Decode::InstructionType::STORE) {
             continue;
         }
         uint64_t accessed_address;
@@ -176,7 +407,7 @@ uint64_t RISCV64Model::read_memory_dword(uint64_t address) const {
             return event.changed_reg->val;
         }
         for (size_t j = i; j > 0; --j) {
-            const auto& event = trace_events.at(j);
+            const auto event = trace_events->get(j);
             if (!event.changed_reg) {
                 continue;
             }
@@ -211,3 +442,39 @@ uint8_t RISCV64Model::read_memory_byte(uint64_t address) const {
     const uint64_t value = read_memory_dword(base_address);
     return (value >> (offset * 8)) & 0xFF;
 };
+
+std::vector<MemoryAccess> RISCV64Model::memory_accesses(size_t hart_id) const {
+    std::vector<MemoryAccess> res;
+    // addresses and stored values come from the registers before the access
+    uint64_t regs[32] = {0};
+    for (size_t i = 0; i < trace_events->size(); ++i) {
+        const auto event = trace_events->get(i);
+        auto decoded = RISCV64Decode::decode(event.instr);
+        if (decoded.type == RISCV64Decode::InstructionType::LOAD && event.changed_reg) {
+            const auto& load = decoded.content.loadContent;
+            res.push_back({event.time, i, regs[load.rs1Index] + load.offset, event.changed_reg->val,
+                static_cast<uint32_t>(hart_id), load.size, false});
+        } else if (decoded.type == RISCV64Decode::InstructionType::STORE) {
+            const auto& store = decoded.content.storeContent;
+            res.push_back({event.time, i, regs[store.rs1Index] + store.offset, regs[store.rs2Index],
+                static_cast<uint32_t>(hart_id), store.size, true});
+        } else if (decoded.type == RISCV64Decode::InstructionType::ATOMIC) {
+            // an amo loads the old value into rd and stores the result, sc only stores
+            const auto& atomic = decoded.content.atomicContent;
+            const uint64_t address = regs[atomic.rs1Index];
+            const bool writes_rd = atomic.rdIndex != 0 && event.changed_reg && event.changed_reg->reg.type == RegType::INT &&
+                event.changed_reg->reg.index == atomic.rdIndex;
+            const uint64_t rd_after = writes_rd ? event.changed_reg->val : regs[atomic.rdIndex];
+            if (atomic.operation != RISCV64Decode::AtomicOperation::SC && atomic.rdIndex != 0) {
+                res.push_back({event.time, i, address, rd_after, static_cast<uint32_t>(hart_id), atomic.size, false});
+            }
+            if (auto stored = RISCV64Decode::atomic_stored_value(atomic, rd_after, regs[atomic.rs2Index])) {
+                res.push_back({event.time, i, address, stored.value(), static_cast<uint32_t>(hart_id), atomic.size, true});
+            }
+        }
+        if (event.changed_reg && event.changed_reg->reg.type == RegType::INT) {
+            regs[event.changed_reg->reg.index] = event.changed_reg->val;
+        }
+    }
+    return res;
+}
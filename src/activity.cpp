@@ -0,0 +1,177 @@
+#include "activity.hpp"
+
+#include "RISCV64_decode.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+    constexpr size_t FUNCTION_BITS = 512;
+
+    // visits events [first, last) with their stall and the entry pc of their frame
+    template <typename Visitor>
+    void visit_events(const ITraceStore& store, const CallStack& stack, size_t first, size_t last, Visitor visitor) {
+        if (first >= last) {
+            return;
+        }
+        uint64_t previous = first > 0 ? store.get(first - 1).time : store.get(0).time;
+        size_t frame_end = 0;
+        uint64_t entry_pc = 0;
+        store.visit_blocks(first, last, [&](const TraceBlock& block) {
+            const auto& columns = block.columns;
+            for (size_t i = block.begin; i < block.end; ++i) {
+                const size_t event_id = block.first_event + i;
+                if (event_id >= frame_end || event_id == first) {
+                    const uint32_t frame_id = stack.frame_at(event_id);
+                    entry_pc = frame_id == CallFrame::NO_FRAME ? 0 : stack.frame(frame_id).entry_pc;
+                    frame_end = stack.frame_end(event_id);
+                }
+                const uint64_t time = columns.time[i];
+                const uint64_t delta = time > previous ? time - previous : 0;
+                previous = time;
+                visitor(event_id, time, RISCV64Decode::classify(columns.instr[i]), delta > 1 ? delta - 1 : 0, entry_pc);
+            }
+            return true;
+        });
+    }
+
+    void add_event(ActivitySummary& summary, RISCV64Decode::InstructionClass type, uint64_t stall, uint64_t entry_pc) {
+        ++summary.instructions;
+        summary.loads += type == RISCV64Decode::InstructionClass::LOAD;
+        summary.stores += type == RISCV64Decode::InstructionClass::STORE;
+        summary.stall += stall;
+        summary.add_function(entry_pc);
+    }
+}
+
+void ActivitySummary::add_function(uint64_t entry_pc) {
+    const uint64_t bit = (entry_pc * 0x9e3779b97f4a7c15ull) >> (64 - std::countr_zero(FUNCTION_BITS));
+    functions[bit >> 6] |= 1ull << (bit & 63);
+}
+
+void ActivitySummary::merge(const ActivitySummary& other) {
+    instructions += other.instructions;
+    loads += other.loads;
+    stores += other.stores;
+    stall += other.stall;
+    for (size_t i = 0; i < functions.size(); ++i) {
+        functions[i] |= other.functions[i];
+    }
+}
+
+size_t ActivitySummary::function_estimate() const {
+    size_t set = 0;
+    for (uint64_t word : functions) {
+        set += std::popcount(word);
+    }
+    if (set == FUNCTION_BITS) {
+        return FUNCTION_BITS;
+    }
+    const double bits = FUNCTION_BITS;
+    return std::llround(bits * std::log(bits / (bits - set)));
+}
+
+ActivityPyramid ActivityPyramid::build(const ITraceStore& store, const CallStack& stack, uint64_t width) {
+    ActivityPyramid res;
+    const size_t event_count = store.size();
+    if (event_count == 0) {
+        res.bucket_events.push_back(0);
+        return res;
+    }
+    res.origin = store.get(0).time;
+    const uint64_t span = std::max(store.get(event_count - 1).time, res.origin) - res.origin + 1;
+    res.bucket_width = width != 0 ? width : std::max<uint64_t>(1, (span + MAX_BUCKETS - 1) / MAX_BUCKETS);
+    const size_t bucket_count = (span + res.bucket_width - 1) / res.bucket_width;
+    auto& base = res.levels.emplace_back(bucket_count);
+    res.bucket_events.assign(bucket_count + 1, event_count);
+    res.bucket_events[0] = 0;
+    // a time going back stays in the current bucket, so that the events of a bucket are contiguous
+    size_t bucket = 0;
+    visit_events(store, stack, 0, event_count, [&](size_t event_id, uint64_t time, RISCV64Decode::InstructionClass type,
+                                                   uint64_t stall, uint64_t entry_pc) {
+        const size_t event_bucket = time > res.origin ? std::min<size_t>((time - res.origin) / res.bucket_width, bucket_count - 1) : 0;
+        while (bucket < event_bucket) {
+            res.bucket_events[++bucket] = event_id;
+        }
+        add_event(base[bucket], type, stall, entry_pc);
+    });
+    while (res.levels.back().size() > 1) {
+        const auto& below = res.levels.back();
+        std::vector<ActivitySummary> above((below.size() + FANOUT - 1) / FANOUT);
+        for (size_t i = 0; i < below.size(); ++i) {
+            above[i / FANOUT].merge(below[i]);
+        }
+        res.levels.push_back(std::move(above));
+    }
+    return res;
+}
+
+ActivitySummary ActivityPyramid::combine(size_t first_bucket, size_t end_bucket) const {
+    ActivitySummary res;
+    size_t level = 0;
+    while (first_bucket < end_bucket) {
+        while (first_bucket < end_bucket && first_bucket % FANOUT != 0) {
+            res.merge(levels[level][first_bucket++]);
+        }
+        while (first_bucket < end_bucket && end_bucket % FANOUT != 0) {
+            res.merge(levels[level][--end_bucket]);
+        }
+        first_bucket /= FANOUT;
+        end_bucket /= FANOUT;
+        ++level;
+    }
+    return res;
+}
+
+ActivitySummary ActivityPyramid::summarize(const ITraceStore& store, const CallStack& stack, uint64_t first_time,
+                                           uint64_t end_time) const {
+    ActivitySummary res;
+    if (levels.empty()) {
+        return res;
+    }
+    const size_t bucket_count = levels[0].size();
+    first_time = std::max(first_time, origin);
+    if (end_time <= first_time) {
+        return res;
+    }
+    // buckets [first_full, end_full) lie inside the range, the ones before and after it may be partial
+    const uint64_t first_offset = first_time - origin;
+    const uint64_t end_offset = end_time - origin;
+    const size_t first_bucket = std::min<uint64_t>(first_offset / bucket_width, bucket_count);
+    const size_t first_full = std::min<uint64_t>((first_offset + bucket_width - 1) / bucket_width, bucket_count);
+    const size_t end_full = std::max<size_t>(std::min<uint64_t>(end_offset / bucket_width, bucket_count), first_full);
+    const size_t end_bucket = std::min<uint64_t>((end_offset + bucket_width - 1) / bucket_width, bucket_count);
+    auto scan = [&](size_t from_bucket, size_t to_bucket) {
+        visit_events(store, stack, bucket_events[from_bucket], bucket_events[to_bucket],
+                     [&](size_t, uint64_t time, RISCV64Decode::InstructionClass type, uint64_t stall, uint64_t entry_pc) {
+            if (time >= first_time && time < end_time) {
+                add_event(res, type, stall, entry_pc);
+            }
+        });
+    };
+    if (first_full >= end_full) {
+        scan(first_bucket, end_bucket);
+        return res;
+    }
+    scan(first_bucket, first_full);
+    res.merge(combine(first_full, end_full));
+    scan(end_full, end_bucket);
+    return res;
+}
+
+uint64_t ActivityPyramid::node_width(size_t index) const {
+    uint64_t res = bucket_width;
+    for (size_t i = 0; i < index; ++i) {
+        res *= FANOUT;
+    }
+    return res;
+}
+
+size_t ActivityPyramid::memory_footprint() const {
+    size_t res = bucket_events.capacity() * sizeof(size_t);
+    for (const auto& level : levels) {
+        res += level.capacity() * sizeof(ActivitySummary);
+    }
+    return res;
+}
@@ -0,0 +1,375 @@
+#include "break_condition.hpp"
+
+#include "RISCV64_decode.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <optional>
+#include <string_view>
+
+namespace {
+    using Op = BreakCondition::Op;
+    using Instruction = BreakCondition::Instruction;
+
+    struct BinaryOperator {
+        std::string_view token;
+        Op op;
+    };
+
+    constexpr std::string_view two_char_tokens[] = {"<=", ">=", "==", "!=", "&&", "||", "<<", ">>"};
+
+    class Compiler {
+        std::string_view text;
+        size_t pos = 0;
+        std::vector<Instruction>& code;
+        size_t depth = 0;
+        size_t nesting = 0;
+
+        [[noreturn]] void fail(const std::string& message) const {
+            throw BreakConditionException(message + " at position " + std::to_string(pos) + " of '" + std::string(text) + '\'');
+        }
+
+        void skip_spaces() {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+                ++pos;
+            }
+        }
+
+        bool accept(std::string_view token) {
+            skip_spaces();
+            if (text.substr(pos, token.size()) != token) {
+                return false;
+            }
+            if (token.size() == 1) {
+                for (auto longer : two_char_tokens) {
+                    if (text.substr(pos, 2) == longer) {
+                        return false;
+                    }
+                }
+            }
+            pos += token.size();
+            return true;
+        }
+
+        void expect(std::string_view token) {
+            if (!accept(token)) {
+                fail("expected '" + std::string(token) + '\'');
+            }
+        }
+
+        // bounds the recursion of the compiler on deeply nested input
+        template <typename Parse>
+        void nested(Parse parse) {
+            if (++nesting > BreakCondition::MAX_NESTING) {
+                fail("expression is nested too deeply");
+            }
+            parse();
+            --nesting;
+        }
+
+        size_t emit(Op op, uint64_t operand = 0) {
+            switch (op) {
+            case Op::PUSH:
+            case Op::REG:
+            case Op::PC:
+            case Op::TIME:
+            case Op::HART:
+            case Op::HITS:
+                if (++depth > BreakCondition::MAX_STACK) {
+                    fail("expression is too deep");
+                }
+                break;
+            case Op::LOAD8:
+            case Op::LOAD16:
+            case Op::LOAD32:
+            case Op::LOAD64:
+            case Op::NOT:
+            case Op::NEG:
+            case Op::INV:
+            case Op::BOOL:
+                break;
+            default:
+                --depth;
+            }
+            code.push_back({op, operand});
+            return code.size() - 1;
+        }
+
+        void binary_level(const std::initializer_list<BinaryOperator>& operators, void (Compiler::*operand)()) {
+            (this->*operand)();
+            bool matched = true;
+            while (matched) {
+                matched = false;
+                for (const auto& candidate : operators) {
+                    if (accept(candidate.token)) {
+                        (this->*operand)();
+                        emit(candidate.op);
+                        matched = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        void short_circuit_level(std::string_view token, Op jump, void (Compiler::*operand)()) {
+            (this->*operand)();
+            std::vector<size_t> jumps;
+            while (accept(token)) {
+                if (jumps.empty()) {
+                    emit(Op::BOOL);
+                }
+                jumps.push_back(emit(jump));
+                (this->*operand)();
+                emit(Op::BOOL);
+            }
+            for (size_t jump_pos : jumps) {
+                code[jump_pos].operand = code.size();
+            }
+        }
+
+        void primary() {
+            skip_spaces();
+            if (accept("(")) {
+                nested([this] { logical_or(); });
+                expect(")");
+                return;
+            }
+            if (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                int base = 10;
+                if (text.substr(pos, 2) == "0x" || text.substr(pos, 2) == "0X") {
+                    base = 16;
+                    pos += 2;
+                }
+                uint64_t value;
+                auto [ptr, ec] = std::from_chars(text.data() + pos, text.data() + text.size(), value, base);
+                if (ec != std::errc()) {
+                    fail("bad number");
+                }
+                pos = ptr - text.data();
+                emit(Op::PUSH, value);
+                return;
+            }
+            size_t start = pos;
+            while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')) {
+                ++pos;
+            }
+            std::string_view name = text.substr(start, pos - start);
+            if (name.empty()) {
+                fail("expected operand");
+            }
+            if (name == "pc") {
+                emit(Op::PC);
+            } else if (name == "time") {
+                emit(Op::TIME);
+            } else if (name == "hart") {
+                emit(Op::HART);
+            } else if (name == "hits") {
+                emit(Op::HITS);
+            } else if (name == "byte" || name == "hword" || name == "word" || name == "dword") {
+                expect("[");
+                nested([this] { logical_or(); });
+                expect("]");
+                emit(name == "byte" ? Op::LOAD8 : name == "hword" ? Op::LOAD16 : name == "word" ? Op::LOAD32 : Op::LOAD64);
+            } else if (auto index = RISCV64Decode::register_index(name)) {
+                emit(Op::REG, index.value());
+            } else {
+                pos = start;
+                fail("unknown name '" + std::string(name) + '\'');
+            }
+        }
+
+        void unary() {
+            if (accept("!")) {
+                nested([this] { unary(); });
+                emit(Op::NOT);
+            } else if (accept("~")) {
+                nested([this] { unary(); });
+                emit(Op::INV);
+            } else if (accept("-")) {
+                nested([this] { unary(); });
+                emit(Op::NEG);
+            } else {
+                primary();
+            }
+        }
+
+        void product() {
+            binary_level({{"*", Op::MUL}, {"/", Op::DIV}, {"%", Op::MOD}}, &Compiler::unary);
+        }
+
+        void sum() {
+            binary_level({{"+", Op::ADD}, {"-", Op::SUB}}, &Compiler::product);
+        }
+
+        void shift() {
+            binary_level({{"<<", Op::SHL}, {">>", Op::SHR}}, &Compiler::sum);
+        }
+
+        void relation() {
+            binary_level({{"<=", Op::LE}, {">=", Op::GE}, {"<", Op::LT}, {">", Op::GT}}, &Compiler::shift);
+        }
+
+        void equality() {
+            binary_level({{"==", Op::EQ}, {"!=", Op::NE}}, &Compiler::relation);
+        }
+
+        void bit_and() {
+            binary_level({{"&", Op::AND}}, &Compiler::equality);
+        }
+
+        void bit_xor() {
+            binary_level({{"^", Op::XOR}}, &Compiler::bit_and);
+        }
+
+        void bit_or() {
+            binary_level({{"|", Op::OR}}, &Compiler::bit_xor);
+        }
+
+        void logical_and() {
+            short_circuit_level("&&", Op::JUMP_IF_ZERO_OR_POP, &Compiler::bit_or);
+        }
+
+        void logical_or() {
+            short_circuit_level("||", Op::JUMP_IF_NONZERO_OR_POP, &Compiler::logical_and);
+        }
+    public:
+        Compiler(std::string_view expression, std::vector<Instruction>& output) : text(expression), code(output) {}
+
+        void compile() {
+            logical_or();
+            skip_spaces();
+            if (pos != text.size()) {
+                fail("unexpected '" + std::string(1, text[pos]) + '\'');
+            }
+        }
+    };
+}
+
+BreakCondition::BreakCondition(const std::string& expression) : text(expression) {
+    Compiler(text, code).compile();
+}
+
+bool BreakCondition::evaluate(const IModel& model, size_t hart_id, uint64_t hits, const MemoryReader* memory) const {
+    uint64_t stack[MAX_STACK];
+    size_t top = 0;
+    for (size_t ip = 0; ip < code.size(); ++ip) {
+        const Instruction& instr = code[ip];
+        uint64_t rhs;
+        switch (instr.op) {
+        case Op::PUSH:
+            stack[top++] = instr.operand;
+            continue;
+        case Op::REG:
+            stack[top++] = model.read_register(static_cast<size_t>(instr.operand));
+            continue;
+        case Op::PC:
+            stack[top++] = model.read_pc();
+            continue;
+        case Op::TIME:
+            stack[top++] = model.cur_time();
+            continue;
+        case Op::HART:
+            stack[top++] = hart_id;
+            continue;
+        case Op::HITS:
+            stack[top++] = hits;
+            continue;
+        case Op::LOAD8:
+            stack[top - 1] = memory ? (*memory)(stack[top - 1], 1) : model.read_memory_byte(stack[top - 1]);
+            continue;
+        case Op::LOAD16:
+            stack[top - 1] = memory ? (*memory)(stack[top - 1], 2) : model.read_memory_hword(stack[top - 1]);
+            continue;
+        case Op::LOAD32:
+            stack[top - 1] = memory ? (*memory)(stack[top - 1], 4) : model.read_memory_word(stack[top - 1]);
+            continue;
+        case Op::LOAD64:
+            stack[top - 1] = memory ? (*memory)(stack[top - 1], 8) : model.read_memory_dword(stack[top - 1]);
+            continue;
+        case Op::NOT:
+            stack[top - 1] = !stack[top - 1];
+            continue;
+        case Op::NEG:
+            stack[top - 1] = -stack[top - 1];
+            continue;
+        case Op::INV:
+            stack[top - 1] = ~stack[top - 1];
+            continue;
+        case Op::BOOL:
+            stack[top - 1] = stack[top - 1] != 0;
+            continue;
+        case Op::JUMP_IF_ZERO_OR_POP:
+            if (stack[top - 1] == 0) {
+                ip = instr.operand - 1;
+            } else {
+                --top;
+            }
+            continue;
+        case Op::JUMP_IF_NONZERO_OR_POP:
+            if (stack[top - 1] != 0) {
+                ip = instr.operand - 1;
+            } else {
+                --top;
+            }
+            continue;
+        default:
+            break;
+        }
+        rhs = stack[--top];
+        uint64_t& lhs = stack[top - 1];
+        switch (instr.op) {
+        case Op::MUL:
+            lhs *= rhs;
+            break;
+        case Op::DIV:
+        case Op::MOD:
+            if (rhs == 0) {
+                throw BreakConditionException("division by zero in '" + text + '\'');
+            }
+            lhs = instr.op == Op::DIV ? lhs / rhs : lhs % rhs;
+            break;
+        case Op::ADD:
+            lhs += rhs;
+            break;
+        case Op::SUB:
+            lhs -= rhs;
+            break;
+        case Op::SHL:
+            lhs = rhs < 64 ? lhs << rhs : 0;
+            break;
+        case Op::SHR:
+            lhs = rhs < 64 ? lhs >> rhs : 0;
+            break;
+        case Op::LT:
+            lhs = lhs < rhs;
+            break;
+        case Op::LE:
+            lhs = lhs <= rhs;
+            break;
+        case Op::GT:
+            lhs = lhs > rhs;
+            break;
+        case Op::GE:
+            lhs = lhs >= rhs;
+            break;
+        case Op::EQ:
+            lhs = lhs == rhs;
+            break;
+        case Op::NE:
+            lhs = lhs != rhs;
+            break;
+        case Op::AND:
+            lhs &= rhs;
+            break;
+        case Op::XOR:
+            lhs ^= rhs;
+            break;
+        case Op::OR:
+            lhs |= rhs;
+            break;
+        default:
+            break;
+        }
+    }
+    return stack[0] != 0;
+}
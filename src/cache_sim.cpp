@@ -0,0 +1,360 @@
+#include "cache_sim.hpp"
+
+#include "RISCV64_decode.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    constexpr size_t MAX_PLRU_WAYS = 64;
+
+    std::vector<std::string> split(const std::string& value, char separator) {
+        std::vector<std::string> res;
+        std::stringstream stream(value);
+        std::string part;
+        while (std::getline(stream, part, separator)) {
+            res.push_back(part);
+        }
+        return res;
+    }
+
+    size_t parse_size(const std::string& value) {
+        size_t pos = 0;
+        size_t res = 0;
+        try {
+            res = std::stoull(value, &pos);
+        } catch (const std::logic_error& e) {
+            throw CacheSimException("bad size " + value);
+        }
+        std::string suffix = value.substr(pos);
+        if (suffix == "k" || suffix == "K") {
+            res <<= 10;
+        } else if (suffix == "m" || suffix == "M") {
+            res <<= 20;
+        } else if (!suffix.empty()) {
+            throw CacheSimException("bad size " + value);
+        }
+        return res;
+    }
+
+    std::string format_size(size_t size) {
+        if (size % (1 << 20) == 0) {
+            return std::to_string(size >> 20) + 'm';
+        }
+        if (size % (1 << 10) == 0) {
+            return std::to_string(size >> 10) + 'k';
+        }
+        return std::to_string(size);
+    }
+
+    const char* policy_name(ReplacementPolicy policy) {
+        switch (policy) {
+        case ReplacementPolicy::LRU:
+            return "lru";
+        case ReplacementPolicy::FIFO:
+            return "fifo";
+        case ReplacementPolicy::RANDOM:
+            return "random";
+        case ReplacementPolicy::PLRU:
+            return "plru";
+        }
+        return "";
+    }
+
+    void count_access(CacheLevelStats& stats, const CacheAccess& access, uint64_t line_address, bool hit) {
+        if (access.is_store) {
+            ++stats.stores;
+            stats.store_misses += !hit;
+        } else {
+            ++stats.loads;
+            stats.load_misses += !hit;
+        }
+        if (!hit) {
+            ++stats.pc_misses[access.pc];
+            ++stats.line_misses[line_address];
+        }
+    }
+
+    double percent(uint64_t part, uint64_t total) {
+        return total == 0 ? 0.0 : 100.0 * part / total;
+    }
+
+    template <typename Key>
+    std::vector<std::pair<Key, uint64_t>> top_entries(const std::unordered_map<Key, uint64_t>& counts, size_t top) {
+        std::vector<std::pair<Key, uint64_t>> res(counts.begin(), counts.end());
+        auto by_count = [](const auto& lhs, const auto& rhs) {
+            return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+        };
+        const size_t count = std::min(top, res.size());
+        std::partial_sort(res.begin(), res.begin() + count, res.end(), by_count);
+        res.resize(count);
+        return res;
+    }
+
+    void write_level(std::ostream& out, const std::string& name, const CacheLevelStats& stats, size_t top,
+                     const std::function<std::string(uint64_t pc)>& resolve) {
+        out << name << ": " << stats.accesses() << " accesses, " << stats.misses() << " misses, hit rate "
+            << 100.0 - percent(stats.misses(), stats.accesses()) << "% (loads "
+            << 100.0 - percent(stats.load_misses, stats.loads) << "%, stores "
+            << 100.0 - percent(stats.store_misses, stats.stores) << "%)\n";
+        if (stats.misses() == 0 || top == 0) {
+            return;
+        }
+        out << "  hot miss pcs:\n" << std::hex;
+        for (const auto& [pc, misses] : top_entries(stats.pc_misses, top)) {
+            out << "    0x" << pc << std::dec << ' ' << misses << " (" << percent(misses, stats.misses()) << "%)";
+            if (resolve) {
+                std::string location = resolve(pc);
+                if (!location.empty()) {
+                    out << ' ' << location;
+                }
+            }
+            out << '\n' << std::hex;
+        }
+        out << std::dec << "  hot miss lines:\n" << std::hex;
+        for (const auto& [line, misses] : top_entries(stats.line_misses, top)) {
+            out << "    0x" << line << std::dec << ' ' << misses << " (" << percent(misses, stats.misses()) << "%)\n" << std::hex;
+        }
+        out << std::dec;
+    }
+}
+
+CacheConfig CacheConfig::parse(const std::string& spec) {
+    auto parts = split(spec, ':');
+    if (parts.size() != 3 && parts.size() != 4) {
+        throw CacheSimException("expected <size>:<ways>:<line size>[:<policy>], got " + spec);
+    }
+    CacheConfig res{parse_size(parts[0]), parse_size(parts[1]), parse_size(parts[2])};
+    if (parts.size() == 4) {
+        const std::string& name = parts[3];
+        if (name == "lru") {
+            res.policy = ReplacementPolicy::LRU;
+        } else if (name == "fifo") {
+            res.policy = ReplacementPolicy::FIFO;
+        } else if (name == "random") {
+            res.policy = ReplacementPolicy::RANDOM;
+        } else if (name == "plru") {
+            res.policy = ReplacementPolicy::PLRU;
+        } else {
+            throw CacheSimException("unknown replacement policy " + name);
+        }
+    }
+    return res;
+}
+
+std::string CacheConfig::to_string() const {
+    return format_size(size) + ':' + std::to_string(ways) + ':' + std::to_string(line_size) + ':' + policy_name(policy);
+}
+
+CacheHierarchyConfig CacheHierarchyConfig::parse(const std::string& spec) {
+    auto parts = split(spec, ',');
+    if (parts.empty() || parts.size() > 3 || (parts.size() == 3 && parts[2] != "shared")) {
+        throw CacheSimException("expected <l1>[,<l2>[,shared]], got " + spec);
+    }
+    CacheHierarchyConfig res{CacheConfig::parse(parts[0]), std::nullopt, false};
+    if (parts.size() > 1) {
+        res.l2 = CacheConfig::parse(parts[1]);
+    }
+    res.shared_l2 = parts.size() == 3;
+    return res;
+}
+
+std::string CacheHierarchyConfig::to_string() const {
+    std::string res = "l1 " + l1.to_string();
+    if (l2) {
+        res += (shared_l2 ? ", shared l2 " : ", l2 ") + l2->to_string();
+    }
+    return res;
+}
+
+Cache::Cache(const CacheConfig& cache_config) : config(cache_config) {
+    if (!std::has_single_bit(config.line_size) || !std::has_single_bit(config.ways)) {
+        throw CacheSimException("line size and ways must be powers of two");
+    }
+    if (config.size % (config.ways * config.line_size) != 0 ||
+        !std::has_single_bit(config.size / (config.ways * config.line_size))) {
+        throw CacheSimException("size of " + config.to_string() + " is not a power of two number of sets");
+    }
+    if (config.policy == ReplacementPolicy::PLRU && config.ways > MAX_PLRU_WAYS) {
+        throw CacheSimException("pseudo-LRU supports up to 64 ways");
+    }
+    const size_t sets = config.size / (config.ways * config.line_size);
+    line_shift = std::countr_zero(config.line_size);
+    set_mask = sets - 1;
+    way_bits = std::countr_zero(config.ways);
+    tags.assign(sets * config.ways, INVALID);
+    stamps.assign(sets * config.ways, 0);
+    if (config.policy == ReplacementPolicy::PLRU) {
+        tree.assign(sets, 0);
+    }
+}
+
+void Cache::touch(size_t set, size_t way) {
+    uint64_t& bits = tree[set];
+    size_t node = 1;
+    // every node on the path points away from the used way
+    for (unsigned level = way_bits; level-- > 0;) {
+        const uint64_t right = (way >> level) & 1;
+        bits = (bits & ~(1ull << node)) | ((right ^ 1) << node);
+        node = node * 2 + right;
+    }
+}
+
+size_t Cache::victim(size_t set) {
+    const size_t base = set << way_bits;
+    for (size_t way = 0; way < config.ways; ++way) {
+        if (tags[base + way] == INVALID) {
+            return way;
+        }
+    }
+    switch (config.policy) {
+    case ReplacementPolicy::RANDOM:
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        return random_state & (config.ways - 1);
+    case ReplacementPolicy::PLRU: {
+        size_t node = 1;
+        size_t way = 0;
+        for (unsigned level = 0; level < way_bits; ++level) {
+            const uint64_t right = (tree[set] >> node) & 1;
+            way = way * 2 + right;
+            node = node * 2 + right;
+        }
+        return way;
+    }
+    default:
+        return std::min_element(stamps.begin() + base, stamps.begin() + base + config.ways) - stamps.begin() - base;
+    }
+}
+
+bool Cache::access(uint64_t line) {
+    const size_t set = line & set_mask;
+    const size_t base = set << way_bits;
+    ++clock;
+    for (size_t way = 0; way < config.ways; ++way) {
+        if (tags[base + way] == line) {
+            if (config.policy == ReplacementPolicy::LRU) {
+                stamps[base + way] = clock;
+            } else if (config.policy == ReplacementPolicy::PLRU) {
+                touch(set, way);
+            }
+            return true;
+        }
+    }
+    const size_t way = victim(set);
+    tags[base + way] = line;
+    stamps[base + way] = clock;
+    if (config.policy == ReplacementPolicy::PLRU) {
+        touch(set, way);
+    }
+    return false;
+}
+
+std::vector<CacheAccess> collect_cache_accesses(const ITraceStore& store) {
+    using RISCV64Decode::InstructionType;
+    std::vector<CacheAccess> res;
+    // addresses come from the registers before the access
+    uint64_t regs[32] = {0};
+    store.visit_blocks(0, store.size(), [&](const TraceBlock& block) {
+        const auto& columns = block.columns;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            const auto decoded = RISCV64Decode::decode(columns.instr[i]);
+            if (decoded.type == InstructionType::LOAD) {
+                const auto& load = decoded.content.loadContent;
+                res.push_back({columns.time[i], columns.pc[i], regs[load.rs1Index] + load.offset, load.size, false});
+            } else if (decoded.type == InstructionType::STORE) {
+                const auto& write = decoded.content.storeContent;
+                res.push_back({columns.time[i], columns.pc[i], regs[write.rs1Index] + write.offset, write.size, true});
+            } else if (decoded.type == InstructionType::ATOMIC) {
+                // lr only reads and sc only writes, an amo reads and writes the word
+                const auto& atomic = decoded.content.atomicContent;
+                const uint64_t address = regs[atomic.rs1Index];
+                if (atomic.operation != RISCV64Decode::AtomicOperation::SC) {
+                    res.push_back({columns.time[i], columns.pc[i], address, atomic.size, false});
+                }
+                if (atomic.operation != RISCV64Decode::AtomicOperation::LR) {
+                    res.push_back({columns.time[i], columns.pc[i], address, atomic.size, true});
+                }
+            }
+            if (columns.reg_index[i] != TraceColumns::NO_REG && columns.reg_type[i] == static_cast<uint8_t>(RegType::INT)) {
+                regs[columns.reg_index[i]] = columns.reg_val[i];
+            }
+        }
+        return true;
+    });
+    return res;
+}
+
+CacheSimReport simulate_caches(const std::vector<std::vector<CacheAccess>>& harts, const CacheHierarchyConfig& config) {
+    CacheSimReport res{config, std::vector<CacheLevelStats>(harts.size()), {}};
+    std::vector<Cache> l1(harts.size(), Cache(config.l1));
+    std::vector<Cache> l2;
+    if (config.l2) {
+        l2.assign(config.shared_l2 ? 1 : harts.size(), Cache(config.l2.value()));
+        res.l2.resize(l2.size());
+    }
+    const unsigned l1_shift = l1.empty() ? 0 : l1[0].line_bits();
+    auto simulate = [&](size_t hart_id, const CacheAccess& access) {
+        // an access crossing a line boundary touches both lines
+        const uint64_t last_line = (access.address + access.size - 1) >> l1_shift;
+        for (uint64_t line = access.address >> l1_shift; line <= last_line; ++line) {
+            const bool hit = l1[hart_id].access(line);
+            count_access(res.l1[hart_id], access, line << l1_shift, hit);
+            if (hit || l2.empty()) {
+                continue;
+            }
+            const size_t l2_id = config.shared_l2 ? 0 : hart_id;
+            // a missed l1 line fills every smaller l2 line it covers
+            const unsigned l2_shift = l2[l2_id].line_bits();
+            const uint64_t last_l2_line = (((line + 1) << l1_shift) - 1) >> l2_shift;
+            for (uint64_t l2_line = (line << l1_shift) >> l2_shift; l2_line <= last_l2_line; ++l2_line) {
+                count_access(res.l2[l2_id], access, l2_line << l2_shift, l2[l2_id].access(l2_line));
+            }
+        }
+    };
+    if (!config.shared_l2) {
+        // every hart has its own caches and stats, so the harts are independent
+        ThreadPool::shared().parallel_for(harts.size(), [&](size_t hart_id) {
+            for (const auto& access : harts[hart_id]) {
+                simulate(hart_id, access);
+            }
+        });
+        return res;
+    }
+    // the shared level sees the harts interleaved by time, ties go to the lower hart
+    std::vector<size_t> next(harts.size(), 0);
+    while (true) {
+        size_t hart_id = harts.size();
+        for (size_t i = 0; i < harts.size(); ++i) {
+            if (next[i] < harts[i].size() &&
+                (hart_id == harts.size() || harts[i][next[i]].time < harts[hart_id][next[hart_id]].time)) {
+                hart_id = i;
+            }
+        }
+        if (hart_id == harts.size()) {
+            break;
+        }
+        simulate(hart_id, harts[hart_id][next[hart_id]++]);
+    }
+    return res;
+}
+
+void write_cache_report(std::ostream& out, const CacheSimReport& report, size_t top,
+                        const std::function<std::string(uint64_t pc)>& resolve) {
+    out << report.config.to_string() << '\n' << std::fixed << std::setprecision(2);
+    for (size_t hart_id = 0; hart_id < report.l1.size(); ++hart_id) {
+        write_level(out, "hart " + std::to_string(hart_id) + " l1", report.l1[hart_id], top, resolve);
+    }
+    if (report.config.shared_l2 && !report.l2.empty()) {
+        write_level(out, "shared l2", report.l2[0], top, resolve);
+    } else {
+        for (size_t hart_id = 0; hart_id < report.l2.size(); ++hart_id) {
+            write_level(out, "hart " + std::to_string(hart_id) + " l2", report.l2[hart_id], top, resolve);
+        }
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,102 @@
+#include "call_stack.hpp"
+
+#include "RISCV64_decode.hpp"
+
+#include <algorithm>
+
+CallStack CallStack::build(const ITraceStore& store) {
+    CallStack res;
+    res.extend(store);
+    res.frames.shrink_to_fit();
+    res.change_events.shrink_to_fit();
+    res.change_frames.shrink_to_fit();
+    return res;
+}
+
+void CallStack::extend(const ITraceStore& store) {
+    using RISCV64Decode::ControlTransfer;
+    const size_t first = event_count;
+    event_count = store.size();
+    if (first == event_count) {
+        return;
+    }
+    if (frames.empty()) {
+        frames.push_back(CallFrame{CallFrame::NO_FRAME, 0, CallFrame::NO_EVENT, 0, 0, 0, CallFrame::NO_EVENT});
+        change_events.push_back(0);
+        change_frames.push_back(0);
+        last_frame = 0;
+    }
+    if (pending_return != CallFrame::NO_FRAME) {
+        frames[pending_return].return_event = first;
+        pending_return = CallFrame::NO_FRAME;
+    }
+    if (pending_change) {
+        change_events.push_back(first);
+        change_frames.push_back(last_frame);
+        pending_change = false;
+    }
+    uint32_t current = last_frame;
+    store.visit_blocks(first, event_count, [&](const TraceBlock& block) {
+        const auto& columns = block.columns;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            const size_t event_id = block.first_event + i;
+            const bool has_next = event_id + 1 < event_count;
+            if (frames[current].entry_event == event_id) {
+                frames[current].entry_pc = columns.pc[i];
+            }
+            auto transfer = RISCV64Decode::control_transfer(columns.instr[i]);
+            if (transfer == ControlTransfer::NONE) {
+                continue;
+            }
+            if (transfer == ControlTransfer::RETURN || transfer == ControlTransfer::RETURN_AND_CALL) {
+                auto& returning = frames[current];
+                if (has_next) {
+                    returning.return_event = event_id + 1;
+                } else {
+                    pending_return = current;
+                }
+                if (returning.parent != CallFrame::NO_FRAME) {
+                    current = returning.parent;
+                } else {
+                    // returned above the first traced frame, its caller becomes a new outermost frame
+                    frames.push_back(CallFrame{CallFrame::NO_FRAME, 0, CallFrame::NO_EVENT, 0, event_id + 1, 0, CallFrame::NO_EVENT});
+                    current = frames.size() - 1;
+                }
+            }
+            if (transfer == ControlTransfer::CALL || transfer == ControlTransfer::RETURN_AND_CALL) {
+                const auto& caller = frames[current];
+                frames.push_back(CallFrame{current, caller.depth + 1, event_id, columns.pc[i], event_id + 1, 0, CallFrame::NO_EVENT});
+                current = frames.size() - 1;
+            }
+            if (has_next) {
+                change_events.push_back(event_id + 1);
+                change_frames.push_back(current);
+            } else {
+                pending_change = true;
+            }
+        }
+        return true;
+    });
+    last_frame = current;
+}
+
+uint32_t CallStack::frame_at(size_t event_id) const {
+    if (change_events.empty()) {
+        return CallFrame::NO_FRAME;
+    }
+    auto it = std::upper_bound(change_events.begin(), change_events.end(), event_id);
+    return change_frames[it - change_events.begin() - 1];
+}
+
+size_t CallStack::frame_end(size_t event_id) const {
+    auto it = std::upper_bound(change_events.begin(), change_events.end(), event_id);
+    return it == change_events.end() ? CallFrame::NO_EVENT : *it;
+}
+
+std::vector<uint32_t> CallStack::backtrace(size_t event_id) const {
+    std::vector<uint32_t> res;
+    for (uint32_t frame_id = frame_at(event_id); frame_id != CallFrame::NO_FRAME; frame_id = frames[frame_id].parent) {
+        res.push_back(frame_id);
+    }
+    return res;
+}
@@ -0,0 +1,196 @@
+#include "coverage.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <iomanip>
+#include <map>
+
+namespace {
+    constexpr size_t MARK_TASK_EVENTS = 1 << 16;
+    constexpr uint64_t MAX_CODE_RANGE = 1ull << 32;
+
+    double percent(size_t hit, size_t total) {
+        return total == 0 ? 0.0 : 100.0 * hit / total;
+    }
+}
+
+CoverageBitmap::CoverageBitmap(uint64_t first_pc, uint64_t end_pc) : first(first_pc), end(end_pc) {
+    if (first_pc >= end_pc) {
+        throw CoverageException("empty code range");
+    }
+    if (end_pc - first_pc > MAX_CODE_RANGE) {
+        throw CoverageException("code range is too large");
+    }
+    const uint64_t slots = (end_pc - first_pc + 1) >> 1;
+    words.resize((slots + 63) / 64);
+}
+
+bool CoverageBitmap::any_covered(uint64_t first_pc, uint64_t end_pc) const {
+    first_pc = std::max(first_pc, first);
+    end_pc = std::min(end_pc, end);
+    if (first_pc >= end_pc) {
+        return false;
+    }
+    const uint64_t end_slot = (end_pc - first + 1) >> 1;
+    for (uint64_t slot = (first_pc - first) >> 1; slot < end_slot;) {
+        const uint64_t word = words[slot >> 6] >> (slot & 63);
+        const uint64_t bits = std::min<uint64_t>(64 - (slot & 63), end_slot - slot);
+        if (bits == 64 ? word != 0 : (word & ((1ull << bits) - 1)) != 0) {
+            return true;
+        }
+        slot += bits;
+    }
+    return false;
+}
+
+void CoverageBitmap::mark(uint64_t pc) {
+    if (contains(pc)) {
+        const uint64_t slot = (pc - first) >> 1;
+        words[slot >> 6] |= 1ull << (slot & 63);
+    }
+}
+
+size_t CoverageBitmap::mark_trace(const ITraceStore& store) {
+    const size_t tasks = (store.size() + MARK_TASK_EVENTS - 1) / MARK_TASK_EVENTS;
+    std::vector<size_t> outside(tasks);
+    ThreadPool::shared().parallel_for(tasks, [&](size_t task) {
+        const size_t first_event = task * MARK_TASK_EVENTS;
+        uint64_t last_pc = first - 1;
+        store.visit_blocks(first_event, std::min(store.size(), first_event + MARK_TASK_EVENTS), [&](const TraceBlock& block) {
+            for (size_t i = block.begin; i < block.end; ++i) {
+                const uint64_t pc = block.columns.pc[i];
+                if (!contains(pc)) {
+                    ++outside[task];
+                    continue;
+                }
+                if (pc == last_pc) {
+                    continue;
+                }
+                last_pc = pc;
+                // hot code is marked already, so the shared word is only written on the first visit
+                const uint64_t slot = (pc - first) >> 1;
+                const uint64_t bit = 1ull << (slot & 63);
+                std::atomic_ref<uint64_t> word(words[slot >> 6]);
+                if ((word.load(std::memory_order_relaxed) & bit) == 0) {
+                    word.fetch_or(bit, std::memory_order_relaxed);
+                }
+            }
+            return true;
+        });
+    });
+    size_t res = 0;
+    for (size_t count : outside) {
+        res += count;
+    }
+    return res;
+}
+
+void CoverageBitmap::merge(const CoverageBitmap& other) {
+    if (other.first != first || other.end != end) {
+        throw CoverageException("bitmaps cover different code ranges");
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] |= other.words[i];
+    }
+}
+
+size_t CoverageBitmap::count() const {
+    size_t res = 0;
+    for (uint64_t word : words) {
+        res += std::popcount(word);
+    }
+    return res;
+}
+
+size_t mark_session(CoverageBitmap& bitmap, DebugSession& session) {
+    size_t res = 0;
+    for (const auto& hart : session.get_harts()) {
+        res += bitmap.mark_trace(hart->trace_store());
+    }
+    return res;
+}
+
+std::vector<FileCoverage> build_coverage_report(const CoverageBitmap& bitmap, const LineToAddrMap& lines,
+                                                const std::vector<FunctionInfo>& functions,
+                                                const std::function<const SourceLineSpec*(uint64_t pc)>& resolve) {
+    std::map<std::string, FileCoverage> files;
+    for (const auto& [line, addresses] : lines) {
+        bool hit = std::any_of(addresses.begin(), addresses.end(), [&](uint64_t address) {
+            return bitmap.covered(address);
+        });
+        files[line.source_path].lines.emplace_back(line.line, hit);
+    }
+    for (const auto& function : functions) {
+        const SourceLineSpec* entry = resolve(function.low_pc);
+        if (entry == nullptr) {
+            continue;
+        }
+        files[entry->source_path].functions.push_back(FunctionCoverage{
+            function.name, entry->line, bitmap.any_covered(function.low_pc, function.high_pc)});
+    }
+    std::vector<FileCoverage> res;
+    res.reserve(files.size());
+    for (auto& [path, file] : files) {
+        file.source_path = path;
+        std::sort(file.lines.begin(), file.lines.end());
+        file.lines_hit = std::count_if(file.lines.begin(), file.lines.end(), [](const auto& line) {
+            return line.second;
+        });
+        file.functions_hit = std::count_if(file.functions.begin(), file.functions.end(), [](const auto& function) {
+            return function.hit;
+        });
+        res.emplace_back(std::move(file));
+    }
+    return res;
+}
+
+std::vector<FileCoverage> build_coverage_report(const CoverageBitmap& bitmap, const DebugInfoProvider& debug_info) {
+    return build_coverage_report(bitmap, debug_info.lines(), debug_info.functions(), [&](uint64_t pc) {
+        return debug_info.find_line_by_pc(pc);
+    });
+}
+
+void write_lcov(std::ostream& out, const std::vector<FileCoverage>& report, const std::string& test_name) {
+    for (const auto& file : report) {
+        out << "TN:" << test_name << '\n';
+        out << "SF:" << file.source_path << '\n';
+        for (const auto& function : file.functions) {
+            out << "FN:" << function.line << ',' << function.name << '\n';
+        }
+        for (const auto& function : file.functions) {
+            out << "FNDA:" << (function.hit ? 1 : 0) << ',' << function.name << '\n';
+        }
+        out << "FNF:" << file.functions.size() << '\n';
+        out << "FNH:" << file.functions_hit << '\n';
+        for (const auto& [line, hit] : file.lines) {
+            out << "DA:" << line << ',' << (hit ? 1 : 0) << '\n';
+        }
+        out << "LF:" << file.lines.size() << '\n';
+        out << "LH:" << file.lines_hit << '\n';
+        out << "end_of_record\n";
+    }
+}
+
+void write_coverage_summary(std::ostream& out, const std::vector<FileCoverage>& report) {
+    size_t lines = 0;
+    size_t lines_hit = 0;
+    size_t functions = 0;
+    size_t functions_hit = 0;
+    out << std::fixed << std::setprecision(1);
+    for (const auto& file : report) {
+        out << file.source_path << ": lines " << file.lines_hit << '/' << file.lines.size()
+            << " (" << percent(file.lines_hit, file.lines.size()) << "%), functions "
+            << file.functions_hit << '/' << file.functions.size() << '\n';
+        lines += file.lines.size();
+        lines_hit += file.lines_hit;
+        functions += file.functions.size();
+        functions_hit += file.functions_hit;
+    }
+    out << "total: lines " << lines_hit << '/' << lines << " (" << percent(lines_hit, lines)
+        << "%), functions " << functions_hit << '/' << functions << " ("
+        << percent(functions_hit, functions) << "%)\n";
+    out << std::defaultfloat;
+}
@@ -0,0 +1,162 @@
+#include "csr_index.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+
+namespace {
+    bool parse_number(std::string_view text, int base, uint64_t& value) {
+        if (base == 16 && (text.starts_with("0x") || text.starts_with("0X"))) {
+            text.remove_prefix(2);
+        }
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+        return error == std::errc() && end == text.data() + text.size() && !text.empty();
+    }
+
+    std::string_view next_token(std::string_view& line) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) {
+            line = {};
+            return {};
+        }
+        size_t end = line.find_first_of(" \t\r", first);
+        std::string_view res = line.substr(first, end == std::string_view::npos ? std::string_view::npos : end - first);
+        line.remove_prefix(end == std::string_view::npos ? line.size() : end);
+        return res;
+    }
+
+    // first event in [first, events.size()) later than time, found by binary search
+    size_t first_event_after(const ITraceStore& events, uint64_t time, size_t first) {
+        size_t last = events.size();
+        while (first < last) {
+            size_t middle = first + (last - first) / 2;
+            if (events.get(middle).time <= time) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+        return first;
+    }
+}
+
+void CsrIndex::parse(std::istream& input, const std::string& trace_name, bool strict, std::vector<PendingChange>& pending) {
+    size_t line_number = parsed_lines;
+    for (std::string line; std::getline(input, line);) {
+        ++line_number;
+        std::string_view rest = line;
+        std::string_view time_token = next_token(rest);
+        if (time_token.empty() || time_token[0] == '#') {
+            continue;
+        }
+        uint64_t time;
+        bool valid = parse_number(time_token, 10, time);
+        size_t first_change = pending.size();
+        for (std::string_view token = next_token(rest); valid && !token.empty(); token = next_token(rest)) {
+            size_t separator = token.find('=');
+            uint64_t value;
+            if (separator == 0 || separator == std::string_view::npos ||
+                !parse_number(token.substr(separator + 1), 16, value)) {
+                valid = false;
+                break;
+            }
+            std::string name(token.substr(0, separator));
+            auto [it, inserted] = csr_ids.try_emplace(name, csr_names.size());
+            if (inserted) {
+                csr_names.push_back(name);
+                csr_changes.emplace_back();
+            }
+            pending.push_back(PendingChange{it->second, CsrChange{0, time, value}});
+        }
+        if (!valid || pending.size() == first_change) {
+            if (strict) {
+                throw CsrTraceException(trace_name, line_number);
+            }
+            pending.resize(first_change);
+            ++skipped;
+        }
+    }
+    parsed_lines = line_number;
+}
+
+CsrIndex CsrIndex::load(std::istream& input, const std::string& trace_name, const ITraceStore& events, bool strict) {
+    CsrIndex res;
+    std::vector<PendingChange> pending;
+    res.parse(input, trace_name, strict, pending);
+    std::stable_sort(pending.begin(), pending.end(), [](const PendingChange& lhs, const PendingChange& rhs) {
+        return lhs.change.time < rhs.change.time;
+    });
+    // a single sweep over the event times places every change after the events not later than it
+    size_t next = 0;
+    events.visit_blocks(0, events.size(), [&](const TraceBlock& block) {
+        for (size_t i = block.begin; i < block.end && next < pending.size(); ++i) {
+            while (next < pending.size() && pending[next].change.time < block.columns.time[i]) {
+                pending[next++].change.event_id = block.first_event + i;
+            }
+        }
+        return next < pending.size();
+    });
+    for (; next < pending.size(); ++next) {
+        pending[next].change.event_id = events.size();
+    }
+    for (const auto& [csr_id, change] : pending) {
+        res.csr_changes[csr_id].push_back(change);
+    }
+    for (auto& changes : res.csr_changes) {
+        changes.shrink_to_fit();
+    }
+    return res;
+}
+
+void CsrIndex::append(std::istream& input, const std::string& trace_name, const ITraceStore& events, bool strict) {
+    std::vector<PendingChange> pending;
+    parse(input, trace_name, strict, pending);
+    for (auto& [csr_id, change] : pending) {
+        auto& changes = csr_changes[csr_id];
+        // appended lines are normally later than all earlier ones, so this is a search near the end
+        auto it = std::upper_bound(changes.begin(), changes.end(), change.time, [](uint64_t time, const CsrChange& other) {
+            return time < other.time;
+        });
+        size_t first = it == changes.begin() ? 0 : std::prev(it)->event_id;
+        change.event_id = first_event_after(events, change.time, first);
+        changes.insert(it, change);
+    }
+}
+
+void CsrIndex::events_appended(const ITraceStore& events, size_t first_new) {
+    for (auto& changes : csr_changes) {
+        auto it = changes.end();
+        while (it != changes.begin() && std::prev(it)->event_id == first_new) {
+            --it;
+        }
+        for (size_t first = first_new; it != changes.end(); ++it) {
+            it->event_id = first_event_after(events, it->time, first);
+            first = it->event_id;
+        }
+    }
+}
+
+const std::vector<CsrChange>& CsrIndex::changes(const std::string& name) const {
+    static const std::vector<CsrChange> no_changes;
+    auto it = csr_ids.find(name);
+    return it == csr_ids.end() ? no_changes : csr_changes[it->second];
+}
+
+std::optional<uint64_t> CsrIndex::read(const std::string& name, size_t applied_events) const {
+    const auto& list = changes(name);
+    auto it = std::upper_bound(list.begin(), list.end(), applied_events, [](size_t events, const CsrChange& change) {
+        return events < change.event_id;
+    });
+    if (it == list.begin()) {
+        return std::nullopt;
+    }
+    return std::prev(it)->value;
+}
+
+size_t CsrIndex::memory_footprint() const {
+    size_t res = 0;
+    for (const auto& changes : csr_changes) {
+        res += changes.capacity() * sizeof(CsrChange);
+    }
+    return res;
+}
@@ -1,8 +1,11 @@
 #include "debug_info_provider.hpp"
+#include "stats.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits>
 #include <unistd.h>
 #include <vector>
 #include <libdwarf/dwarf.h>
@@ -83,6 +86,97 @@ namespace {
         return std::make_pair(line_addr_ret, addr_line_ret);
     }
 
+    void collect_functions(Dwarf_Die die, Dwarf_Debug dbg, Dwarf_Error err, std::vector<FunctionInfo>& res) {
+        Dwarf_Half tag;
+        if (dwarf_tag(die, &tag, &err) != DW_DLV_OK) {
+            return;
+        }
+        if (tag == DW_TAG_subprogram) {
+            Dwarf_Addr low_pc;
+            Dwarf_Addr high_pc;
+            Dwarf_Half high_pc_form;
+            enum Dwarf_Form_Class form_class;
+            char* name;
+            if (dwarf_lowpc(die, &low_pc, &err) == DW_DLV_OK &&
+                dwarf_highpc_b(die, &high_pc, &high_pc_form, &form_class, &err) == DW_DLV_OK &&
+                dwarf_diename(die, &name, &err) == DW_DLV_OK) {
+                if (form_class == DW_FORM_CLASS_CONSTANT) {
+                    high_pc += low_pc;
+                }
+                res.push_back(FunctionInfo{name, low_pc, high_pc});
+                dwarf_dealloc(dbg, name, DW_DLA_STRING);
+            }
+            return;
+        }
+        // functions may be nested in namespaces and classes
+        Dwarf_Die child;
+        if (dwarf_child(die, &child, &err) != DW_DLV_OK) {
+            return;
+        }
+        while (true) {
+            collect_functions(child, dbg, err, res);
+            Dwarf_Die sibling;
+            int status = dwarf_siblingof_b(dbg, child, true, &sibling, &err);
+            dwarf_dealloc(dbg, child, DW_DLA_DIE);
+            if (status != DW_DLV_OK) {
+                break;
+            }
+            child = sibling;
+        }
+    }
+
+    std::vector<FunctionInfo> build_function_list(Dwarf_Debug dbg, Dwarf_Error err) {
+        std::vector<FunctionInfo> res;
+        Dwarf_Bool      is_info = true;
+        Dwarf_Unsigned  cu_header_length;
+        Dwarf_Half      version_stamp;
+        Dwarf_Off       abbrev_offset;
+        Dwarf_Half      address_size;
+        Dwarf_Half      length_size;
+        Dwarf_Half      extension_size;
+        Dwarf_Sig8      type_signature;
+        Dwarf_Unsigned  typeoffset;
+        Dwarf_Unsigned  next_cu_header_offset;
+        Dwarf_Half      header_cu_type;
+        while (dwarf_next_cu_header_d(dbg, is_info, &cu_header_length,
+                                  &version_stamp, &abbrev_offset,
+                                  &address_size, &length_size,
+                                  &extension_size, &type_signature,
+                                  &typeoffset, &next_cu_header_offset,
+                                  &header_cu_type, &err) == DW_DLV_OK) {
+            Dwarf_Die cu_die;
+            if (dwarf_siblingof_b(dbg, nullptr, is_info, &cu_die, &err) != DW_DLV_OK) {
+                continue;
+            }
+            collect_functions(cu_die, dbg, err, res);
+        }
+        std::sort(res.begin(), res.end(), [](const FunctionInfo& lhs, const FunctionInfo& rhs) {
+            return lhs.low_pc < rhs.low_pc;
+        });
+        return res;
+    }
+
+    std::pair<uint64_t, uint64_t> read_text_range(Elf* elf, const AddrToLineMap& addr_line_map) {
+        uint64_t first = std::numeric_limits<uint64_t>::max();
+        uint64_t end = 0;
+        for (Elf_Scn* section = elf_nextscn(elf, nullptr); section != nullptr; section = elf_nextscn(elf, section)) {
+            const Elf64_Shdr* header = elf64_getshdr(section);
+            if (header != nullptr && (header->sh_flags & SHF_EXECINSTR) && header->sh_size != 0) {
+                first = std::min<uint64_t>(first, header->sh_addr);
+                end = std::max<uint64_t>(end, header->sh_addr + header->sh_size);
+            }
+        }
+        if (first < end) {
+            return {first, end};
+        }
+        for (const auto& [addr, line] : addr_line_map) {
+            first = std::min<uint64_t>(first, addr);
+            // the longest instruction after the last line address
+            end = std::max<uint64_t>(end, addr + 4);
+        }
+        return first < end ? std::make_pair(first, end) : std::make_pair<uint64_t, uint64_t>(0, 0);
+    }
+
     struct InternalTypeInfo {
         std::string name;
         size_t size;
@@ -305,6 +399,7 @@ namespace {
 }
 
 DebugInfoProvider::DebugInfoProvider(const std::string& elf_path, const std::string& common_prefix) : elf_file_path(elf_path) {
+    stats::ScopedTimer open_timer("debug_info.open");
     if (elf_version(EV_CURRENT) == EV_NONE)
         throw DwarfException("ELF library too old");
     elf_fd = open(elf_path.c_str(), O_RDONLY);
@@ -326,9 +421,17 @@ DebugInfoProvider::DebugInfoProvider(const std::string& elf_path, const std::str
         close(elf_fd);
         throw DwarfException("failed to read dwarf");
     }
-    auto [l2a, a2l] = build_maps(dbg, err, common_prefix);
-    line_addr_map = std::move(l2a);
-    addr_line_map = std::move(a2l);
+    {
+        stats::ScopedTimer maps_timer("debug_info.build_maps");
+        auto [l2a, a2l] = build_maps(dbg, err, common_prefix);
+        line_addr_map = std::move(l2a);
+        addr_line_map = std::move(a2l);
+    }
+    function_list = build_function_list(dbg, err);
+    text_address_range = read_text_range(elf_handler, addr_line_map);
+    if (stats::enabled()) {
+        stats::add_count("debug_info.lines", addr_line_map.size());
+    }
 }
 
 DebugInfoProvider::DebugInfoProvider(DebugInfoProvider&& other) :
@@ -338,7 +441,10 @@ DebugInfoProvider::DebugInfoProvider(DebugInfoProvider&& other) :
     dbg(other.dbg),
     err(other.err),
     line_addr_map(std::move(other.line_addr_map)),
-    addr_line_map(std::move(other.addr_line_map)) {
+    addr_line_map(std::move(other.addr_line_map)),
+    type_size_map(std::move(other.type_size_map)),
+    function_list(std::move(other.function_list)),
+    text_address_range(other.text_address_range) {
         other.elf_fd = -1;
         other.elf_handler = nullptr;
         other.dbg = nullptr;
@@ -354,6 +460,11 @@ const SourceLineSpec& DebugInfoProvider::get_line_by_pc(uint64_t pc) const {
     return res->second;
 }
 
+const SourceLineSpec* DebugInfoProvider::find_line_by_pc(uint64_t pc) const noexcept {
+    auto res = addr_line_map.find(pc);
+    return res == addr_line_map.end() ? nullptr : &res->second;
+}
+
 const std::vector<uint64_t>& DebugInfoProvider::get_pc_by_line(const SourceLineSpec& line_spec) const {
     auto res = line_addr_map.find(line_spec);
     if (res == line_addr_map.end()) {
@@ -421,6 +532,8 @@ void visit_die(
 
 std::vector<VariableInfo> DebugInfoProvider::get_available_variables(uint64_t pc) const {
     std::vector<VariableInfo> res;
+    // libdwarf handles are not thread safe, while one provider may be shared between sessions
+    std::lock_guard<std::mutex> guard(dwarf_lock);
 
     Dwarf_Bool      is_info = true;
     Dwarf_Unsigned  cu_header_length;
@@ -1,9 +1,23 @@
 #include "executor.hpp"
+#include "RISCV64_decode.hpp"
+#include "coverage.hpp"
+#include "latency.hpp"
+#include "lock_analysis.hpp"
 #include "model.hpp"
+#include "stats.hpp"
+#include "timeline.hpp"
 
+#include <charconv>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
 #include <unordered_map>
 
 namespace {
+    constexpr size_t FIND_PRINT_LIMIT = 32;
+    constexpr size_t MAX_EXAMINE_BYTES = 1 << 20;
+
     uint64_t parse_value_maybe_hex(const std::string& arg) {
         if (arg.starts_with("0x")) {
             return std::stoull(arg.c_str() + 2, nullptr, 16);
@@ -12,6 +26,21 @@ namespace {
         }
     }
 
+    // decimal or 0x prefixed hex number that is the whole argument
+    std::optional<uint64_t> parse_number(std::string_view arg) {
+        int base = 10;
+        if (arg.starts_with("0x")) {
+            arg.remove_prefix(2);
+            base = 16;
+        }
+        uint64_t value;
+        auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value, base);
+        if (arg.empty() || ec != std::errc() || end != arg.data() + arg.size()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
     void reg_command(Executor::CommandParams p) {
         if (p.args.size() == 0) {
             auto res = p.session->get_all_regs();
@@ -38,6 +67,171 @@ namespace {
         p.out << hart_id << ": " << p.session->description() << std::endl;
     }
 
+    void sync_command(Executor::CommandParams p) {
+        if (p.args == "on" || p.args == "off") {
+            p.session.set_auto_sync(p.args == "on");
+            p.out << "hart switch sync is " << p.args << std::endl;
+            return;
+        }
+        p.session.sync();
+        p.out << "harts synced to time " << p.session->cur_time() << std::endl;
+    }
+
+    void goto_time_command(Executor::CommandParams p) {
+        if (p.args.empty()) {
+            p.err << "time expected\n";
+            return;
+        }
+        auto time = parse_number(p.args);
+        if (!time) {
+            p.err << "bad time " << p.args << std::endl;
+            return;
+        }
+        p.session.seek_time(time.value());
+        const auto& harts = p.session.get_harts();
+        for (size_t i = 0; i < harts.size(); ++i) {
+            p.out << i << ": time " << harts[i]->cur_time() << std::hex << " pc 0x" << harts[i]->read_pc() << std::dec << std::endl;
+        }
+    }
+
+    void find_command(Executor::CommandParams p) {
+        auto query = TraceQuery::parse(p.args);
+        auto found = p.session.find_events(query, 0, FIND_PRINT_LIMIT + 1);
+        const auto& store = p.session->trace_store();
+        for (size_t i = 0; i < std::min(found.size(), FIND_PRINT_LIMIT); ++i) {
+            auto event = store.get(found[i]);
+            p.out << "event " << found[i] << ": time " << event.time << std::hex << " pc 0x" << event.pc << std::dec << std::endl;
+        }
+        if (found.empty()) {
+            p.out << "no events found\n";
+        } else if (found.size() > FIND_PRINT_LIMIT) {
+            p.out << "... " << p.session.count_events(query) << " events in total\n";
+        }
+    }
+
+    void count_command(Executor::CommandParams p) {
+        p.out << p.session.count_events(TraceQuery::parse(p.args)) << std::endl;
+    }
+
+    // applies events up to and including the given one, so that pc is the one printed by find
+    void goto_event_command(Executor::CommandParams p) {
+        if (p.args.empty()) {
+            p.err << "event id expected\n";
+            return;
+        }
+        auto parsed = parse_number(p.args);
+        if (!parsed) {
+            p.err << "bad event id " << p.args << std::endl;
+            return;
+        }
+        const uint64_t event_id = parsed.value();
+        const auto& store = p.session->trace_store();
+        if (event_id >= store.size()) {
+            p.err << "trace has " << store.size() << " events\n";
+            return;
+        }
+        p.session->seek_event(event_id + 1);
+        auto event = store.get(event_id);
+        p.out << "event " << event_id << ": time " << event.time << std::hex << " pc 0x" << event.pc << std::dec << std::endl;
+    }
+
+    void print_frame(Executor::CommandParams& p, const std::vector<uint32_t>& frames, size_t level) {
+        const auto& stack = p.session->call_stack();
+        const auto& frame = stack.frame(frames[level]);
+        // outer frames are shown at their call instruction
+        uint64_t pc = level == 0 ? p.session->read_pc() : stack.frame(frames[level - 1]).call_pc;
+        p.out << '#' << level << "  " << std::hex << "0x" << pc;
+        if (frame.call_event != CallFrame::NO_EVENT) {
+            p.out << " in 0x" << frame.entry_pc;
+        }
+        p.out << std::dec;
+        if (!p.debug_info_provider().empty()) {
+            try {
+                p.out << " at " << p.debug_info_provider().get_line_by_pc(pc);
+            } catch (const NoSuchLineException& e) {
+            }
+        }
+        p.out << std::endl;
+    }
+
+    void backtrace_command(Executor::CommandParams p) {
+        auto frames = p.session.backtrace();
+        for (size_t level = 0; level < frames.size(); ++level) {
+            print_frame(p, frames, level);
+        }
+    }
+
+    void move_frame(Executor::CommandParams& p, bool outward) {
+        auto parsed = p.args.empty() ? std::optional<uint64_t>(1) : parse_number(p.args);
+        if (!parsed) {
+            p.err << "bad frame count " << p.args << std::endl;
+            return;
+        }
+        const uint64_t count = parsed.value();
+        auto frames = p.session.backtrace();
+        if (frames.empty()) {
+            p.err << "no frames\n";
+            return;
+        }
+        size_t level = p.session.get_selected_frame();
+        if (outward) {
+            // saturates instead of wrapping on huge counts
+            level = count >= frames.size() - 1 - level ? frames.size() - 1 : level + count;
+        } else {
+            level = count > level ? 0 : level - count;
+        }
+        p.session.select_frame(level);
+        print_frame(p, frames, level);
+    }
+
+    void up_command(Executor::CommandParams p) {
+        move_frame(p, true);
+    }
+
+    void down_command(Executor::CommandParams p) {
+        move_frame(p, false);
+    }
+
+    void finish_command(Executor::CommandParams p) {
+        auto ret = p.session.finish();
+        if (ret) {
+            p.out << "hart " << ret.value() << " reached break point\n";
+        }
+        auto frames = p.session.backtrace();
+        if (!frames.empty()) {
+            print_frame(p, frames, 0);
+        }
+    }
+
+    void source_step(Executor::CommandParams& p, DebugSession::SourceStep step) {
+        if (p.debug_info_provider().empty()) {
+            p.err << "no debug info loaded\n";
+            return;
+        }
+        auto ret = p.session.source_step(step, p.debug_info_provider());
+        if (ret) {
+            p.out << "hart " << ret.value() << " reached break point\n";
+        }
+        const uint64_t pc = p.session->read_pc();
+        p.out << "event " << p.session.position_event(p.session.get_active_hart()) << std::hex << ": pc 0x" << pc << std::dec;
+        if (const auto* line = p.debug_info_provider().find_line_by_pc(pc)) {
+            p.out << " at " << *line;
+        }
+        p.out << std::endl;
+    }
+
+    void next_command(Executor::CommandParams p) {
+        source_step(p, DebugSession::SourceStep::NEXT);
+    }
+
+    void step_line_command(Executor::CommandParams p) {
+        source_step(p, DebugSession::SourceStep::STEP);
+    }
+
+    void prev_line_command(Executor::CommandParams p) {
+        source_step(p, DebugSession::SourceStep::PREV);
+    }
+
     void step_command(Executor::CommandParams p) {
         p.session->step_forward();
     }
@@ -51,54 +245,68 @@ namespace {
         p.session->set_state_pc(target_pc);
     }
 
-    void add_break_point_command(Executor::CommandParams p) {
-        uint64_t target_pc;
+    std::optional<uint64_t> resolve_break_point_target(Executor::CommandParams& p, const std::string& target) {
+        if (target.empty()) {
+            p.err << "no breakpoint target\n";
+            return std::nullopt;
+        }
         try {
-            if (p.args[0] >= '0' && p.args[0] <= '9') {
-                target_pc = parse_value_maybe_hex(p.args);
-            } else {
-                size_t colon_pos = p.args.find(':');
-                if (colon_pos == std::string::npos) {
-                    p.err << "unsupported breakpoint target\n";
-                    return;
-                } else {
-                    std::string filename = p.args.substr(0, colon_pos);
-                    size_t line_num = std::stoull(p.args.c_str() + colon_pos + 1);
-                    SourceLineSpec spec(filename, line_num, 0);
-                    target_pc = p.debug_info_provider.get_pc_by_line(spec)[0];
-                }
+            if (target[0] >= '0' && target[0] <= '9') {
+                return parse_value_maybe_hex(target);
+            }
+            size_t colon_pos = target.find(':');
+            if (colon_pos == std::string::npos) {
+                p.err << "unsupported breakpoint target\n";
+                return std::nullopt;
             }
+            std::string filename = target.substr(0, colon_pos);
+            size_t line_num = std::stoull(target.c_str() + colon_pos + 1);
+            SourceLineSpec spec(filename, line_num, 0);
+            return p.debug_info_provider().get_pc_by_line(spec)[0];
         } catch(std::runtime_error& e) {
             p.err << "error occured: " << e.what() << std::endl;
-            return;
+            return std::nullopt;
         }
-        p.session.add_break_point(target_pc);
-        p.out << "break point set for " << std::hex << "0x" << target_pc << std::dec << std::endl;
     }
 
-    void remove_break_point_command(Executor::CommandParams p) {
-        uint64_t target_pc;
-        try {
-            if (p.args[0] >= '0' && p.args[0] <= '9') {
-                target_pc = parse_value_maybe_hex(p.args);
-            } else {
-                size_t colon_pos = p.args.find(':');
-                if (colon_pos == std::string::npos) {
-                    p.err << "unsupported breakpoint target\n";
-                    return;
-                } else {
-                    std::string filename = p.args.substr(0, colon_pos);
-                    size_t line_num = std::stoull(p.args.c_str() + colon_pos + 1);
-                    SourceLineSpec spec(filename, line_num, 0);
-                    target_pc = p.debug_info_provider.get_pc_by_line(spec)[0];
+    void add_break_point_command(Executor::CommandParams p) {
+        if (p.args.empty()) {
+            for (const auto& [address, break_point] : p.session.get_break_points()) {
+                p.out << std::hex << "0x" << address << std::dec;
+                if (break_point.condition) {
+                    p.out << " if " << break_point.condition->source();
                 }
+                p.out << " (hits: " << break_point.hits << ")\n";
             }
-        } catch(std::runtime_error& e) {
-            p.err << "error occured: " << e.what() << std::endl;
             return;
         }
-        if (p.session.remove_break_point(target_pc)) {
-            p.out << "break point set for " << std::hex << "0x" << target_pc << std::dec << std::endl;
+        std::string target = p.args;
+        std::optional<BreakCondition> condition;
+        size_t if_pos = p.args.find(" if ");
+        if (if_pos != std::string::npos) {
+            target = p.args.substr(0, if_pos);
+            try {
+                condition.emplace(p.args.substr(if_pos + 4));
+            } catch(BreakConditionException& e) {
+                p.err << "error occured: " << e.what() << std::endl;
+                return;
+            }
+        }
+        auto target_pc = resolve_break_point_target(p, target);
+        if (!target_pc) {
+            return;
+        }
+        p.session.add_break_point(target_pc.value(), std::move(condition));
+        p.out << "break point set for " << std::hex << "0x" << target_pc.value() << std::dec << std::endl;
+    }
+
+    void remove_break_point_command(Executor::CommandParams p) {
+        auto target_pc = resolve_break_point_target(p, p.args);
+        if (!target_pc) {
+            return;
+        }
+        if (p.session.remove_break_point(target_pc.value())) {
+            p.out << "break point set for " << std::hex << "0x" << target_pc.value() << std::dec << std::endl;
         } else {
             p.out << "no break point found\n";
         }
@@ -128,7 +336,7 @@ namespace {
             pc = parse_value_maybe_hex(p.args);
         }
         try {
-            auto res = p.debug_info_provider.get_line_by_pc(pc);
+            auto res = p.debug_info_provider().get_line_by_pc(pc);
             p.out << res << std::endl;
         } catch(NoSuchLineException& e) {
             p.out << e.what() << std::endl;
@@ -137,8 +345,10 @@ namespace {
 
     void variables_command(Executor::CommandParams p) {
         const uint64_t pc = p.session->read_pc();
-        auto variables = p.debug_info_provider.get_available_variables(pc);
+        auto variables = p.debug_info_provider().get_available_variables(pc);
         const uint64_t bp = p.session->read_register("x4");
+        std::vector<uint64_t> addresses;
+        addresses.reserve(variables.size());
         for (auto& v : variables) {
             uint64_t addr;
             if (v.location.type == LocationType::MEMORY) {
@@ -148,34 +358,323 @@ namespace {
             } else {
                 addr = -1;
             }
-            p.out << v.name 
+            addresses.push_back(addr);
+        }
+        auto values = p.session.read_memory(addresses, 8);
+        for (size_t i = 0; i < variables.size(); ++i) {
+            p.out << variables[i].name
                 << " (" << std::hex
-                << addr
+                << addresses[i]
                 << ")" << std::dec
-                << ": " << v.type_name
-                << " = " << p.session->read_memory_dword(addr) << std::endl;
+                << ": " << variables[i].type_name
+                << " = " << values[i] << std::endl;
         }
     }
 
-    std::unordered_map<std::string, Executor::CommandObject> commands = {
+    // x/<count><format><size> <addr>: format is x, d, u or c, size is b, h, w or g as in gdb
+    void examine_command(Executor::CommandParams p) {
+        size_t count = 1;
+        char format = 'x';
+        size_t size = 4;
+        std::string target = p.args;
+        if (target.starts_with('/')) {
+            size_t space_pos = target.find(' ');
+            std::string spec = target.substr(1, space_pos == std::string::npos ? std::string::npos : space_pos - 1);
+            size_t target_pos = target.find_first_not_of(" \t", space_pos);
+            target = target_pos == std::string::npos ? "" : target.substr(target_pos);
+            if (spec.empty()) {
+                p.err << "format expected after /\n";
+                return;
+            }
+            size_t digits = std::min(spec.find_first_not_of("0123456789"), spec.size());
+            if (digits > 0) {
+                auto parsed = parse_number(std::string_view(spec).substr(0, digits));
+                if (!parsed) {
+                    p.err << "bad count " << spec.substr(0, digits) << std::endl;
+                    return;
+                }
+                count = parsed.value();
+            }
+            for (char c : spec.substr(digits)) {
+                if (c == 'x' || c == 'd' || c == 'u' || c == 'c') {
+                    format = c;
+                } else if (c == 'b' || c == 'h' || c == 'w' || c == 'g') {
+                    size = c == 'b' ? 1 : c == 'h' ? 2 : c == 'w' ? 4 : 8;
+                } else {
+                    p.err << "unknown format letter '" << c << "'\n";
+                    return;
+                }
+            }
+        }
+        if (target.empty()) {
+            p.err << "address expected\n";
+            return;
+        }
+        if (format == 'c') {
+            size = 1;
+        }
+        if (count == 0) {
+            p.err << "count must be positive\n";
+            return;
+        }
+        // checked before multiplying, so that a huge count cannot wrap
+        if (count > MAX_EXAMINE_BYTES / size) {
+            p.err << "at most " << MAX_EXAMINE_BYTES << " bytes can be examined at once\n";
+            return;
+        }
+        uint64_t address;
+        if (auto reg = RISCV64Decode::register_index(target)) {
+            address = p.session->read_register(reg.value());
+        } else if (target == "pc") {
+            address = p.session->read_pc();
+        } else {
+            try {
+                address = parse_value_maybe_hex(target);
+            } catch (const std::logic_error& e) {
+                p.err << "bad address " << target << std::endl;
+                return;
+            }
+        }
+        auto bytes = p.session.read_memory_range(address, count * size);
+        const size_t per_line = format == 'c' ? 8 : 16 / size;
+        for (size_t i = 0; i < count; ++i) {
+            if (i % per_line == 0) {
+                if (i > 0) {
+                    p.out << '\n';
+                }
+                p.out << std::hex << "0x" << address + i * size << ':' << std::dec;
+            }
+            uint64_t value = 0;
+            for (size_t byte = size; byte > 0; --byte) {
+                value = (value << 8) | bytes[i * size + byte - 1];
+            }
+            p.out << '\t';
+            if (format == 'x') {
+                p.out << std::hex << "0x" << std::setw(size * 2) << std::setfill('0') << value << std::setfill(' ') << std::dec;
+            } else if (format == 'd') {
+                const unsigned shift = 64 - size * 8;
+                p.out << (static_cast<int64_t>(value << shift) >> shift);
+            } else if (format == 'u') {
+                p.out << value;
+            } else if (value >= 0x20 && value < 0x7f) {
+                p.out << '\'' << static_cast<char>(value) << '\'';
+            } else {
+                p.out << value;
+            }
+        }
+        p.out << std::endl;
+    }
+
+    void memory_command(Executor::CommandParams p) {
+        if (p.args.empty()) {
+            p.err << "address expected\n";
+            return;
+        }
+        std::istringstream args(p.args);
+        std::string address_arg;
+        std::string size_arg;
+        args >> address_arg >> size_arg;
+        auto address = parse_number(address_arg);
+        if (!address) {
+            p.err << "bad address " << address_arg << std::endl;
+            return;
+        }
+        auto size = size_arg.empty() ? std::optional<uint64_t>(8) : parse_number(size_arg);
+        if (size != 1 && size != 2 && size != 4 && size != 8) {
+            p.err << "size must be 1, 2, 4 or 8\n";
+            return;
+        }
+        uint64_t value = p.session.read_memory(address.value(), size.value());
+        p.out << std::hex << "0x" << address.value() << ": 0x" << value << std::dec;
+        auto writer = p.session.last_memory_write(address.value());
+        if (writer) {
+            p.out << " (written by hart " << writer->hart_id << " at time " << writer->time
+                << ", event " << writer->event_id << ')';
+        }
+        p.out << std::endl;
+    }
+
+    void stats_command(Executor::CommandParams p) {
+        auto values = stats::snapshot();
+        const auto& harts = p.session.get_harts();
+        for (size_t i = 0; i < harts.size(); ++i) {
+            std::string prefix = "hart" + std::to_string(i);
+            values.counters[prefix + ".events"] = harts[i]->event_count();
+            values.counters[prefix + ".resident_bytes"] = harts[i]->memory_footprint();
+        }
+        if (p.args.starts_with("json")) {
+            size_t path_pos = p.args.find_first_not_of(" \t", 4);
+            if (path_pos == std::string::npos) {
+                stats::write_json(p.out, values);
+                return;
+            }
+            std::string path = p.args.substr(path_pos);
+            std::ofstream file(path);
+            if (!file) {
+                p.err << "failed to open " << path << std::endl;
+                return;
+            }
+            stats::write_json(file, values);
+            return;
+        }
+        if (!stats::enabled()) {
+            p.out << "timers are disabled, start with --stats to collect them\n";
+        }
+        stats::print(p.out, values);
+    }
+
+    void coverage_command(Executor::CommandParams p) {
+        if (p.debug_info_provider().empty()) {
+            p.err << "no debug info loaded\n";
+            return;
+        }
+        auto [first_pc, end_pc] = p.debug_info_provider().text_range();
+        CoverageBitmap bitmap(first_pc, end_pc);
+        size_t outside = mark_session(bitmap, p.session);
+        auto report = build_coverage_report(bitmap, p.debug_info_provider());
+        if (!p.args.empty()) {
+            std::ofstream file(p.args);
+            if (!file) {
+                p.err << "failed to open " << p.args << std::endl;
+                return;
+            }
+            write_lcov(file, report);
+        }
+        write_coverage_summary(p.out, report);
+        if (outside != 0) {
+            p.out << outside << " events outside of the text range" << std::endl;
+        }
+    }
+
+    void summary_command(Executor::CommandParams p) {
+        std::istringstream args(p.args);
+        std::string first_arg;
+        std::string end_arg;
+        if (!(args >> first_arg)) {
+            p.err << "time range expected\n";
+            return;
+        }
+        if (!(args >> end_arg)) {
+            p.err << "end time expected\n";
+            return;
+        }
+        auto first_time = parse_number(first_arg);
+        auto end_time = parse_number(end_arg);
+        if (!first_time || !end_time) {
+            p.err << "bad time " << (first_time ? end_arg : first_arg) << std::endl;
+            return;
+        }
+        if (end_time.value() <= first_time.value()) {
+            p.err << "empty time range\n";
+            return;
+        }
+        const auto& pyramids = p.session.activity();
+        const auto& harts = p.session.get_harts();
+        p.out << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < harts.size(); ++i) {
+            auto summary = pyramids[i].summarize(harts[i]->trace_store(), harts[i]->call_stack(), first_time.value(),
+                                                 end_time.value());
+            p.out << "hart " << i << ": " << summary.instructions << " instructions (IPC "
+                << static_cast<double>(summary.instructions) / (end_time.value() - first_time.value()) << "), " << summary.loads
+                << " loads, " << summary.stores << " stores, stall " << summary.stall << ", ~"
+                << summary.function_estimate() << " functions\n";
+        }
+        p.out << std::defaultfloat;
+    }
+
+    void latency_command(Executor::CommandParams p) {
+        auto top = p.args.empty() ? std::optional<uint64_t>(10) : parse_number(p.args);
+        if (!top) {
+            p.err << "bad count " << p.args << std::endl;
+            return;
+        }
+        auto harts = analyze_latency(p.session);
+        write_latency_report(p.out, harts, top.value(), p.debug_info_provider().empty() ? nullptr : &p.debug_info_provider());
+    }
+
+    void locks_command(Executor::CommandParams p) {
+        auto top = p.args.empty() ? std::optional<uint64_t>(10) : parse_number(p.args);
+        if (!top) {
+            p.err << "bad count " << p.args << std::endl;
+            return;
+        }
+        auto locks = analyze_locks(p.session);
+        write_lock_report(p.out, locks, top.value(), p.debug_info_provider().empty() ? nullptr : &p.debug_info_provider());
+    }
+
+    void export_timeline_command(Executor::CommandParams p) {
+        if (p.args.empty()) {
+            p.err << "path expected\n";
+            return;
+        }
+        std::ofstream file(p.args, std::ios::binary);
+        if (!file) {
+            p.err << "failed to open " << p.args << std::endl;
+            return;
+        }
+        static const std::vector<FunctionInfo> no_functions;
+        const auto& functions = p.debug_info_provider().empty() ? no_functions : p.debug_info_provider().functions();
+        size_t slices = export_timeline(file, p.session, functions);
+        p.out << slices << " slices of " << p.session.get_harts().size() << " harts written to " << p.args << std::endl;
+    }
+
+    const std::unordered_map<std::string, Executor::CommandObject> commands = {
         {"reg", reg_command},
         {"hart", hart_command},
         {"step", step_command},
         {"s", step_command},
         {"step_back", step_back_command},
         {"sb", step_back_command},
+        {"sync", sync_command},
+        {"goto-time", goto_time_command},
+        {"gt", goto_time_command},
+        {"goto-event", goto_event_command},
+        {"ge", goto_event_command},
+        {"find", find_command},
+        {"count", count_command},
         {"run-till", run_till_command},
         {"rt", run_till_command},
         {"bp", add_break_point_command},
         {"rbp", remove_break_point_command},
         {"resume", resume_command},
         {"run", resume_command},
+        {"next", next_command},
+        {"n", next_command},
+        {"step-line", step_line_command},
+        {"sl", step_line_command},
+        {"prev-line", prev_line_command},
+        {"pl", prev_line_command},
+        {"bt", backtrace_command},
+        {"backtrace", backtrace_command},
+        {"up", up_command},
+        {"down", down_command},
+        {"finish", finish_command},
         {"line", line_command},
         {"l", line_command},
-        {"variables", variables_command}
+        {"variables", variables_command},
+        {"mem", memory_command},
+        {"x", examine_command},
+        {"coverage", coverage_command},
+        {"export-timeline", export_timeline_command},
+        {"latency", latency_command},
+        {"locks", locks_command},
+        {"summary", summary_command},
+        {"stats", stats_command}
     };
 }
 
+Executor::DebugInfoFuture Executor::load_debug_info(const std::string& elf_path, const std::string& common_prefix,
+                                                    std::ostream& err) {
+    return std::async(std::launch::async, [elf_path, common_prefix, &err] {
+        try {
+            return std::make_shared<DebugInfoProvider>(elf_path, common_prefix);
+        } catch (const std::exception& e) {
+            err << e.what() << "\nno debug info loaded from " << elf_path << std::endl;
+            return std::make_shared<DebugInfoProvider>();
+        }
+    }).share();
+}
+
 void Executor::execute_command(const std::string& command) {
     std::string command_type;
     size_t space_pos = command.find(' ');
@@ -189,8 +688,16 @@ void Executor::execute_command(const std::string& command) {
         ++args_pos;
     }
     std::string command_args = args_pos == std::string::npos ? "" : command.substr(args_pos);
-    if (!commands.contains(command_type)) {
+    // gdb style x/<format> <addr>
+    if (command_type.starts_with("x/")) {
+        command_args = command_type.substr(1) + (command_args.empty() ? "" : " " + command_args);
+        command_type = "x";
+    }
+    auto command_it = commands.find(command_type);
+    if (command_it == commands.end()) {
         throw UnsupportedCommandException(command_type);
     }
-    commands[command_type](Executor::CommandParams(command_args, *out, *err, session, debug_info));
+    // every command sees the lines written to followed traces up to now
+    session.update_traces();
+    command_it->second(Executor::CommandParams(command_args, *out, *err, session, debug_info));
 }
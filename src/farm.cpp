@@ -0,0 +1,112 @@
+#include "farm.hpp"
+
+#include "executor.hpp"
+#include "session.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    void run_script(Executor& exec, std::istream& script, std::ostream& out) {
+        for (std::string input; std::getline(script, input);) {
+            if (input.empty()) {
+                continue;
+            }
+            if (input == "exit") {
+                break;
+            }
+            out << '>' << input << '\n';
+            try {
+                exec.execute_command(input);
+            } catch (const std::runtime_error& e) {
+                out << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+std::vector<FarmJob> read_manifest(std::istream& manifest) {
+    std::vector<FarmJob> res;
+    size_t line_number = 0;
+    for (std::string line; std::getline(manifest, line);) {
+        ++line_number;
+        size_t first_no_space = line.find_first_not_of(" \t");
+        if (first_no_space == std::string::npos || line[first_no_space] == '#') {
+            continue;
+        }
+        std::stringstream view(line);
+        FarmJob job;
+        job.id = res.size();
+        if (!(view >> job.trace_dir >> job.elf_path >> job.script_path)) {
+            throw std::runtime_error("Malformed manifest line " + std::to_string(line_number) + ": " + line);
+        }
+        res.emplace_back(std::move(job));
+    }
+    return res;
+}
+
+DebugInfoCache::DebugInfoCache() :
+    loader([](const std::string& elf_path) {
+        return std::make_shared<DebugInfoProvider>(elf_path, "tests/");
+    }) {}
+
+std::shared_ptr<DebugInfoProvider> DebugInfoCache::get(const std::string& elf_path) {
+    std::promise<std::shared_ptr<DebugInfoProvider>> promise;
+    std::shared_future<std::shared_ptr<DebugInfoProvider>> future;
+    bool owner = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = providers.find(elf_path);
+        if (it == providers.end()) {
+            future = promise.get_future().share();
+            providers.emplace(elf_path, future);
+            owner = true;
+        } else {
+            future = it->second;
+        }
+    }
+    if (owner) {
+        try {
+            promise.set_value(loader(elf_path));
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    }
+    return future.get();
+}
+
+void ResultWriter::write(const std::string& block) {
+    std::lock_guard<std::mutex> guard(lock);
+    out << block;
+    out.flush();
+}
+
+void run_job(const FarmJob& job, DebugInfoCache& debug_info_cache, ResultWriter& writer) {
+    auto start = std::chrono::steady_clock::now();
+    std::ostringstream result;
+    std::string status = "ok";
+    try {
+        std::ifstream script(job.script_path);
+        if (!script) {
+            throw std::runtime_error("failed to open script " + job.script_path);
+        }
+        // per trace progress lines of concurrent jobs would interleave on stderr
+        TraceLoadConfig load_config;
+        load_config.progress = false;
+        DebugSessionFactory factory(TraceStorageConfig(), load_config);
+        DebugSession session = factory.create_session(job.trace_dir);
+        Executor exec(std::move(session), debug_info_cache.get(job.elf_path));
+        exec.set_output(result, result);
+        run_script(exec, script, result);
+    } catch (const std::exception& e) {
+        status = std::string("error: ") + e.what();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::ostringstream block;
+    block << "=== test " << job.id << ": " << job.trace_dir << " (" << job.elf_path << ", " << job.script_path << ") ===\n";
+    block << result.str();
+    block << "=== status " << job.id << ": " << status << " (" << elapsed.count() << " ms) ===\n";
+    writer.write(block.str());
+}
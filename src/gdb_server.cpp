@@ -0,0 +1,512 @@
+#include "gdb_server.hpp"
+
+#include "RISCV64_decode.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    constexpr size_t PC_REGNUM = 32;
+    constexpr size_t MAX_PACKET_SIZE = 0x4000;
+    // gdb signal numbers of stop replies, named apart from the <csignal> macros
+    constexpr int GDB_SIGTRAP = 5;
+    constexpr int GDB_SIGINT = 2;
+
+    std::string build_target_xml() {
+        std::ostringstream xml;
+        xml << "<?xml version=\"1.0\"?>"
+            << "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+            << "<target version=\"1.0\">"
+            << "<architecture>riscv:rv64</architecture>"
+            << "<feature name=\"org.gnu.gdb.riscv.cpu\">";
+        for (size_t i = 0; i < 32; ++i) {
+            xml << "<reg name=\"" << RISCV64Decode::abi_register_names[i] << "\" bitsize=\"64\" type=\""
+                << (i == 1 ? "code_ptr" : (i == 2 || i == 8) ? "data_ptr" : "int")
+                << "\" regnum=\"" << i << "\"/>";
+        }
+        xml << "<reg name=\"pc\" bitsize=\"64\" type=\"code_ptr\" regnum=\"" << PC_REGNUM << "\"/>"
+            << "</feature></target>";
+        return xml.str();
+    }
+
+    const std::string& target_xml() {
+        static const std::string xml = build_target_xml();
+        return xml;
+    }
+
+    const char hex_digits[] = "0123456789abcdef";
+
+    void append_hex_byte(std::string& out, uint8_t byte) {
+        out += hex_digits[byte >> 4];
+        out += hex_digits[byte & 0xf];
+    }
+
+    // registers and memory go over the wire in target (little endian) byte order
+    void append_le64(std::string& out, uint64_t value) {
+        for (size_t i = 0; i < 8; ++i) {
+            append_hex_byte(out, (value >> (i * 8)) & 0xff);
+        }
+    }
+
+    std::string hex_encode(const std::string& text) {
+        std::string res;
+        for (char c : text) {
+            append_hex_byte(res, static_cast<uint8_t>(c));
+        }
+        return res;
+    }
+
+    uint64_t parse_hex(const std::string& text) {
+        return std::stoull(text, nullptr, 16);
+    }
+
+    // thread ids in RSP are 1-based, 0 means "any" and -1 means "all"
+    std::string thread_id(size_t hart_id) {
+        std::ostringstream id;
+        id << std::hex << hart_id + 1;
+        return id.str();
+    }
+
+    std::string escape_binary(const std::string& data) {
+        std::string res;
+        for (char c : data) {
+            if (c == '#' || c == '$' || c == '}' || c == '*') {
+                res += '}';
+                res += static_cast<char>(c ^ 0x20);
+            } else {
+                res += c;
+            }
+        }
+        return res;
+    }
+
+    // removes a socket left by an earlier server, false when another kind of file is in the way
+    bool remove_socket(const std::string& path) {
+        struct stat path_stat;
+        if (lstat(path.c_str(), &path_stat) < 0) {
+            return errno == ENOENT;
+        }
+        if (!S_ISSOCK(path_stat.st_mode)) {
+            return false;
+        }
+        unlink(path.c_str());
+        return true;
+    }
+
+    int listen_on(const std::string& target) {
+        bool is_port = !target.empty() && target.find_first_not_of("0123456789") == std::string::npos;
+        int fd = socket(is_port ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw GdbServerException(std::string("socket: ") + std::strerror(errno));
+        }
+        int bind_res;
+        if (is_port) {
+            int enable = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(std::stoi(target));
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind_res = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        } else {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            if (target.size() >= sizeof(addr.sun_path)) {
+                close(fd);
+                throw GdbServerException("socket path too long: " + target);
+            }
+            std::strncpy(addr.sun_path, target.c_str(), sizeof(addr.sun_path) - 1);
+            if (!remove_socket(target)) {
+                close(fd);
+                throw GdbServerException("not a socket: " + target);
+            }
+            bind_res = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        }
+        if (bind_res < 0 || listen(fd, 1) < 0) {
+            std::string reason = std::strerror(errno);
+            close(fd);
+            throw GdbServerException("failed to listen on " + target + ": " + reason);
+        }
+        return fd;
+    }
+}
+
+bool GdbServer::read_char(char& c) {
+    ssize_t res;
+    do {
+        res = read(in_fd, &c, 1);
+    } while (res < 0 && errno == EINTR);
+    return res == 1;
+}
+
+bool GdbServer::read_packet(std::string& packet) {
+    char c;
+    while (true) {
+        do {
+            if (!read_char(c)) {
+                return false;
+            }
+            if (c == '\x03') {
+                // interrupt request while stopped, execution is synchronous
+                send_packet(stop_reply(GDB_SIGINT));
+            }
+        } while (c != '$');
+        packet.clear();
+        while (read_char(c) && c != '#') {
+            packet += c;
+        }
+        char checksum_text[3] = {0};
+        if (!read_char(checksum_text[0]) || !read_char(checksum_text[1])) {
+            return false;
+        }
+        if (!ack_mode) {
+            return true;
+        }
+        uint8_t checksum = 0;
+        for (char p : packet) {
+            checksum += static_cast<uint8_t>(p);
+        }
+        if (checksum == std::strtoul(checksum_text, nullptr, 16)) {
+            write_all("+");
+            return true;
+        }
+        write_all("-");
+    }
+}
+
+void GdbServer::write_all(const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t res = write(out_fd, data.data() + written, data.size() - written);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw GdbServerException(std::string("write: ") + std::strerror(errno));
+        }
+        written += res;
+    }
+}
+
+void GdbServer::send_packet(const std::string& payload) {
+    uint8_t checksum = 0;
+    for (char c : payload) {
+        checksum += static_cast<uint8_t>(c);
+    }
+    std::string frame = "$" + payload + "#";
+    append_hex_byte(frame, checksum);
+    while (true) {
+        write_all(frame);
+        if (!ack_mode) {
+            return;
+        }
+        char ack;
+        if (!read_char(ack) || ack != '-') {
+            return;
+        }
+    }
+}
+
+std::string GdbServer::stop_reply(int signal, const std::string& reason) const {
+    std::string res = "T";
+    append_hex_byte(res, signal);
+    res += "thread:" + thread_id(session.get_active_hart()) + ";";
+    if (!reason.empty()) {
+        res += reason + ";";
+    }
+    return res;
+}
+
+std::string GdbServer::read_registers() const {
+    std::string res;
+    res.reserve((PC_REGNUM + 1) * 16);
+    for (size_t i = 0; i < 32; ++i) {
+        append_le64(res, session->read_register(i));
+    }
+    append_le64(res, session->read_pc());
+    return res;
+}
+
+std::string GdbServer::read_register(const std::string& args) const {
+    size_t regnum = parse_hex(args);
+    std::string res;
+    if (regnum < 32) {
+        append_le64(res, session->read_register(regnum));
+    } else if (regnum == PC_REGNUM) {
+        append_le64(res, session->read_pc());
+    } else {
+        return "E01";
+    }
+    return res;
+}
+
+std::string GdbServer::read_memory(const std::string& args) const {
+    size_t comma = args.find(',');
+    if (comma == std::string::npos) {
+        return "E01";
+    }
+    uint64_t address = parse_hex(args.substr(0, comma));
+    uint64_t length = std::min<uint64_t>(parse_hex(args.substr(comma + 1)), MAX_PACKET_SIZE / 2);
+    std::string res;
+    res.reserve(length * 2);
+    for (uint8_t byte : session.read_memory_range(address, length)) {
+        append_hex_byte(res, byte);
+    }
+    return res;
+}
+
+std::string GdbServer::set_thread(const std::string& args) {
+    if (args.size() < 2) {
+        return "E01";
+    }
+    std::string id = args.substr(1);
+    if (id == "-1" || id == "0") {
+        return "OK";
+    }
+    size_t hart_id = parse_hex(id);
+    if (hart_id == 0 || hart_id > session.get_harts().size()) {
+        return "E01";
+    }
+    session.set_active_hart(hart_id - 1);
+    return "OK";
+}
+
+std::string GdbServer::breakpoint(const std::string& packet) {
+    // only software breakpoints, format is Z0,addr,kind
+    if (packet.size() < 3 || packet[1] != '0') {
+        return "";
+    }
+    size_t comma = packet.find(',', 3);
+    uint64_t address = parse_hex(packet.substr(3, comma == std::string::npos ? std::string::npos : comma - 3));
+    if (packet[0] == 'Z') {
+        session.add_break_point(address);
+    } else {
+        session.remove_break_point(address);
+    }
+    return "OK";
+}
+
+std::string GdbServer::resume(const std::string& packet) {
+    if (packet == "bs") {
+        if (!session->step_back()) {
+            return stop_reply(GDB_SIGTRAP, "replaylog:begin");
+        }
+        return stop_reply(GDB_SIGTRAP);
+    }
+    // like continue, reverse continue moves every hart
+    if (packet == "bc") {
+        auto hit = session.run_all_back();
+        if (!hit) {
+            return stop_reply(GDB_SIGTRAP, "replaylog:begin");
+        }
+        session.set_active_hart(hit.value());
+        return stop_reply(GDB_SIGTRAP, "swbreak:");
+    }
+    if (packet[0] == 's') {
+        if (!session->step_forward()) {
+            return stop_reply(GDB_SIGTRAP, "replaylog:end");
+        }
+        return stop_reply(GDB_SIGTRAP);
+    }
+    auto hit = session.run_all();
+    if (!hit) {
+        return stop_reply(GDB_SIGTRAP, "replaylog:end");
+    }
+    session.set_active_hart(hit.value());
+    return stop_reply(GDB_SIGTRAP, "swbreak:");
+}
+
+// vCont with the first action applied, execution is synchronous, so the rest are ignored
+std::string GdbServer::resume_actions(const std::string& packet) {
+    if (packet == "vCont?") {
+        return "vCont;c;s";
+    }
+    if (!packet.starts_with("vCont;") || packet.size() < 7) {
+        return "";
+    }
+    std::string action = packet.substr(6, packet.find(';', 6) - 6);
+    if (action[0] != 'c' && action[0] != 's') {
+        return "E01";
+    }
+    size_t colon = action.find(':');
+    if (action[0] == 's' && colon != std::string::npos) {
+        std::string id = action.substr(colon + 1);
+        if (id != "-1" && id != "0") {
+            size_t hart_id = parse_hex(id);
+            if (hart_id == 0 || hart_id > session.get_harts().size()) {
+                return "E01";
+            }
+            session.set_active_hart(hart_id - 1);
+        }
+    }
+    return resume(action.substr(0, 1));
+}
+
+std::string GdbServer::handle_query(const std::string& packet) {
+    if (packet.starts_with("qSupported")) {
+        std::ostringstream packet_size;
+        packet_size << std::hex << MAX_PACKET_SIZE;
+        return "PacketSize=" + packet_size.str() +
+            ";qXfer:features:read+;QStartNoAckMode+;ReverseStep+;ReverseContinue+;swbreak+;vContSupported+";
+    }
+    if (packet == "QStartNoAckMode") {
+        // the acknowledgement for this packet is still sent by read_packet
+        ack_mode = false;
+        return "OK";
+    }
+    if (packet == "qAttached") {
+        return "1";
+    }
+    if (packet == "qC") {
+        return "QC" + thread_id(session.get_active_hart());
+    }
+    if (packet == "qfThreadInfo") {
+        std::string res = "m";
+        for (size_t i = 0; i < session.get_harts().size(); ++i) {
+            if (i != 0) {
+                res += ',';
+            }
+            res += thread_id(i);
+        }
+        return res;
+    }
+    if (packet == "qsThreadInfo") {
+        return "l";
+    }
+    if (packet.starts_with("qThreadExtraInfo,")) {
+        size_t hart_id = parse_hex(packet.substr(17));
+        const auto& harts = session.get_harts();
+        if (hart_id == 0 || hart_id > harts.size()) {
+            return "E01";
+        }
+        return hex_encode(harts[hart_id - 1]->description());
+    }
+    const std::string xfer_prefix = "qXfer:features:read:target.xml:";
+    if (packet.starts_with(xfer_prefix)) {
+        std::string range = packet.substr(xfer_prefix.size());
+        size_t comma = range.find(',');
+        if (comma == std::string::npos) {
+            return "E01";
+        }
+        size_t offset = parse_hex(range.substr(0, comma));
+        size_t length = parse_hex(range.substr(comma + 1));
+        const auto& xml = target_xml();
+        if (offset >= xml.size()) {
+            return "l";
+        }
+        std::string chunk = xml.substr(offset, length);
+        return (offset + chunk.size() < xml.size() ? "m" : "l") + escape_binary(chunk);
+    }
+    return "";
+}
+
+std::string GdbServer::handle_packet(const std::string& packet, bool& detach) {
+    if (packet.empty()) {
+        return "";
+    }
+    switch (packet[0]) {
+    case '?':
+        return stop_reply(GDB_SIGTRAP);
+    case 'g':
+        return read_registers();
+    case 'p':
+        return read_register(packet.substr(1));
+    case 'm':
+        return read_memory(packet.substr(1));
+    case 'G':
+    case 'P':
+    case 'M':
+    case 'X':
+        return "E01";
+    case 'H':
+        return set_thread(packet.substr(1));
+    case 'T': {
+        size_t hart_id = parse_hex(packet.substr(1));
+        return hart_id != 0 && hart_id <= session.get_harts().size() ? "OK" : "E01";
+    }
+    case 'Z':
+    case 'z':
+        return breakpoint(packet);
+    case 'c':
+    case 's':
+        return resume(packet);
+    case 'b':
+        if (packet == "bc" || packet == "bs") {
+            return resume(packet);
+        }
+        return "";
+    case 'v':
+        return resume_actions(packet);
+    case 'D':
+        detach = true;
+        return "OK";
+    case 'q':
+    case 'Q':
+        return handle_query(packet);
+    default:
+        return "";
+    }
+}
+
+void GdbServer::serve_connection() {
+    ack_mode = true;
+    bool detach = false;
+    std::string packet;
+    while (!detach && read_packet(packet)) {
+        if (packet == "k") {
+            return;
+        }
+        std::string reply;
+        try {
+            reply = handle_packet(packet, detach);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            reply = "E01";
+        }
+        send_packet(reply);
+    }
+}
+
+void GdbServer::serve(const std::string& target) {
+    if (target == "-") {
+        serve(STDIN_FILENO, STDOUT_FILENO);
+        return;
+    }
+    int listen_fd = listen_on(target);
+    std::cerr << "waiting for gdb on " << target << std::endl;
+    int conn_fd = accept(listen_fd, nullptr, nullptr);
+    if (conn_fd < 0) {
+        std::string reason = std::strerror(errno);
+        close(listen_fd);
+        throw GdbServerException("accept: " + reason);
+    }
+    int enable = 1;
+    setsockopt(conn_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    try {
+        serve(conn_fd, conn_fd);
+    } catch (...) {
+        close(conn_fd);
+        close(listen_fd);
+        throw;
+    }
+    close(conn_fd);
+    close(listen_fd);
+    if (target.find_first_not_of("0123456789") != std::string::npos) {
+        remove_socket(target);
+    }
+}
+
+void GdbServer::serve(int input_fd, int output_fd) {
+    in_fd = input_fd;
+    out_fd = output_fd;
+    serve_connection();
+}
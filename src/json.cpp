@@ -0,0 +1,20 @@
+#include "json.hpp"
+
+std::string json_escape(std::string_view value) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string res;
+    res.reserve(value.size());
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+            res += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            res += "\\u00";
+            res += HEX[c >> 4];
+            res += HEX[c & 0xf];
+        } else {
+            res += c;
+        }
+    }
+    return res;
+}
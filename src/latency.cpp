@@ -0,0 +1,228 @@
+#include "latency.hpp"
+
+#include "model.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <map>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SC_TRACE_WITH_AVX2_KERNELS
+#endif
+
+namespace {
+    // deltas[i] = time[i] - time[i - 1], with previous standing for time[-1], time going back
+    // gives 0 as in ActivityPyramid
+    using DeltaKernel = void (*)(const uint64_t* time, size_t count, uint64_t previous, uint64_t* deltas);
+
+    uint64_t time_delta(uint64_t time, uint64_t previous) {
+        return time > previous ? time - previous : 0;
+    }
+
+    void time_deltas_scalar(const uint64_t* time, size_t count, uint64_t previous, uint64_t* deltas) {
+        if (count == 0) {
+            return;
+        }
+        deltas[0] = time_delta(time[0], previous);
+        for (size_t i = 1; i < count; ++i) {
+            deltas[i] = time_delta(time[i], time[i - 1]);
+        }
+    }
+
+#ifdef SC_TRACE_WITH_AVX2_KERNELS
+    __attribute__((target("avx2")))
+    void time_deltas_avx2(const uint64_t* time, size_t count, uint64_t previous, uint64_t* deltas) {
+        if (count == 0) {
+            return;
+        }
+        deltas[0] = time_delta(time[0], previous);
+        // avx2 compares only signed lanes, flipping the sign bits makes the compare unsigned
+        const __m256i sign = _mm256_set1_epi64x(static_cast<int64_t>(1ull << 63));
+        size_t i = 1;
+        for (; i + 4 <= count; i += 4) {
+            __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(time + i));
+            __m256i before = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(time + i - 1));
+            __m256i back = _mm256_cmpgt_epi64(_mm256_xor_si256(before, sign), _mm256_xor_si256(current, sign));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(deltas + i), _mm256_andnot_si256(back, _mm256_sub_epi64(current, before)));
+        }
+        for (; i < count; ++i) {
+            deltas[i] = time_delta(time[i], time[i - 1]);
+        }
+    }
+#endif
+
+    DeltaKernel delta_kernel() {
+        static const DeltaKernel selected = [] {
+#ifdef SC_TRACE_WITH_AVX2_KERNELS
+            if (__builtin_cpu_supports("avx2")) {
+                return time_deltas_avx2;
+            }
+#endif
+            return time_deltas_scalar;
+        }();
+        return selected;
+    }
+
+    std::string bucket_range(size_t bucket) {
+        if (bucket == 0) {
+            return "0";
+        }
+        const uint64_t low = 1ull << (bucket - 1);
+        if (low == 1) {
+            return "1";
+        }
+        return std::to_string(low) + ".." + std::to_string(low * 2 - 1);
+    }
+
+    template <typename Key>
+    std::vector<std::pair<Key, SiteLatency>> top_sites(const std::map<Key, SiteLatency>& sites, size_t top) {
+        std::vector<std::pair<Key, SiteLatency>> res(sites.begin(), sites.end());
+        auto by_stall = [](const auto& lhs, const auto& rhs) {
+            return lhs.second.stall != rhs.second.stall ? lhs.second.stall > rhs.second.stall : lhs.first < rhs.first;
+        };
+        const size_t count = std::min(top, res.size());
+        std::partial_sort(res.begin(), res.begin() + count, res.end(), by_stall);
+        res.resize(count);
+        return res;
+    }
+
+    void write_site(std::ostream& out, const SiteLatency& site) {
+        out << " stall " << site.stall << ", " << site.count << " events, mean "
+            << static_cast<double>(site.total) / site.count << ", max " << site.max;
+    }
+}
+
+void LatencyHistogram::add(uint64_t delta) {
+    ++buckets[std::bit_width(delta)];
+    ++count;
+    total += delta;
+    stall += delta > 1 ? delta - 1 : 0;
+    max = std::max(max, delta);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    total += other.total;
+    stall += other.stall;
+    max = std::max(max, other.max);
+}
+
+uint64_t LatencyHistogram::percentile_bound(double fraction) const {
+    const double target = fraction * count;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += buckets[bucket];
+        if (seen > 0 && seen >= target) {
+            return bucket == 0 ? 0 : std::min<uint64_t>(max, bucket == 64 ? ~0ull : (1ull << bucket) - 1);
+        }
+    }
+    return max;
+}
+
+HartLatency analyze_latency(const ITraceStore& store) {
+    HartLatency res;
+    res.events = store.size();
+    if (res.events == 0) {
+        return res;
+    }
+    res.first_time = store.get(0).time;
+    res.last_time = store.get(res.events - 1).time;
+    const DeltaKernel kernel = delta_kernel();
+    std::vector<uint64_t> deltas;
+    uint64_t previous = res.first_time;
+    // the previous pc is kept with its entry, so that straight-line repeats skip the hash lookup
+    uint64_t last_pc = 0;
+    SiteLatency* last_site = nullptr;
+    store.visit_blocks(1, res.events, [&](const TraceBlock& block) {
+        const auto& columns = block.columns;
+        const size_t count = block.end - block.begin;
+        deltas.resize(count);
+        kernel(columns.time.data() + block.begin, count, previous, deltas.data());
+        previous = columns.time[block.end - 1];
+        for (size_t i = 0; i < count; ++i) {
+            const size_t event = block.begin + i;
+            const uint64_t delta = deltas[i];
+            const uint64_t pc = columns.pc[event];
+            res.all.add(delta);
+            res.classes[static_cast<size_t>(RISCV64Decode::classify(columns.instr[event]))].add(delta);
+            if (last_site == nullptr || pc != last_pc) {
+                last_site = &res.pcs[pc];
+                last_pc = pc;
+            }
+            last_site->add(delta);
+        }
+        return true;
+    });
+    return res;
+}
+
+std::vector<HartLatency> analyze_latency(DebugSession& session) {
+    const auto& harts = session.get_harts();
+    std::vector<HartLatency> res(harts.size());
+    ThreadPool::shared().parallel_for(harts.size(), [&](size_t hart_id) {
+        res[hart_id] = analyze_latency(harts[hart_id]->trace_store());
+    });
+    return res;
+}
+
+void write_latency_report(std::ostream& out, const std::vector<HartLatency>& harts, size_t top,
+                          const DebugInfoProvider* debug_info) {
+    out << std::fixed << std::setprecision(2);
+    std::map<uint64_t, SiteLatency> pcs;
+    for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+        const auto& hart = harts[hart_id];
+        out << "hart " << hart_id << ": " << hart.events << " events over " << hart.span()
+            << " time units, IPC " << hart.ipc() << ", stall " << hart.all.stall << '\n';
+        for (size_t i = 0; i < RISCV64Decode::INSTRUCTION_CLASS_COUNT; ++i) {
+            const auto& histogram = hart.classes[i];
+            if (histogram.count == 0) {
+                continue;
+            }
+            out << "  " << std::left << std::setw(8) << RISCV64Decode::instruction_class_names[i] << std::right
+                << histogram.count << " events, mean " << histogram.mean() << ", p99 <= "
+                << histogram.percentile_bound(0.99) << ", max " << histogram.max << ", stall " << histogram.stall << '\n';
+        }
+        out << "  deltas:";
+        for (size_t bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket) {
+            if (hart.all.buckets[bucket] != 0) {
+                out << ' ' << bucket_range(bucket) << ':' << hart.all.buckets[bucket];
+            }
+        }
+        out << '\n';
+        for (const auto& [pc, site] : hart.pcs) {
+            pcs[pc].merge(site);
+        }
+    }
+    out << "worst stall pcs:\n";
+    for (const auto& [pc, site] : top_sites(pcs, top)) {
+        out << "  " << std::hex << "0x" << pc << std::dec;
+        write_site(out, site);
+        const SourceLineSpec* line = debug_info ? debug_info->find_line_by_pc(pc) : nullptr;
+        if (line) {
+            out << " at " << *line;
+        }
+        out << '\n';
+    }
+    if (debug_info) {
+        std::map<std::pair<std::string, size_t>, SiteLatency> lines;
+        for (const auto& [pc, site] : pcs) {
+            const SourceLineSpec* line = debug_info->find_line_by_pc(pc);
+            if (line) {
+                lines[{line->source_path, line->line}].merge(site);
+            }
+        }
+        out << "worst stall lines:\n";
+        for (const auto& [line, site] : top_sites(lines, top)) {
+            out << "  " << line.first << ':' << line.second;
+            write_site(out, site);
+            out << '\n';
+        }
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,82 @@
+#include "lazy_model.hpp"
+
+void LazyModel::State::load() {
+    std::unique_lock<std::mutex> guard(lock);
+    if (status == Status::PENDING && !cancelled) {
+        status = Status::LOADING;
+        guard.unlock();
+        std::exception_ptr load_error;
+        try {
+            loader(*model);
+        } catch (...) {
+            load_error = std::current_exception();
+        }
+        guard.lock();
+        error = load_error;
+        status = error ? Status::FAILED : Status::READY;
+        ready.store(!error, std::memory_order_release);
+        done.notify_all();
+        return;
+    }
+    done.wait(guard, [this] { return status != Status::LOADING; });
+}
+
+LazyModel::LazyModel(std::unique_ptr<RISCV64Model> model, Loader loader, const std::string& name) :
+    state(std::make_shared<State>()) {
+    state->model = std::move(model);
+    state->loader = std::move(loader);
+    state->name = name;
+}
+
+LazyModel::~LazyModel() {
+    std::lock_guard<std::mutex> guard(state->lock);
+    state->cancelled = true;
+    if (state->status == Status::LOADING) {
+        state->model->cancel_loading();
+    }
+}
+
+void LazyModel::load() const {
+    state->load();
+    std::lock_guard<std::mutex> guard(state->lock);
+    if (state->status == Status::FAILED) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+std::function<void()> LazyModel::load_task() const {
+    return [weak_state = std::weak_ptr<State>(state)] {
+        if (auto locked = weak_state.lock()) {
+            // errors are rethrown on the first use of the model
+            locked->load();
+        }
+    };
+}
+
+std::string LazyModel::load_status() const {
+    std::lock_guard<std::mutex> guard(state->lock);
+    switch (state->status) {
+    case Status::PENDING:
+        return "waiting to load";
+    case Status::LOADING:
+        return "loading, " + std::to_string(state->model->loaded_lines()) + " lines read";
+    case Status::READY:
+        return "loaded";
+    case Status::FAILED:
+        try {
+            std::rethrow_exception(state->error);
+        } catch (const std::exception& e) {
+            return std::string("failed: ") + e.what();
+        } catch (...) {
+            return "failed";
+        }
+    }
+    return "";
+}
+
+std::string LazyModel::description() const {
+    if (loaded()) {
+        return state->model->description();
+    }
+    return state->name + " (" + load_status() + ')';
+}
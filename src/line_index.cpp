@@ -0,0 +1,172 @@
+#include "line_index.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    constexpr size_t BUILD_TASK_EVENTS = 1 << 16;
+
+    struct Run {
+        size_t first_event;
+        uint32_t line;
+    };
+
+    uint32_t frame_depth(const CallStack& calls, uint32_t frame_id) {
+        return frame_id == CallFrame::NO_FRAME ? 0 : calls.frame(frame_id).depth;
+    }
+
+    // frame of a call made from a frame of the given depth that leads to frame_id
+    const CallFrame& outermost_callee(const CallStack& calls, uint32_t frame_id, uint32_t depth) {
+        while (calls.frame(frame_id).depth > depth + 1) {
+            frame_id = calls.frame(frame_id).parent;
+        }
+        return calls.frame(frame_id);
+    }
+}
+
+LineIndex LineIndex::build(const ITraceStore& store, const LineResolver& resolve) {
+    LineIndex res;
+    res.event_count = store.size();
+    std::mutex lines_lock;
+    std::map<std::pair<std::string_view, size_t>, uint32_t> line_ids;
+    auto line_id = [&](uint64_t pc) {
+        const SourceLineSpec* spec = resolve(pc);
+        if (spec == nullptr) {
+            return NO_LINE;
+        }
+        std::lock_guard<std::mutex> guard(lines_lock);
+        auto [it, inserted] = line_ids.try_emplace({spec->source_path, spec->line}, res.lines.size());
+        if (inserted) {
+            res.lines.push_back(spec);
+        }
+        return it->second;
+    };
+    const size_t tasks = (store.size() + BUILD_TASK_EVENTS - 1) / BUILD_TASK_EVENTS;
+    std::vector<std::vector<Run>> task_runs(tasks);
+    ThreadPool::shared().parallel_for(tasks, [&](size_t task) {
+        // every distinct pc is resolved once per task
+        std::unordered_map<uint64_t, uint32_t> pc_lines;
+        auto& runs = task_runs[task];
+        const size_t first = task * BUILD_TASK_EVENTS;
+        store.visit_blocks(first, std::min(store.size(), first + BUILD_TASK_EVENTS), [&](const TraceBlock& block) {
+            for (size_t i = block.begin; i < block.end; ++i) {
+                const uint64_t pc = block.columns.pc[i];
+                auto it = pc_lines.find(pc);
+                if (it == pc_lines.end()) {
+                    it = pc_lines.emplace(pc, line_id(pc)).first;
+                }
+                if (runs.empty() || runs.back().line != it->second) {
+                    runs.push_back(Run{block.first_event + i, it->second});
+                }
+            }
+            return true;
+        });
+    });
+    for (const auto& runs : task_runs) {
+        for (const auto& run : runs) {
+            if (res.run_lines.empty() || res.run_lines.back() != run.line) {
+                res.run_events.push_back(run.first_event);
+                res.run_lines.push_back(run.line);
+            }
+        }
+    }
+    return res;
+}
+
+LineIndex LineIndex::build(const ITraceStore& store, const DebugInfoProvider& debug_info) {
+    return build(store, [&debug_info](uint64_t pc) {
+        return debug_info.find_line_by_pc(pc);
+    });
+}
+
+size_t LineIndex::run_at(size_t event_id) const {
+    return std::upper_bound(run_events.begin(), run_events.end(), event_id) - run_events.begin() - 1;
+}
+
+std::optional<size_t> next_line_event(const LineIndex& lines, const CallStack& calls, size_t event_id) {
+    if (lines.run_count() == 0) {
+        return std::nullopt;
+    }
+    const size_t start_run = lines.run_at(event_id);
+    const uint32_t start_line = lines.run_line(start_run);
+    const uint32_t start_frame = calls.frame_at(event_id);
+    const uint32_t start_depth = frame_depth(calls, start_frame);
+    size_t event = lines.run_end_event(start_run);
+    while (event < lines.size()) {
+        const uint32_t frame = calls.frame_at(event);
+        if (frame_depth(calls, frame) > start_depth) {
+            event = outermost_callee(calls, frame, start_depth).return_event;
+            if (event == CallFrame::NO_EVENT) {
+                return std::nullopt;
+            }
+            continue;
+        }
+        const size_t run = lines.run_at(event);
+        const uint32_t line = lines.run_line(run);
+        if (line != LineIndex::NO_LINE && (line != start_line || frame != start_frame)) {
+            return event;
+        }
+        event = lines.run_end_event(run);
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> step_line_event(const LineIndex& lines, size_t event_id) {
+    if (lines.run_count() == 0) {
+        return std::nullopt;
+    }
+    const size_t start_run = lines.run_at(event_id);
+    for (size_t run = start_run + 1; run < lines.run_count(); ++run) {
+        if (lines.run_line(run) != LineIndex::NO_LINE && lines.run_line(run) != lines.run_line(start_run)) {
+            return lines.run_first_event(run);
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> prev_line_event(const LineIndex& lines, const CallStack& calls, size_t event_id) {
+    if (lines.run_count() == 0) {
+        return std::nullopt;
+    }
+    const size_t start_run = lines.run_at(event_id);
+    const uint32_t start_line = lines.run_line(start_run);
+    const uint32_t start_frame = calls.frame_at(event_id);
+    const uint32_t start_depth = frame_depth(calls, start_frame);
+    // event before the given one in the frame of the given depth or its callers, calls are skipped
+    auto previous = [&calls](size_t event, uint32_t depth) -> std::optional<size_t> {
+        if (event == 0) {
+            return std::nullopt;
+        }
+        const uint32_t frame = calls.frame_at(event - 1);
+        if (frame_depth(calls, frame) > depth) {
+            return outermost_callee(calls, frame, depth).call_event;
+        }
+        return event - 1;
+    };
+    for (auto event = previous(lines.run_first_event(start_run), start_depth); event;) {
+        const size_t run = lines.run_at(event.value());
+        const uint32_t line = lines.run_line(run);
+        const uint32_t frame = calls.frame_at(event.value());
+        if (line == LineIndex::NO_LINE || (line == start_line && frame == start_frame)) {
+            event = previous(lines.run_first_event(run), start_depth);
+            continue;
+        }
+        // extends back to the start of the line over the calls made from it
+        size_t target = lines.run_first_event(run);
+        const uint32_t depth = frame_depth(calls, frame);
+        for (auto before = previous(target, depth); before; before = previous(target, depth)) {
+            const size_t before_run = lines.run_at(before.value());
+            if (calls.frame_at(before.value()) != frame || lines.run_line(before_run) != line) {
+                break;
+            }
+            target = lines.run_first_event(before_run);
+        }
+        return target;
+    }
+    return std::nullopt;
+}
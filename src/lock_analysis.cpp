@@ -0,0 +1,366 @@
+#include "lock_analysis.hpp"
+
+#include "model.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
+namespace {
+    using RISCV64Decode::AtomicOperation;
+    using RISCV64Decode::InstructionType;
+
+    struct WordState {
+        bool held = false;
+        uint64_t acquire_time = 0;
+        bool waiting = false;
+        uint64_t wait_start = 0;
+        uint64_t spins = 0;
+    };
+
+    class LockTracker {
+        size_t hart_id;
+        std::unordered_map<uint64_t, WordState> words;
+        std::vector<LockEvent>& events;
+        LockEvent make(LockEvent::Kind kind, uint64_t time, uint64_t pc, uint64_t address) const {
+            return LockEvent{kind, hart_id, time, pc, address};
+        }
+    public:
+        LockTracker(size_t hart, std::vector<LockEvent>& res) : hart_id(hart), events(res) {}
+
+        void spin(uint64_t time, uint64_t pc, uint64_t address) {
+            auto& word = words[address];
+            if (word.held) {
+                return;
+            }
+            if (!word.waiting) {
+                word.waiting = true;
+                word.wait_start = time;
+            }
+            ++word.spins;
+            events.push_back(make(LockEvent::Kind::SPIN, time, pc, address));
+        }
+
+        void acquire(uint64_t time, uint64_t pc, uint64_t address) {
+            auto& word = words[address];
+            if (word.held) {
+                update(time, pc, address);
+                return;
+            }
+            auto event = make(LockEvent::Kind::ACQUIRE, time, pc, address);
+            event.duration = word.waiting ? time - word.wait_start : 0;
+            event.spins = word.spins;
+            events.push_back(event);
+            word = WordState{true, time};
+        }
+
+        // a zero written to a word that is not held is an ordinary update
+        void release(uint64_t time, uint64_t pc, uint64_t address) {
+            auto& word = words[address];
+            if (!word.held) {
+                update(time, pc, address);
+                return;
+            }
+            auto event = make(LockEvent::Kind::RELEASE, time, pc, address);
+            event.duration = time - word.acquire_time;
+            events.push_back(event);
+            word = WordState{};
+        }
+
+        void update(uint64_t time, uint64_t pc, uint64_t address) {
+            events.push_back(make(LockEvent::Kind::UPDATE, time, pc, address));
+        }
+
+        void atomic(const AtomicAccess& access) {
+            const uint64_t time = access.time;
+            const uint64_t pc = access.pc;
+            const uint64_t address = access.address;
+            switch (access.operation) {
+            case AtomicOperation::LR:
+                // lr reading zero is decided by the sc after it
+                if (access.loaded != 0) {
+                    spin(time, pc, address);
+                }
+                break;
+            case AtomicOperation::SC:
+                if (access.loaded != 0) {
+                    spin(time, pc, address);
+                } else if (access.stored != 0) {
+                    acquire(time, pc, address);
+                } else {
+                    release(time, pc, address);
+                }
+                break;
+            case AtomicOperation::SWAP:
+                if (access.stored == 0) {
+                    release(time, pc, address);
+                } else if (access.loaded == 0) {
+                    acquire(time, pc, address);
+                } else {
+                    spin(time, pc, address);
+                }
+                break;
+            case AtomicOperation::OR:
+                if (access.stored == 0) {
+                    update(time, pc, address);
+                } else if ((access.loaded & access.stored) == 0) {
+                    acquire(time, pc, address);
+                } else {
+                    spin(time, pc, address);
+                }
+                break;
+            case AtomicOperation::AND:
+                if ((access.loaded & access.stored) == 0) {
+                    release(time, pc, address);
+                } else {
+                    update(time, pc, address);
+                }
+                break;
+            default:
+                update(time, pc, address);
+                break;
+            }
+        }
+
+        void load(uint64_t time, uint64_t pc, uint64_t address, uint64_t loaded) {
+            if (loaded != 0) {
+                spin(time, pc, address);
+            }
+        }
+
+        void store(uint64_t time, uint64_t pc, uint64_t address, uint64_t stored) {
+            if (stored == 0 && words[address].held) {
+                release(time, pc, address);
+            }
+        }
+    };
+
+    // rd after the event, the trace holds the register only when the event writes it
+    uint64_t register_after(const TraceColumns& columns, size_t i, const uint64_t* regs, uint8_t index) {
+        if (index != 0 && columns.reg_index[i] == index && columns.reg_type[i] == static_cast<uint8_t>(RegType::INT)) {
+            return columns.reg_val[i];
+        }
+        return regs[index];
+    }
+
+    void update_register(const TraceColumns& columns, size_t i, uint64_t* regs) {
+        if (columns.reg_index[i] != TraceColumns::NO_REG && columns.reg_index[i] != 0 &&
+            columns.reg_type[i] == static_cast<uint8_t>(RegType::INT)) {
+            regs[columns.reg_index[i]] = columns.reg_val[i];
+        }
+    }
+
+    void add_stats(LockHartStats& res, const LockHartStats& other) {
+        res.acquires += other.acquires;
+        res.contended_acquires += other.contended_acquires;
+        res.spins += other.spins;
+        res.wait += other.wait;
+        res.max_wait = std::max(res.max_wait, other.max_wait);
+        res.hold += other.hold;
+        res.updates += other.updates;
+        for (const auto& [holder, spins] : other.blocked_by) {
+            res.blocked_by[holder] += spins;
+        }
+    }
+
+    void write_stats(std::ostream& out, const LockHartStats& stats) {
+        out << stats.acquires << " acquires (" << stats.contended_acquires << " contended), " << stats.spins
+            << " spins, wait " << stats.wait << " (max " << stats.max_wait << "), hold " << stats.hold;
+        if (stats.updates != 0) {
+            out << ", " << stats.updates << " updates";
+        }
+    }
+}
+
+std::vector<AtomicAccess> collect_atomic_accesses(const ITraceStore& store) {
+    std::vector<AtomicAccess> res;
+    uint64_t regs[32] = {0};
+    store.visit_blocks(0, store.size(), [&](const TraceBlock& block) {
+        const auto& columns = block.columns;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            const auto decoded = RISCV64Decode::decode(columns.instr[i]);
+            if (decoded.type == InstructionType::ATOMIC) {
+                const auto& atomic = decoded.content.atomicContent;
+                res.push_back({block.first_event + i, columns.time[i], columns.pc[i], regs[atomic.rs1Index], atomic.operation,
+                               regs[atomic.rs2Index], register_after(columns, i, regs, atomic.rdIndex)});
+            }
+            update_register(columns, i, regs);
+        }
+        return true;
+    });
+    return res;
+}
+
+std::vector<LockEvent> collect_lock_events(const ITraceStore& store, size_t hart_id, const std::vector<AtomicAccess>& atomics,
+                                           const std::set<uint64_t>& addresses) {
+    std::vector<LockEvent> res;
+    if (addresses.empty()) {
+        return res;
+    }
+    LockTracker tracker(hart_id, res);
+    auto next_atomic = atomics.begin();
+    uint64_t regs[32] = {0};
+    store.visit_blocks(0, store.size(), [&](const TraceBlock& block) {
+        const auto& columns = block.columns;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            const size_t event_id = block.first_event + i;
+            if (next_atomic != atomics.end() && next_atomic->event_id == event_id) {
+                tracker.atomic(*next_atomic++);
+            } else {
+                const auto decoded = RISCV64Decode::decode(columns.instr[i]);
+                if (decoded.type == InstructionType::LOAD) {
+                    const auto& load = decoded.content.loadContent;
+                    const uint64_t address = regs[load.rs1Index] + load.offset;
+                    if (addresses.contains(address)) {
+                        tracker.load(columns.time[i], columns.pc[i], address, register_after(columns, i, regs, load.rdIndex));
+                    }
+                } else if (decoded.type == InstructionType::STORE) {
+                    const auto& write = decoded.content.storeContent;
+                    const uint64_t address = regs[write.rs1Index] + write.offset;
+                    if (addresses.contains(address)) {
+                        tracker.store(columns.time[i], columns.pc[i], address, regs[write.rs2Index]);
+                    }
+                }
+            }
+            update_register(columns, i, regs);
+        }
+        return true;
+    });
+    return res;
+}
+
+LockHartStats LockStats::total() const {
+    LockHartStats res;
+    for (const auto& [hart_id, stats] : harts) {
+        add_stats(res, stats);
+    }
+    return res;
+}
+
+size_t LockStats::contending_harts() const {
+    return std::count_if(harts.begin(), harts.end(), [](const auto& hart) {
+        return hart.second.spins != 0;
+    });
+}
+
+std::vector<LockStats> merge_lock_events(const std::vector<std::vector<LockEvent>>& harts) {
+    std::map<uint64_t, std::vector<LockEvent>> words;
+    for (const auto& events : harts) {
+        for (const auto& event : events) {
+            words[event.address].push_back(event);
+        }
+    }
+    std::vector<std::vector<LockEvent>*> word_events;
+    for (auto& [address, events] : words) {
+        word_events.push_back(&events);
+    }
+    std::vector<LockStats> res(word_events.size());
+    ThreadPool::shared().parallel_for(word_events.size(), [&](size_t word_id) {
+        auto& events = *word_events[word_id];
+        // events of a hart are already in order
+        std::stable_sort(events.begin(), events.end(), [](const LockEvent& lhs, const LockEvent& rhs) {
+            return lhs.time != rhs.time ? lhs.time < rhs.time : lhs.hart_id < rhs.hart_id;
+        });
+        auto& lock = res[word_id];
+        lock.address = events.front().address;
+        std::optional<size_t> holder;
+        for (const auto& event : events) {
+            auto& stats = lock.harts[event.hart_id];
+            switch (event.kind) {
+            case LockEvent::Kind::SPIN:
+                ++stats.spins;
+                if (holder && holder.value() != event.hart_id) {
+                    ++stats.blocked_by[holder.value()];
+                }
+                break;
+            case LockEvent::Kind::ACQUIRE:
+                if (lock.pc == 0) {
+                    lock.pc = event.pc;
+                }
+                ++stats.acquires;
+                stats.contended_acquires += event.spins != 0;
+                stats.wait += event.duration;
+                stats.max_wait = std::max(stats.max_wait, event.duration);
+                holder = event.hart_id;
+                break;
+            case LockEvent::Kind::RELEASE:
+                stats.hold += event.duration;
+                if (holder == event.hart_id) {
+                    holder.reset();
+                }
+                break;
+            case LockEvent::Kind::UPDATE:
+                ++stats.updates;
+                break;
+            }
+        }
+    });
+    std::erase_if(res, [](const LockStats& lock) {
+        const auto total = lock.total();
+        return total.acquires == 0 && total.spins == 0;
+    });
+    std::vector<std::pair<uint64_t, size_t>> order;
+    for (size_t i = 0; i < res.size(); ++i) {
+        order.emplace_back(res[i].total().wait, i);
+    }
+    std::sort(order.begin(), order.end(), [&](const auto& lhs, const auto& rhs) {
+        return lhs.first != rhs.first ? lhs.first > rhs.first : res[lhs.second].address < res[rhs.second].address;
+    });
+    std::vector<LockStats> sorted;
+    sorted.reserve(res.size());
+    for (const auto& [wait, i] : order) {
+        sorted.push_back(std::move(res[i]));
+    }
+    return sorted;
+}
+
+std::vector<LockStats> analyze_locks(DebugSession& session) {
+    const auto& harts = session.get_harts();
+    std::vector<std::vector<AtomicAccess>> atomics(harts.size());
+    ThreadPool::shared().parallel_for(harts.size(), [&](size_t hart_id) {
+        atomics[hart_id] = collect_atomic_accesses(harts[hart_id]->trace_store());
+    });
+    // a word one hart uses atomically may be spun on or released by plain accesses of another
+    std::set<uint64_t> addresses;
+    for (const auto& accesses : atomics) {
+        for (const auto& access : accesses) {
+            addresses.insert(access.address);
+        }
+    }
+    std::vector<std::vector<LockEvent>> events(harts.size());
+    ThreadPool::shared().parallel_for(harts.size(), [&](size_t hart_id) {
+        events[hart_id] = collect_lock_events(harts[hart_id]->trace_store(), hart_id, atomics[hart_id], addresses);
+    });
+    return merge_lock_events(events);
+}
+
+void write_lock_report(std::ostream& out, const std::vector<LockStats>& locks, size_t top,
+                       const DebugInfoProvider* debug_info) {
+    const size_t contended = std::count_if(locks.begin(), locks.end(), [](const LockStats& lock) {
+        return lock.total().contended_acquires != 0;
+    });
+    out << locks.size() << " locks, " << contended << " contended\n";
+    for (size_t i = 0; i < std::min(top, locks.size()); ++i) {
+        const auto& lock = locks[i];
+        out << "lock " << std::hex << "0x" << lock.address << std::dec << ": ";
+        write_stats(out, lock.total());
+        out << ", " << lock.contending_harts() << " of " << lock.harts.size() << " harts spinning";
+        if (lock.pc != 0) {
+            out << ", acquired at " << std::hex << "0x" << lock.pc << std::dec;
+            const SourceLineSpec* line = debug_info ? debug_info->find_line_by_pc(lock.pc) : nullptr;
+            if (line) {
+                out << " (" << *line << ")";
+            }
+        }
+        out << '\n';
+        for (const auto& [hart_id, stats] : lock.harts) {
+            out << "  hart " << hart_id << ": ";
+            write_stats(out, stats);
+            for (const auto& [holder, spins] : stats.blocked_by) {
+                out << ", " << spins << " spins on hart " << holder;
+            }
+            out << '\n';
+        }
+    }
+}
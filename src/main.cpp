@@ -1,22 +1,197 @@
 #include "session.hpp"
+#include "cache_sim.hpp"
+#include "coverage.hpp"
 #include "executor.hpp"
+#include "gdb_server.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "trace_diff.hpp"
+#include <charconv>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "Not enough arguments\n";
+    std::optional<std::string> gdb_server_target;
+    std::optional<std::string> stats_json_path;
+    std::optional<std::string> coverage_path;
+    std::vector<std::string> cache_specs;
+    bool diff_mode = false;
+    bool bad_arguments = false;
+    TraceStorageConfig storage_config;
+    TraceLoadConfig load_config;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--gdb-server" && i + 1 < argc) {
+            gdb_server_target = argv[++i];
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            const std::string_view value = argv[++i];
+            size_t budget = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), budget);
+            if (ec != std::errc() || ptr != value.data() + value.size() || budget == 0 || budget > SIZE_MAX >> 20) {
+                std::cerr << "Bad memory budget " << value << '\n';
+                bad_arguments = true;
+                continue;
+            }
+            storage_config.paged = true;
+            storage_config.paged_config.memory_budget = budget << 20;
+        } else if (arg == "--spill-dir" && i + 1 < argc) {
+            storage_config.paged_config.spill_dir = argv[++i];
+        } else if (arg == "--diff") {
+            diff_mode = true;
+        } else if (arg == "--coverage" && i + 1 < argc) {
+            coverage_path = argv[++i];
+        } else if (arg == "--cachesim" && i + 1 < argc) {
+            cache_specs.push_back(argv[++i]);
+        } else if (arg == "--follow") {
+            load_config.follow = true;
+        } else if (arg == "--strict") {
+            load_config.strict = true;
+        } else if (arg == "--stats") {
+            stats::set_enabled(true);
+        } else if (arg == "--stats-json" && i + 1 < argc) {
+            stats::set_enabled(true);
+            stats_json_path = argv[++i];
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    // the elf is optional for cache simulation and not used by the gdb server
+    if (bad_arguments || positional.size() < (cache_specs.empty() && !gdb_server_target ? 2 : 1)) {
+        if (!bad_arguments) {
+            std::cerr << "Not enough arguments\n";
+        }
         std::cerr << "Please provide traces root path and elf\n";
+        std::cerr << "Options: --gdb-server <port|unix socket path|-> <traces> serve gdb instead of the prompt\n";
+        std::cerr << "         --diff <golden traces> <failing traces> [elf] print the first divergence of every hart\n";
+        std::cerr << "         --coverage <lcov path> <traces>... <elf> merge line and function coverage of all runs\n";
+        std::cerr << "         --cachesim <l1>[,<l2>[,shared]] <traces> [elf] simulate data caches, repeat to compare configurations\n";
+        std::cerr << "         --memory-budget <MiB> keep traces on disk and page them in within the budget\n";
+        std::cerr << "         --spill-dir <path> directory for paged trace files\n";
+        std::cerr << "         --follow keep reading lines appended to the traces while they are written\n";
+        std::cerr << "         --strict stop loading on the first malformed trace line\n";
+        std::cerr << "         --stats collect load timers and counters for the stats command\n";
+        std::cerr << "         --stats-json <path> also write them as JSON on exit\n";
         return 1;
     }
 
-    DebugSessionFactory factory;
+    DebugSessionFactory factory(storage_config, load_config);
     std::unique_ptr<Executor> exec;
 
+    if (diff_mode) {
+        try {
+            DebugSession golden = factory.create_session(positional[0]);
+            DebugSession failing = factory.create_session(positional[1]);
+            std::optional<DebugInfoProvider> provider;
+            if (positional.size() > 2) {
+                provider.emplace(positional[2], "tests/");
+            }
+            write_diff_report(std::cout, golden, failing, provider ? &provider.value() : nullptr);
+        }
+        catch (const std::exception& err) {
+            std::cerr << err.what() << std::endl;
+            return 2;
+        }
+        return 0;
+    }
+
+    if (coverage_path) {
+        try {
+            DebugInfoProvider provider(positional.back(), "tests/");
+            auto [first_pc, end_pc] = provider.text_range();
+            CoverageBitmap merged(first_pc, end_pc);
+            std::mutex merged_lock;
+            size_t outside = 0;
+            ThreadPool::shared().parallel_for(positional.size() - 1, [&](size_t run) {
+                DebugSession session = factory.create_session(positional[run]);
+                CoverageBitmap bitmap(first_pc, end_pc);
+                size_t run_outside = mark_session(bitmap, session);
+                std::lock_guard<std::mutex> guard(merged_lock);
+                merged.merge(bitmap);
+                outside += run_outside;
+            });
+            auto report = build_coverage_report(merged, provider);
+            std::ofstream lcov_file(coverage_path.value());
+            if (!lcov_file) {
+                throw std::runtime_error("failed to open " + coverage_path.value());
+            }
+            write_lcov(lcov_file, report);
+            write_coverage_summary(std::cout, report);
+            if (outside != 0) {
+                std::cout << outside << " events outside of the text range" << std::endl;
+            }
+        }
+        catch (const std::exception& err) {
+            std::cerr << err.what() << std::endl;
+            return 2;
+        }
+        return 0;
+    }
+
+    if (!cache_specs.empty()) {
+        try {
+            std::vector<CacheHierarchyConfig> configs;
+            for (const auto& spec : cache_specs) {
+                configs.push_back(CacheHierarchyConfig::parse(spec));
+            }
+            DebugSession session = factory.create_session(positional[0]);
+            const auto& harts = session.get_harts();
+            std::vector<std::vector<CacheAccess>> accesses(harts.size());
+            ThreadPool::shared().parallel_for(harts.size(), [&](size_t hart_id) {
+                accesses[hart_id] = collect_cache_accesses(harts[hart_id]->trace_store());
+            });
+            // the address streams are collected once and replayed through every configuration
+            std::vector<CacheSimReport> reports(configs.size());
+            ThreadPool::shared().parallel_for(configs.size(), [&](size_t config_id) {
+                reports[config_id] = simulate_caches(accesses, configs[config_id]);
+            });
+            std::optional<DebugInfoProvider> provider;
+            if (positional.size() > 1) {
+                provider.emplace(positional[1], "tests/");
+            }
+            auto resolve = [&](uint64_t pc) {
+                const SourceLineSpec* line = provider ? provider->find_line_by_pc(pc) : nullptr;
+                return line ? line->to_string() : std::string();
+            };
+            for (const auto& report : reports) {
+                write_cache_report(std::cout, report, 10, resolve);
+            }
+        }
+        catch (const std::exception& err) {
+            std::cerr << err.what() << std::endl;
+            return 2;
+        }
+        return 0;
+    }
+
+    if (gdb_server_target) {
+        try {
+            DebugSession session = factory.create_session(positional[0]);
+            GdbServer server(session);
+            server.serve(gdb_server_target.value());
+            if (stats_json_path) {
+                std::ofstream stats_file(stats_json_path.value());
+                stats::write_json(stats_file, stats::snapshot());
+            }
+        }
+        catch (const std::exception& err) {
+            std::cerr << err.what() << std::endl;
+            return 2;
+        }
+        return 0;
+    }
+
     try {
-        DebugSession session = factory.create_session(argv[1]);
-        DebugInfoProvider provider(argv[2], "tests/");
-        exec = std::make_unique<Executor>(std::move(session), std::move(provider));
+        // the prompt is shown right away, harts and debug info load in the background
+        DebugSession session = factory.create_session(positional[0], true);
+        exec = std::make_unique<Executor>(std::move(session), Executor::load_debug_info(positional[1], "tests/", std::cerr));
     } 
     catch (const std::exception& err) {
         std::cerr << err.what() << std::endl;
@@ -42,5 +217,8 @@ int main(int argc, char* argv[]) {
         std::cout << '>';
     }
 
+    if (stats_json_path) {
+        exec->execute_command("stats json " + stats_json_path.value());
+    }
     return 0;
 }
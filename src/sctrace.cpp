@@ -0,0 +1,177 @@
+#include "sctrace.hpp"
+
+#include "debug_info_provider.hpp"
+#include "session.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+namespace {
+    sctrace::EventColumns make_columns(const TraceColumns& columns, size_t first_event, size_t begin, size_t end) {
+        const size_t count = end - begin;
+        return sctrace::EventColumns{
+            first_event + begin,
+            std::span<const uint64_t>(columns.time).subspan(begin, count),
+            std::span<const uint64_t>(columns.pc).subspan(begin, count),
+            std::span<const uint32_t>(columns.instr).subspan(begin, count),
+            std::span<const uint8_t>(columns.reg_index).subspan(begin, count),
+            std::span<const uint8_t>(columns.reg_type).subspan(begin, count),
+            std::span<const uint64_t>(columns.reg_val).subspan(begin, count),
+            std::span<const uint64_t>(columns.reg_prev).subspan(begin, count)
+        };
+    }
+
+    sctrace::Function make_function(const FunctionInfo& function) {
+        return sctrace::Function{function.name, function.low_pc, function.high_pc};
+    }
+}
+
+struct sctrace::Hart::Impl {
+    std::shared_ptr<IModel> model;
+};
+
+size_t sctrace::Hart::event_count() const {
+    return impl->model->event_count();
+}
+
+sctrace::Event sctrace::Hart::event(size_t event_id) const {
+    if (event_id >= event_count()) {
+        throw std::out_of_range("No event " + std::to_string(event_id) + " on hart " + std::to_string(hart_id));
+    }
+    const auto entry = impl->model->trace_store().get(event_id);
+    Event res{entry.time, entry.pc, entry.instr, NO_REGISTER, 0, 0, 0};
+    if (entry.changed_reg) {
+        res.reg_index = entry.changed_reg->reg.index;
+        res.reg_type = static_cast<uint8_t>(entry.changed_reg->reg.type);
+        res.reg_value = entry.changed_reg->val;
+        res.reg_prev = entry.changed_reg->prev;
+    }
+    return res;
+}
+
+void sctrace::Hart::visit(size_t first, size_t last, const ColumnVisitor& visitor) const {
+    const auto& store = impl->model->trace_store();
+    store.visit_blocks(first, std::min(last, store.size()), [&visitor](const TraceBlock& block) {
+        return visitor(make_columns(block.columns, block.first_event, block.begin, block.end));
+    });
+}
+
+std::optional<sctrace::EventColumns> sctrace::Hart::columns() const {
+    const auto* columns = impl->model->trace_store().resident_columns();
+    if (!columns) {
+        return std::nullopt;
+    }
+    return make_columns(*columns, 0, 0, columns->size());
+}
+
+struct sctrace::Session::Impl {
+    DebugSession session;
+    std::once_flag memory_built;
+    const Memory* memory = nullptr;
+    // merged on the first memory read, read only afterwards
+    const Memory& memory_view() {
+        std::call_once(memory_built, [this] {
+            memory = &session.memory_view();
+        });
+        return *memory;
+    }
+    MemoryPosition position(size_t hart_id, size_t applied_events) {
+        const auto& harts = session.get_harts();
+        if (hart_id >= harts.size()) {
+            throw NoSuchHartException(hart_id);
+        }
+        const auto& store = harts[hart_id]->trace_store();
+        applied_events = std::min(applied_events, store.size());
+        // the time of a hart is that of its next event, or of the last one at the end of the trace
+        uint64_t time = 0;
+        if (applied_events < store.size()) {
+            time = store.get(applied_events).time;
+        } else if (applied_events > 0) {
+            time = store.get(applied_events - 1).time;
+        }
+        return MemoryPosition{time, hart_id, applied_events};
+    }
+};
+
+sctrace::Session sctrace::Session::open(const std::string& trace_dir, const SessionOptions& options) {
+    TraceStorageConfig storage_config;
+    if (options.memory_budget_mib != 0) {
+        storage_config.paged = true;
+        storage_config.paged_config.memory_budget = options.memory_budget_mib << 20;
+        storage_config.paged_config.spill_dir = options.spill_dir;
+    }
+    TraceLoadConfig load_config;
+    load_config.strict = options.strict;
+    auto impl = std::make_shared<Impl>();
+    impl->session = DebugSessionFactory(storage_config, load_config).create_session(trace_dir);
+    return Session(std::move(impl));
+}
+
+size_t sctrace::Session::hart_count() const {
+    return impl->session.get_harts().size();
+}
+
+sctrace::Hart sctrace::Session::hart(size_t hart_id) const {
+    const auto& harts = impl->session.get_harts();
+    if (hart_id >= harts.size()) {
+        throw NoSuchHartException(hart_id);
+    }
+    return Hart(std::make_shared<const Hart::Impl>(Hart::Impl{harts[hart_id]}), hart_id);
+}
+
+uint64_t sctrace::Session::read_memory(uint64_t address, size_t size, size_t hart_id, size_t applied_events) const {
+    auto position = impl->position(hart_id, applied_events);
+    return impl->memory_view().read(address, size, position);
+}
+
+std::vector<uint8_t> sctrace::Session::read_memory_range(uint64_t address, size_t length, size_t hart_id,
+                                                         size_t applied_events) const {
+    auto position = impl->position(hart_id, applied_events);
+    return impl->memory_view().read_range(address, length, position);
+}
+
+std::vector<uint64_t> sctrace::Session::read_memory(std::span<const uint64_t> addresses, size_t size, size_t hart_id,
+                                                    size_t applied_events) const {
+    auto position = impl->position(hart_id, applied_events);
+    return impl->memory_view().read_batch(addresses, size, position);
+}
+
+struct sctrace::DebugInfo::Impl {
+    DebugInfoProvider provider;
+};
+
+sctrace::DebugInfo sctrace::DebugInfo::open(const std::string& elf_path, const std::string& common_prefix) {
+    auto impl = std::make_shared<Impl>(Impl{DebugInfoProvider(elf_path, common_prefix)});
+    return DebugInfo(std::move(impl));
+}
+
+std::optional<sctrace::SourceLine> sctrace::DebugInfo::line(uint64_t pc) const {
+    const auto* line = impl->provider.find_line_by_pc(pc);
+    if (!line) {
+        return std::nullopt;
+    }
+    return SourceLine{line->source_path, line->line, line->column};
+}
+
+std::vector<uint64_t> sctrace::DebugInfo::pcs(const std::string& file, size_t line) const {
+    const auto& lines = impl->provider.lines();
+    auto it = lines.find(SourceLineSpec(file, line, 0));
+    return it == lines.end() ? std::vector<uint64_t>() : it->second;
+}
+
+std::vector<sctrace::Function> sctrace::DebugInfo::functions() const {
+    std::vector<Function> res;
+    for (const auto& function : impl->provider.functions()) {
+        res.push_back(make_function(function));
+    }
+    return res;
+}
+
+std::optional<sctrace::Function> sctrace::DebugInfo::function_at(uint64_t pc) const {
+    for (const auto& function : impl->provider.functions()) {
+        if (function.low_pc <= pc && pc < function.high_pc) {
+            return make_function(function);
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,154 @@
+#include "sctrace.h"
+
+#include "sctrace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <string>
+
+struct sctrace_session {
+    sctrace::Session session;
+};
+
+struct sctrace_debug_info {
+    sctrace::DebugInfo debug_info;
+};
+
+namespace {
+    thread_local std::string last_error;
+
+    // runs body and turns its exceptions into -1 and the last error
+    template <typename Body>
+    int guarded(Body body) {
+        try {
+            return body();
+        } catch (const std::exception& e) {
+            last_error = e.what();
+        } catch (...) {
+            last_error = "unknown error";
+        }
+        return -1;
+    }
+
+    void copy_string(const std::string& value, char* out, size_t out_size) {
+        if (out_size == 0) {
+            return;
+        }
+        size_t length = std::min(value.size(), out_size - 1);
+        std::memcpy(out, value.data(), length);
+        out[length] = '\0';
+    }
+}
+
+const char* sctrace_last_error(void) {
+    return last_error.c_str();
+}
+
+sctrace_session* sctrace_open(const char* trace_dir, const sctrace_options* options) {
+    sctrace_session* res = nullptr;
+    guarded([&] {
+        sctrace::SessionOptions session_options;
+        if (options) {
+            session_options.strict = options->strict != 0;
+            session_options.memory_budget_mib = options->memory_budget_mib;
+            session_options.spill_dir = options->spill_dir ? options->spill_dir : "";
+        }
+        res = new sctrace_session{sctrace::Session::open(trace_dir, session_options)};
+        return 0;
+    });
+    return res;
+}
+
+void sctrace_close(sctrace_session* session) {
+    delete session;
+}
+
+size_t sctrace_hart_count(const sctrace_session* session) {
+    return session->session.hart_count();
+}
+
+int sctrace_event_count(const sctrace_session* session, size_t hart_id, size_t* count) {
+    return guarded([&] {
+        *count = session->session.hart(hart_id).event_count();
+        return 0;
+    });
+}
+
+int sctrace_visit(const sctrace_session* session, size_t hart_id, size_t first, size_t last,
+                  sctrace_visitor visitor, void* user_data) {
+    return guarded([&] {
+        session->session.hart(hart_id).visit(first, last, [visitor, user_data](const sctrace::EventColumns& columns) {
+            sctrace_columns view{
+                columns.first_event,
+                columns.size(),
+                columns.time.data(),
+                columns.pc.data(),
+                columns.instr.data(),
+                columns.reg_index.data(),
+                columns.reg_type.data(),
+                columns.reg_value.data(),
+                columns.reg_prev.data()
+            };
+            return visitor(&view, user_data) != 0;
+        });
+        return 0;
+    });
+}
+
+int sctrace_read_memory(const sctrace_session* session, uint64_t address, size_t size, size_t hart_id,
+                        size_t applied_events, uint64_t* value) {
+    return guarded([&] {
+        *value = session->session.read_memory(address, size, hart_id, applied_events);
+        return 0;
+    });
+}
+
+int sctrace_read_memory_range(const sctrace_session* session, uint64_t address, size_t length, size_t hart_id,
+                              size_t applied_events, uint8_t* out) {
+    return guarded([&] {
+        auto bytes = session->session.read_memory_range(address, length, hart_id, applied_events);
+        std::memcpy(out, bytes.data(), bytes.size());
+        return 0;
+    });
+}
+
+sctrace_debug_info* sctrace_debug_info_open(const char* elf_path, const char* common_prefix) {
+    sctrace_debug_info* res = nullptr;
+    guarded([&] {
+        res = new sctrace_debug_info{sctrace::DebugInfo::open(elf_path, common_prefix ? common_prefix : "")};
+        return 0;
+    });
+    return res;
+}
+
+void sctrace_debug_info_close(sctrace_debug_info* debug_info) {
+    delete debug_info;
+}
+
+int sctrace_line_by_pc(const sctrace_debug_info* debug_info, uint64_t pc, char* file, size_t file_size,
+                       size_t* line) {
+    return guarded([&] {
+        auto found = debug_info->debug_info.line(pc);
+        if (!found) {
+            return 0;
+        }
+        copy_string(found->file, file, file_size);
+        *line = found->line;
+        return 1;
+    });
+}
+
+int sctrace_function_by_pc(const sctrace_debug_info* debug_info, uint64_t pc, char* name, size_t name_size,
+                           uint64_t* low_pc, uint64_t* high_pc) {
+    return guarded([&] {
+        auto found = debug_info->debug_info.function_at(pc);
+        if (!found) {
+            return 0;
+        }
+        copy_string(found->name, name, name_size);
+        *low_pc = found->low_pc;
+        *high_pc = found->high_pc;
+        return 1;
+    });
+}
@@ -1,19 +1,52 @@
 #include "session.hpp"
 
 #include "RISCV64_model.hpp"
+#include "lazy_model.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "trace_input.hpp"
 
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <iostream>
 
 namespace {
-    std::vector<std::string> get_trace_log_files(const std::string& dirPath) {
-        std::vector<std::string> result;
+    // long running hart loads are kept off the shared pool, which they use for their own parallel parts
+    ThreadPool& background_loader() {
+        static ThreadPool pool(std::max<size_t>(1, std::thread::hardware_concurrency() / 2));
+        return pool;
+    }
+
+    struct TraceFiles {
+        std::vector<std::string> harts;
+        // CSR trace of a hart by the path of its trace
+        std::unordered_map<std::string, std::string> csrs;
+    };
+
+    // "trace_log_csr_0" belongs to "trace_log_0"
+    std::string strip_csr_tag(std::string filename) {
+        size_t pos = filename.find("csr");
+        size_t length = 3;
+        if (pos + length < filename.size() && (filename[pos + length] == '_' || filename[pos + length] == '.')) {
+            ++length;
+        } else if (pos > 0 && (filename[pos - 1] == '_' || filename[pos - 1] == '.')) {
+            --pos;
+            ++length;
+        }
+        return filename.erase(pos, length);
+    }
+
+    TraceFiles get_trace_log_files(const std::string& dirPath) {
+        TraceFiles result;
+        std::unordered_map<std::string, std::string> csr_files;
         namespace fs = std::filesystem;
         fs::path directory(dirPath);
         if (!fs::exists(directory) || !fs::is_directory(directory)) {
@@ -22,26 +55,96 @@ namespace {
         for (const auto& entry : fs::directory_iterator(directory)) {
             if (!entry.is_regular_file()) continue;
             std::string filename = entry.path().filename().string();
-            if (filename.find("trace_log") != std::string::npos &&
-                filename.find("csr") == std::string::npos) {
-                result.push_back(entry.path().string());
+            if (filename.find("trace_log") == std::string::npos) {
+                continue;
+            }
+            if (filename.find("csr") == std::string::npos) {
+                result.harts.push_back(entry.path().string());
+            } else {
+                csr_files.emplace(strip_csr_tag(filename), entry.path().string());
+            }
+        }
+        for (const auto& hart : result.harts) {
+            auto it = csr_files.find(fs::path(hart).filename().string());
+            if (it != csr_files.end()) {
+                result.csrs.emplace(hart, it->second);
             }
         }
         return result;
     }
 }
 
-DebugSession DebugSessionFactory::create_session(const std::string& trace_dir_path) {
-    auto traces = get_trace_log_files(trace_dir_path);
+DebugSession DebugSessionFactory::create_session(const std::string& trace_dir_path, bool background) {
+    stats::ScopedTimer session_timer("session.create");
+    auto files = get_trace_log_files(trace_dir_path);
+    auto& traces = files.harts;
     std::sort(traces.begin(), traces.end());
     DebugSession res;
+    if (load_config.follow) {
+        res.follower = std::make_shared<TraceFollower>();
+    }
+    std::vector<std::shared_ptr<LazyModel>> harts;
     for (const auto& trace : traces) {
-        std::cerr << "processing " << trace << " of total " << traces.size() << " traces\n";
-        std::ifstream trace_stream(trace);
         std::string trace_name = trace.substr(trace.rfind('/') + 1);
-        auto cpu = std::make_unique<RISCV64Model>();
-        cpu->init(trace_stream, trace_name);
-        res.cpu_array.emplace_back(std::move(cpu));
+        std::unique_ptr<RISCV64Model> cpu;
+        if (storage_config.paged) {
+            PagedTraceStoreConfig hart_config = storage_config.paged_config;
+            hart_config.memory_budget /= traces.size();
+            cpu = std::make_unique<RISCV64Model>(std::make_unique<PagedTraceStore>(hart_config));
+        } else {
+            cpu = std::make_unique<RISCV64Model>();
+        }
+        cpu->load_config = load_config;
+        std::optional<std::string> csr_trace;
+        if (auto it = files.csrs.find(trace); it != files.csrs.end()) {
+            csr_trace = it->second;
+        }
+        auto loader = [trace, trace_name, csr_trace, background, progress = load_config.progress, follower = res.follower, total = traces.size()](RISCV64Model& model) {
+            if (!background && progress) {
+                std::cerr << "processing " << trace << " of total " << total << " traces\n";
+            }
+            stats::ScopedTimer trace_timer("session.load_trace");
+            if (!follower) {
+                auto trace_stream = open_trace_input(trace);
+                model.init(*trace_stream, trace_name);
+                if (csr_trace) {
+                    auto csr_stream = open_trace_input(csr_trace.value());
+                    model.init_csrs(*csr_stream, csr_trace->substr(csr_trace->rfind('/') + 1));
+                }
+                return;
+            }
+            // a trace still being written is loaded up to its last complete line and followed from there
+            uint64_t trace_length = 0;
+            auto trace_stream = open_trace_prefix(trace, trace_length);
+            model.init(*trace_stream, trace_name);
+            uint64_t csr_length = 0;
+            std::string csr_name;
+            if (csr_trace) {
+                csr_name = csr_trace->substr(csr_trace->rfind('/') + 1);
+                auto csr_stream = open_trace_prefix(csr_trace.value(), csr_length);
+                model.init_csrs(*csr_stream, csr_name);
+            }
+            // last, the follower may hand lines to the model as soon as it knows the trace
+            follower->add(trace, trace_length, [&model](std::istream& lines) {
+                model.append_trace(lines);
+            });
+            if (csr_trace) {
+                follower->add(csr_trace.value(), csr_length, [&model, csr_name](std::istream& lines) {
+                    model.append_csrs(lines, csr_name);
+                });
+            }
+        };
+        harts.push_back(std::make_shared<LazyModel>(std::move(cpu), std::move(loader), trace_name));
+        res.cpu_array.push_back(harts.back());
+    }
+    for (const auto& hart : harts) {
+        background_loader().submit(hart->load_task());
+    }
+    if (!background) {
+        // takes over the harts the loader has not started yet
+        for (const auto& hart : harts) {
+            hart->load();
+        }
     }
     return res;
 }
@@ -0,0 +1,163 @@
+#include "session_memory.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <utility>
+
+Memory Memory::merge(std::vector<std::vector<MemoryAccess>> per_hart) {
+    Memory res;
+    size_t total = 0;
+    for (const auto& accesses : per_hart) {
+        total += accesses.size();
+    }
+    res.accesses.reserve(total);
+    // (time, hart, position in the hart sequence), ties are ordered by hart
+    using Head = std::tuple<uint64_t, size_t, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    for (size_t hart = 0; hart < per_hart.size(); ++hart) {
+        if (!per_hart[hart].empty()) {
+            heads.emplace(per_hart[hart][0].time, hart, 0);
+        }
+    }
+    while (!heads.empty()) {
+        auto [time, hart, pos] = heads.top();
+        heads.pop();
+        res.accesses.push_back(per_hart[hart][pos]);
+        if (++pos < per_hart[hart].size()) {
+            heads.emplace(per_hart[hart][pos].time, hart, pos);
+        }
+    }
+    // (dword, access index) pairs sorted by dword, accesses of one dword stay in time order
+    std::vector<std::pair<uint64_t, size_t>> touched;
+    for (size_t i = 0; i < res.accesses.size(); ++i) {
+        const auto& access = res.accesses[i];
+        uint64_t last_byte = access.address + access.size - 1;
+        for (uint64_t dword = access.address & ~0x7ULL; dword <= (last_byte & ~0x7ULL); dword += 8) {
+            touched.emplace_back(dword, i);
+        }
+    }
+    std::sort(touched.begin(), touched.end());
+    res.access_indices.reserve(touched.size());
+    for (size_t i = 0; i < touched.size(); ++i) {
+        if (i == 0 || touched[i].first != touched[i - 1].first) {
+            res.dwords.push_back(touched[i].first);
+            res.dword_offsets.push_back(i);
+        }
+        res.access_indices.push_back(touched[i].second);
+    }
+    res.dword_offsets.push_back(touched.size());
+    return res;
+}
+
+template <typename Visitor>
+void Memory::visit_visible(size_t slot, const MemoryPosition& position, Visitor visitor) const {
+    auto begin = access_indices.begin() + dword_offsets[slot];
+    auto end = std::upper_bound(begin, access_indices.begin() + dword_offsets[slot + 1], position.time,
+        [this](uint64_t time, size_t index) {
+            return time < accesses[index].time;
+        });
+    for (auto index = end; index != begin;) {
+        const auto& access = accesses[*--index];
+        if (access.hart_id == position.hart_id && access.event_id >= position.event_id) {
+            continue;
+        }
+        if (visitor(access)) {
+            return;
+        }
+    }
+}
+
+size_t Memory::first_slot(uint64_t address, size_t from) const {
+    return std::lower_bound(dwords.begin() + from, dwords.end(), address & ~0x7ULL) - dwords.begin();
+}
+
+void Memory::read_from(size_t slot, uint64_t address, size_t length, const MemoryPosition& position, uint8_t* out) const {
+    const uint64_t end = address + length;
+    for (; slot < dwords.size() && dwords[slot] < end; ++slot) {
+        const uint64_t dword = dwords[slot];
+        const uint64_t first = std::max(address, dword);
+        const uint64_t last = std::min(end, dword + 8);
+        uint8_t missing = 0;
+        for (uint64_t byte = first; byte < last; ++byte) {
+            missing |= 1 << (byte - dword);
+        }
+        visit_visible(slot, position, [&](const MemoryAccess& access) {
+            for (uint64_t byte = first; byte < last; ++byte) {
+                uint8_t bit = 1 << (byte - dword);
+                if ((missing & bit) && byte >= access.address && byte < access.address + access.size) {
+                    out[byte - address] = (access.value >> ((byte - access.address) * 8)) & 0xff;
+                    missing &= ~bit;
+                }
+            }
+            return missing == 0;
+        });
+    }
+}
+
+uint64_t Memory::read(uint64_t address, size_t size, const MemoryPosition& position) const {
+    uint8_t bytes[8] = {0};
+    size = std::min<size_t>(size, 8);
+    read_from(first_slot(address), address, size, position, bytes);
+    uint64_t res = 0;
+    for (size_t i = size; i > 0; --i) {
+        res = (res << 8) | bytes[i - 1];
+    }
+    return res;
+}
+
+std::vector<uint8_t> Memory::read_range(uint64_t address, size_t length, const MemoryPosition& position) const {
+    std::vector<uint8_t> res(length);
+    read_from(first_slot(address), address, length, position, res.data());
+    return res;
+}
+
+std::vector<uint64_t> Memory::read_batch(std::span<const uint64_t> addresses, size_t size, const MemoryPosition& position) const {
+    size = std::min<size_t>(size, 8);
+    std::vector<size_t> order(addresses.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&addresses](size_t a, size_t b) {
+        return addresses[a] < addresses[b];
+    });
+    std::vector<uint64_t> res(addresses.size());
+    size_t slot = 0;
+    for (size_t i : order) {
+        uint8_t bytes[8] = {0};
+        slot = first_slot(addresses[i], slot);
+        read_from(slot, addresses[i], size, position, bytes);
+        for (size_t byte = size; byte > 0; --byte) {
+            res[i] = (res[i] << 8) | bytes[byte - 1];
+        }
+    }
+    return res;
+}
+
+std::optional<MemoryAccess> Memory::last_store(uint64_t address, const MemoryPosition& position) const {
+    std::optional<MemoryAccess> res;
+    size_t slot = first_slot(address);
+    if (slot == dwords.size() || dwords[slot] != (address & ~0x7ULL)) {
+        return res;
+    }
+    visit_visible(slot, position, [&res, address](const MemoryAccess& access) {
+        if (access.is_store && address >= access.address && address < access.address + access.size) {
+            res = access;
+            return true;
+        }
+        return false;
+    });
+    return res;
+}
+
+std::vector<size_t> Memory::access_events(size_t hart_id, uint64_t first_address, uint64_t last_address) const {
+    std::vector<size_t> res;
+    for (const auto& access : accesses) {
+        if (access.hart_id == hart_id && access.address <= last_address &&
+            access.address + access.size - 1 >= first_address) {
+            res.push_back(access.event_id);
+        }
+    }
+    return res;
+}
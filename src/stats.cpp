@@ -0,0 +1,64 @@
+#include "stats.hpp"
+
+#include "json.hpp"
+
+#include <iomanip>
+#include <mutex>
+
+namespace {
+    std::mutex stats_lock;
+    stats::Snapshot values;
+}
+
+void stats::add_time(const std::string& name, std::chrono::nanoseconds duration, uint64_t calls) {
+    std::lock_guard<std::mutex> guard(stats_lock);
+    auto& timer = values.timers[name];
+    timer.total += duration;
+    timer.calls += calls;
+}
+
+void stats::add_count(const std::string& name, uint64_t value) {
+    std::lock_guard<std::mutex> guard(stats_lock);
+    values.counters[name] += value;
+}
+
+stats::Snapshot stats::snapshot() {
+    std::lock_guard<std::mutex> guard(stats_lock);
+    return values;
+}
+
+void stats::reset() {
+    std::lock_guard<std::mutex> guard(stats_lock);
+    values = Snapshot();
+}
+
+void stats::print(std::ostream& out, const Snapshot& values) {
+    for (const auto& [name, timer] : values.timers) {
+        out << name << ": " << std::fixed << std::setprecision(3)
+            << std::chrono::duration<double, std::milli>(timer.total).count() << " ms";
+        if (timer.calls > 1) {
+            out << " (" << timer.calls << " calls)";
+        }
+        out << std::defaultfloat << std::endl;
+    }
+    for (const auto& [name, value] : values.counters) {
+        out << name << ": " << value << std::endl;
+    }
+}
+
+void stats::write_json(std::ostream& out, const Snapshot& values) {
+    out << "{\n  \"timers\": {";
+    const char* separator = "\n";
+    for (const auto& [name, timer] : values.timers) {
+        out << separator << "    \"" << json_escape(name) << "\": {\"ns\": " << timer.total.count()
+            << ", \"calls\": " << timer.calls << '}';
+        separator = ",\n";
+    }
+    out << "\n  },\n  \"counters\": {";
+    separator = "\n";
+    for (const auto& [name, value] : values.counters) {
+        out << separator << "    \"" << json_escape(name) << "\": " << value;
+        separator = ",\n";
+    }
+    out << "\n  }\n}\n";
+}
@@ -0,0 +1,159 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace {
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local size_t current_worker = 0;
+
+    // shared with helper tasks, which may start only after all indices are taken
+    struct ParallelRange {
+        std::function<void(size_t)> body;
+        size_t count;
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+        std::mutex lock;
+        std::condition_variable finished;
+        std::exception_ptr error;
+
+        ParallelRange(const std::function<void(size_t)>& range_body, size_t range_count) :
+            body(range_body),
+            count(range_count) {}
+
+        void run() {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                try {
+                    body(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                if (done.fetch_add(1) + 1 == count) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    finished.notify_all();
+                }
+            }
+        }
+    };
+}
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues.emplace_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(Task task) {
+    size_t queue_id;
+    if (current_pool == this) {
+        queue_id = current_worker;
+    } else {
+        queue_id = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+    {
+        std::lock_guard<std::mutex> guard(queues[queue_id]->lock);
+        queues[queue_id]->tasks.emplace_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        ++queued;
+        ++pending;
+    }
+    has_work.notify_one();
+}
+
+void ThreadPool::wait_idle() {
+    std::unique_lock<std::mutex> guard(state_lock);
+    idle.wait(guard, [this] { return pending == 0; });
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    auto range = std::make_shared<ParallelRange>(body, count);
+    size_t helpers = std::min(count, workers.size()) - 1;
+    for (size_t i = 0; i < helpers; ++i) {
+        submit([range] { range->run(); });
+    }
+    range->run();
+    std::unique_lock<std::mutex> guard(range->lock);
+    range->finished.wait(guard, [&range] { return range->done.load() == range->count; });
+    if (range->error) {
+        std::rethrow_exception(range->error);
+    }
+}
+
+bool ThreadPool::try_pop(size_t queue_id, Task& task) {
+    {
+        auto& own = *queues[queue_id];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); ++i) {
+        auto& victim = *queues[(queue_id + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(size_t worker_id) {
+    current_pool = this;
+    current_worker = worker_id;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(state_lock);
+            has_work.wait(guard, [this] { return stopping || queued > 0; });
+            if (queued == 0) {
+                return;
+            }
+            --queued;
+        }
+        // a task was reserved above, so some queue is guaranteed to hold one
+        Task task;
+        while (!try_pop(worker_id, task)) {
+            std::this_thread::yield();
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> guard(state_lock);
+            if (--pending == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        stopping = true;
+    }
+    has_work.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
@@ -0,0 +1,208 @@
+#include "timeline.hpp"
+
+#include "model.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+namespace {
+    constexpr size_t MAX_COUNTER_SAMPLES = 4096;
+}
+
+ChromeTraceWriter::ChromeTraceWriter(std::ostream& stream, size_t buffer_size) :
+    out(stream),
+    buffer_limit(std::max<size_t>(buffer_size, 1)) {
+    buffer.reserve(buffer_limit + 256);
+    append("{\"traceEvents\":[");
+}
+
+void ChromeTraceWriter::append(std::string_view value) {
+    buffer += value;
+    if (buffer.size() >= buffer_limit) {
+        flush();
+    }
+}
+
+void ChromeTraceWriter::append(uint64_t value) {
+    char digits[20];
+    auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+    append(std::string_view(digits, end - digits));
+}
+
+void ChromeTraceWriter::flush() {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+    if (!out) {
+        throw TimelineException("failed to write the trace");
+    }
+}
+
+void ChromeTraceWriter::begin_event() {
+    if (finished) {
+        throw TimelineException("trace is already finished");
+    }
+    append(events == 0 ? "\n" : ",\n");
+    ++events;
+}
+
+void ChromeTraceWriter::thread_name(uint64_t tid, std::string_view name) {
+    begin_event();
+    append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":");
+    append(tid);
+    append(",\"args\":{\"name\":\"");
+    append(json_escape(name));
+    append("\"}}");
+}
+
+void ChromeTraceWriter::slice(uint64_t tid, std::string_view escaped_name, uint64_t begin, uint64_t end) {
+    begin_event();
+    append("{\"name\":\"");
+    append(escaped_name);
+    append("\",\"ph\":\"X\",\"pid\":0,\"tid\":");
+    append(tid);
+    append(",\"ts\":");
+    append(begin);
+    append(",\"dur\":");
+    append(end - begin);
+    append("}");
+}
+
+void ChromeTraceWriter::counter(std::string_view escaped_name, uint64_t time,
+                                std::initializer_list<std::pair<std::string_view, uint64_t>> values) {
+    begin_event();
+    append("{\"name\":\"");
+    append(escaped_name);
+    append("\",\"ph\":\"C\",\"pid\":0,\"ts\":");
+    append(time);
+    append(",\"args\":{");
+    bool first = true;
+    for (const auto& [name, value] : values) {
+        append(first ? "\"" : ",\"");
+        append(name);
+        append("\":");
+        append(value);
+        first = false;
+    }
+    append("}}");
+}
+
+void ChromeTraceWriter::finish() {
+    if (finished) {
+        return;
+    }
+    append("\n]}\n");
+    finished = true;
+    flush();
+    out.flush();
+}
+
+FunctionNames::FunctionNames(const std::vector<FunctionInfo>& functions) {
+    for (const auto& function : functions) {
+        if (function.low_pc < function.high_pc) {
+            ranges.push_back(Range{function.low_pc, function.high_pc, json_escape(function.name)});
+        }
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const Range& lhs, const Range& rhs) {
+        return lhs.low_pc < rhs.low_pc;
+    });
+}
+
+std::string_view FunctionNames::find(uint64_t pc, std::string& fallback) const {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), pc, [](uint64_t value, const Range& range) {
+        return value < range.low_pc;
+    });
+    if (it != ranges.begin() && pc < std::prev(it)->high_pc) {
+        return std::prev(it)->escaped_name;
+    }
+    char digits[16];
+    auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), pc, 16);
+    fallback = "0x";
+    fallback.append(digits, end - digits);
+    return fallback;
+}
+
+size_t write_timeline(ChromeTraceWriter& writer, uint64_t tid, const ITraceStore& store, const CallStack& stack,
+                      const FunctionNames& names) {
+    const size_t event_count = store.size();
+    if (event_count == 0) {
+        return 0;
+    }
+    const uint64_t last_time = store.get(event_count - 1).time;
+    auto time_at = [&](size_t event_id) {
+        return event_id < event_count ? store.get(event_id).time : last_time;
+    };
+    // frames are created in order of entry and return innermost first, so a stack of the open
+    // ones is closed in order of return and the events are read front to back
+    std::vector<std::pair<uint32_t, uint64_t>> open;
+    std::string fallback;
+    size_t slices = 0;
+    auto close = [&](uint32_t frame_id, uint64_t entry_time, uint64_t end_time) {
+        writer.slice(tid, names.find(stack.frame(frame_id).entry_pc, fallback), entry_time, end_time);
+        ++slices;
+    };
+    auto close_returned = [&](size_t event_id) {
+        while (!open.empty()) {
+            const auto& frame = stack.frame(open.back().first);
+            if (frame.return_event == CallFrame::NO_EVENT || frame.return_event > event_id) {
+                break;
+            }
+            close(open.back().first, open.back().second, time_at(frame.return_event));
+            open.pop_back();
+        }
+    };
+    for (uint32_t frame_id = 0; frame_id < stack.size(); ++frame_id) {
+        const auto& frame = stack.frame(frame_id);
+        // a call by the last event enters no traced code
+        if (frame.entry_event >= event_count) {
+            break;
+        }
+        close_returned(frame.entry_event);
+        open.emplace_back(frame_id, time_at(frame.entry_event));
+    }
+    close_returned(event_count);
+    while (!open.empty()) {
+        close(open.back().first, open.back().second, last_time);
+        open.pop_back();
+    }
+    return slices;
+}
+
+void write_activity_counters(ChromeTraceWriter& writer, std::string_view escaped_name, const ActivityPyramid& pyramid,
+                             size_t max_samples) {
+    size_t level = 0;
+    while (level + 1 < pyramid.level_count() && pyramid.level(level).size() > max_samples) {
+        ++level;
+    }
+    if (level >= pyramid.level_count()) {
+        return;
+    }
+    const uint64_t width = pyramid.node_width(level);
+    const auto& nodes = pyramid.level(level);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        writer.counter(escaped_name, pyramid.start_time() + i * width, {
+            {"instructions", nodes[i].instructions},
+            {"loads", nodes[i].loads},
+            {"stores", nodes[i].stores},
+            {"stall", nodes[i].stall}
+        });
+    }
+}
+
+size_t export_timeline(std::ostream& out, DebugSession& session, const std::vector<FunctionInfo>& functions) {
+    FunctionNames names(functions);
+    ChromeTraceWriter writer(out);
+    const auto& harts = session.get_harts();
+    for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+        writer.thread_name(hart_id, "hart " + std::to_string(hart_id));
+    }
+    size_t slices = 0;
+    for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+        slices += write_timeline(writer, hart_id, harts[hart_id]->trace_store(), harts[hart_id]->call_stack(), names);
+    }
+    const auto& pyramids = session.activity();
+    for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+        write_activity_counters(writer, "hart " + std::to_string(hart_id) + " activity", pyramids[hart_id], MAX_COUNTER_SAMPLES);
+    }
+    writer.finish();
+    return slices;
+}
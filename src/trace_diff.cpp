@@ -0,0 +1,146 @@
+#include "trace_diff.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+    constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ULL;
+    constexpr uint64_t HASH_MULTIPLIER = 0x100000001b3ULL;
+    constexpr size_t WINDOWS_PER_TASK = 64;
+
+    // a bijection of the hash for a fixed value, so one differing field always changes the result
+    uint64_t combine(uint64_t hash, uint64_t value) {
+        return (hash ^ value) * HASH_MULTIPLIER;
+    }
+
+    std::vector<uint64_t> window_hashes(const ITraceStore& store, size_t events, size_t window_events) {
+        const size_t windows = (events + window_events - 1) / window_events;
+        std::vector<uint64_t> res(windows);
+        const size_t tasks = (windows + WINDOWS_PER_TASK - 1) / WINDOWS_PER_TASK;
+        ThreadPool::shared().parallel_for(tasks, [&](size_t task) {
+            size_t window = task * WINDOWS_PER_TASK;
+            const size_t last_event = std::min(events, (window + WINDOWS_PER_TASK) * window_events);
+            uint64_t hash = HASH_SEED;
+            size_t in_window = 0;
+            store.visit_blocks(window * window_events, last_event, [&](const TraceBlock& block) {
+                const auto& columns = block.columns;
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    hash = combine(hash, columns.pc[i]);
+                    hash = combine(hash, columns.instr[i] |
+                        static_cast<uint64_t>(columns.reg_index[i]) << 32 |
+                        static_cast<uint64_t>(columns.reg_type[i]) << 40);
+                    hash = combine(hash, columns.reg_val[i]);
+                    if (++in_window == window_events) {
+                        res[window++] = hash;
+                        hash = HASH_SEED;
+                        in_window = 0;
+                    }
+                }
+                return true;
+            });
+            if (in_window > 0) {
+                res[window] = hash;
+            }
+        });
+        return res;
+    }
+
+    std::vector<uint64_t> prefix_hashes(const std::vector<uint64_t>& hashes) {
+        std::vector<uint64_t> res(hashes.size());
+        uint64_t prefix = HASH_SEED;
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            prefix = combine(prefix, hashes[i]);
+            res[i] = prefix;
+        }
+        return res;
+    }
+
+    bool same_event(const TraceEntry& golden, const TraceEntry& failing) {
+        if (golden.pc != failing.pc || golden.instr != failing.instr ||
+            golden.changed_reg.has_value() != failing.changed_reg.has_value()) {
+            return false;
+        }
+        return !golden.changed_reg ||
+            (golden.changed_reg->reg == failing.changed_reg->reg && golden.changed_reg->val == failing.changed_reg->val);
+    }
+
+    void write_event(std::ostream& out, const TraceEntry& event, const DebugInfoProvider* debug_info) {
+        out << "time " << event.time << std::hex << " pc 0x" << event.pc << " instr 0x" << event.instr;
+        if (event.changed_reg) {
+            out << (event.changed_reg->reg.type == RegType::INT ? " x" : " f") << std::dec
+                << event.changed_reg->reg.index << "=0x" << std::hex << event.changed_reg->val;
+        }
+        out << std::dec;
+        if (const SourceLineSpec* line = debug_info ? debug_info->find_line_by_pc(event.pc) : nullptr) {
+            out << " at " << *line;
+        }
+        out << '\n';
+    }
+}
+
+std::optional<size_t> find_first_divergence(const ITraceStore& golden, const ITraceStore& failing, size_t window_events) {
+    const size_t common = std::min(golden.size(), failing.size());
+    if (window_events == 0) {
+        window_events = DEFAULT_DIFF_WINDOW;
+    }
+    auto golden_prefix = prefix_hashes(window_hashes(golden, common, window_events));
+    auto failing_prefix = prefix_hashes(window_hashes(failing, common, window_events));
+    size_t low = 0;
+    size_t high = golden_prefix.size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (golden_prefix[middle] == failing_prefix[middle]) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    // equal content always gives equal hashes, so the events before the window found
+    // can differ only in case of a 64-bit hash collision
+    for (size_t event_id = std::min(low * window_events, common); event_id < common; ++event_id) {
+        if (!same_event(golden.get(event_id), failing.get(event_id))) {
+            return event_id;
+        }
+    }
+    if (golden.size() != failing.size()) {
+        return common;
+    }
+    return std::nullopt;
+}
+
+void write_diff_report(std::ostream& out, DebugSession& golden, DebugSession& failing, const DebugInfoProvider* debug_info) {
+    const auto& golden_harts = golden.get_harts();
+    const auto& failing_harts = failing.get_harts();
+    if (golden_harts.size() != failing_harts.size()) {
+        out << "hart count differs: " << golden_harts.size() << " vs " << failing_harts.size() << '\n';
+    }
+    for (size_t i = 0; i < std::min(golden_harts.size(), failing_harts.size()); ++i) {
+        const auto& golden_store = golden_harts[i]->trace_store();
+        const auto& failing_store = failing_harts[i]->trace_store();
+        auto divergence = find_first_divergence(golden_store, failing_store);
+        if (!divergence) {
+            out << "hart " << i << ": identical, " << golden_store.size() << " events\n";
+            continue;
+        }
+        const size_t event_id = divergence.value();
+        out << "hart " << i << ": first divergence at event " << event_id << '\n';
+        if (event_id > 0) {
+            out << "  last common: ";
+            write_event(out, golden_store.get(event_id - 1), debug_info);
+        }
+        out << "  golden:      ";
+        if (event_id < golden_store.size()) {
+            write_event(out, golden_store.get(event_id), debug_info);
+        } else {
+            out << "end of trace\n";
+        }
+        out << "  failing:     ";
+        if (event_id < failing_store.size()) {
+            write_event(out, failing_store.get(event_id), debug_info);
+        } else {
+            out << "end of trace\n";
+        }
+    }
+}
@@ -0,0 +1,194 @@
+#include "trace_follow.hpp"
+
+#include "trace_input.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <string_view>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr size_t READ_CHUNK = 16 << 20;
+
+    // eventfd of the follower waiting for SIGINT, the signal may reach any thread
+    std::atomic<int> waiting_interrupt_fd = -1;
+
+    void on_interrupt(int) {
+        int fd = waiting_interrupt_fd.load();
+        if (fd >= 0) {
+            uint64_t one = 1;
+            [[maybe_unused]] ssize_t written = write(fd, &one, sizeof(one));
+        }
+    }
+
+    // a read lease is refused while any process has the file open for writing; nothing when
+    // leases are not available, e.g. for a file of another user or on a network file system
+    std::optional<bool> open_for_writing(int fd) {
+        if (fcntl(fd, F_SETLEASE, F_RDLCK) == 0) {
+            fcntl(fd, F_SETLEASE, F_UNLCK);
+            return false;
+        }
+        if (errno == EAGAIN) {
+            return true;
+        }
+        return std::nullopt;
+    }
+}
+
+TraceFollower::TraceFollower() {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        throw TraceFollowException(std::string("failed to start inotify: ") + std::strerror(errno));
+    }
+    interrupt_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (interrupt_fd < 0) {
+        close(inotify_fd);
+        throw TraceFollowException(std::string("failed to create eventfd: ") + std::strerror(errno));
+    }
+}
+
+TraceFollower::~TraceFollower() {
+    for (const auto& file : files) {
+        close(file->fd);
+    }
+    close(inotify_fd);
+    close(interrupt_fd);
+}
+
+void TraceFollower::add(const std::string& path, uint64_t offset, Sink sink) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw TraceInputException(path, "failed to open");
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    int watch = inotify_add_watch(inotify_fd, path.c_str(), IN_MODIFY | IN_CLOSE_WRITE);
+    if (watch < 0) {
+        close(fd);
+        throw TraceInputException(path, std::string("failed to watch: ") + std::strerror(errno));
+    }
+    // lines written since the offset was taken are read by the next update
+    files.push_back(std::make_unique<File>(File{path, fd, offset, std::move(sink)}));
+    watches[watch] = files.back().get();
+}
+
+void TraceFollower::read_events() {
+    alignas(inotify_event) char buffer[4096];
+    for (ssize_t length; (length = read(inotify_fd, buffer, sizeof(buffer))) > 0;) {
+        for (char* ptr = buffer; ptr < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            auto it = watches.find(event->wd);
+            if (it != watches.end()) {
+                File& file = *it->second;
+                if (event->mask & IN_MODIFY) {
+                    file.modified = true;
+                    file.writing = true;
+                }
+                if (event->mask & IN_CLOSE_WRITE) {
+                    file.modified = true;
+                    file.writing = false;
+                }
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+bool TraceFollower::read_appended(File& file) {
+    bool res = false;
+    while (true) {
+        struct stat file_stat;
+        if (fstat(file.fd, &file_stat) < 0) {
+            throw TraceInputException(file.path, "failed to stat");
+        }
+        const uint64_t size = file_stat.st_size;
+        if (size < file.offset) {
+            throw TraceInputException(file.path, "truncated while followed");
+        }
+        if (size == file.offset) {
+            break;
+        }
+        std::string chunk(std::min<uint64_t>(size - file.offset, READ_CHUNK), '\0');
+        const ssize_t read = pread(file.fd, chunk.data(), chunk.size(), file.offset);
+        if (read < 0) {
+            throw TraceInputException(file.path, "failed to read");
+        }
+        const size_t newline = std::string_view(chunk.data(), read).rfind('\n');
+        if (newline == std::string_view::npos) {
+            break;
+        }
+        chunk.resize(newline + 1);
+        file.offset += chunk.size();
+        std::istringstream lines(std::move(chunk));
+        file.sink(lines);
+        res = true;
+    }
+    return res;
+}
+
+size_t TraceFollower::update() {
+    std::vector<File*> modified;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        read_events();
+        for (const auto& file : files) {
+            if (file->modified) {
+                file->modified = false;
+                modified.push_back(file.get());
+            }
+        }
+    }
+    size_t res = 0;
+    for (File* file : modified) {
+        res += read_appended(*file) ? 1 : 0;
+    }
+    return res;
+}
+
+TraceFollower::WaitResult TraceFollower::wait() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        read_events();
+        if (std::any_of(files.begin(), files.end(), [](const auto& file) { return file->modified; })) {
+            return WaitResult::MODIFIED;
+        }
+        // without leases a file counts as written between a modification and its close
+        auto written = [](const auto& file) {
+            return open_for_writing(file->fd).value_or(file->writing);
+        };
+        if (std::none_of(files.begin(), files.end(), written)) {
+            return WaitResult::FINISHED;
+        }
+    }
+    struct sigaction action = {};
+    struct sigaction previous = {};
+    action.sa_handler = on_interrupt;
+    sigemptyset(&action.sa_mask);
+    waiting_interrupt_fd.store(interrupt_fd);
+    sigaction(SIGINT, &action, &previous);
+    pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {interrupt_fd, POLLIN, 0}};
+    const int ready = poll(fds, 2, -1);
+    const int poll_error = errno;
+    sigaction(SIGINT, &previous, nullptr);
+    waiting_interrupt_fd.store(-1);
+    uint64_t interrupts = 0;
+    const bool interrupted = read(interrupt_fd, &interrupts, sizeof(interrupts)) > 0;
+    if (interrupted || (ready < 0 && poll_error == EINTR)) {
+        return WaitResult::INTERRUPTED;
+    }
+    if (ready < 0) {
+        throw TraceFollowException(std::string("failed to wait for trace changes: ") + std::strerror(poll_error));
+    }
+    // close events are handled by the next call, after the lines written before them are read
+    return WaitResult::MODIFIED;
+}
@@ -0,0 +1,410 @@
+#include "trace_input.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <streambuf>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#ifdef SC_TRACE_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    constexpr size_t BLOCK_SIZE = 1 << 20;
+    constexpr size_t QUEUE_CAPACITY = 8;
+    // decompressed bytes of the zstd frames held ahead of the parser, one frame may exceed it
+    constexpr size_t READ_AHEAD_BYTES = 64 << 20;
+
+    // Bounded hand-off between the decompression stage and the parser
+    class BlockQueue {
+        std::mutex lock;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        std::deque<std::string> blocks;
+        std::exception_ptr error;
+        bool closed = false;
+        bool cancelled = false;
+    public:
+        bool push(std::string block) {
+            std::unique_lock<std::mutex> guard(lock);
+            not_full.wait(guard, [this] { return cancelled || blocks.size() < QUEUE_CAPACITY; });
+            if (cancelled) {
+                return false;
+            }
+            blocks.emplace_back(std::move(block));
+            not_empty.notify_one();
+            return true;
+        }
+        bool pop(std::string& block) {
+            std::unique_lock<std::mutex> guard(lock);
+            not_empty.wait(guard, [this] { return closed || !blocks.empty(); });
+            if (blocks.empty()) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                return false;
+            }
+            block = std::move(blocks.front());
+            blocks.pop_front();
+            not_full.notify_one();
+            return true;
+        }
+        void close(std::exception_ptr producer_error = nullptr) {
+            std::lock_guard<std::mutex> guard(lock);
+            closed = true;
+            error = producer_error;
+            not_empty.notify_all();
+        }
+        void cancel() {
+            std::lock_guard<std::mutex> guard(lock);
+            cancelled = true;
+            not_full.notify_all();
+        }
+    };
+
+    using Producer = std::function<void(BlockQueue&)>;
+
+    class PipelineStreambuf : public std::streambuf {
+        BlockQueue queue;
+        std::string current;
+        std::thread producer_thread;
+    public:
+        explicit PipelineStreambuf(Producer producer) {
+            producer_thread = std::thread([this, producer = std::move(producer)] {
+                try {
+                    producer(queue);
+                    queue.close();
+                } catch (...) {
+                    queue.close(std::current_exception());
+                }
+            });
+        }
+        ~PipelineStreambuf() {
+            queue.cancel();
+            producer_thread.join();
+        }
+    protected:
+        int_type underflow() override {
+            do {
+                if (!queue.pop(current)) {
+                    return traits_type::eof();
+                }
+            } while (current.empty());
+            setg(current.data(), current.data(), current.data() + current.size());
+            return traits_type::to_int_type(*gptr());
+        }
+    };
+
+    class PipelineStream : public std::istream {
+        PipelineStreambuf buffer;
+    public:
+        explicit PipelineStream(Producer producer) : std::istream(nullptr), buffer(std::move(producer)) {
+            rdbuf(&buffer);
+            // makes errors of the decompression stage reach the reader
+            exceptions(std::ios::badbit);
+        }
+    };
+
+    void produce_gzip(const std::string& path, BlockQueue& queue) {
+        gzFile file = gzopen(path.c_str(), "rb");
+        if (!file) {
+            throw TraceInputException(path, "failed to open");
+        }
+        gzbuffer(file, BLOCK_SIZE);
+        while (true) {
+            std::string block(BLOCK_SIZE, '\0');
+            int read = gzread(file, block.data(), block.size());
+            int errnum = Z_OK;
+            const char* message = gzerror(file, &errnum);
+            // a truncated stream returns the data decoded so far and reports Z_BUF_ERROR
+            if (read < 0 || (errnum != Z_OK && errnum != Z_STREAM_END)) {
+                std::string reason = message;
+                gzclose(file);
+                throw TraceInputException(path, reason);
+            }
+            if (read == 0) {
+                break;
+            }
+            block.resize(read);
+            if (!queue.push(std::move(block))) {
+                break;
+            }
+        }
+        gzclose(file);
+    }
+
+#ifdef SC_TRACE_WITH_ZSTD
+    class MappedFile {
+        void* data = MAP_FAILED;
+        size_t size = 0;
+    public:
+        explicit MappedFile(const std::string& path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw TraceInputException(path, "failed to open");
+            }
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) < 0) {
+                close(fd);
+                throw TraceInputException(path, "failed to stat");
+            }
+            size = file_stat.st_size;
+            if (size > 0) {
+                data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            close(fd);
+            if (size > 0 && data == MAP_FAILED) {
+                throw TraceInputException(path, "failed to map");
+            }
+        }
+        MappedFile(const MappedFile& other) = delete;
+        MappedFile& operator=(const MappedFile& other) = delete;
+        const char* begin() const {
+            return static_cast<const char*>(data);
+        }
+        size_t length() const {
+            return size;
+        }
+        ~MappedFile() {
+            if (data != MAP_FAILED) {
+                munmap(data, size);
+            }
+        }
+    };
+
+    // calls sink with decompressed pieces of at most BLOCK_SIZE, stops early if sink returns false
+    void decompress_zstd_frame(const std::string& path, const char* data, size_t size,
+                               const std::function<bool(std::string&&)>& sink) {
+        std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+        ZSTD_inBuffer in{data, size, 0};
+        size_t ret = 1;
+        bool out_full = false;
+        while (in.pos < in.size || (ret != 0 && out_full)) {
+            std::string block(BLOCK_SIZE, '\0');
+            ZSTD_outBuffer out{block.data(), block.size(), 0};
+            ret = ZSTD_decompressStream(ctx.get(), &out, &in);
+            if (ZSTD_isError(ret)) {
+                throw TraceInputException(path, ZSTD_getErrorName(ret));
+            }
+            out_full = out.pos == out.size;
+            block.resize(out.pos);
+            if (!block.empty() && !sink(std::move(block))) {
+                return;
+            }
+        }
+        if (ret != 0) {
+            throw TraceInputException(path, "truncated zstd frame");
+        }
+    }
+
+    void produce_zstd(const std::string& path, BlockQueue& queue) {
+        MappedFile file(path);
+        std::vector<std::pair<const char*, size_t>> frames;
+        for (size_t offset = 0; offset < file.length();) {
+            size_t frame_size = ZSTD_findFrameCompressedSize(file.begin() + offset, file.length() - offset);
+            if (ZSTD_isError(frame_size)) {
+                throw TraceInputException(path, ZSTD_getErrorName(frame_size));
+            }
+            frames.emplace_back(file.begin() + offset, frame_size);
+            offset += frame_size;
+        }
+        auto push = [&queue](std::string&& block) { return queue.push(std::move(block)); };
+        if (frames.size() == 1) {
+            decompress_zstd_frame(path, frames[0].first, frames[0].second, push);
+            return;
+        }
+        // frames are decompressed on the pool, a window of them bounded in count and in decompressed
+        // bytes runs ahead of the parser.
+        // A frame no worker has started yet is decompressed here, so a busy pool cannot stall the reader.
+        struct FrameTask {
+            std::packaged_task<std::vector<std::string>()> task;
+            std::atomic<bool> claimed = false;
+            void run() {
+                if (!claimed.exchange(true)) {
+                    task();
+                }
+            }
+            // waits for a started frame, one not started yet never runs
+            void cancel(std::future<std::vector<std::string>>& result) {
+                if (claimed.exchange(true)) {
+                    result.wait();
+                }
+            }
+        };
+        struct PendingFrame {
+            std::shared_ptr<FrameTask> task;
+            std::future<std::vector<std::string>> result;
+            size_t bytes;
+        };
+        auto& pool = ThreadPool::shared();
+        const size_t window = 2 * pool.size() + 1;
+        std::deque<PendingFrame> in_progress;
+        // decompressed bytes held by the window, a frame of unknown size takes the whole budget
+        size_t in_progress_bytes = 0;
+        size_t next_frame = 0;
+        try {
+            while (next_frame < frames.size() || !in_progress.empty()) {
+                while (next_frame < frames.size() && in_progress.size() < window) {
+                    const auto& [frame_data, frame_size] = frames[next_frame];
+                    const unsigned long long content_size = ZSTD_getFrameContentSize(frame_data, frame_size);
+                    const size_t bytes = content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR ?
+                        READ_AHEAD_BYTES : std::min<unsigned long long>(content_size, READ_AHEAD_BYTES);
+                    if (!in_progress.empty() && in_progress_bytes + bytes > READ_AHEAD_BYTES) {
+                        break;
+                    }
+                    auto task = std::make_shared<FrameTask>();
+                    task->task = std::packaged_task<std::vector<std::string>()>(
+                        [&path, frame = frames[next_frame]] {
+                            std::vector<std::string> blocks;
+                            decompress_zstd_frame(path, frame.first, frame.second, [&blocks](std::string&& block) {
+                                blocks.emplace_back(std::move(block));
+                                return true;
+                            });
+                            return blocks;
+                        });
+                    in_progress.push_back({task, task->task.get_future(), bytes});
+                    in_progress_bytes += bytes;
+                    pool.submit([task] { task->run(); });
+                    ++next_frame;
+                }
+                in_progress.front().task->run();
+                auto blocks = in_progress.front().result.get();
+                in_progress_bytes -= in_progress.front().bytes;
+                in_progress.pop_front();
+                for (auto& block : blocks) {
+                    if (!queue.push(std::move(block))) {
+                        next_frame = frames.size();
+                        break;
+                    }
+                }
+            }
+        } catch (...) {
+            // frame tasks reference the mapping, it must outlive all of them
+            for (auto& frame : in_progress) {
+                frame.task->cancel(frame.result);
+            }
+            throw;
+        }
+        for (auto& frame : in_progress) {
+            frame.task->cancel(frame.result);
+        }
+    }
+#endif
+
+    // offset after the last newline in the first size bytes of the file
+    uint64_t complete_lines_length(const std::string& path, int fd, uint64_t size) {
+        std::string block(BLOCK_SIZE, '\0');
+        while (size > 0) {
+            const uint64_t first = size > BLOCK_SIZE ? size - BLOCK_SIZE : 0;
+            const ssize_t read = pread(fd, block.data(), size - first, first);
+            if (read != static_cast<ssize_t>(size - first)) {
+                throw TraceInputException(path, "failed to read");
+            }
+            const size_t newline = std::string_view(block.data(), read).rfind('\n');
+            if (newline != std::string_view::npos) {
+                return first + newline + 1;
+            }
+            size = first;
+        }
+        return 0;
+    }
+
+    void produce_range(const std::string& path, uint64_t length, BlockQueue& queue) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw TraceInputException(path, "failed to open");
+        }
+        for (uint64_t offset = 0; offset < length;) {
+            std::string block(std::min<uint64_t>(BLOCK_SIZE, length - offset), '\0');
+            const ssize_t read = pread(fd, block.data(), block.size(), offset);
+            if (read <= 0) {
+                close(fd);
+                throw TraceInputException(path, "failed to read");
+            }
+            block.resize(read);
+            offset += read;
+            if (!queue.push(std::move(block))) {
+                break;
+            }
+        }
+        close(fd);
+    }
+
+    enum class Compression {
+        NONE,
+        GZIP,
+        ZSTD
+    };
+
+    Compression detect_compression(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw TraceInputException(path, "failed to open");
+        }
+        unsigned char magic[4] = {0};
+        file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+        if (file.gcount() >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+            return Compression::GZIP;
+        }
+        if (file.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+            return Compression::ZSTD;
+        }
+        return Compression::NONE;
+    }
+}
+
+std::unique_ptr<std::istream> open_trace_input(const std::string& path) {
+    switch (detect_compression(path)) {
+    case Compression::GZIP:
+        return std::make_unique<PipelineStream>([path](BlockQueue& queue) { produce_gzip(path, queue); });
+    case Compression::ZSTD:
+#ifdef SC_TRACE_WITH_ZSTD
+        return std::make_unique<PipelineStream>([path](BlockQueue& queue) { produce_zstd(path, queue); });
+#else
+        throw TraceInputException(path, "built without zstd support");
+#endif
+    default:
+        return std::make_unique<std::ifstream>(path);
+    }
+}
+
+std::unique_ptr<std::istream> open_trace_prefix(const std::string& path, uint64_t& length) {
+    if (detect_compression(path) != Compression::NONE) {
+        throw TraceInputException(path, "only uncompressed traces can be followed");
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw TraceInputException(path, "failed to open");
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0) {
+        close(fd);
+        throw TraceInputException(path, "failed to stat");
+    }
+    try {
+        length = complete_lines_length(path, fd, file_stat.st_size);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return std::make_unique<PipelineStream>([path, length](BlockQueue& queue) { produce_range(path, length, queue); });
+}
@@ -0,0 +1,345 @@
+#include "trace_query.hpp"
+
+#include "RISCV64_decode.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <sstream>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SC_TRACE_WITH_AVX2_KERNELS
+#endif
+
+namespace {
+    constexpr size_t SCAN_TASK_EVENTS = 1 << 16;
+
+    // Every kernel clears bit i % 64 of bits[i / 64] for the element i that fails its condition
+    struct Kernels {
+        void (*and_range)(const uint64_t* values, size_t count, ValueRange range, uint64_t* bits);
+        void (*and_masked)(const uint32_t* values, size_t count, uint32_t mask, uint32_t expected, uint64_t* bits);
+        void (*and_equal)(const uint8_t* values, size_t count, uint8_t expected, uint64_t* bits);
+    };
+
+    void and_range_scalar(const uint64_t* values, size_t count, ValueRange range, uint64_t* bits) {
+        for (size_t word = 0; word * 64 < count; ++word) {
+            const size_t word_count = std::min<size_t>(64, count - word * 64);
+            const uint64_t* word_values = values + word * 64;
+            uint64_t res = 0;
+            for (size_t i = 0; i < word_count; ++i) {
+                res |= static_cast<uint64_t>(range.contains(word_values[i])) << i;
+            }
+            bits[word] &= res;
+        }
+    }
+
+    void and_masked_scalar(const uint32_t* values, size_t count, uint32_t mask, uint32_t expected, uint64_t* bits) {
+        for (size_t word = 0; word * 64 < count; ++word) {
+            const size_t word_count = std::min<size_t>(64, count - word * 64);
+            const uint32_t* word_values = values + word * 64;
+            uint64_t res = 0;
+            for (size_t i = 0; i < word_count; ++i) {
+                res |= static_cast<uint64_t>((word_values[i] & mask) == expected) << i;
+            }
+            bits[word] &= res;
+        }
+    }
+
+    void and_equal_scalar(const uint8_t* values, size_t count, uint8_t expected, uint64_t* bits) {
+        for (size_t word = 0; word * 64 < count; ++word) {
+            const size_t word_count = std::min<size_t>(64, count - word * 64);
+            const uint8_t* word_values = values + word * 64;
+            uint64_t res = 0;
+            for (size_t i = 0; i < word_count; ++i) {
+                res |= static_cast<uint64_t>(word_values[i] == expected) << i;
+            }
+            bits[word] &= res;
+        }
+    }
+
+#ifdef SC_TRACE_WITH_AVX2_KERNELS
+    // full words are compared with AVX2, the tail word falls back to the scalar loop
+    __attribute__((target("avx2")))
+    void and_range_avx2(const uint64_t* values, size_t count, ValueRange range, uint64_t* bits) {
+        // unsigned value - first <= span, compared as signed after flipping the sign bits
+        const __m256i sign = _mm256_set1_epi64x(static_cast<int64_t>(1ULL << 63));
+        const __m256i first = _mm256_set1_epi64x(static_cast<int64_t>(range.first));
+        const __m256i span = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<int64_t>(range.last - range.first)), sign);
+        const size_t full_words = count / 64;
+        for (size_t word = 0; word < full_words; ++word) {
+            const uint64_t* word_values = values + word * 64;
+            uint64_t outside = 0;
+            for (size_t i = 0; i < 64; i += 4) {
+                __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word_values + i));
+                __m256i offset = _mm256_xor_si256(_mm256_sub_epi64(value, first), sign);
+                __m256i greater = _mm256_cmpgt_epi64(offset, span);
+                outside |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(greater))) << i;
+            }
+            bits[word] &= ~outside;
+        }
+        and_range_scalar(values + full_words * 64, count - full_words * 64, range, bits + full_words);
+    }
+
+    __attribute__((target("avx2")))
+    void and_masked_avx2(const uint32_t* values, size_t count, uint32_t mask, uint32_t expected, uint64_t* bits) {
+        const __m256i mask_vector = _mm256_set1_epi32(static_cast<int32_t>(mask));
+        const __m256i expected_vector = _mm256_set1_epi32(static_cast<int32_t>(expected));
+        const size_t full_words = count / 64;
+        for (size_t word = 0; word < full_words; ++word) {
+            const uint32_t* word_values = values + word * 64;
+            uint64_t res = 0;
+            for (size_t i = 0; i < 64; i += 8) {
+                __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word_values + i));
+                __m256i equal = _mm256_cmpeq_epi32(_mm256_and_si256(value, mask_vector), expected_vector);
+                res |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(equal))) << i;
+            }
+            bits[word] &= res;
+        }
+        and_masked_scalar(values + full_words * 64, count - full_words * 64, mask, expected, bits + full_words);
+    }
+
+    __attribute__((target("avx2")))
+    void and_equal_avx2(const uint8_t* values, size_t count, uint8_t expected, uint64_t* bits) {
+        const __m256i expected_vector = _mm256_set1_epi8(static_cast<char>(expected));
+        const size_t full_words = count / 64;
+        for (size_t word = 0; word < full_words; ++word) {
+            const uint8_t* word_values = values + word * 64;
+            __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word_values));
+            __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word_values + 32));
+            uint64_t res = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, expected_vector)));
+            res |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, expected_vector)))) << 32;
+            bits[word] &= res;
+        }
+        and_equal_scalar(values + full_words * 64, count - full_words * 64, expected, bits + full_words);
+    }
+#endif
+
+    const Kernels& kernels() {
+        static const Kernels selected = [] {
+#ifdef SC_TRACE_WITH_AVX2_KERNELS
+            if (__builtin_cpu_supports("avx2")) {
+                return Kernels{and_range_avx2, and_masked_avx2, and_equal_avx2};
+            }
+#endif
+            return Kernels{and_range_scalar, and_masked_scalar, and_equal_scalar};
+        }();
+        return selected;
+    }
+
+    // bit i of bits is set for event block.begin + i of the block when it matches the query
+    void evaluate_block(const TraceBlock& block, const TraceQuery& query, std::vector<uint64_t>& bits) {
+        const size_t count = block.end - block.begin;
+        bits.assign((count + 63) / 64, ~0ULL);
+        if (count % 64 != 0) {
+            bits.back() = (1ULL << (count % 64)) - 1;
+        }
+        const auto& columns = block.columns;
+        const auto& selected = kernels();
+        if (query.pc) {
+            selected.and_range(columns.pc.data() + block.begin, count, query.pc.value(), bits.data());
+        }
+        if (query.time) {
+            selected.and_range(columns.time.data() + block.begin, count, query.time.value(), bits.data());
+        }
+        if (query.instr_mask != 0) {
+            selected.and_masked(columns.instr.data() + block.begin, count, query.instr_mask, query.instr_value, bits.data());
+        }
+        if (query.reg_index) {
+            selected.and_equal(columns.reg_index.data() + block.begin, count, query.reg_index.value(), bits.data());
+            selected.and_equal(columns.reg_type.data() + block.begin, count, static_cast<uint8_t>(RegType::INT), bits.data());
+            if (query.reg_value) {
+                selected.and_range(columns.reg_val.data() + block.begin, count, query.reg_value.value(), bits.data());
+            }
+        }
+    }
+
+    // visitor is called with every matching event id in [first, last) and returns false to stop
+    template <typename Visitor>
+    void scan(const ITraceStore& store, const TraceQuery& query, size_t first, size_t last, Visitor visitor) {
+        std::vector<uint64_t> bits;
+        store.visit_blocks(first, last, [&](const TraceBlock& block) {
+            evaluate_block(block, query, bits);
+            for (size_t word = 0; word < bits.size(); ++word) {
+                for (uint64_t matched = bits[word]; matched != 0; matched &= matched - 1) {
+                    if (!visitor(block.first_event + block.begin + word * 64 + std::countr_zero(matched))) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        });
+    }
+
+    uint64_t parse_value(std::string_view text) {
+        int base = 10;
+        if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+            text.remove_prefix(2);
+            base = 16;
+        }
+        uint64_t value;
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+        if (text.empty() || ec != std::errc() || ptr != text.data() + text.size()) {
+            throw TraceQueryException("bad number '" + std::string(text) + '\'');
+        }
+        return value;
+    }
+
+    // "<value>" or "<first>..<end>" with the end excluded
+    ValueRange parse_range(const std::string& text) {
+        size_t dots = text.find("..");
+        if (dots == std::string::npos) {
+            uint64_t value = parse_value(text);
+            return ValueRange{value, value};
+        }
+        uint64_t first = parse_value(std::string_view(text).substr(0, dots));
+        uint64_t end = parse_value(std::string_view(text).substr(dots + 2));
+        if (end <= first) {
+            throw TraceQueryException("empty range '" + text + '\'');
+        }
+        return ValueRange{first, end - 1};
+    }
+
+    ValueRange comparison_range(const std::string& op, uint64_t value) {
+        constexpr uint64_t max = std::numeric_limits<uint64_t>::max();
+        if (op == "==") {
+            return ValueRange{value, value};
+        } else if (op == ">=") {
+            return ValueRange{value, max};
+        } else if (op == "<=") {
+            return ValueRange{0, value};
+        } else if (op == ">" && value != max) {
+            return ValueRange{value + 1, max};
+        } else if (op == "<" && value != 0) {
+            return ValueRange{0, value - 1};
+        }
+        throw TraceQueryException("condition '" + op + ' ' + std::to_string(value) + "' never holds");
+    }
+
+    bool is_comparison(const std::string& token) {
+        return token == "==" || token == "<" || token == "<=" || token == ">" || token == ">=";
+    }
+
+    void set_instr_condition(TraceQuery& query, uint32_t mask, uint32_t value) {
+        if ((query.instr_mask & mask & (query.instr_value ^ value)) != 0) {
+            throw TraceQueryException("conflicting instruction conditions");
+        }
+        query.instr_mask |= mask;
+        query.instr_value = (query.instr_value & ~mask) | (value & mask);
+    }
+}
+
+TraceQuery TraceQuery::parse(const std::string& text) {
+    std::istringstream input(text);
+    std::vector<std::string> tokens;
+    for (std::string token; input >> token;) {
+        tokens.push_back(token);
+    }
+    TraceQuery query;
+    auto argument = [&tokens](size_t& i) -> const std::string& {
+        if (i + 1 >= tokens.size()) {
+            throw TraceQueryException("value expected after '" + tokens[i] + '\'');
+        }
+        return tokens[++i];
+    };
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const std::string& token = tokens[i];
+        if (token == "pc") {
+            query.pc = parse_range(argument(i));
+        } else if (token == "time") {
+            query.time = parse_range(argument(i));
+        } else if (token == "addr") {
+            query.address = parse_range(argument(i));
+        } else if (token == "load") {
+            set_instr_condition(query, RISCV64Decode::OPCODE_MASK, RISCV64Decode::LOAD_OPCODE);
+        } else if (token == "store") {
+            set_instr_condition(query, RISCV64Decode::OPCODE_MASK, RISCV64Decode::STORE_OPCODE);
+        } else if (token == "instr") {
+            const std::string& spec = argument(i);
+            size_t slash = spec.find('/');
+            uint64_t value = parse_value(std::string_view(spec).substr(0, slash));
+            uint64_t mask = slash == std::string::npos ? 0xffffffff : parse_value(std::string_view(spec).substr(slash + 1));
+            if (value > 0xffffffff || mask > 0xffffffff || mask == 0) {
+                throw TraceQueryException("bad instruction pattern '" + spec + '\'');
+            }
+            set_instr_condition(query, mask, value & mask);
+        } else if (auto index = RISCV64Decode::register_index(token)) {
+            if (query.reg_index && query.reg_index != index) {
+                throw TraceQueryException("an event writes only one register");
+            }
+            query.reg_index = static_cast<uint8_t>(index.value());
+            if (i + 1 < tokens.size() && is_comparison(tokens[i + 1])) {
+                const std::string& op = tokens[++i];
+                query.reg_value = comparison_range(op, parse_value(argument(i)));
+            }
+        } else {
+            throw TraceQueryException("unknown condition '" + token + '\'');
+        }
+    }
+    return query;
+}
+
+bool TraceQuery::matches(const TraceEntry& event) const {
+    if ((pc && !pc->contains(event.pc)) ||
+        (time && !time->contains(event.time)) ||
+        (event.instr & instr_mask) != instr_value) {
+        return false;
+    }
+    if (!reg_index) {
+        return true;
+    }
+    return event.changed_reg && event.changed_reg->reg.type == RegType::INT &&
+        event.changed_reg->reg.index == reg_index.value() &&
+        (!reg_value || reg_value->contains(event.changed_reg->val));
+}
+
+std::vector<size_t> find_events(const ITraceStore& store, const TraceQuery& query, size_t first_event, size_t limit) {
+    std::vector<size_t> res;
+    const size_t total = store.size();
+    if (first_event >= total || limit == 0) {
+        return res;
+    }
+    const size_t tasks = (total - first_event + SCAN_TASK_EVENTS - 1) / SCAN_TASK_EVENTS;
+    // tasks are scanned in rounds, so that a small limit stops the search early
+    const size_t round_tasks = std::max<size_t>(1, ThreadPool::shared().size()) * 2;
+    std::vector<std::vector<size_t>> found;
+    for (size_t round_first = 0; round_first < tasks && res.size() < limit; round_first += round_tasks) {
+        found.assign(std::min(round_tasks, tasks - round_first), {});
+        ThreadPool::shared().parallel_for(found.size(), [&](size_t i) {
+            const size_t first = first_event + (round_first + i) * SCAN_TASK_EVENTS;
+            auto& task_found = found[i];
+            scan(store, query, first, std::min(total, first + SCAN_TASK_EVENTS), [&task_found, limit](size_t event_id) {
+                task_found.push_back(event_id);
+                return task_found.size() < limit;
+            });
+        });
+        for (const auto& task_found : found) {
+            size_t take = std::min(task_found.size(), limit - res.size());
+            res.insert(res.end(), task_found.begin(), task_found.begin() + take);
+        }
+    }
+    return res;
+}
+
+size_t count_events(const ITraceStore& store, const TraceQuery& query) {
+    const size_t tasks = (store.size() + SCAN_TASK_EVENTS - 1) / SCAN_TASK_EVENTS;
+    std::vector<size_t> counts(tasks);
+    ThreadPool::shared().parallel_for(tasks, [&](size_t task) {
+        const size_t first = task * SCAN_TASK_EVENTS;
+        std::vector<uint64_t> bits;
+        store.visit_blocks(first, std::min(store.size(), first + SCAN_TASK_EVENTS), [&](const TraceBlock& block) {
+            evaluate_block(block, query, bits);
+            for (uint64_t word : bits) {
+                counts[task] += std::popcount(word);
+            }
+            return true;
+        });
+    });
+    size_t res = 0;
+    for (size_t count : counts) {
+        res += count;
+    }
+    return res;
+}
@@ -0,0 +1,320 @@
+#include "trace_store.hpp"
+
+#include "thread_pool.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+    struct ColumnData {
+        char* data;
+        size_t element_size;
+    };
+
+    template <typename T>
+    ColumnData column_data(std::vector<T>& column) {
+        return ColumnData{reinterpret_cast<char*>(column.data()), sizeof(T)};
+    }
+
+    // order of the columns inside a chunk of the spill file
+    std::array<ColumnData, 7> columns_of(TraceColumns& columns) {
+        return {
+            column_data(columns.time),
+            column_data(columns.pc),
+            column_data(columns.instr),
+            column_data(columns.reg_index),
+            column_data(columns.reg_type),
+            column_data(columns.reg_val),
+            column_data(columns.reg_prev)
+        };
+    }
+
+    void read_exact(int fd, char* dst, size_t size, size_t offset) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t res = pread(fd, dst + done, size - done, offset + done);
+            if (res < 0 && errno == EINTR) {
+                continue;
+            }
+            if (res <= 0) {
+                throw TraceStoreException("failed to read spill file");
+            }
+            done += res;
+        }
+    }
+
+    void write_exact(int fd, const char* src, size_t size, size_t offset) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t res = pwrite(fd, src + done, size - done, offset + done);
+            if (res < 0 && errno == EINTR) {
+                continue;
+            }
+            if (res <= 0) {
+                throw TraceStoreException(std::string("failed to write spill file: ") + std::strerror(errno));
+            }
+            done += res;
+        }
+    }
+}
+
+void TraceColumns::reserve(size_t count) {
+    time.reserve(count);
+    pc.reserve(count);
+    instr.reserve(count);
+    reg_index.reserve(count);
+    reg_type.reserve(count);
+    reg_val.reserve(count);
+    reg_prev.reserve(count);
+}
+
+void TraceColumns::resize(size_t count) {
+    time.resize(count);
+    pc.resize(count);
+    instr.resize(count);
+    reg_index.resize(count);
+    reg_type.resize(count);
+    reg_val.resize(count);
+    reg_prev.resize(count);
+}
+
+void TraceColumns::clear() {
+    resize(0);
+}
+
+void TraceColumns::shrink_to_fit() {
+    time.shrink_to_fit();
+    pc.shrink_to_fit();
+    instr.shrink_to_fit();
+    reg_index.shrink_to_fit();
+    reg_type.shrink_to_fit();
+    reg_val.shrink_to_fit();
+    reg_prev.shrink_to_fit();
+}
+
+void TraceColumns::push_back(const TraceEntry& entry) {
+    time.push_back(entry.time);
+    pc.push_back(entry.pc);
+    instr.push_back(entry.instr);
+    if (entry.changed_reg) {
+        reg_index.push_back(entry.changed_reg->reg.index);
+        reg_type.push_back(static_cast<uint8_t>(entry.changed_reg->reg.type));
+        reg_val.push_back(entry.changed_reg->val);
+        reg_prev.push_back(entry.changed_reg->prev);
+    } else {
+        reg_index.push_back(NO_REG);
+        reg_type.push_back(0);
+        reg_val.push_back(0);
+        reg_prev.push_back(0);
+    }
+}
+
+TraceEntry TraceColumns::get(size_t index) const {
+    TraceEntry res(time[index], pc[index], instr[index]);
+    if (reg_index[index] != NO_REG) {
+        RegisterDescription reg{reg_index[index], static_cast<RegType>(reg_type[index])};
+        res.changed_reg = RegisterUpdateEvent(reg, reg_val[index], reg_prev[index]);
+    }
+    return res;
+}
+
+struct PagedTraceStore::State {
+    int fd = -1;
+    size_t chunk_events;
+    size_t max_resident_chunks;
+    size_t total_events = 0;
+    std::mutex lock;
+    std::list<size_t> lru;
+    std::unordered_map<size_t, std::pair<std::shared_ptr<const TraceColumns>, std::list<size_t>::iterator>> cache;
+    std::unordered_set<size_t> in_flight;
+    size_t last_chunk = SIZE_MAX;
+
+    size_t chunk_bytes() const {
+        return chunk_events * TraceColumns::EVENT_BYTES;
+    }
+
+    size_t chunk_count() const {
+        return (total_events + chunk_events - 1) / chunk_events;
+    }
+
+    size_t chunk_size_locked(size_t chunk_id) const {
+        return std::min(chunk_events, total_events - chunk_id * chunk_events);
+    }
+
+    std::shared_ptr<const TraceColumns> read_chunk(size_t chunk_id, size_t events) const {
+        auto chunk = std::make_shared<TraceColumns>();
+        chunk->resize(events);
+        size_t offset = chunk_id * chunk_bytes();
+        for (auto column : columns_of(*chunk)) {
+            read_exact(fd, column.data, chunk->size() * column.element_size, offset);
+            offset += chunk_events * column.element_size;
+        }
+        return chunk;
+    }
+
+    void insert_locked(size_t chunk_id, std::shared_ptr<const TraceColumns> chunk) {
+        // a chunk read before more events were appended to it is stale
+        if (cache.contains(chunk_id) || chunk->size() != chunk_size_locked(chunk_id)) {
+            return;
+        }
+        lru.push_front(chunk_id);
+        cache.emplace(chunk_id, std::make_pair(std::move(chunk), lru.begin()));
+        while (cache.size() > max_resident_chunks) {
+            cache.erase(lru.back());
+            lru.pop_back();
+        }
+    }
+
+    static void schedule_prefetch_locked(const std::shared_ptr<State>& self, size_t chunk_id) {
+        if (chunk_id >= self->chunk_count() || self->cache.contains(chunk_id) || self->in_flight.contains(chunk_id)) {
+            return;
+        }
+        self->in_flight.insert(chunk_id);
+        size_t events = self->chunk_size_locked(chunk_id);
+        ThreadPool::shared().submit([self, chunk_id, events] {
+            std::shared_ptr<const TraceColumns> chunk;
+            try {
+                chunk = self->read_chunk(chunk_id, events);
+            } catch (const TraceStoreException& e) {
+                // the foreground read will report the error
+            }
+            std::lock_guard<std::mutex> guard(self->lock);
+            self->in_flight.erase(chunk_id);
+            if (chunk) {
+                self->insert_locked(chunk_id, std::move(chunk));
+            }
+        });
+    }
+
+    ~State() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+PagedTraceStore::PagedTraceStore(const PagedTraceStoreConfig& store_config) : state(std::make_shared<State>()) {
+    if (store_config.chunk_events == 0) {
+        throw TraceStoreException("chunk size must be positive");
+    }
+    state->chunk_events = store_config.chunk_events;
+    // the chunk in use and the one being prefetched must fit together
+    state->max_resident_chunks = std::max<size_t>(2, store_config.memory_budget / state->chunk_bytes());
+    namespace fs = std::filesystem;
+    fs::path dir = store_config.spill_dir.empty() ? fs::temp_directory_path() : fs::path(store_config.spill_dir);
+    std::string path_template = (dir / "sc-trace-XXXXXX").string();
+    state->fd = mkstemp(path_template.data());
+    if (state->fd < 0) {
+        throw TraceStoreException("failed to create spill file in " + dir.string() + ": " + std::strerror(errno));
+    }
+    unlink(path_template.c_str());
+    write_buffer.reserve(state->chunk_events);
+}
+
+void PagedTraceStore::flush_write_buffer() {
+    if (write_buffer.size() == 0) {
+        return;
+    }
+    // after finish_loading the buffer may start in the middle of a chunk
+    const size_t first = event_count - write_buffer.size();
+    const size_t chunk_id = first / state->chunk_events;
+    size_t offset = chunk_id * state->chunk_bytes();
+    for (auto column : columns_of(write_buffer)) {
+        const size_t column_offset = offset + (first % state->chunk_events) * column.element_size;
+        write_exact(state->fd, column.data, write_buffer.size() * column.element_size, column_offset);
+        offset += state->chunk_events * column.element_size;
+    }
+    write_buffer.clear();
+    std::lock_guard<std::mutex> guard(state->lock);
+    state->total_events = event_count;
+    auto cached = state->cache.find(chunk_id);
+    if (cached != state->cache.end()) {
+        state->lru.erase(cached->second.second);
+        state->cache.erase(cached);
+    }
+}
+
+void PagedTraceStore::append(const TraceEntry& entry) {
+    write_buffer.push_back(entry);
+    ++event_count;
+    if (event_count % state->chunk_events == 0) {
+        flush_write_buffer();
+    }
+}
+
+void PagedTraceStore::finish_loading() {
+    flush_write_buffer();
+    write_buffer.shrink_to_fit();
+}
+
+std::shared_ptr<const TraceColumns> PagedTraceStore::load_chunk(size_t chunk_id) const {
+    std::shared_ptr<const TraceColumns> chunk;
+    size_t events;
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        events = state->chunk_size_locked(chunk_id);
+        auto it = state->cache.find(chunk_id);
+        if (it != state->cache.end()) {
+            state->lru.splice(state->lru.begin(), state->lru, it->second.second);
+            chunk = it->second.first;
+        }
+        if (chunk_id != state->last_chunk) {
+            if (state->last_chunk != SIZE_MAX) {
+                if (chunk_id > state->last_chunk) {
+                    State::schedule_prefetch_locked(state, chunk_id + 1);
+                } else if (chunk_id > 0) {
+                    State::schedule_prefetch_locked(state, chunk_id - 1);
+                }
+            }
+            state->last_chunk = chunk_id;
+        }
+    }
+    if (!chunk) {
+        // a chunk still being prefetched is read again rather than waited for,
+        // so that a caller running on a pool thread never blocks on the pool
+        chunk = state->read_chunk(chunk_id, events);
+        std::lock_guard<std::mutex> guard(state->lock);
+        state->insert_locked(chunk_id, chunk);
+    }
+    return chunk;
+}
+
+TraceEntry PagedTraceStore::get(size_t event_id) const {
+    size_t flushed = event_count - write_buffer.size();
+    if (event_id >= flushed) {
+        return write_buffer.get(event_id - flushed);
+    }
+    auto chunk = load_chunk(event_id / state->chunk_events);
+    return chunk->get(event_id % state->chunk_events);
+}
+
+void PagedTraceStore::visit_blocks(size_t first, size_t last, const BlockVisitor& visitor) const {
+    const size_t flushed = event_count - write_buffer.size();
+    while (first < std::min(last, flushed)) {
+        const size_t chunk_id = first / state->chunk_events;
+        const size_t chunk_first = chunk_id * state->chunk_events;
+        auto chunk = load_chunk(chunk_id);
+        const size_t end = std::min(last, chunk_first + chunk->size());
+        if (!visitor(TraceBlock{*chunk, chunk_first, first - chunk_first, end - chunk_first})) {
+            return;
+        }
+        first = end;
+    }
+    if (first < last) {
+        visitor(TraceBlock{write_buffer, flushed, first - flushed, last - flushed});
+    }
+}
+
+size_t PagedTraceStore::resident_bytes() const {
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->cache.size() * state->chunk_bytes() + write_buffer.capacity_bytes();
+}
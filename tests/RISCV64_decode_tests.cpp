@@ -25,6 +25,19 @@ void check_instruction(const RISCV64Decode::Instruction& to_test, const RISCV64D
         ASSERT_EQ(test_store.rs1Index, ref_store.rs1Index);
         ASSERT_EQ(test_store.rs2Index, ref_store.rs2Index);
         ASSERT_EQ(test_store.size, ref_store.size);
+        break;
+    }
+    case RISCV64Decode::InstructionType::ATOMIC: {
+        auto& test_atomic = to_test.content.atomicContent;
+        auto& ref_atomic = ref.content.atomicContent;
+        ASSERT_EQ(test_atomic.operation, ref_atomic.operation);
+        ASSERT_EQ(test_atomic.size, ref_atomic.size);
+        ASSERT_EQ(test_atomic.rs1Index, ref_atomic.rs1Index);
+        ASSERT_EQ(test_atomic.rs2Index, ref_atomic.rs2Index);
+        ASSERT_EQ(test_atomic.rdIndex, ref_atomic.rdIndex);
+        ASSERT_EQ(test_atomic.acquire, ref_atomic.acquire);
+        ASSERT_EQ(test_atomic.release, ref_atomic.release);
+        break;
     }
     default:
         break;
@@ -140,3 +153,123 @@ TEST(Unsupported, arithmetics) {
     ref.type = RISCV64Decode::InstructionType::UNSUPPORTED;
     check_instruction(RISCV64Decode::decode(instr), ref);
 }
+
+TEST(DecodeTests, ControlTransfer) {
+    using RISCV64Decode::ControlTransfer;
+    // jal ra; j; jalr ra, 0(t1); ret; jalr t0, 0(ra)
+    ASSERT_EQ(ControlTransfer::CALL, RISCV64Decode::control_transfer(0x008000ef));
+    ASSERT_EQ(ControlTransfer::NONE, RISCV64Decode::control_transfer(0x0080006f));
+    ASSERT_EQ(ControlTransfer::CALL, RISCV64Decode::control_transfer(0x000300e7));
+    ASSERT_EQ(ControlTransfer::RETURN, RISCV64Decode::control_transfer(0x00008067));
+    ASSERT_EQ(ControlTransfer::RETURN_AND_CALL, RISCV64Decode::control_transfer(0x000082e7));
+    // c.jr ra; c.jalr t1; c.jr t1; c.ebreak
+    ASSERT_EQ(ControlTransfer::RETURN, RISCV64Decode::control_transfer(0x8082));
+    ASSERT_EQ(ControlTransfer::CALL, RISCV64Decode::control_transfer(0x9302));
+    ASSERT_EQ(ControlTransfer::NONE, RISCV64Decode::control_transfer(0x8302));
+    ASSERT_EQ(ControlTransfer::NONE, RISCV64Decode::control_transfer(0x9002));
+    ASSERT_EQ(ControlTransfer::NONE, RISCV64Decode::control_transfer(0x00000013));
+}
+
+TEST(LoadDecode, compressed) {
+    // c.lw a5, 0(a0); c.ld a0, 8(a1); c.ldsp a0, 8(sp)
+    RISCV64Decode::Instruction ref;
+    ref.type = RISCV64Decode::InstructionType::LOAD;
+    ref.content.loadContent = {0, 4, 10, 15, true};
+    check_instruction(RISCV64Decode::decode(0x411c), ref);
+    ref.content.loadContent = {8, 8, 11, 10, true};
+    check_instruction(RISCV64Decode::decode(0x6588), ref);
+    ref.content.loadContent = {8, 8, 2, 10, true};
+    check_instruction(RISCV64Decode::decode(0x6522), ref);
+}
+
+TEST(StoreDecode, compressed) {
+    // c.sw a5, 4(a0); c.sdsp ra, 8(sp)
+    RISCV64Decode::Instruction ref;
+    ref.type = RISCV64Decode::InstructionType::STORE;
+    ref.content.storeContent = {4, 4, 10, 15};
+    check_instruction(RISCV64Decode::decode(0xc15c), ref);
+    ref.content.storeContent = {8, 8, 2, 1};
+    check_instruction(RISCV64Decode::decode(0xe406), ref);
+    // c.fld and c.lwsp into x0 are not integer accesses
+    ASSERT_EQ(RISCV64Decode::InstructionType::UNSUPPORTED, RISCV64Decode::decode(0x2188).type);
+    ASSERT_EQ(RISCV64Decode::InstructionType::UNSUPPORTED, RISCV64Decode::decode(0x4002).type);
+}
+
+TEST(DecodeTests, Classify) {
+    using RISCV64Decode::InstructionClass;
+    using RISCV64Decode::classify;
+    // nop; mul; div; ld; sd; beq; jal; amoadd.w; fadd.s; csrr; ecall; fence
+    ASSERT_EQ(InstructionClass::ALU, classify(0x00000013));
+    ASSERT_EQ(InstructionClass::MUL, classify(0x02c58533));
+    ASSERT_EQ(InstructionClass::DIV, classify(0x02c5c533));
+    ASSERT_EQ(InstructionClass::LOAD, classify(0x0005b503));
+    ASSERT_EQ(InstructionClass::STORE, classify(0x00a5b023));
+    ASSERT_EQ(InstructionClass::BRANCH, classify(0x00b50063));
+    ASSERT_EQ(InstructionClass::JUMP, classify(0x008000ef));
+    ASSERT_EQ(InstructionClass::ATOMIC, classify(0x00b5202f));
+    ASSERT_EQ(InstructionClass::FLOAT, classify(0x00000053));
+    ASSERT_EQ(InstructionClass::CSR, classify(0x30002573));
+    ASSERT_EQ(InstructionClass::SYSTEM, classify(0x00000073));
+    ASSERT_EQ(InstructionClass::SYSTEM, classify(0x0ff0000f));
+    // c.lw; c.sw; c.j; c.beqz; c.jr ra; c.ebreak; c.mv; c.nop
+    ASSERT_EQ(InstructionClass::LOAD, classify(0x4188));
+    ASSERT_EQ(InstructionClass::STORE, classify(0xc188));
+    ASSERT_EQ(InstructionClass::JUMP, classify(0xa001));
+    ASSERT_EQ(InstructionClass::BRANCH, classify(0xc101));
+    ASSERT_EQ(InstructionClass::JUMP, classify(0x8082));
+    ASSERT_EQ(InstructionClass::SYSTEM, classify(0x9002));
+    ASSERT_EQ(InstructionClass::ALU, classify(0x852e));
+    ASSERT_EQ(InstructionClass::ALU, classify(0x0001));
+}
+
+TEST(AtomicDecode, lr_w) {
+    uint32_t instr = 0x100527af; // lr.w x15, (x10)
+    RISCV64Decode::Instruction ref;
+    ref.type = RISCV64Decode::InstructionType::ATOMIC;
+    ref.content.atomicContent.operation = RISCV64Decode::AtomicOperation::LR;
+    ref.content.atomicContent.size = 4;
+    ref.content.atomicContent.rs1Index = 10;
+    ref.content.atomicContent.rs2Index = 0;
+    ref.content.atomicContent.rdIndex = 15;
+    ref.content.atomicContent.acquire = false;
+    ref.content.atomicContent.release = false;
+    check_instruction(RISCV64Decode::decode(instr), ref);
+}
+
+TEST(AtomicDecode, amoswap_d_aq) {
+    uint32_t instr = 0x0c6532af; // amoswap.d.aq x5, x6, (x10)
+    RISCV64Decode::Instruction ref;
+    ref.type = RISCV64Decode::InstructionType::ATOMIC;
+    ref.content.atomicContent.operation = RISCV64Decode::AtomicOperation::SWAP;
+    ref.content.atomicContent.size = 8;
+    ref.content.atomicContent.rs1Index = 10;
+    ref.content.atomicContent.rs2Index = 6;
+    ref.content.atomicContent.rdIndex = 5;
+    ref.content.atomicContent.acquire = true;
+    ref.content.atomicContent.release = false;
+    check_instruction(RISCV64Decode::decode(instr), ref);
+}
+
+TEST(AtomicDecode, unsupported) {
+    // funct5 00101 is not an amo operation, funct3 000 has no atomic size
+    ASSERT_EQ(RISCV64Decode::InstructionType::UNSUPPORTED, RISCV64Decode::decode(0x2865202f).type);
+    ASSERT_EQ(RISCV64Decode::InstructionType::UNSUPPORTED, RISCV64Decode::decode(0x0865002f).type);
+}
+
+TEST(AtomicDecode, StoredValue) {
+    using RISCV64Decode::atomic_stored_value;
+    auto atomic = [](uint32_t instr) {
+        return RISCV64Decode::decode(instr).content.atomicContent;
+    };
+    // amoswap.w x6, x5, (x10); amoadd.d x6, x5, (x10); sc.w x7, x5, (x10)
+    ASSERT_EQ(5, atomic_stored_value(atomic(0x0855232f), 1, 5));
+    ASSERT_EQ(6, atomic_stored_value(atomic(0x0055332f), 1, 5));
+    ASSERT_EQ(5, atomic_stored_value(atomic(0x185523af), 0, 5));
+    ASSERT_FALSE(atomic_stored_value(atomic(0x185523af), 1, 5).has_value());
+    // amomax.w and amominu.w compare the low words, -1 is the larger unsigned one
+    ASSERT_EQ(1, atomic_stored_value(atomic(0xa055232f), UINT64_MAX, 1));
+    ASSERT_EQ(1, atomic_stored_value(atomic(0xc055232f), UINT64_MAX, 1));
+    // lr.w x15, (x10) and amoadd.w x0, x5, (x10) leave no known value
+    ASSERT_FALSE(atomic_stored_value(atomic(0x100527af), 1, 5).has_value());
+    ASSERT_FALSE(atomic_stored_value(atomic(0x0055202f), 1, 5).has_value());
+}
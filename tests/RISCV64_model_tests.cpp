@@ -40,6 +40,9 @@ namespace {
         void init_dut(std::istream& trace_input, const std::string& filename) {
             init(trace_input, filename);
         }
+        void set_load_config(const TraceLoadConfig& config) {
+            load_config = config;
+        }
     };
 }
 
@@ -104,3 +107,64 @@ TEST(SequenceTests, StepForAndBack) {
         }
     }
 }
+
+TEST(LineTests, Malformed) {
+    TraceLine tl;
+    ASSERT_EQ(TraceParseError::MISSING_FIELD, TraceLine::parse("1221 3 N 0000000002000348 00000193", tl));
+    ASSERT_EQ(TraceParseError::BAD_FIELD, TraceLine::parse("simulator: warning, something happened", tl));
+    ASSERT_EQ(TraceParseError::BAD_REGISTER, TraceLine::parse("1 2 N 4 0 8 x3ff", tl));
+    ASSERT_EQ(TraceParseError::BAD_REGISTER, TraceLine::parse("1 2 N 4 0 8 x32=0", tl));
+    ASSERT_THROW(TraceLine("1 2 N 4 0"), TraceParseException);
+}
+
+TEST(SequenceTests, SkipsMalformedLines) {
+    std::stringstream trace;
+    trace << "1 2 N 0 0 4" << std::endl;
+    trace << "simulator: warning" << std::endl;
+    trace << "2 2 N 4 0 8 x3=ff" << std::endl;
+    trace << "3 2 N 8 0 c x3=" << std::endl;
+    trace << "3 2 N 8" << std::endl;
+    RISCV64ModelDUT dut;
+    dut.init_dut(trace, "sample text");
+    const auto& errors = dut.get_load_errors();
+    ASSERT_EQ(3, errors.total());
+    ASSERT_EQ(1, errors.counts[static_cast<size_t>(TraceParseError::BAD_FIELD)]);
+    ASSERT_EQ(1, errors.counts[static_cast<size_t>(TraceParseError::BAD_REGISTER)]);
+    ASSERT_EQ(1, errors.counts[static_cast<size_t>(TraceParseError::MISSING_FIELD)]);
+    ASSERT_EQ(2, errors.samples[0].line_number);
+    ASSERT_EQ(2, dut.event_count());
+}
+
+TEST(SequenceTests, StrictLoadThrows) {
+    std::stringstream trace;
+    trace << "1 2 N 0 0 4" << std::endl;
+    trace << "2 2 N 4" << std::endl;
+    RISCV64ModelDUT dut;
+    TraceLoadConfig config;
+    config.strict = true;
+    dut.set_load_config(config);
+    ASSERT_THROW(dut.init_dut(trace, "sample text"), TraceLoadException);
+}
+
+TEST(SequenceTests, AtomicMemoryAccesses) {
+    std::stringstream trace;
+    trace << "1 0 N 100 13 104 x10=8000" << std::endl;
+    trace << "2 0 N 104 13 108 x5=1" << std::endl;
+    // amoswap.w x6, x5, (x10); amoadd.d x6, x5, (x10); sc.w x7, x5, (x10); amoadd.w x0, x5, (x10)
+    trace << "3 0 N 108 0855232f 10c x6=0" << std::endl;
+    trace << "4 0 N 10c 0055332f 110 x6=1" << std::endl;
+    trace << "5 0 N 110 185523af 114 x7=0" << std::endl;
+    trace << "6 0 N 114 0055202f 118" << std::endl;
+    RISCV64ModelDUT dut;
+    dut.init_dut(trace, "sample text");
+    auto accesses = dut.memory_accesses(0);
+    ASSERT_EQ(5, accesses.size());
+    const std::pair<bool, uint64_t> expected[] = {{false, 0}, {true, 1}, {false, 1}, {true, 2}, {true, 1}};
+    for (size_t i = 0; i < accesses.size(); ++i) {
+        ASSERT_EQ(0x8000, accesses[i].address);
+        ASSERT_EQ(expected[i].first, accesses[i].is_store);
+        ASSERT_EQ(expected[i].second, accesses[i].value);
+    }
+    ASSERT_EQ(8, accesses[3].size);
+    ASSERT_EQ(4, accesses[4].size);
+}
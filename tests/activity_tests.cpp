@@ -0,0 +1,92 @@
+#include "activity.hpp"
+#include "test_traces.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+using namespace test_traces;
+
+namespace {
+    // random mix of calls, returns, loads and stores with gaps in time
+    InMemoryTraceStore make_store(size_t events) {
+        std::mt19937 random(7);
+        const uint32_t instrs[] = {NOP, NOP, LD, SD, CALL, RET};
+        InMemoryTraceStore store;
+        uint64_t time = 100;
+        for (size_t i = 0; i < events; ++i) {
+            time += random() % 8 == 0 ? random() % 50 : 1;
+            store.append(TraceEntry(time, 0x1000 + (random() % 64) * 4, instrs[random() % std::size(instrs)]));
+        }
+        return store;
+    }
+
+    ActivitySummary scan(const InMemoryTraceStore& store, const CallStack& stack, uint64_t first_time, uint64_t end_time) {
+        ActivitySummary res;
+        for (size_t i = 0; i < store.size(); ++i) {
+            const auto event = store.get(i);
+            if (event.time < first_time || event.time >= end_time) {
+                continue;
+            }
+            const uint64_t delta = i > 0 ? event.time - store.get(i - 1).time : 0;
+            ++res.instructions;
+            res.loads += event.instr == LD;
+            res.stores += event.instr == SD;
+            res.stall += delta > 1 ? delta - 1 : 0;
+            res.add_function(stack.frame(stack.frame_at(i)).entry_pc);
+        }
+        return res;
+    }
+
+    void expect_equal(const ActivitySummary& expected, const ActivitySummary& actual) {
+        ASSERT_EQ(expected.instructions, actual.instructions);
+        ASSERT_EQ(expected.loads, actual.loads);
+        ASSERT_EQ(expected.stores, actual.stores);
+        ASSERT_EQ(expected.stall, actual.stall);
+        ASSERT_EQ(expected.functions, actual.functions);
+    }
+}
+
+TEST(ActivityTests, RangesMatchScan) {
+    auto store = make_store(5000);
+    auto stack = CallStack::build(store);
+    // narrow buckets give several levels
+    auto pyramid = ActivityPyramid::build(store, stack, 3);
+    ASSERT_GE(pyramid.level_count(), 4);
+    ASSERT_EQ(1, pyramid.level(pyramid.level_count() - 1).size());
+    const uint64_t last_time = store.get(store.size() - 1).time;
+    expect_equal(scan(store, stack, 0, last_time + 1), pyramid.summarize(store, stack, 0, last_time + 1));
+    std::mt19937 random(3);
+    for (size_t i = 0; i < 200; ++i) {
+        uint64_t first_time = 90 + random() % (last_time + 20 - 90);
+        uint64_t end_time = first_time + 1 + random() % (i % 2 == 0 ? 10 : last_time);
+        SCOPED_TRACE(std::to_string(first_time) + ".." + std::to_string(end_time));
+        expect_equal(scan(store, stack, first_time, end_time), pyramid.summarize(store, stack, first_time, end_time));
+    }
+}
+
+TEST(ActivityTests, AutomaticBucketWidth) {
+    auto store = make_store(1000);
+    auto stack = CallStack::build(store);
+    auto pyramid = ActivityPyramid::build(store, stack);
+    ASSERT_LE(pyramid.level(0).size(), ActivityPyramid::MAX_BUCKETS);
+    ASSERT_EQ(store.size(), pyramid.level(pyramid.level_count() - 1)[0].instructions);
+    ASSERT_EQ(store.get(0).time, pyramid.start_time());
+    ASSERT_EQ(pyramid.node_width(0) * 8, pyramid.node_width(1));
+}
+
+TEST(ActivityTests, EmptyTrace) {
+    InMemoryTraceStore store;
+    auto stack = CallStack::build(store);
+    auto pyramid = ActivityPyramid::build(store, stack);
+    ASSERT_EQ(0, pyramid.summarize(store, stack, 0, 100).instructions);
+}
+
+TEST(ActivityTests, FunctionEstimate) {
+    ActivitySummary summary;
+    ASSERT_EQ(0, summary.function_estimate());
+    for (uint64_t pc = 0; pc < 20; ++pc) {
+        summary.add_function(0x1000 + pc * 0x40);
+    }
+    ASSERT_NEAR(20, summary.function_estimate(), 1);
+}
@@ -0,0 +1,63 @@
+#include "RISCV64_model.hpp"
+#include "session.hpp"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+namespace {
+    class RISCV64ModelDUT : public RISCV64Model {
+    public:
+        void init_dut(std::istream& trace_input, const std::string& filename) {
+            init(trace_input, filename);
+        }
+    };
+
+    RISCV64ModelDUT make_model() {
+        std::stringstream trace;
+        trace << "10 0 N 100 0 104 x10=5" << std::endl;
+        trace << "20 0 N 104 0 108 x11=7" << std::endl;
+        RISCV64ModelDUT dut;
+        dut.init_dut(trace, "sample text");
+        dut.step_forward();
+        dut.step_forward();
+        return dut;
+    }
+}
+
+TEST(BreakConditionTests, Arithmetic) {
+    auto dut = make_model();
+    ASSERT_TRUE(BreakCondition("1 + 2 * 3 == 7").evaluate(dut, 0, 0));
+    ASSERT_TRUE(BreakCondition("(1 + 2) * 3 == 9 && 0x10 >> 4 == 1").evaluate(dut, 0, 0));
+    ASSERT_TRUE(BreakCondition("-1 == 0xffffffffffffffff").evaluate(dut, 0, 0));
+    ASSERT_TRUE(BreakCondition("1 < 2 == 1").evaluate(dut, 0, 0));
+    ASSERT_FALSE(BreakCondition("!(3 & 1)").evaluate(dut, 0, 0));
+}
+
+TEST(BreakConditionTests, ModelOperands) {
+    auto dut = make_model();
+    ASSERT_TRUE(BreakCondition("x10 == 5 && a1 == 7").evaluate(dut, 0, 0));
+    ASSERT_TRUE(BreakCondition("pc == 0x104 && time == 20").evaluate(dut, 0, 0));
+    ASSERT_TRUE(BreakCondition("hart == 2 && hits > 1000").evaluate(dut, 2, 1001));
+    ASSERT_FALSE(BreakCondition("hart == 2 && hits > 1000").evaluate(dut, 2, 1000));
+}
+
+TEST(BreakConditionTests, ShortCircuit) {
+    auto dut = make_model();
+    ASSERT_FALSE(BreakCondition("0 && 1 / 0").evaluate(dut, 0, 0));
+    ASSERT_TRUE(BreakCondition("1 || 1 / 0").evaluate(dut, 0, 0));
+    ASSERT_TRUE(BreakCondition("0 || 0 || 3").evaluate(dut, 0, 0));
+    ASSERT_THROW(BreakCondition("1 && 1 / 0").evaluate(dut, 0, 0), BreakConditionException);
+}
+
+TEST(BreakConditionTests, CompileErrors) {
+    ASSERT_THROW(BreakCondition("x32 == 0"), BreakConditionException);
+    ASSERT_THROW(BreakCondition("x10 =="), BreakConditionException);
+    ASSERT_THROW(BreakCondition("(x10"), BreakConditionException);
+    ASSERT_THROW(BreakCondition("x10 = 1"), BreakConditionException);
+    ASSERT_THROW(BreakCondition("foo"), BreakConditionException);
+    // nesting is bounded instead of overflowing the stack
+    ASSERT_THROW(BreakCondition(std::string(100000, '(') + "1"), BreakConditionException);
+    ASSERT_THROW(BreakCondition(std::string(100000, '!') + "1"), BreakConditionException);
+    ASSERT_NO_THROW(BreakCondition(std::string(100, '(') + "1" + std::string(100, ')')));
+}
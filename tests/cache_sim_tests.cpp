@@ -0,0 +1,162 @@
+#include "cache_sim.hpp"
+#include "test_traces.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace test_traces;
+
+namespace {
+    CacheAccess load(uint64_t time, uint64_t address) {
+        return CacheAccess{time, 0x100, address, 8, false};
+    }
+
+    // hit or miss of every access in order
+    std::vector<bool> run(Cache& cache, std::initializer_list<uint64_t> lines) {
+        std::vector<bool> res;
+        for (uint64_t line : lines) {
+            res.push_back(cache.access(line));
+        }
+        return res;
+    }
+}
+
+TEST(CacheSimTests, ParseConfig) {
+    auto config = CacheHierarchyConfig::parse("32k:8:64,1m:16:128:plru,shared");
+    ASSERT_EQ(32 << 10, config.l1.size);
+    ASSERT_EQ(8, config.l1.ways);
+    ASSERT_EQ(ReplacementPolicy::LRU, config.l1.policy);
+    ASSERT_EQ(1 << 20, config.l2->size);
+    ASSERT_EQ(ReplacementPolicy::PLRU, config.l2->policy);
+    ASSERT_TRUE(config.shared_l2);
+    ASSERT_EQ("l1 32k:8:64:lru, shared l2 1m:16:128:plru", config.to_string());
+    ASSERT_THROW(CacheHierarchyConfig::parse("32k:8"), CacheSimException);
+    ASSERT_THROW(CacheHierarchyConfig::parse("32k:8:64:mru"), CacheSimException);
+    ASSERT_THROW(Cache(CacheConfig::parse("48k:8:64")), CacheSimException);
+}
+
+TEST(CacheSimTests, ReplacementPolicies) {
+    // one set of two ways: the third line evicts the least recently used or the oldest line
+    Cache lru(CacheConfig{128, 2, 64, ReplacementPolicy::LRU});
+    ASSERT_EQ(std::vector<bool>({false, false, true, false, true, false}), run(lru, {1, 2, 1, 3, 1, 2}));
+    Cache fifo(CacheConfig{128, 2, 64, ReplacementPolicy::FIFO});
+    ASSERT_EQ(std::vector<bool>({false, false, true, false, false, false}), run(fifo, {1, 2, 1, 3, 1, 2}));
+    // four ways: after 1 2 3 4 1 the tree points at the pair of 3 and 4, and there at 3
+    Cache plru(CacheConfig{256, 4, 64, ReplacementPolicy::PLRU});
+    ASSERT_EQ(std::vector<bool>({false, false, false, false, true, false, true, true, true, false}),
+        run(plru, {1, 2, 3, 4, 1, 5, 1, 2, 4, 3}));
+    Cache random(CacheConfig{256, 4, 64, ReplacementPolicy::RANDOM});
+    ASSERT_EQ(std::vector<bool>({false, false, false, false, true, true, true, true}),
+        run(random, {1, 2, 3, 4, 1, 2, 3, 4}));
+}
+
+TEST(CacheSimTests, CollectAccesses) {
+    InMemoryTraceStore store;
+    TraceEntry base(0, 0x100, NOP);
+    base.changed_reg = RegisterUpdateEvent({10, RegType::INT}, 0x8000);
+    store.append(base);
+    store.append(TraceEntry(1, 0x104, store_dword(10, 11, 40)));
+    TraceEntry loaded(2, 0x108, load_word(12, 10, 4));
+    loaded.changed_reg = RegisterUpdateEvent({12, RegType::INT}, 7);
+    store.append(loaded);
+    auto accesses = collect_cache_accesses(store);
+    ASSERT_EQ(2, accesses.size());
+    ASSERT_TRUE(accesses[0].is_store);
+    ASSERT_EQ(0x8028, accesses[0].address);
+    ASSERT_EQ(8, accesses[0].size);
+    ASSERT_EQ(0x104, accesses[0].pc);
+    ASSERT_FALSE(accesses[1].is_store);
+    ASSERT_EQ(0x8004, accesses[1].address);
+    ASSERT_EQ(4, accesses[1].size);
+}
+
+TEST(CacheSimTests, AtomicsReadAndWrite) {
+    InMemoryTraceStore store;
+    TraceEntry base(0, 0x100, NOP);
+    base.changed_reg = RegisterUpdateEvent({10, RegType::INT}, 0x8000);
+    store.append(base);
+    // lr.w x15, (x10); sc.w x7, x5, (x10); amoadd.w x0, x5, (x10)
+    store.append(TraceEntry(1, 0x104, 0x100527af));
+    store.append(TraceEntry(2, 0x108, 0x185523af));
+    store.append(TraceEntry(3, 0x10c, 0x0055202f));
+    auto accesses = collect_cache_accesses(store);
+    ASSERT_EQ(4, accesses.size());
+    const bool stores[] = {false, true, false, true};
+    for (size_t i = 0; i < accesses.size(); ++i) {
+        ASSERT_EQ(stores[i], accesses[i].is_store);
+        ASSERT_EQ(0x8000, accesses[i].address);
+        ASSERT_EQ(4, accesses[i].size);
+    }
+}
+
+TEST(CacheSimTests, CompressedAccesses) {
+    InMemoryTraceStore store;
+    TraceEntry base(0, 0x100, NOP);
+    base.changed_reg = RegisterUpdateEvent({11, RegType::INT}, 0x8000);
+    store.append(base);
+    // c.ld a0, 8(a1); ld a0, 0(a1); c.sdsp ra, 8(sp)
+    TraceEntry compressed(1, 0x104, 0x6588);
+    compressed.changed_reg = RegisterUpdateEvent({10, RegType::INT}, 1);
+    store.append(compressed);
+    TraceEntry full(2, 0x106, LD);
+    full.changed_reg = RegisterUpdateEvent({10, RegType::INT}, 2);
+    store.append(full);
+    store.append(TraceEntry(3, 0x10a, 0xe406));
+    auto accesses = collect_cache_accesses(store);
+    ASSERT_EQ(3, accesses.size());
+    ASSERT_EQ(0x8008, accesses[0].address);
+    ASSERT_EQ(8, accesses[0].size);
+    ASSERT_EQ(0x8000, accesses[1].address);
+    ASSERT_TRUE(accesses[2].is_store);
+    ASSERT_EQ(8, accesses[2].address);
+    auto report = simulate_caches({accesses}, CacheHierarchyConfig::parse("1k:2:64"));
+    ASSERT_EQ(2, report.l1[0].loads);
+    ASSERT_EQ(1, report.l1[0].load_misses);
+}
+
+TEST(CacheSimTests, SmallerL2Lines) {
+    // a missed 64 byte l1 line touches two 32 byte l2 lines
+    auto report = simulate_caches({{load(0, 0x1000), load(1, 0x1020)}}, CacheHierarchyConfig::parse("1k:2:64,4k:4:32"));
+    ASSERT_EQ(1, report.l1[0].misses());
+    ASSERT_EQ(2, report.l2[0].accesses());
+    ASSERT_EQ(2, report.l2[0].misses());
+    ASSERT_EQ(1, report.l2[0].line_misses.count(0x1020));
+}
+
+TEST(CacheSimTests, SharedL2) {
+    // both harts read the same line, the second one finds it in the shared level
+    std::vector<std::vector<CacheAccess>> harts = {{load(0, 0x1000)}, {load(1, 0x1008)}};
+    auto private_report = simulate_caches(harts, CacheHierarchyConfig::parse("1k:2:64,4k:4:64"));
+    ASSERT_EQ(2, private_report.l2.size());
+    ASSERT_EQ(1, private_report.l2[1].misses());
+    auto shared_report = simulate_caches(harts, CacheHierarchyConfig::parse("1k:2:64,4k:4:64,shared"));
+    ASSERT_EQ(1, shared_report.l2.size());
+    ASSERT_EQ(2, shared_report.l2[0].accesses());
+    ASSERT_EQ(1, shared_report.l2[0].misses());
+    ASSERT_EQ(1, shared_report.l1[1].misses());
+}
+
+TEST(CacheSimTests, ReportHotMisses) {
+    // a misaligned access touches two lines, the streaming pc misses on every line
+    std::vector<CacheAccess> accesses = {{0, 0x200, 0x103c, 8, false}};
+    for (uint64_t i = 0; i < 8; ++i) {
+        accesses.push_back(CacheAccess{i + 1, 0x300, 0x2000 + i * 64, 8, true});
+    }
+    accesses.push_back(CacheAccess{9, 0x200, 0x1040, 8, false});
+    auto report = simulate_caches({accesses}, CacheHierarchyConfig::parse("1k:2:64"));
+    ASSERT_EQ(11, report.l1[0].accesses());
+    ASSERT_EQ(10, report.l1[0].misses());
+    ASSERT_EQ(8, report.l1[0].pc_misses.at(0x300));
+    std::ostringstream out;
+    write_cache_report(out, report, 1, [](uint64_t pc) {
+        return pc == 0x300 ? std::string("main.c:10:3") : std::string();
+    });
+    ASSERT_EQ(
+        "l1 1k:2:64:lru\n"
+        "hart 0 l1: 11 accesses, 10 misses, hit rate 9.09% (loads 33.33%, stores 0.00%)\n"
+        "  hot miss pcs:\n"
+        "    0x300 8 (80.00%) main.c:10:3\n"
+        "  hot miss lines:\n"
+        "    0x1000 1 (10.00%)\n", out.str());
+}
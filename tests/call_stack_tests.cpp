@@ -0,0 +1,68 @@
+#include "call_stack.hpp"
+#include "test_traces.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace test_traces;
+
+TEST(CallStackTests, Backtrace) {
+    auto store = make_call_store();
+    CallStack stack = CallStack::build(store);
+    auto frames = stack.backtrace(4);
+    ASSERT_EQ(3, frames.size());
+    ASSERT_EQ(0x300, stack.frame(frames[0]).entry_pc);
+    ASSERT_EQ(0x204, stack.frame(frames[0]).call_pc);
+    ASSERT_EQ(0x104, stack.frame(frames[1]).call_pc);
+    ASSERT_EQ(CallFrame::NO_EVENT, stack.frame(frames[2]).call_event);
+    ASSERT_EQ(2, stack.frame(frames[0]).depth);
+
+    ASSERT_EQ(6, stack.frame(frames[0]).return_event);
+    ASSERT_EQ(7, stack.frame(frames[1]).return_event);
+    ASSERT_EQ(stack.frame_at(0), stack.frame_at(1));
+    ASSERT_EQ(stack.frame_at(0), stack.frame_at(7));
+    ASSERT_EQ(2, stack.backtrace(8).size());
+    ASSERT_EQ(0x108, stack.frame(stack.backtrace(8)[0]).call_pc);
+}
+
+TEST(CallStackTests, ReturnAboveFirstFrame) {
+    auto store = make_call_store();
+    CallStack stack = CallStack::build(store);
+    // the ret at event 9 leaves the traced code, the caller becomes a new outermost frame
+    auto frames = stack.backtrace(10);
+    ASSERT_EQ(1, frames.size());
+    ASSERT_EQ(10, stack.frame(frames[0]).entry_event);
+    ASSERT_EQ(0x500, stack.frame(frames[0]).entry_pc);
+    ASSERT_EQ(CallFrame::NO_EVENT, stack.frame(frames[0]).return_event);
+    ASSERT_EQ(5, stack.size());
+}
+
+TEST(CallStackTests, EmptyTrace) {
+    InMemoryTraceStore store;
+    CallStack stack = CallStack::build(store);
+    ASSERT_TRUE(stack.backtrace(0).empty());
+}
+
+TEST(CallStackTests, ExtendMatchesBuild) {
+    auto full_store = make_call_store();
+    CallStack full = CallStack::build(full_store);
+    // splits right after calls and returns leave their effects pending until the next event
+    for (size_t split : {1, 2, 6, 7, 9, 10}) {
+        InMemoryTraceStore store;
+        for (size_t i = 0; i < split; ++i) {
+            store.append(full_store.get(i));
+        }
+        CallStack stack = CallStack::build(store);
+        for (size_t i = split; i < full_store.size(); ++i) {
+            store.append(full_store.get(i));
+            stack.extend(store);
+        }
+        ASSERT_EQ(full.size(), stack.size());
+        for (size_t i = 0; i < full_store.size(); ++i) {
+            ASSERT_EQ(full.backtrace(i), stack.backtrace(i));
+        }
+        for (uint32_t frame = 0; frame < full.size(); ++frame) {
+            ASSERT_EQ(full.frame(frame).return_event, stack.frame(frame).return_event);
+            ASSERT_EQ(full.frame(frame).entry_pc, stack.frame(frame).entry_pc);
+        }
+    }
+}
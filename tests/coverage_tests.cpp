@@ -0,0 +1,70 @@
+#include "coverage.hpp"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+TEST(CoverageTests, Bitmap) {
+    CoverageBitmap bitmap(0x1000, 0x2000);
+    bitmap.mark(0x1002);
+    bitmap.mark(0x1ffe);
+    bitmap.mark(0x3000);
+    ASSERT_TRUE(bitmap.covered(0x1002));
+    ASSERT_FALSE(bitmap.covered(0x1004));
+    ASSERT_EQ(2, bitmap.count());
+    ASSERT_TRUE(bitmap.any_covered(0x1000, 0x1004));
+    ASSERT_FALSE(bitmap.any_covered(0x1004, 0x1ffe));
+    ASSERT_TRUE(bitmap.any_covered(0x1004, 0x5000));
+
+    CoverageBitmap other(0x1000, 0x2000);
+    other.mark(0x1800);
+    bitmap.merge(other);
+    ASSERT_EQ(3, bitmap.count());
+    ASSERT_THROW(bitmap.merge(CoverageBitmap(0x1000, 0x3000)), CoverageException);
+}
+
+TEST(CoverageTests, MarkTrace) {
+    InMemoryTraceStore store;
+    for (size_t i = 0; i < 300000; ++i) {
+        // a loop over 0x1000..0x1040 and a few events outside of the range
+        uint64_t pc = i % 1000 == 0 ? 0x80000000 : 0x1000 + (i % 17) * 4;
+        store.append(TraceEntry(i, pc, 0x13));
+    }
+    store.finish_loading();
+    CoverageBitmap bitmap(0x1000, 0x2000);
+    ASSERT_EQ(300, bitmap.mark_trace(store));
+    ASSERT_EQ(17, bitmap.count());
+    ASSERT_TRUE(bitmap.covered(0x1040));
+    ASSERT_FALSE(bitmap.covered(0x1044));
+}
+
+TEST(CoverageTests, LcovReport) {
+    CoverageBitmap bitmap(0x100, 0x200);
+    bitmap.mark(0x100);
+    bitmap.mark(0x108);
+    LineToAddrMap lines = {
+        {SourceLineSpec("b.c", 3, 0), {0x100, 0x104}},
+        {SourceLineSpec("b.c", 4, 0), {0x10c}},
+        {SourceLineSpec("a.c", 7, 0), {0x108}},
+        {SourceLineSpec("a.c", 9, 0), {0x110}}
+    };
+    std::vector<FunctionInfo> functions = {{"f", 0x100, 0x108}, {"g", 0x108, 0x110}, {"h", 0x110, 0x114}};
+    AddrToLineMap entries = {
+        {0x100, SourceLineSpec("b.c", 3, 0)}, {0x108, SourceLineSpec("a.c", 7, 0)}, {0x110, SourceLineSpec("a.c", 9, 0)}
+    };
+    auto report = build_coverage_report(bitmap, lines, functions, [&](uint64_t pc) -> const SourceLineSpec* {
+        auto it = entries.find(pc);
+        return it == entries.end() ? nullptr : &it->second;
+    });
+    ASSERT_EQ(2, report.size());
+    ASSERT_EQ("a.c", report[0].source_path);
+    ASSERT_EQ(1, report[0].lines_hit);
+    ASSERT_EQ(1, report[0].functions_hit);
+
+    std::stringstream out;
+    write_lcov(out, report, "run");
+    ASSERT_EQ(
+        "TN:run\nSF:a.c\nFN:7,g\nFN:9,h\nFNDA:1,g\nFNDA:0,h\nFNF:2\nFNH:1\nDA:7,1\nDA:9,0\nLF:2\nLH:1\nend_of_record\n"
+        "TN:run\nSF:b.c\nFN:3,f\nFNDA:1,f\nFNF:1\nFNH:1\nDA:3,1\nDA:4,0\nLF:2\nLH:1\nend_of_record\n",
+        out.str());
+}
@@ -0,0 +1,74 @@
+#include "csr_index.hpp"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+namespace {
+    // events at times 10, 20, ..., 100
+    InMemoryTraceStore make_store() {
+        InMemoryTraceStore store;
+        for (size_t i = 0; i < 10; ++i) {
+            store.append(TraceEntry((i + 1) * 10, 0x1000 + i * 4, 0x13));
+        }
+        store.finish_loading();
+        return store;
+    }
+}
+
+TEST(CsrIndexTests, ReadAtPosition) {
+    auto store = make_store();
+    std::stringstream trace(
+        "# time csr=value\n"
+        "5 mstatus=0000000000000000\n"
+        "20 mstatus=0000000000001800 mcause=0000000000000008\n"
+        "45 mepc=0x1010\n"
+        "500 mstatus=0\n");
+    auto csrs = CsrIndex::load(trace, "trace_log_csr_0", store);
+    ASSERT_EQ(0, csrs.skipped_lines());
+    ASSERT_EQ((std::vector<std::string>{"mstatus", "mcause", "mepc"}), csrs.names());
+    ASSERT_EQ(0, csrs.changes("mstatus")[0].event_id);
+    ASSERT_EQ(2, csrs.changes("mstatus")[1].event_id);
+    ASSERT_EQ(10, csrs.changes("mstatus")[2].event_id);
+    ASSERT_EQ(0, csrs.read("mstatus", 0));
+    ASSERT_EQ(0, csrs.read("mstatus", 1));
+    ASSERT_EQ(0x1800, csrs.read("mstatus", 2));
+    ASSERT_EQ(0x1800, csrs.read("mstatus", 9));
+    ASSERT_EQ(0, csrs.read("mstatus", 10));
+    ASSERT_FALSE(csrs.read("mcause", 1).has_value());
+    ASSERT_EQ(0x1010, csrs.read("mepc", 4));
+    ASSERT_FALSE(csrs.read("satp", 4).has_value());
+}
+
+TEST(CsrIndexTests, MalformedLines) {
+    auto store = make_store();
+    std::stringstream trace("10 mstatus=1\nbad line\n20 mstatus\n30 mstatus=zz\n40 mstatus=2\n");
+    auto csrs = CsrIndex::load(trace, "trace_log_csr_0", store);
+    ASSERT_EQ(3, csrs.skipped_lines());
+    ASSERT_EQ(2, csrs.changes("mstatus").size());
+    std::stringstream strict_trace("10 mstatus=1\n20 mstatus\n");
+    ASSERT_THROW(CsrIndex::load(strict_trace, "trace_log_csr_0", store, true), CsrTraceException);
+}
+
+TEST(CsrIndexTests, AppendWhileFollowing) {
+    InMemoryTraceStore store;
+    for (size_t i = 0; i < 5; ++i) {
+        store.append(TraceEntry((i + 1) * 10, 0x1000 + i * 4, 0x13));
+    }
+    std::stringstream trace("20 mstatus=1\n70 mstatus=2\n");
+    auto csrs = CsrIndex::load(trace, "trace_log_csr_0", store);
+    // the change at 70 is after the last event until more are appended
+    ASSERT_EQ(5, csrs.changes("mstatus")[1].event_id);
+    for (size_t i = 5; i < 10; ++i) {
+        store.append(TraceEntry((i + 1) * 10, 0x1000 + i * 4, 0x13));
+    }
+    csrs.events_appended(store, 5);
+    ASSERT_EQ(7, csrs.changes("mstatus")[1].event_id);
+    ASSERT_EQ(1, csrs.read("mstatus", 6));
+    ASSERT_EQ(2, csrs.read("mstatus", 7));
+    std::stringstream appended("85 mstatus=3 mepc=0x1020\n");
+    csrs.append(appended, "trace_log_csr_0", store);
+    ASSERT_EQ(3, csrs.read("mstatus", 8));
+    ASSERT_EQ(0x1020, csrs.read("mepc", 8));
+    ASSERT_FALSE(csrs.read("mepc", 7).has_value());
+}
@@ -0,0 +1,136 @@
+#include "executor.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+    std::string make_session_dir() {
+        namespace fs = std::filesystem;
+        fs::path dir = fs::temp_directory_path() / "sc-trace-executor-tests";
+        fs::create_directories(dir);
+        std::ofstream hart0(dir / "trace_log_0");
+        for (size_t i = 0; i < 20; ++i) {
+            hart0 << i << " 0 N " << std::hex << 0x1000 + i * 4 << " 0 " << 0x1004 + i * 4 << std::dec << '\n';
+        }
+        return dir.string();
+    }
+
+    // two nested calls, the second one returns at the end
+    std::string make_call_session_dir() {
+        namespace fs = std::filesystem;
+        fs::path dir = fs::temp_directory_path() / "sc-trace-executor-call-tests";
+        fs::create_directories(dir);
+        std::ofstream(dir / "trace_log_0") <<
+            "0 0 N 1000 8000ef 1008\n"
+            "1 0 N 1008 8000ef 1010\n"
+            "2 0 N 1010 13 1014\n"
+            "3 0 N 1014 13 1018\n";
+        return dir.string();
+    }
+
+    class ExecutorTests : public testing::Test {
+    protected:
+        Executor executor{DebugSessionFactory().create_session(make_session_dir()), DebugInfoProvider()};
+        std::stringstream out;
+        std::stringstream err;
+        ExecutorTests() {
+            executor.set_output(out, err);
+        }
+        // runs the command and returns its error output, the regular output stays in out
+        std::string run(const std::string& command) {
+            out.str("");
+            err.str("");
+            executor.execute_command(command);
+            return err.str();
+        }
+    };
+}
+
+TEST_F(ExecutorTests, ExamineRejectsBadSpecs) {
+    ASSERT_EQ("", run("x/2xw 0x1000"));
+    ASSERT_TRUE(out.str().starts_with("0x1000:"));
+    ASSERT_NE("", run("x/4611686018427387904xw 0"));
+    ASSERT_NE("", run("x/99999999999999999999999xw 0"));
+    ASSERT_NE("", run("x/0xw 0"));
+    ASSERT_NE("", run("x/"));
+    ASSERT_NE("", run("x/ 0x100"));
+    ASSERT_EQ("", out.str());
+}
+
+TEST_F(ExecutorTests, SummaryArguments) {
+    ASSERT_NE("", run("summary"));
+    ASSERT_NE("", run("summary 100 "));
+    ASSERT_NE("", run("summary 1 foo"));
+    ASSERT_NE("", run("summary 5 5"));
+    ASSERT_EQ("", run("summary 0  0x10"));
+    ASSERT_TRUE(out.str().starts_with("hart 0: 16 instructions"));
+}
+
+TEST(ExecutorDebugInfoTests, FailedLoadFallsBackToEmpty) {
+    std::stringstream load_err;
+    auto provider = Executor::load_debug_info("/nonexistent/elf", "", load_err);
+    ASSERT_TRUE(provider.get()->empty());
+    ASSERT_NE(std::string::npos, load_err.str().find("/nonexistent/elf"));
+    Executor executor(DebugSessionFactory().create_session(make_session_dir()), provider);
+    std::stringstream out;
+    std::stringstream err;
+    executor.set_output(out, err);
+    executor.execute_command("latency");
+    executor.execute_command("locks");
+    ASSERT_EQ("", err.str());
+    executor.execute_command("coverage");
+    ASSERT_EQ("no debug info loaded\n", err.str());
+}
+
+TEST_F(ExecutorTests, MemoryArguments) {
+    ASSERT_NE("", run("mem zz"));
+    ASSERT_NE("", run("mem 0x10 foo"));
+    ASSERT_NE("", run("mem 0x10 3"));
+    ASSERT_EQ("", out.str());
+    ASSERT_EQ("", run("mem 0x10 4"));
+    ASSERT_TRUE(out.str().starts_with("0x10: 0x"));
+}
+
+TEST_F(ExecutorTests, GotoArguments) {
+    ASSERT_NE("", run("ge foo"));
+    ASSERT_NE("", run("ge 20"));
+    ASSERT_NE("", run("gt foo"));
+    ASSERT_NE("", run("gt 5x"));
+    ASSERT_EQ("", out.str());
+    ASSERT_EQ("", run("ge 0x3"));
+    ASSERT_EQ("event 3: time 3 pc 0x100c\n", out.str());
+    ASSERT_EQ("", run("gt 7"));
+    ASSERT_TRUE(out.str().starts_with("0: time 7"));
+}
+
+TEST(ExecutorFrameTests, MoveFrameArguments) {
+    Executor executor(DebugSessionFactory().create_session(make_call_session_dir()), DebugInfoProvider());
+    std::stringstream out;
+    std::stringstream err;
+    executor.set_output(out, err);
+    executor.execute_command("ge 2");
+    executor.execute_command("up foo");
+    ASSERT_NE("", err.str());
+    err.str("");
+    executor.execute_command("up");
+    out.str("");
+    executor.execute_command("up 18446744073709551615");
+    ASSERT_EQ("", err.str());
+    ASSERT_TRUE(out.str().starts_with("#2 "));
+    out.str("");
+    executor.execute_command("down 18446744073709551615");
+    ASSERT_TRUE(out.str().starts_with("#0 "));
+}
+
+TEST_F(ExecutorTests, ReportCounts) {
+    ASSERT_NE("", run("latency foo"));
+    ASSERT_EQ("", run("latency 3"));
+    ASSERT_TRUE(out.str().starts_with("hart 0: 20 events"));
+    ASSERT_NE("", run("locks foo"));
+    ASSERT_EQ("", run("locks 3"));
+    ASSERT_EQ("0 locks, 0 contended\n", out.str());
+}
@@ -0,0 +1,124 @@
+#include "farm.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+    std::string make_session_dir() {
+        namespace fs = std::filesystem;
+        fs::path dir = fs::temp_directory_path() / "sc-trace-farm-tests";
+        fs::create_directories(dir);
+        std::ofstream hart0(dir / "trace_log_0");
+        for (size_t i = 0; i < 10; ++i) {
+            hart0 << i << " 0 N " << std::hex << 0x1000 + i * 4 << " 0 " << 0x1004 + i * 4 << std::dec << '\n';
+        }
+        std::ofstream(dir / "script") << "ge 3\n\nexit\nge 4\n";
+        return dir.string();
+    }
+
+    DebugInfoCache::Loader empty_loader(std::atomic<size_t>& loads) {
+        return [&loads](const std::string&) {
+            ++loads;
+            return std::make_shared<DebugInfoProvider>();
+        };
+    }
+}
+
+TEST(FarmTests, ReadManifest) {
+    std::stringstream manifest(
+        "# nightly\n"
+        "\n"
+        "  traces/a  a.elf a.script\n"
+        "   # skipped\n"
+        "traces/b b.elf b.script extra\n");
+    auto jobs = read_manifest(manifest);
+    ASSERT_EQ(2, jobs.size());
+    ASSERT_EQ(0, jobs[0].id);
+    ASSERT_EQ("traces/a", jobs[0].trace_dir);
+    ASSERT_EQ("a.elf", jobs[0].elf_path);
+    ASSERT_EQ("a.script", jobs[0].script_path);
+    ASSERT_EQ(1, jobs[1].id);
+    ASSERT_EQ("b.script", jobs[1].script_path);
+}
+
+TEST(FarmTests, MalformedManifestLine) {
+    std::stringstream manifest("traces/a a.elf a.script\n\ntraces/b b.elf\n");
+    try {
+        read_manifest(manifest);
+        FAIL();
+    } catch (const std::runtime_error& e) {
+        ASSERT_EQ("Malformed manifest line 3: traces/b b.elf", std::string(e.what()));
+    }
+}
+
+TEST(FarmTests, DebugInfoLoadedOncePerElf) {
+    std::atomic<size_t> loads = 0;
+    DebugInfoCache cache(empty_loader(loads));
+    std::vector<std::shared_ptr<DebugInfoProvider>> providers(32);
+    ThreadPool pool(4);
+    pool.parallel_for(providers.size(), [&](size_t i) {
+        providers[i] = cache.get(i % 2 ? "odd.elf" : "even.elf");
+    });
+    ASSERT_EQ(2, loads);
+    for (size_t i = 2; i < providers.size(); ++i) {
+        ASSERT_EQ(providers[i % 2], providers[i]);
+    }
+    ASSERT_NE(providers[0], providers[1]);
+}
+
+TEST(FarmTests, DebugInfoFailureSharedByJobs) {
+    size_t loads = 0;
+    DebugInfoCache cache([&loads](const std::string& elf_path) -> std::shared_ptr<DebugInfoProvider> {
+        ++loads;
+        throw std::runtime_error("bad " + elf_path);
+    });
+    ASSERT_THROW(cache.get("a.elf"), std::runtime_error);
+    ASSERT_THROW(cache.get("a.elf"), std::runtime_error);
+    ASSERT_EQ(1, loads);
+}
+
+TEST(FarmTests, ResultWriterKeepsBlocksWhole) {
+    std::stringstream out;
+    ResultWriter writer(out);
+    std::string block(4096, 'a');
+    block += '\n';
+    ThreadPool pool(4);
+    pool.parallel_for(16, [&](size_t i) {
+        std::string own = block;
+        own[0] = static_cast<char>('a' + i);
+        writer.write(own);
+    });
+    size_t lines = 0;
+    for (std::string line; std::getline(out, line); ++lines) {
+        ASSERT_EQ(4096, line.size());
+        ASSERT_EQ(std::string::npos, line.find_first_not_of('a', 1));
+    }
+    ASSERT_EQ(16, lines);
+}
+
+TEST(FarmTests, RunJobIsSilent) {
+    std::string dir = make_session_dir();
+    std::atomic<size_t> loads = 0;
+    DebugInfoCache cache(empty_loader(loads));
+    std::stringstream out;
+    ResultWriter writer(out);
+    std::stringstream err;
+    auto* old_err = std::cerr.rdbuf(err.rdbuf());
+    run_job({7, dir, "test.elf", dir + "/script"}, cache, writer);
+    run_job({8, dir, "test.elf", dir + "/missing"}, cache, writer);
+    std::cerr.rdbuf(old_err);
+    ASSERT_EQ("", err.str());
+    ASSERT_EQ(1, loads);
+    const auto result = out.str();
+    ASSERT_TRUE(result.starts_with("=== test 7: " + dir + " (test.elf, " + dir + "/script) ===\n>ge 3\nevent 3:"));
+    ASSERT_NE(std::string::npos, result.find("=== status 7: ok ("));
+    ASSERT_EQ(std::string::npos, result.find(">ge 4"));
+    ASSERT_NE(std::string::npos, result.find("=== status 8: error: failed to open script " + dir + "/missing ("));
+}
@@ -0,0 +1,209 @@
+#include "gdb_server.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace {
+    // hart 0 runs from 0x1000, hart 1 from 0x2000 setting x5 to the event number
+    std::string make_session_dir() {
+        namespace fs = std::filesystem;
+        fs::path dir = fs::temp_directory_path() / "sc-trace-gdb-server-tests";
+        fs::create_directories(dir);
+        std::ofstream hart0(dir / "trace_log_0");
+        for (size_t i = 0; i < 20; ++i) {
+            hart0 << i << " 0 N " << std::hex << 0x1000 + i * 4 << " 0 " << 0x1004 + i * 4 << std::dec << '\n';
+        }
+        std::ofstream hart1(dir / "trace_log_1");
+        for (size_t i = 0; i < 10; ++i) {
+            hart1 << i * 3 << " 0 N " << std::hex << 0x2000 + i * 4 << " 0 " << 0x2004 + i * 4 << " x5=" << i << std::dec << '\n';
+        }
+        return dir.string();
+    }
+
+    std::string checksum(const std::string& payload) {
+        uint8_t sum = 0;
+        for (char c : payload) {
+            sum += static_cast<uint8_t>(c);
+        }
+        char text[3];
+        std::snprintf(text, sizeof(text), "%02x", sum);
+        return text;
+    }
+
+    std::string le64(uint64_t value) {
+        std::string res;
+        for (size_t i = 0; i < 8; ++i) {
+            char text[3];
+            std::snprintf(text, sizeof(text), "%02x", static_cast<unsigned>((value >> (i * 8)) & 0xff));
+            res += text;
+        }
+        return res;
+    }
+
+    // the server runs on one end of a socketpair, the test plays gdb on the other
+    class GdbServerTests : public testing::Test {
+    protected:
+        DebugSession session = DebugSessionFactory().create_session(make_session_dir());
+        int fds[2] = {-1, -1};
+        std::thread server_thread;
+        bool ack_mode = true;
+
+        void SetUp() override {
+            ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+            server_thread = std::thread([this] {
+                GdbServer server(session);
+                server.serve(fds[1], fds[1]);
+            });
+        }
+
+        void TearDown() override {
+            shutdown(fds[0], SHUT_RDWR);
+            server_thread.join();
+            close(fds[0]);
+            close(fds[1]);
+        }
+
+        void send_raw(const std::string& data) {
+            ASSERT_EQ(static_cast<ssize_t>(data.size()), write(fds[0], data.data(), data.size()));
+        }
+
+        char read_byte() {
+            char c = 0;
+            EXPECT_EQ(1, read(fds[0], &c, 1));
+            return c;
+        }
+
+        // payload of the next frame, its checksum is verified
+        std::string read_frame() {
+            EXPECT_EQ('$', read_byte());
+            std::string payload;
+            for (char c = read_byte(); c != '#'; c = read_byte()) {
+                payload += c;
+            }
+            std::string sum;
+            sum += read_byte();
+            sum += read_byte();
+            EXPECT_EQ(checksum(payload), sum);
+            return payload;
+        }
+
+        std::string request(const std::string& payload) {
+            send_raw("$" + payload + "#" + checksum(payload));
+            if (ack_mode) {
+                EXPECT_EQ('+', read_byte());
+            }
+            std::string reply = read_frame();
+            if (ack_mode) {
+                send_raw("+");
+            }
+            return reply;
+        }
+    };
+}
+
+TEST_F(GdbServerTests, FramingAndChecksums) {
+    send_raw("$?#00");
+    ASSERT_EQ('-', read_byte());
+    send_raw("$?#3f");
+    ASSERT_EQ('+', read_byte());
+    ASSERT_EQ("T05thread:1;", read_frame());
+    // a nack makes the server send the reply again
+    send_raw("-");
+    ASSERT_EQ("T05thread:1;", read_frame());
+    send_raw("+");
+    ASSERT_EQ("", request("unknown"));
+}
+
+TEST_F(GdbServerTests, NoAckMode) {
+    ASSERT_NE(std::string::npos, request("qSupported:swbreak+").find("QStartNoAckMode+"));
+    ASSERT_EQ("OK", request("QStartNoAckMode"));
+    ack_mode = false;
+    // checksums are no longer verified and no acks are sent
+    send_raw("$qC#00");
+    ASSERT_EQ("QC1", read_frame());
+    ASSERT_EQ("m1,2", request("qfThreadInfo"));
+}
+
+TEST_F(GdbServerTests, RegistersAndMemory) {
+    ASSERT_EQ("OK", request("Hg2"));
+    ASSERT_EQ("T05thread:2;", request("s"));
+    ASSERT_EQ("T05thread:2;", request("s"));
+    const auto& hart = session.get_harts()[1];
+    std::string expected;
+    for (size_t i = 0; i < 32; ++i) {
+        expected += le64(hart->read_register(i));
+    }
+    expected += le64(hart->read_pc());
+    ASSERT_EQ(expected, request("g"));
+    ASSERT_EQ(le64(1), request("p5"));
+    ASSERT_EQ(le64(hart->read_pc()), request("p20"));
+    ASSERT_EQ("E01", request("p21"));
+    ASSERT_EQ(16, request("m1000,8").size());
+    ASSERT_EQ("E01", request("m1000"));
+    ASSERT_EQ("E01", request("G00"));
+}
+
+TEST_F(GdbServerTests, BreakpointsAndReverseExecution) {
+    ASSERT_EQ("OK", request("Z0,1014,4"));
+    ASSERT_EQ("T05thread:1;swbreak:;", request("c"));
+    ASSERT_EQ(le64(0x1014), request("p20"));
+    ASSERT_EQ("T05thread:1;", request("s"));
+    ASSERT_NE(le64(0x1014), request("p20"));
+    ASSERT_EQ("T05thread:1;", request("bs"));
+    ASSERT_EQ(le64(0x1014), request("p20"));
+    ASSERT_EQ("T05thread:1;replaylog:begin;", request("bc"));
+    ASSERT_EQ("T05thread:1;swbreak:;", request("c"));
+    ASSERT_EQ("OK", request("z0,1014,4"));
+    ASSERT_EQ("T05thread:1;replaylog:end;", request("c"));
+}
+
+TEST_F(GdbServerTests, ReverseContinueMovesEveryHart) {
+    ASSERT_EQ("OK", request("Z0,2008,4"));
+    ASSERT_EQ("T05thread:2;swbreak:;", request("c"));
+    ASSERT_EQ("OK", request("z0,2008,4"));
+    ASSERT_EQ("OK", request("Z0,1004,4"));
+    // hart 1 steps back first, then hart 0 reaches the break point
+    ASSERT_EQ("T05thread:1;swbreak:;", request("bc"));
+    ASSERT_EQ(le64(0x1004), request("p20"));
+    ASSERT_EQ("OK", request("Hg2"));
+    ASSERT_EQ(le64(0x2004), request("p20"));
+    ASSERT_EQ("OK", request("z0,1004,4"));
+    ASSERT_EQ("T05thread:2;replaylog:begin;", request("bc"));
+    ASSERT_EQ(0, session.get_harts()[0]->cur_event());
+    ASSERT_EQ(0, session.get_harts()[1]->cur_event());
+}
+
+TEST_F(GdbServerTests, ThreadsAndVCont) {
+    ASSERT_EQ("m1,2", request("qfThreadInfo"));
+    ASSERT_EQ("l", request("qsThreadInfo"));
+    ASSERT_EQ("OK", request("T2"));
+    ASSERT_EQ("E01", request("T3"));
+    ASSERT_EQ("E01", request("Hg3"));
+    ASSERT_EQ("QC1", request("qC"));
+    ASSERT_EQ("vCont;c;s", request("vCont?"));
+    ASSERT_EQ("T05thread:2;", request("vCont;s:2;c"));
+    ASSERT_EQ("QC2", request("qC"));
+    ASSERT_EQ(le64(0), request("p5"));
+    ASSERT_EQ("E01", request("vCont;s:3"));
+    ASSERT_EQ("E01", request("vCont;x"));
+    ASSERT_EQ('m', request("qXfer:features:read:target.xml:0,40")[0]);
+}
+
+TEST(GdbServerListenTests, KeepsFilesThatAreNotSockets) {
+    namespace fs = std::filesystem;
+    fs::path path = fs::temp_directory_path() / "sc-trace-gdb-server-not-socket";
+    std::ofstream(path) << "keep";
+    DebugSession session = DebugSessionFactory().create_session(make_session_dir());
+    GdbServer server(session);
+    ASSERT_THROW(server.serve(path.string()), GdbServerException);
+    ASSERT_TRUE(fs::is_regular_file(path));
+    fs::remove(path);
+}
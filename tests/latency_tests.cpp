@@ -0,0 +1,92 @@
+#include "latency.hpp"
+#include "test_traces.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace test_traces;
+
+namespace {
+    // a loop of nop, div, ld at 0x100 repeated, the div takes 10 time units and the ld 3
+    void fill(ITraceStore& store, size_t iterations) {
+        uint64_t time = 0;
+        for (size_t i = 0; i < iterations; ++i) {
+            store.append(TraceEntry(time += 1, 0x100, NOP));
+            store.append(TraceEntry(time += 10, 0x104, DIV));
+            store.append(TraceEntry(time += 3, 0x108, LD));
+        }
+    }
+}
+
+TEST(LatencyTests, ClassesAndPcs) {
+    InMemoryTraceStore store;
+    fill(store, 100);
+    auto hart = analyze_latency(store);
+    ASSERT_EQ(300, hart.events);
+    ASSERT_EQ(299, hart.all.count);
+    const auto& div = hart.classes[static_cast<size_t>(RISCV64Decode::InstructionClass::DIV)];
+    ASSERT_EQ(100, div.count);
+    ASSERT_EQ(10, div.max);
+    ASSERT_EQ(900, div.stall);
+    ASSERT_EQ(100, div.buckets[4]);
+    ASSERT_EQ(10, div.percentile_bound(0.99));
+    const auto& load = hart.classes[static_cast<size_t>(RISCV64Decode::InstructionClass::LOAD)];
+    ASSERT_EQ(3.0, load.mean());
+    // the first nop has no previous event
+    ASSERT_EQ(99, hart.pcs.at(0x100).count);
+    ASSERT_EQ(1000, hart.pcs.at(0x104).total);
+    ASSERT_DOUBLE_EQ(300.0 / (1400 - 1), hart.ipc());
+}
+
+TEST(LatencyTests, TimeGoingBackIsNoStall) {
+    // backward steps fall in the vector loop and in the scalar tail
+    const uint64_t times[] = {100, 102, 50, 53, 54, 10, 11, 12, 13, 14, 1, 5};
+    InMemoryTraceStore store;
+    uint64_t total = 0;
+    for (size_t i = 0; i < std::size(times); ++i) {
+        store.append(TraceEntry(times[i], 0x100, NOP));
+        total += i > 0 && times[i] > times[i - 1] ? times[i] - times[i - 1] : 0;
+    }
+    auto hart = analyze_latency(store);
+    ASSERT_EQ(total, hart.all.total);
+    ASSERT_EQ(4, hart.all.max);
+    ASSERT_EQ(0, hart.all.buckets[64]);
+    ASSERT_EQ(3, hart.all.buckets[0]);
+    ASSERT_EQ(0.0, hart.ipc());
+}
+
+TEST(LatencyTests, PagedMatchesInMemory) {
+    // deltas across chunk boundaries take the previous time from the chunk before
+    InMemoryTraceStore in_memory;
+    PagedTraceStoreConfig config;
+    config.chunk_events = 7;
+    PagedTraceStore paged(config);
+    fill(in_memory, 50);
+    fill(paged, 50);
+    paged.finish_loading();
+    auto expected = analyze_latency(in_memory);
+    auto actual = analyze_latency(paged);
+    ASSERT_EQ(expected.all.buckets, actual.all.buckets);
+    ASSERT_EQ(expected.all.total, actual.all.total);
+    for (const auto& [pc, site] : expected.pcs) {
+        ASSERT_EQ(site.total, actual.pcs.at(pc).total);
+    }
+}
+
+TEST(LatencyTests, Report) {
+    InMemoryTraceStore store;
+    fill(store, 2);
+    std::vector<HartLatency> harts = {analyze_latency(store)};
+    std::ostringstream out;
+    write_latency_report(out, harts, 2);
+    ASSERT_EQ(
+        "hart 0: 6 events over 27 time units, IPC 0.22, stall 22\n"
+        "  alu     1 events, mean 1.00, p99 <= 1, max 1, stall 0\n"
+        "  div     2 events, mean 10.00, p99 <= 10, max 10, stall 18\n"
+        "  load    2 events, mean 3.00, p99 <= 3, max 3, stall 4\n"
+        "  deltas: 1:1 2..3:2 8..15:2\n"
+        "worst stall pcs:\n"
+        "  0x104 stall 18, 2 events, mean 10.00, max 10\n"
+        "  0x108 stall 4, 2 events, mean 3.00, max 3\n", out.str());
+}
@@ -0,0 +1,39 @@
+#include "lazy_model.hpp"
+
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+TEST(LazyModelTests, LoadsOnceOnFirstUse) {
+    size_t loads = 0;
+    LazyModel model(std::make_unique<RISCV64Model>(), [&loads](RISCV64Model&) { ++loads; }, "trace_log_0");
+    ASSERT_FALSE(model.loaded());
+    ASSERT_EQ("trace_log_0 (waiting to load)", model.description());
+    ASSERT_EQ(0, model.event_count());
+    ASSERT_TRUE(model.loaded());
+    auto task = model.load_task();
+    task();
+    ASSERT_FALSE(model.step_forward());
+    ASSERT_EQ(1, loads);
+}
+
+TEST(LazyModelTests, LoadErrorOnEveryUse) {
+    LazyModel model(std::make_unique<RISCV64Model>(), [](RISCV64Model&) {
+        throw std::runtime_error("broken trace");
+    }, "trace_log_0");
+    model.load_task()();
+    ASSERT_EQ("trace_log_0 (failed: broken trace)", model.description());
+    ASSERT_THROW(model.event_count(), std::runtime_error);
+    ASSERT_THROW(model.read_pc(), std::runtime_error);
+}
+
+TEST(LazyModelTests, BackgroundTaskAfterDestruction) {
+    size_t loads = 0;
+    std::function<void()> task;
+    {
+        LazyModel model(std::make_unique<RISCV64Model>(), [&loads](RISCV64Model&) { ++loads; }, "trace_log_0");
+        task = model.load_task();
+    }
+    task();
+    ASSERT_EQ(0, loads);
+}
@@ -0,0 +1,79 @@
+#include "line_index.hpp"
+#include "test_traces.hpp"
+
+#include <map>
+
+#include <gtest/gtest.h>
+
+using namespace test_traces;
+
+namespace {
+    // line 2 calls f (lines 10, 11), line 3 is a loop, pc 0x114 has no line
+    const std::pair<uint64_t, uint32_t> events[] = {
+        {0x100, NOP}, {0x104, CALL}, {0x200, NOP}, {0x204, NOP}, {0x208, RET}, {0x108, NOP},
+        {0x10c, NOP}, {0x10c, NOP}, {0x10c, NOP}, {0x10c, NOP}, {0x10c, NOP},
+        {0x110, NOP}, {0x114, NOP}, {0x118, NOP}
+    };
+
+    const std::map<uint64_t, SourceLineSpec> lines = {
+        {0x100, SourceLineSpec("m.c", 1, 0)}, {0x104, SourceLineSpec("m.c", 2, 0)},
+        {0x108, SourceLineSpec("m.c", 2, 5)}, {0x10c, SourceLineSpec("m.c", 3, 0)},
+        {0x110, SourceLineSpec("m.c", 4, 0)}, {0x118, SourceLineSpec("m.c", 5, 0)},
+        {0x200, SourceLineSpec("f.c", 10, 0)}, {0x204, SourceLineSpec("f.c", 11, 0)},
+        {0x208, SourceLineSpec("f.c", 11, 3)}
+    };
+
+    class LineIndexTests : public testing::Test {
+    protected:
+        InMemoryTraceStore store;
+        CallStack calls;
+        LineIndex index;
+        void SetUp() override {
+            for (size_t i = 0; i < std::size(events); ++i) {
+                store.append(TraceEntry(i, events[i].first, events[i].second));
+            }
+            calls = CallStack::build(store);
+            index = LineIndex::build(store, [](uint64_t pc) -> const SourceLineSpec* {
+                auto it = lines.find(pc);
+                return it == lines.end() ? nullptr : &it->second;
+            });
+        }
+    };
+}
+
+TEST_F(LineIndexTests, Runs) {
+    // columns are ignored, so 0x204 and 0x208 share a run
+    ASSERT_EQ(9, index.run_count());
+    ASSERT_EQ(index.run_at(6), index.run_at(10));
+    ASSERT_EQ(6, index.run_first_event(index.run_at(8)));
+    ASSERT_EQ(11, index.run_end_event(index.run_at(8)));
+    ASSERT_EQ(LineIndex::NO_LINE, index.run_line(index.run_at(12)));
+    ASSERT_EQ(11, index.line(index.run_line(index.run_at(4))).line);
+}
+
+TEST_F(LineIndexTests, Next) {
+    ASSERT_EQ(1, next_line_event(index, calls, 0));
+    // the call and the rest of line 2 are stepped over
+    ASSERT_EQ(6, next_line_event(index, calls, 1));
+    ASSERT_EQ(11, next_line_event(index, calls, 7));
+    ASSERT_EQ(13, next_line_event(index, calls, 11));
+    ASSERT_FALSE(next_line_event(index, calls, 13).has_value());
+    // returning to the caller stops there
+    ASSERT_EQ(5, next_line_event(index, calls, 3));
+}
+
+TEST_F(LineIndexTests, StepLine) {
+    ASSERT_EQ(2, step_line_event(index, 1));
+    ASSERT_EQ(3, step_line_event(index, 2));
+    ASSERT_EQ(5, step_line_event(index, 3));
+    ASSERT_EQ(13, step_line_event(index, 11));
+}
+
+TEST_F(LineIndexTests, PrevLine) {
+    // back to the start of line 2, over the call made from it
+    ASSERT_EQ(1, prev_line_event(index, calls, 6));
+    ASSERT_EQ(0, prev_line_event(index, calls, 1));
+    ASSERT_FALSE(prev_line_event(index, calls, 0).has_value());
+    ASSERT_EQ(11, prev_line_event(index, calls, 13));
+    ASSERT_EQ(2, prev_line_event(index, calls, 4));
+}
@@ -0,0 +1,166 @@
+#include "lock_analysis.hpp"
+#include "test_traces.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace test_traces;
+
+namespace {
+    constexpr uint64_t LOCK = 0x8000;
+    constexpr uint64_t COUNTER = 0x9000;
+    constexpr uint8_t A0 = 10;
+    constexpr uint8_t A1 = 11;
+    constexpr uint8_t T0 = 5;
+    constexpr uint8_t T1 = 6;
+    constexpr uint8_t T2 = 7;
+
+    uint32_t amo(uint32_t funct5, uint32_t rd, uint32_t rs1, uint32_t rs2) {
+        return (funct5 << 27) | (rs2 << 20) | (rs1 << 15) | (0b010 << 12) | (rd << 7) | 0b0101111;
+    }
+
+    const uint32_t LR = amo(0b00010, T1, A0, 0);
+    const uint32_t SC = amo(0b00011, T2, A0, T0);
+    const uint32_t SWAP = amo(0b00001, T1, A0, T0);
+    const uint32_t ADD = amo(0b00000, T1, A1, T0);
+
+    TraceEntry entry(uint64_t time, uint32_t instr, uint8_t reg, uint64_t value) {
+        return TraceEntry(time, 0x100 + time * 4, instr, RegisterUpdateEvent({reg, RegType::INT}, value));
+    }
+
+    // a0 points to the lock, a1 to a counter, t0 holds 1
+    InMemoryTraceStore make_store(std::initializer_list<TraceEntry> entries) {
+        InMemoryTraceStore store;
+        store.append(entry(0, NOP, A0, LOCK));
+        store.append(entry(0, NOP, A1, COUNTER));
+        store.append(entry(0, NOP, T0, 1));
+        for (const auto& e : entries) {
+            store.append(e);
+        }
+        return store;
+    }
+
+    std::vector<LockStats> analyze(const std::vector<InMemoryTraceStore>& harts) {
+        std::vector<std::vector<LockEvent>> events;
+        std::set<uint64_t> addresses;
+        std::vector<std::vector<AtomicAccess>> atomics;
+        for (const auto& store : harts) {
+            atomics.push_back(collect_atomic_accesses(store));
+            for (const auto& access : atomics.back()) {
+                addresses.insert(access.address);
+            }
+        }
+        for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+            events.push_back(collect_lock_events(harts[hart_id], hart_id, atomics[hart_id], addresses));
+        }
+        return merge_lock_events(events);
+    }
+
+    // hart 0 holds the lock over [10, 50), hart 1 spins on it and takes it at 60
+    std::vector<InMemoryTraceStore> make_contended() {
+        std::vector<InMemoryTraceStore> harts;
+        harts.push_back(make_store({
+            entry(10, SWAP, T1, 0),
+            TraceEntry(50, 0x200, store_word(A0, 0))
+        }));
+        harts.push_back(make_store({
+            entry(20, SWAP, T1, 1),
+            entry(30, SWAP, T1, 1),
+            entry(40, SWAP, T1, 1),
+            entry(45, load_word(A1 + 1, A0), A1 + 1, 1),
+            entry(60, SWAP, T1, 0),
+            TraceEntry(70, 0x300, amo(0b00001, 0, A0, 0))
+        }));
+        return harts;
+    }
+}
+
+TEST(LockAnalysisTests, CollectAtomicAccesses) {
+    auto store = make_store({entry(10, SWAP, T1, 0), entry(20, ADD, T1, 3)});
+    auto atomics = collect_atomic_accesses(store);
+    ASSERT_EQ(2, atomics.size());
+    ASSERT_EQ(3, atomics[0].event_id);
+    ASSERT_EQ(LOCK, atomics[0].address);
+    ASSERT_EQ(RISCV64Decode::AtomicOperation::SWAP, atomics[0].operation);
+    ASSERT_EQ(1, atomics[0].stored);
+    ASSERT_EQ(0, atomics[0].loaded);
+    ASSERT_EQ(COUNTER, atomics[1].address);
+    ASSERT_EQ(3, atomics[1].loaded);
+}
+
+TEST(LockAnalysisTests, ContendedSwapLock) {
+    auto locks = analyze(make_contended());
+    ASSERT_EQ(1, locks.size());
+    const auto& lock = locks[0];
+    ASSERT_EQ(LOCK, lock.address);
+    ASSERT_EQ(0x100 + 10 * 4, lock.pc);
+    ASSERT_EQ(1, lock.contending_harts());
+    const auto total = lock.total();
+    ASSERT_EQ(2, total.acquires);
+    ASSERT_EQ(1, total.contended_acquires);
+    ASSERT_EQ(4, total.spins);
+    ASSERT_EQ(40, total.wait);
+    ASSERT_EQ(50, total.hold);
+    const auto& waiter = lock.harts.at(1);
+    ASSERT_EQ(40, waiter.max_wait);
+    ASSERT_EQ(10, waiter.hold);
+    ASSERT_EQ((std::map<size_t, uint64_t>{{0, 4}}), waiter.blocked_by);
+    ASSERT_TRUE(lock.harts.at(0).blocked_by.empty());
+}
+
+TEST(LockAnalysisTests, LrScRetries) {
+    std::vector<InMemoryTraceStore> harts;
+    harts.push_back(make_store({
+        entry(5, LR, T1, 1),
+        entry(6, LR, T1, 0),
+        entry(7, SC, T2, 1),
+        entry(8, LR, T1, 0),
+        entry(9, SC, T2, 0),
+        entry(12, ADD, T1, 0),
+        entry(13, ADD, T1, 1)
+    }));
+    // the counter has no acquires and is not a lock
+    auto locks = analyze(harts);
+    ASSERT_EQ(1, locks.size());
+    const auto total = locks[0].total();
+    ASSERT_EQ(LOCK, locks[0].address);
+    ASSERT_EQ(1, total.acquires);
+    ASSERT_EQ(1, total.contended_acquires);
+    ASSERT_EQ(2, total.spins);
+    ASSERT_EQ(4, total.wait);
+    ASSERT_EQ(0, total.updates);
+}
+
+TEST(LockAnalysisTests, CompressedSpinAndRelease) {
+    // c.lw a5, 0(a0) spins, c.sw a5, 0(a0) with a5 zero releases
+    constexpr uint32_t C_LW = 0x411c;
+    constexpr uint32_t C_SW = 0xc11c;
+    std::vector<InMemoryTraceStore> harts;
+    harts.push_back(make_store({
+        entry(10, SWAP, T1, 0),
+        TraceEntry(50, 0x200, C_SW)
+    }));
+    harts.push_back(make_store({
+        entry(20, C_LW, 15, 1),
+        entry(30, C_LW, 15, 1),
+        entry(60, SWAP, T1, 0)
+    }));
+    auto locks = analyze(harts);
+    ASSERT_EQ(1, locks.size());
+    const auto total = locks[0].total();
+    ASSERT_EQ(2, total.acquires);
+    ASSERT_EQ(1, total.contended_acquires);
+    ASSERT_EQ(2, total.spins);
+    ASSERT_EQ(40, total.wait);
+    ASSERT_EQ(40, locks[0].harts.at(0).hold);
+}
+
+TEST(LockAnalysisTests, Report) {
+    std::stringstream out;
+    write_lock_report(out, analyze(make_contended()), 10);
+    const auto report = out.str();
+    ASSERT_NE(std::string::npos, report.find("1 locks, 1 contended"));
+    ASSERT_NE(std::string::npos, report.find("lock 0x8000: 2 acquires (1 contended), 4 spins, wait 40 (max 40), hold 50"));
+    ASSERT_NE(std::string::npos, report.find("hart 1: 1 acquires (1 contended), 4 spins, wait 40 (max 40), hold 10, 4 spins on hart 0"));
+}
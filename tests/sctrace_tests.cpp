@@ -0,0 +1,77 @@
+#include "sctrace.h"
+#include "sctrace.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+    // sets x2 and x5, then stores x5 to 0(x2)
+    std::string make_trace_dir() {
+        namespace fs = std::filesystem;
+        fs::path dir = fs::temp_directory_path() / "sc-trace-library-tests";
+        fs::create_directories(dir);
+        std::ofstream(dir / "trace_log_0") <<
+            "1 0 N 1000 13 1004 x2=100\n"
+            "2 0 N 1004 13 1008 x5=abcd\n"
+            "3 0 N 1008 513023 100c\n";
+        return dir.string();
+    }
+
+    int count_events(const sctrace_columns* columns, void* user_data) {
+        *static_cast<size_t*>(user_data) += columns->size;
+        return 1;
+    }
+}
+
+TEST(LibraryTests, ColumnViews) {
+    auto session = sctrace::Session::open(make_trace_dir());
+    ASSERT_EQ(1, session.hart_count());
+    auto hart = session.hart(0);
+    ASSERT_EQ(3, hart.event_count());
+    auto columns = hart.columns();
+    ASSERT_TRUE(columns.has_value());
+    ASSERT_EQ(3, columns->size());
+    ASSERT_EQ(0x1008, columns->pc[2]);
+    ASSERT_EQ(sctrace::NO_REGISTER, columns->reg_index[2]);
+    ASSERT_EQ(0xabcd, columns->reg_value[1]);
+    size_t visited = 0;
+    hart.visit(1, 10, [&visited](const sctrace::EventColumns& block) {
+        visited += block.size();
+        return true;
+    });
+    ASSERT_EQ(2, visited);
+    ASSERT_EQ(5, hart.event(1).reg_index);
+    ASSERT_THROW(session.hart(1), std::runtime_error);
+}
+
+TEST(LibraryTests, PagedHasNoWholeView) {
+    sctrace::SessionOptions options;
+    options.memory_budget_mib = 1;
+    auto session = sctrace::Session::open(make_trace_dir(), options);
+    ASSERT_FALSE(session.hart(0).columns().has_value());
+    ASSERT_EQ(0x1004, session.hart(0).event(1).pc);
+}
+
+TEST(LibraryTests, MemoryAtEvent) {
+    auto session = sctrace::Session::open(make_trace_dir());
+    ASSERT_EQ(0, session.read_memory(0x100, 8, 0, 2));
+    ASSERT_EQ(0xabcd, session.read_memory(0x100, 8, 0, 3));
+    ASSERT_EQ(0xcd, session.read_memory_range(0x100, 2, 0, 3)[0]);
+}
+
+TEST(LibraryTests, CInterface) {
+    sctrace_session* session = sctrace_open(make_trace_dir().c_str(), nullptr);
+    ASSERT_NE(nullptr, session);
+    size_t events = 0;
+    ASSERT_EQ(0, sctrace_visit(session, 0, 0, 3, count_events, &events));
+    ASSERT_EQ(3, events);
+    uint64_t value = 0;
+    ASSERT_EQ(0, sctrace_read_memory(session, 0x100, 2, 0, 3, &value));
+    ASSERT_EQ(0xabcd, value);
+    ASSERT_EQ(-1, sctrace_event_count(session, 5, &events));
+    ASSERT_NE(std::string(), sctrace_last_error());
+    sctrace_close(session);
+}
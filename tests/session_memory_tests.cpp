@@ -0,0 +1,66 @@
+#include "session_memory.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    MemoryAccess store(uint64_t time, uint64_t event_id, uint32_t hart, uint64_t address, uint8_t size, uint64_t value) {
+        return MemoryAccess{time, event_id, address, value, hart, size, true};
+    }
+
+    MemoryAccess load(uint64_t time, uint64_t event_id, uint32_t hart, uint64_t address, uint8_t size, uint64_t value) {
+        return MemoryAccess{time, event_id, address, value, hart, size, false};
+    }
+}
+
+TEST(SessionMemoryTests, MergedByTime) {
+    std::vector<std::vector<MemoryAccess>> per_hart(2);
+    per_hart[0] = {store(10, 0, 0, 0x100, 8, 0x1111111111111111), store(30, 5, 0, 0x100, 4, 0x33333333)};
+    per_hart[1] = {store(20, 0, 1, 0x104, 4, 0x22222222)};
+    Memory memory = Memory::merge(per_hart);
+    ASSERT_EQ(3, memory.size());
+
+    // hart 1 before its own store, hart 0 store is visible by time
+    ASSERT_EQ(0x1111111111111111, memory.read(0x100, 8, {25, 1, 0}));
+    ASSERT_EQ(0x2222222211111111, memory.read(0x100, 8, {25, 1, 1}));
+    ASSERT_EQ(0x2222222211111111, memory.read(0x100, 8, {25, 0, 5}));
+    ASSERT_EQ(0x2222222233333333, memory.read(0x100, 8, {30, 0, 6}));
+    ASSERT_EQ(0x2222, memory.read(0x106, 2, {30, 0, 6}));
+    ASSERT_EQ(0, memory.read(0x100, 8, {5, 0, 0}));
+
+    auto writer = memory.last_store(0x104, {25, 0, 5});
+    ASSERT_TRUE(writer.has_value());
+    ASSERT_EQ(1, writer->hart_id);
+    ASSERT_EQ(20, writer->time);
+    ASSERT_EQ(0, memory.last_store(0x104, {15, 0, 1})->hart_id);
+    ASSERT_FALSE(memory.last_store(0x104, {5, 0, 0}).has_value());
+}
+
+TEST(SessionMemoryTests, LoadsAndUnalignedAccess) {
+    std::vector<std::vector<MemoryAccess>> per_hart(1);
+    per_hart[0] = {load(1, 0, 0, 0x200, 8, 0x0807060504030201), store(2, 1, 0, 0x206, 4, 0xddccbbaa)};
+    Memory memory = Memory::merge(per_hart);
+    ASSERT_EQ(0xbbaa060504030201, memory.read(0x200, 8, {2, 0, 2}));
+    ASSERT_EQ(0xddcc, memory.read(0x208, 2, {2, 0, 2}));
+    ASSERT_FALSE(memory.last_store(0x200, {2, 0, 2}).has_value());
+}
+
+TEST(SessionMemoryTests, RangeAndBatchMatchSingleReads) {
+    std::vector<std::vector<MemoryAccess>> per_hart(2);
+    for (uint64_t i = 0; i < 64; ++i) {
+        per_hart[i % 2].push_back(store(i, i / 2, i % 2, 0x1000 + i * 6, 1 << (i % 4), i * 0x0101010101010101));
+    }
+    Memory memory = Memory::merge(per_hart);
+    const MemoryPosition position{40, 1, 10};
+    auto bytes = memory.read_range(0xff8, 0x1a0, position);
+    ASSERT_EQ(0x1a0, bytes.size());
+    for (uint64_t address = 0xff8; address < 0xff8 + 0x1a0; ++address) {
+        ASSERT_EQ(memory.read(address, 1, position), bytes[address - 0xff8]);
+    }
+    std::vector<uint64_t> addresses = {0x1100, 0x1003, 0x1000, 0x5000, 0x1003, 0x10fa};
+    auto values = memory.read_batch(addresses, 8, position);
+    ASSERT_EQ(addresses.size(), values.size());
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        ASSERT_EQ(memory.read(addresses[i], 8, position), values[i]);
+    }
+    ASSERT_EQ(0, values[3]);
+}
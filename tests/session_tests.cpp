@@ -0,0 +1,156 @@
+#include "session.hpp"
+#include "csr_index.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+    // hart 0 runs one event per time unit, hart 1 one event every three units
+    std::string make_session_dir() {
+        namespace fs = std::filesystem;
+        fs::path dir = fs::temp_directory_path() / "sc-trace-session-tests";
+        fs::create_directories(dir);
+        std::ofstream hart0(dir / "trace_log_0");
+        for (size_t i = 0; i < 30; ++i) {
+            hart0 << i << " 0 N " << std::hex << 0x1000 + i * 4 << " 0 " << 0x1004 + i * 4 << std::dec << '\n';
+        }
+        std::ofstream hart1(dir / "trace_log_1");
+        for (size_t i = 0; i < 10; ++i) {
+            hart1 << i * 3 << " 0 N " << std::hex << 0x2000 + i * 4 << " 0 " << 0x2004 + i * 4 << " x5=" << i << std::dec << '\n';
+        }
+        std::ofstream hart1_csrs(dir / "trace_log_csr_1");
+        hart1_csrs << "0 mstatus=0\n6 mstatus=1800 mepc=0x2008\n";
+        return dir.string();
+    }
+}
+
+TEST(SessionTests, SeekTime) {
+    DebugSession session = DebugSessionFactory().create_session(make_session_dir());
+    session.seek_time(13);
+    const auto& harts = session.get_harts();
+    ASSERT_EQ(13, harts[0]->cur_time());
+    ASSERT_EQ(12, harts[1]->cur_time());
+    ASSERT_EQ(3, harts[1]->read_register(5));
+    session.seek_time(0);
+    ASSERT_EQ(0, harts[0]->cur_time());
+    ASSERT_EQ(0, harts[1]->read_register(5));
+}
+
+TEST(SessionTests, BreakPointHitsCountForwardOnly) {
+    DebugSession session = DebugSessionFactory().create_session(make_session_dir());
+    session.add_break_point(0x1014);
+    ASSERT_EQ(0, session.run());
+    ASSERT_FALSE(session.run());
+    ASSERT_EQ(0, session.run_back());
+    ASSERT_EQ(0x1014, session->read_pc());
+    ASSERT_EQ(1, session.get_break_points().at(0x1014).hits);
+    ASSERT_FALSE(session.run());
+    ASSERT_EQ(0, session.run_to(0));
+    ASSERT_EQ(1, session.get_break_points().at(0x1014).hits);
+}
+
+TEST(SessionTests, CsrTrace) {
+    DebugSession session = DebugSessionFactory().create_session(make_session_dir());
+    const auto& harts = session.get_harts();
+    ASSERT_THROW(harts[0]->read_register("mstatus"), NoSuchRegisterException);
+    ASSERT_THROW(harts[1]->read_register("mstatus"), UnknownCsrValueException);
+    harts[1]->seek_event(2);
+    ASSERT_EQ(0, harts[1]->read_register("mstatus"));
+    harts[1]->seek_event(3);
+    ASSERT_EQ(0x1800, harts[1]->read_register("mstatus"));
+    ASSERT_EQ(0x2008, harts[1]->read_register("mepc"));
+    ASSERT_EQ(34, harts[1]->get_all_regs().size());
+}
+
+TEST(SessionTests, SyncToActiveHart) {
+    DebugSession session = DebugSessionFactory().create_session(make_session_dir());
+    for (size_t i = 0; i < 20; ++i) {
+        session->step_forward();
+    }
+    session.sync();
+    const auto& harts = session.get_harts();
+    ASSERT_EQ(20, harts[0]->cur_time());
+    ASSERT_EQ(18, harts[1]->cur_time());
+
+    session.set_auto_sync(true);
+    session.set_active_hart(1);
+    session->step_back();
+    session->step_back();
+    session.set_active_hart(0);
+    ASSERT_EQ(12, harts[0]->cur_time());
+}
+
+TEST(SessionTests, FindEvents) {
+    DebugSession session = DebugSessionFactory().create_session(make_session_dir());
+    session.set_active_hart(1);
+    auto found = session.find_events(TraceQuery::parse("t0 >= 7"));
+    ASSERT_EQ((std::vector<size_t>{7, 8, 9}), found);
+    ASSERT_EQ(3, session.count_events(TraceQuery::parse("pc 0x2004..0x2010")));
+    session->set_state_pc(0x2010);
+    ASSERT_EQ(4, session->cur_event());
+    ASSERT_THROW(session->set_state_pc(0x1000), NoSuchPcException);
+    ASSERT_EQ(4, session->cur_event());
+}
+
+TEST(SessionTests, FinishSelectedFrame) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "sc-trace-session-calls";
+    fs::create_directories(dir);
+    {
+        // main calls f at 0x104, f calls g at 0x204
+        std::ofstream trace(dir / "trace_log_0");
+        const char* lines[] = {
+            "0 0 N 100 13 104", "1 0 N 104 008000ef 200 x1=108", "2 0 N 200 13 204",
+            "3 0 N 204 008000ef 300 x1=208", "4 0 N 300 13 304", "5 0 N 304 00008067 208",
+            "6 0 N 208 00008067 108", "7 0 N 108 13 10c"
+        };
+        for (const char* line : lines) {
+            trace << line << '\n';
+        }
+    }
+    DebugSession session = DebugSessionFactory().create_session(dir.string());
+    session->seek_event(5);
+    ASSERT_EQ(0x300, session->read_pc());
+    ASSERT_EQ(3, session.backtrace().size());
+    session.select_frame(1);
+    ASSERT_EQ(1, session.get_selected_frame());
+    ASSERT_FALSE(session.finish().has_value());
+    ASSERT_EQ(0x108, session->read_pc());
+    ASSERT_EQ(0, session.get_selected_frame());
+    ASSERT_THROW(session.finish(), NoReturnException);
+}
+
+TEST(SessionTests, FollowAppendedLines) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "sc-trace-session-follow-tests";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    // call at event 1, the last line is still being written
+    std::ofstream(dir / "trace_log_0") <<
+        "0 0 N 1000 13 1004\n"
+        "1 0 N 1004 8000ef 2000 x1=1008\n"
+        "2 0 N 2000 13 20";
+    TraceLoadConfig load_config;
+    load_config.follow = true;
+    DebugSession session = DebugSessionFactory(TraceStorageConfig(), load_config).create_session(dir.string());
+    ASSERT_TRUE(session.following());
+    ASSERT_EQ(2, session->event_count());
+    ASSERT_FALSE(session.update_traces());
+    // returns at event 3 and writes x1 again at event 4
+    std::ofstream(dir / "trace_log_0", std::ios::app) <<
+        "04\n"
+        "3 0 N 2004 8067 1008\n"
+        "4 0 N 1008 13 100c x1=5\n";
+    ASSERT_TRUE(session.update_traces());
+    ASSERT_EQ(5, session->event_count());
+    // the writer has closed the trace, so run stops at its end instead of waiting
+    ASSERT_FALSE(session.run().has_value());
+    ASSERT_EQ(5, session->read_register(1));
+    session->step_back();
+    ASSERT_EQ(0x1008, session->read_register(1));
+    ASSERT_EQ(4, session->call_stack().frame(1).return_event);
+    fs::remove_all(dir);
+}
@@ -0,0 +1,53 @@
+#include "RISCV64_model.hpp"
+#include "stats.hpp"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+namespace {
+    class RISCV64ModelDUT : public RISCV64Model {
+    public:
+        void init_dut(std::istream& trace_input, const std::string& filename) {
+            init(trace_input, filename);
+        }
+    };
+
+    const char* trace_text =
+        "0 0 C 0000000002000000 00000297 0000000002000004 x5=0000000002000000\n"
+        "1 0 C 0000000002000004 02028293 0000000002000008 x5=0000000002000020\n"
+        "2 0 C 0000000002000008 00000013 000000000200000c x=1\n";
+}
+
+TEST(StatsTests, DisabledCollectsNothing) {
+    stats::reset();
+    stats::set_enabled(false);
+    std::stringstream trace(trace_text);
+    RISCV64ModelDUT model;
+    model.init_dut(trace, "trace");
+    auto values = stats::snapshot();
+    ASSERT_TRUE(values.timers.empty());
+    ASSERT_TRUE(values.counters.empty());
+}
+
+TEST(StatsTests, LoadCounters) {
+    stats::reset();
+    stats::set_enabled(true);
+    std::stringstream trace(trace_text);
+    RISCV64ModelDUT model;
+    model.init_dut(trace, "trace");
+    stats::set_enabled(false);
+    auto values = stats::snapshot();
+    ASSERT_EQ(3, values.counters["load.lines"]);
+    ASSERT_EQ(1, values.counters["load.bad_lines"]);
+    ASSERT_EQ(2, values.counters["load.events"]);
+    ASSERT_EQ(2, model.event_count());
+    ASSERT_TRUE(values.timers.contains("load.parse"));
+    std::stringstream json;
+    stats::write_json(json, values);
+    ASSERT_NE(std::string::npos, json.str().find("\"load.events\": 2"));
+    values.counters["tab\tname"] = 1;
+    json.str("");
+    stats::write_json(json, values);
+    ASSERT_NE(std::string::npos, json.str().find("\"tab\\u0009name\": 1"));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "trace_store.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+// instructions and traces shared by the analysis tests
+namespace test_traces {
+    constexpr uint32_t NOP = 0x00000013;
+    // ld a0, 0(a1)
+    constexpr uint32_t LD = 0x0005b503;
+    // sd a0, 0(a1)
+    constexpr uint32_t SD = 0x00a5b023;
+    // div a0, a1, a2
+    constexpr uint32_t DIV = 0x02c5c533;
+    // jal ra, +8
+    constexpr uint32_t CALL = 0x008000ef;
+    // jalr x0, 0(ra)
+    constexpr uint32_t RET = 0x00008067;
+
+    inline uint32_t load_word(uint32_t rd, uint32_t rs1, uint32_t offset = 0) {
+        return (offset << 20) | (rs1 << 15) | (0b010 << 12) | (rd << 7) | 0b0000011;
+    }
+
+    inline uint32_t store(uint32_t funct3, uint32_t rs1, uint32_t rs2, uint32_t offset) {
+        return ((offset >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((offset & 0x1f) << 7) | 0b0100011;
+    }
+
+    inline uint32_t store_word(uint32_t rs1, uint32_t rs2, uint32_t offset = 0) {
+        return store(0b010, rs1, rs2, offset);
+    }
+
+    inline uint32_t store_dword(uint32_t rs1, uint32_t rs2, uint32_t offset = 0) {
+        return store(0b011, rs1, rs2, offset);
+    }
+
+    // main: 0x100, f: 0x200, g: 0x300, time is time_step times the event number
+    //  0 0x100 nop     1 0x104 call f   2 0x200 nop     3 0x204 call g   4 0x300 nop
+    //  5 0x304 ret     6 0x208 ret      7 0x108 call g  8 0x300 ret      9 0x10c ret
+    // 10 0x500 nop
+    inline InMemoryTraceStore make_call_store(uint64_t time_step = 1) {
+        const std::pair<uint64_t, uint32_t> events[] = {
+            {0x100, NOP}, {0x104, CALL}, {0x200, NOP}, {0x204, CALL}, {0x300, NOP},
+            {0x304, RET}, {0x208, RET}, {0x108, CALL}, {0x300, RET}, {0x10c, RET}, {0x500, NOP}
+        };
+        InMemoryTraceStore store;
+        for (size_t i = 0; i < std::size(events); ++i) {
+            store.append(TraceEntry(i * time_step, events[i].first, events[i].second));
+        }
+        return store;
+    }
+}
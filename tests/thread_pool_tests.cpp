@@ -0,0 +1,60 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+TEST(ThreadPoolTests, RunsAllTasks) {
+    std::atomic<size_t> counter = 0;
+    ThreadPool pool(4);
+    for (size_t i = 0; i < 1000; ++i) {
+        pool.submit([&counter] { counter.fetch_add(1); });
+    }
+    pool.wait_idle();
+    ASSERT_EQ(1000, counter.load());
+}
+
+TEST(ThreadPoolTests, NestedSubmit) {
+    std::atomic<size_t> counter = 0;
+    ThreadPool pool(3);
+    for (size_t i = 0; i < 10; ++i) {
+        pool.submit([&pool, &counter] {
+            for (size_t j = 0; j < 10; ++j) {
+                pool.submit([&counter] { counter.fetch_add(1); });
+            }
+        });
+    }
+    pool.wait_idle();
+    ASSERT_EQ(100, counter.load());
+}
+
+TEST(ThreadPoolTests, WaitOnEmptyPool) {
+    ThreadPool pool(2);
+    pool.wait_idle();
+    SUCCEED();
+}
+
+TEST(ThreadPoolTests, ParallelFor) {
+    std::vector<size_t> values(1000, 0);
+    ThreadPool pool(4);
+    pool.parallel_for(values.size(), [&values](size_t i) { values[i] = i * 2; });
+    for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_EQ(i * 2, values[i]);
+    }
+    ASSERT_THROW(pool.parallel_for(10, [](size_t i) {
+        if (i == 7) {
+            throw std::runtime_error("failed");
+        }
+    }), std::runtime_error);
+}
+
+TEST(ThreadPoolTests, NestedParallelFor) {
+    std::atomic<size_t> counter = 0;
+    ThreadPool pool(2);
+    pool.parallel_for(8, [&pool, &counter](size_t) {
+        pool.parallel_for(8, [&counter](size_t) { counter.fetch_add(1); });
+    });
+    ASSERT_EQ(64, counter.load());
+}
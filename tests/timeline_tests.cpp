@@ -0,0 +1,67 @@
+#include "timeline.hpp"
+#include "test_traces.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace test_traces;
+
+namespace {
+    const std::vector<FunctionInfo> functions = {
+        {"g", 0x300, 0x400}, {"main", 0x100, 0x200}, {"f", 0x200, 0x300}
+    };
+
+    std::string slice(const std::string& name, uint64_t begin, uint64_t end) {
+        return "{\"name\":\"" + name + "\",\"ph\":\"X\",\"pid\":0,\"tid\":3,\"ts\":" + std::to_string(begin) +
+            ",\"dur\":" + std::to_string(end - begin) + "}";
+    }
+}
+
+TEST(TimelineTests, SlicesInReturnOrder) {
+    auto store = make_call_store(10);
+    CallStack stack = CallStack::build(store);
+    std::ostringstream out;
+    ChromeTraceWriter writer(out);
+    ASSERT_EQ(5, write_timeline(writer, 3, store, stack, FunctionNames(functions)));
+    writer.finish();
+    // the frame left by the last ret is outside of every function and open until the end
+    std::string expected = "{\"traceEvents\":[\n" +
+        slice("g", 40, 60) + ",\n" +
+        slice("f", 20, 70) + ",\n" +
+        slice("g", 80, 90) + ",\n" +
+        slice("main", 0, 100) + ",\n" +
+        slice("0x500", 100, 100) + "\n]}\n";
+    ASSERT_EQ(expected, out.str());
+}
+
+TEST(TimelineTests, SmallBufferWritesSameDocument) {
+    auto store = make_call_store(10);
+    CallStack stack = CallStack::build(store);
+    std::ostringstream full;
+    std::ostringstream chunked;
+    ChromeTraceWriter full_writer(full);
+    ChromeTraceWriter chunked_writer(chunked, 7);
+    for (auto* writer : {&full_writer, &chunked_writer}) {
+        writer->thread_name(3, "hart \"3\"");
+        write_timeline(*writer, 3, store, stack, FunctionNames(functions));
+        writer->finish();
+    }
+    ASSERT_EQ(full.str(), chunked.str());
+    ASSERT_NE(std::string::npos, full.str().find("\"args\":{\"name\":\"hart \\\"3\\\"\"}"));
+    ASSERT_EQ(6, chunked_writer.event_count());
+}
+
+TEST(TimelineTests, EmptyTrace) {
+    InMemoryTraceStore store;
+    CallStack stack = CallStack::build(store);
+    std::ostringstream out;
+    ChromeTraceWriter writer(out);
+    ASSERT_EQ(0, write_timeline(writer, 0, store, stack, FunctionNames()));
+    writer.finish();
+    ASSERT_EQ("{\"traceEvents\":[\n]}\n", out.str());
+}
+
+TEST(TimelineTests, JsonEscape) {
+    ASSERT_EQ("a\\\"b\\\\c\\u000a", json_escape("a\"b\\c\n"));
+}
@@ -0,0 +1,93 @@
+#include "trace_diff.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    TraceEntry make_entry(size_t i) {
+        TraceEntry entry(i * 10, 0x1000 + i * 4, i);
+        if (i % 3 == 0) {
+            entry.changed_reg = RegisterUpdateEvent({i % 32, RegType::INT}, i * 7, i * 5);
+        }
+        return entry;
+    }
+
+    template <typename Store>
+    void fill(Store& store, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            store.append(make_entry(i));
+        }
+        store.finish_loading();
+    }
+}
+
+TEST(TraceDiffTests, IdenticalTraces) {
+    InMemoryTraceStore golden;
+    InMemoryTraceStore failing;
+    fill(golden, 1000);
+    fill(failing, 1000);
+    ASSERT_FALSE(find_first_divergence(golden, failing, 16).has_value());
+}
+
+TEST(TraceDiffTests, FindsExactEvent) {
+    for (size_t diverged : {0, 15, 16, 517, 999}) {
+        InMemoryTraceStore golden;
+        InMemoryTraceStore failing;
+        fill(golden, 1000);
+        for (size_t i = 0; i < 1000; ++i) {
+            auto entry = make_entry(i);
+            if (i >= diverged) {
+                entry.pc += 4;
+            }
+            failing.append(entry);
+        }
+        auto res = find_first_divergence(golden, failing, 16);
+        ASSERT_TRUE(res.has_value());
+        ASSERT_EQ(diverged, res.value());
+    }
+}
+
+TEST(TraceDiffTests, RegisterValueAndTimeOnly) {
+    InMemoryTraceStore golden;
+    InMemoryTraceStore failing;
+    fill(golden, 300);
+    for (size_t i = 0; i < 300; ++i) {
+        auto entry = make_entry(i);
+        entry.time += 1;
+        if (i == 201) {
+            entry.changed_reg = RegisterUpdateEvent({1, RegType::INT}, 0, 0);
+        }
+        failing.append(entry);
+    }
+    auto res = find_first_divergence(golden, failing, 16);
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(201, res.value());
+}
+
+TEST(TraceDiffTests, PrefixReturnsCommonLength) {
+    InMemoryTraceStore golden;
+    InMemoryTraceStore failing;
+    fill(golden, 1000);
+    fill(failing, 700);
+    ASSERT_EQ(700, find_first_divergence(golden, failing, 16).value());
+    ASSERT_EQ(700, find_first_divergence(failing, golden, 16).value());
+}
+
+TEST(TraceDiffTests, PagedAgainstInMemory) {
+    PagedTraceStoreConfig config;
+    config.chunk_events = 64;
+    config.memory_budget = 4 * 64 * TraceColumns::EVENT_BYTES;
+    PagedTraceStore golden(config);
+    fill(golden, 5000);
+    InMemoryTraceStore failing;
+    fill(failing, 5000);
+    ASSERT_FALSE(find_first_divergence(golden, failing, 100).has_value());
+    InMemoryTraceStore changed;
+    for (size_t i = 0; i < 5000; ++i) {
+        auto entry = make_entry(i);
+        if (i == 4321) {
+            entry.instr ^= 1;
+        }
+        changed.append(entry);
+    }
+    ASSERT_EQ(4321, find_first_divergence(golden, changed, 100).value());
+}
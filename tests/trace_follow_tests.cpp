@@ -0,0 +1,109 @@
+#include "trace_follow.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+    std::string temp_path(const std::string& name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    TraceFollower::Sink collect(std::vector<std::string>& lines) {
+        return [&lines](std::istream& input) {
+            for (std::string line; std::getline(input, line);) {
+                lines.push_back(line);
+            }
+        };
+    }
+}
+
+TEST(TraceFollowTests, CompleteLinesOnly) {
+    std::string path = temp_path("sc_trace_follow_lines");
+    std::ofstream(path) << "loaded\n";
+    std::vector<std::string> lines;
+    TraceFollower follower;
+    follower.add(path, 7, collect(lines));
+    ASSERT_EQ(0, follower.update());
+    {
+        std::ofstream writer(path, std::ios::app);
+        writer << "first\nsec" << std::flush;
+        ASSERT_EQ(1, follower.update());
+        ASSERT_EQ(std::vector<std::string>{"first"}, lines);
+        writer << "ond\n" << std::flush;
+    }
+    ASSERT_EQ(1, follower.update());
+    ASSERT_EQ((std::vector<std::string>{"first", "second"}), lines);
+    std::remove(path.c_str());
+}
+
+TEST(TraceFollowTests, FinishedWhenWriterCloses) {
+    std::string path = temp_path("sc_trace_follow_finished");
+    std::ofstream(path) << "";
+    std::vector<std::string> lines;
+    TraceFollower follower;
+    follower.add(path, 0, collect(lines));
+    std::ofstream(path, std::ios::app) << "last\n";
+    ASSERT_EQ(TraceFollower::WaitResult::MODIFIED, follower.wait());
+    ASSERT_EQ(1, follower.update());
+    ASSERT_EQ(TraceFollower::WaitResult::FINISHED, follower.wait());
+    ASSERT_EQ(std::vector<std::string>{"last"}, lines);
+    std::remove(path.c_str());
+}
+
+TEST(TraceFollowTests, FinishedWhenAlreadyComplete) {
+    std::string path = temp_path("sc_trace_follow_complete");
+    std::ofstream(path) << "only\n";
+    std::vector<std::string> lines;
+    TraceFollower follower;
+    follower.add(path, 5, collect(lines));
+    ASSERT_EQ(TraceFollower::WaitResult::MODIFIED, follower.wait());
+    ASSERT_EQ(0, follower.update());
+    ASSERT_EQ(TraceFollower::WaitResult::FINISHED, follower.wait());
+    // a later writer is still followed
+    std::ofstream(path, std::ios::app) << "more\n";
+    ASSERT_EQ(TraceFollower::WaitResult::MODIFIED, follower.wait());
+    ASSERT_EQ(1, follower.update());
+    ASSERT_EQ(std::vector<std::string>{"more"}, lines);
+    std::remove(path.c_str());
+}
+
+TEST(TraceFollowTests, TruncatedFile) {
+    std::string path = temp_path("sc_trace_follow_truncated");
+    std::ofstream(path) << "one\ntwo\n";
+    std::vector<std::string> lines;
+    TraceFollower follower;
+    follower.add(path, 8, collect(lines));
+    std::ofstream(path) << "x\n";
+    ASSERT_THROW(follower.update(), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(TraceFollowTests, WaitsForSilentWriter) {
+    std::string path = temp_path("sc_trace_follow_silent");
+    std::ofstream(path) << "first\n";
+    std::vector<std::string> lines;
+    TraceFollower follower;
+    // the writer keeps the file open without writing anything after the follower starts
+    std::ofstream writer(path, std::ios::app);
+    follower.add(path, 6, collect(lines));
+    ASSERT_EQ(TraceFollower::WaitResult::MODIFIED, follower.wait());
+    ASSERT_EQ(0, follower.update());
+    std::thread late_writer([&writer] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        writer << "second\n" << std::flush;
+        writer.close();
+    });
+    ASSERT_EQ(TraceFollower::WaitResult::MODIFIED, follower.wait());
+    late_writer.join();
+    ASSERT_EQ(1, follower.update());
+    ASSERT_EQ(std::vector<std::string>{"second"}, lines);
+    ASSERT_EQ(TraceFollower::WaitResult::FINISHED, follower.wait());
+    std::remove(path.c_str());
+}
@@ -0,0 +1,89 @@
+#include "trace_input.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+#ifdef SC_TRACE_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <gtest/gtest.h>
+
+namespace {
+    std::string make_trace_text(size_t lines) {
+        std::string res;
+        for (size_t i = 0; i < lines; ++i) {
+            res += std::to_string(i) + " 2 N " + std::to_string(i * 4) + " 0 " + std::to_string(i * 4 + 4) + "\n";
+        }
+        return res;
+    }
+
+    std::string temp_path(const std::string& name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    std::string read_all(const std::string& path) {
+        auto input = open_trace_input(path);
+        std::string res;
+        for (std::string line; std::getline(*input, line);) {
+            res += line + "\n";
+        }
+        return res;
+    }
+
+    void write_gzip(const std::string& path, const std::vector<std::string>& members) {
+        std::remove(path.c_str());
+        for (const auto& member : members) {
+            gzFile file = gzopen(path.c_str(), "ab");
+            gzwrite(file, member.data(), member.size());
+            gzclose(file);
+        }
+    }
+}
+
+TEST(TraceInputTests, PlainFile) {
+    std::string path = temp_path("sc_trace_input_plain");
+    std::string text = make_trace_text(100);
+    std::ofstream(path) << text;
+    ASSERT_EQ(text, read_all(path));
+    std::remove(path.c_str());
+}
+
+TEST(TraceInputTests, GzipMultiMember) {
+    std::string path = temp_path("sc_trace_input_gzip");
+    std::string first = make_trace_text(100000);
+    std::string second = make_trace_text(10);
+    write_gzip(path, {first, second});
+    ASSERT_EQ(first + second, read_all(path));
+    std::remove(path.c_str());
+}
+
+TEST(TraceInputTests, TruncatedGzipThrows) {
+    std::string path = temp_path("sc_trace_input_truncated");
+    write_gzip(path, {make_trace_text(100000)});
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+    ASSERT_THROW(read_all(path), TraceInputException);
+    std::remove(path.c_str());
+}
+
+#ifdef SC_TRACE_WITH_ZSTD
+TEST(TraceInputTests, ZstdMultiFrame) {
+    std::string path = temp_path("sc_trace_input_zstd");
+    std::string expected;
+    std::ofstream out(path, std::ios::binary);
+    for (size_t frame = 0; frame < 7; ++frame) {
+        std::string text = make_trace_text(10000 + frame);
+        expected += text;
+        std::string compressed(ZSTD_compressBound(text.size()), '\0');
+        size_t size = ZSTD_compress(compressed.data(), compressed.size(), text.data(), text.size(), 1);
+        out.write(compressed.data(), size);
+    }
+    out.close();
+    ASSERT_EQ(expected, read_all(path));
+    std::remove(path.c_str());
+}
+#endif
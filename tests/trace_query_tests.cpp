@@ -0,0 +1,110 @@
+#include "trace_query.hpp"
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+namespace {
+    constexpr uint32_t LOAD_INSTR = 0x00053583;
+    constexpr uint32_t STORE_INSTR = 0x00b53023;
+
+    TraceEntry make_entry(size_t i, std::mt19937_64& random) {
+        const uint32_t instrs[] = {0x13, LOAD_INSTR, STORE_INSTR, 0x00a50533};
+        TraceEntry entry(i * 2, 0x1000 + (random() % 256) * 4, instrs[random() % 4]);
+        if (random() % 2 == 0) {
+            entry.changed_reg = RegisterUpdateEvent({random() % 32, random() % 8 == 0 ? RegType::FLOAT : RegType::INT},
+                random() % 0x2000);
+        }
+        return entry;
+    }
+
+    template <typename Store>
+    void fill(Store& store, size_t count) {
+        std::mt19937_64 random(7);
+        for (size_t i = 0; i < count; ++i) {
+            store.append(make_entry(i, random));
+        }
+        store.finish_loading();
+    }
+
+    std::vector<size_t> reference_find(const ITraceStore& store, const TraceQuery& query) {
+        std::vector<size_t> res;
+        for (size_t i = 0; i < store.size(); ++i) {
+            if (query.matches(store.get(i))) {
+                res.push_back(i);
+            }
+        }
+        return res;
+    }
+
+    const char* queries[] = {
+        "pc 0x1100..0x1200",
+        "store",
+        "load a0",
+        "x10 > 0x1000",
+        "a1 <= 7 pc 0x1000..0x1400",
+        "time 1000..50000 instr 0x13",
+        "instr 0x3/0x7f x11",
+        "pc 0x13fc time 0..0xffffffffffffffff"
+    };
+}
+
+TEST(TraceQueryTests, Parse) {
+    auto query = TraceQuery::parse("store pc 0x100..0x200 sp > 0x1000 addr 4096");
+    ASSERT_EQ(0x7f, query.instr_mask);
+    ASSERT_EQ(0x23, query.instr_value);
+    ASSERT_EQ(0x100, query.pc->first);
+    ASSERT_EQ(0x1ff, query.pc->last);
+    ASSERT_EQ(2, query.reg_index.value());
+    ASSERT_EQ(0x1001, query.reg_value->first);
+    ASSERT_EQ(4096, query.address->first);
+    ASSERT_EQ(4096, query.address->last);
+    ASSERT_FALSE(query.time.has_value());
+
+    ASSERT_THROW(TraceQuery::parse("pc"), TraceQueryException);
+    ASSERT_THROW(TraceQuery::parse("pc 0x200..0x100"), TraceQueryException);
+    ASSERT_THROW(TraceQuery::parse("load store"), TraceQueryException);
+    ASSERT_THROW(TraceQuery::parse("x1 x2"), TraceQueryException);
+    ASSERT_THROW(TraceQuery::parse("a0 < 0"), TraceQueryException);
+    ASSERT_THROW(TraceQuery::parse("foo"), TraceQueryException);
+}
+
+TEST(TraceQueryTests, MatchesScalarReference) {
+    InMemoryTraceStore store;
+    // crosses several scan tasks and ends inside a word
+    fill(store, 200037);
+    for (const char* text : queries) {
+        auto query = TraceQuery::parse(text);
+        auto expected = reference_find(store, query);
+        ASSERT_EQ(expected, find_events(store, query)) << text;
+        ASSERT_EQ(expected.size(), count_events(store, query)) << text;
+    }
+}
+
+TEST(TraceQueryTests, PagedStore) {
+    PagedTraceStoreConfig config;
+    config.chunk_events = 1000;
+    config.memory_budget = 4 * 1000 * TraceColumns::EVENT_BYTES;
+    PagedTraceStore paged(config);
+    fill(paged, 70001);
+    InMemoryTraceStore in_memory;
+    fill(in_memory, 70001);
+    for (const char* text : queries) {
+        auto query = TraceQuery::parse(text);
+        ASSERT_EQ(find_events(in_memory, query), find_events(paged, query)) << text;
+        ASSERT_EQ(count_events(in_memory, query), count_events(paged, query)) << text;
+    }
+}
+
+TEST(TraceQueryTests, FirstEventAndLimit) {
+    InMemoryTraceStore store;
+    fill(store, 150000);
+    auto query = TraceQuery::parse("store");
+    auto all = find_events(store, query);
+    ASSERT_GT(all.size(), 10);
+    auto limited = find_events(store, query, all[3], 5);
+    ASSERT_EQ(std::vector<size_t>(all.begin() + 3, all.begin() + 8), limited);
+    auto last = find_events(store, query, all.back(), 5);
+    ASSERT_EQ(std::vector<size_t>{all.back()}, last);
+    ASSERT_TRUE(find_events(store, query, store.size()).empty());
+}
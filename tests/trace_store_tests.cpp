@@ -0,0 +1,127 @@
+#include "RISCV64_model.hpp"
+#include "trace_store.hpp"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+namespace {
+    TraceEntry make_entry(size_t i) {
+        TraceEntry entry(i * 10, 0x1000 + i * 4, i);
+        if (i % 3 == 0) {
+            entry.changed_reg = RegisterUpdateEvent({i % 32, RegType::INT}, i * 7, i * 5);
+        }
+        return entry;
+    }
+
+    void check_entry(const TraceEntry& entry, size_t i) {
+        auto ref = make_entry(i);
+        ASSERT_EQ(ref.time, entry.time);
+        ASSERT_EQ(ref.pc, entry.pc);
+        ASSERT_EQ(ref.instr, entry.instr);
+        ASSERT_EQ(ref.changed_reg.has_value(), entry.changed_reg.has_value());
+        if (ref.changed_reg) {
+            ASSERT_EQ(ref.changed_reg->reg, entry.changed_reg->reg);
+            ASSERT_EQ(ref.changed_reg->val, entry.changed_reg->val);
+            ASSERT_EQ(ref.changed_reg->prev, entry.changed_reg->prev);
+        }
+    }
+
+    PagedTraceStoreConfig small_config() {
+        PagedTraceStoreConfig config;
+        config.chunk_events = 16;
+        config.memory_budget = 3 * 16 * TraceColumns::EVENT_BYTES;
+        return config;
+    }
+
+    class RISCV64ModelDUT : public RISCV64Model {
+    public:
+        using RISCV64Model::RISCV64Model;
+        void init_dut(std::istream& trace_input, const std::string& filename) {
+            init(trace_input, filename);
+        }
+    };
+}
+
+TEST(PagedStoreTests, SequentialAndRandomAccess) {
+    PagedTraceStore store(small_config());
+    constexpr size_t count = 1000;
+    for (size_t i = 0; i < count; ++i) {
+        store.append(make_entry(i));
+    }
+    store.finish_loading();
+    ASSERT_EQ(count, store.size());
+    for (size_t i = 0; i < count; ++i) {
+        check_entry(store.get(i), i);
+    }
+    for (size_t i = count; i > 0; --i) {
+        check_entry(store.get(i - 1), i - 1);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        size_t id = (i * 7919) % count;
+        check_entry(store.get(id), id);
+    }
+    ASSERT_LE(store.resident_bytes(), 3 * 16 * TraceColumns::EVENT_BYTES);
+}
+
+TEST(PagedStoreTests, ReadBeforeFinish) {
+    PagedTraceStore store(small_config());
+    for (size_t i = 0; i < 20; ++i) {
+        store.append(make_entry(i));
+    }
+    check_entry(store.get(3), 3);
+    check_entry(store.get(18), 18);
+}
+
+TEST(PagedStoreTests, ModelMatchesInMemory) {
+    std::stringstream trace;
+    for (size_t i = 0; i < 200; ++i) {
+        trace << i << " 2 N " << std::hex << i * 4 << " 0 " << i * 4 + 4;
+        if (i % 2) {
+            trace << " x" << std::dec << i % 31 + 1 << '=' << std::hex << i;
+        }
+        trace << std::dec << std::endl;
+    }
+    std::stringstream trace_copy(trace.str());
+    RISCV64ModelDUT reference;
+    reference.init_dut(trace, "reference");
+    RISCV64ModelDUT paged(std::make_unique<PagedTraceStore>(small_config()));
+    paged.init_dut(trace_copy, "paged");
+    while (reference.step_forward()) {
+        ASSERT_TRUE(paged.step_forward());
+        ASSERT_EQ(reference.read_pc(), paged.read_pc());
+        ASSERT_EQ(reference.get_all_regs(), paged.get_all_regs());
+    }
+    ASSERT_FALSE(paged.step_forward());
+    while (reference.step_back()) {
+        ASSERT_TRUE(paged.step_back());
+        ASSERT_EQ(reference.read_pc(), paged.read_pc());
+        ASSERT_EQ(reference.cur_time(), paged.cur_time());
+        ASSERT_EQ(reference.get_all_regs(), paged.get_all_regs());
+    }
+}
+
+TEST(PagedStoreTests, VisitBlocksCoversRange) {
+    PagedTraceStore store(small_config());
+    constexpr size_t count = 100;
+    for (size_t i = 0; i < count; ++i) {
+        store.append(make_entry(i));
+    }
+    // events past the last full chunk are still in the write buffer
+    size_t next = 5;
+    store.visit_blocks(5, 90, [&next](const TraceBlock& block) {
+        for (size_t i = block.begin; i < block.end; ++i) {
+            EXPECT_EQ(next, block.first_event + i);
+            check_entry(block.columns.get(i), next++);
+        }
+        return true;
+    });
+    ASSERT_EQ(90, next);
+    store.finish_loading();
+    size_t blocks = 0;
+    store.visit_blocks(0, count, [&blocks](const TraceBlock&) {
+        ++blocks;
+        return false;
+    });
+    ASSERT_EQ(1, blocks);
+}
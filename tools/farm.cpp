@@ -0,0 +1,67 @@
+#include "farm.hpp"
+#include "thread_pool.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+    // far above any useful pool, guards against typos like -1
+    constexpr size_t MAX_THREADS = 4096;
+}
+
+int main(int argc, char* argv[]) {
+    size_t thread_count = std::thread::hardware_concurrency();
+    bool bad_thread_count = false;
+    if (argc > 3) {
+        const std::string_view value = argv[3];
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), thread_count);
+        bad_thread_count = ec != std::errc() || ptr != value.data() + value.size() || thread_count == 0 ||
+            thread_count > MAX_THREADS;
+    }
+    if (argc < 3 || bad_thread_count) {
+        if (bad_thread_count) {
+            std::cerr << "Bad number of threads " << argv[3] << ", expected 1 to " << MAX_THREADS << '\n';
+        } else {
+            std::cerr << "Not enough arguments\n";
+        }
+        std::cerr << "Please provide manifest path and output file, optionally number of threads\n";
+        std::cerr << "Each manifest line is: <trace dir> <elf> <script>\n";
+        return 1;
+    }
+
+    std::vector<FarmJob> jobs;
+    try {
+        std::ifstream manifest(argv[1]);
+        if (!manifest) {
+            throw std::runtime_error(std::string("failed to open manifest ") + argv[1]);
+        }
+        jobs = read_manifest(manifest);
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 2;
+    }
+
+    std::ofstream output(argv[2]);
+    if (!output) {
+        std::cerr << "failed to open output " << argv[2] << std::endl;
+        return 2;
+    }
+
+    DebugInfoCache debug_info_cache;
+    ResultWriter writer(output);
+    {
+        ThreadPool pool(thread_count);
+        for (const auto& job : jobs) {
+            pool.submit([&job, &debug_info_cache, &writer] {
+                run_job(job, debug_info_cache, writer);
+            });
+        }
+        pool.wait_idle();
+    }
+    return 0;
+}